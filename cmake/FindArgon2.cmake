@@ -22,6 +22,8 @@ if (MINGW)
   execute_process(COMMAND objcopy
               --redefine-sym argon2_hash=libargon2_argon2_hash
               --redefine-sym _argon2_hash=_libargon2_argon2_hash
+              --redefine-sym argon2_ctx=libargon2_argon2_ctx
+              --redefine-sym _argon2_ctx=_libargon2_argon2_ctx
               --redefine-sym argon2_error_message=libargon2_argon2_error_message
               --redefine-sym _argon2_error_message=_libargon2_argon2_error_message
               ${ARGON2_SYS_LIBRARIES} ${CMAKE_BINARY_DIR}/libargon2_patched.a
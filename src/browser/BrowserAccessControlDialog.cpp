@@ -35,11 +35,11 @@ BrowserAccessControlDialog::~BrowserAccessControlDialog()
 {
 }
 
-void BrowserAccessControlDialog::setUrl(const QString& url)
+void BrowserAccessControlDialog::setHosts(const QStringList& hosts)
 {
     ui->label->setText(QString(tr("%1 has requested access to passwords for the following item(s).\n"
                                   "Please select whether you want to allow access."))
-                           .arg(QUrl(url).host()));
+                           .arg(hosts.join(", ")));
 }
 
 void BrowserAccessControlDialog::setItems(const QList<Entry*>& items)
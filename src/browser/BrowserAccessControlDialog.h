@@ -21,6 +21,7 @@
 
 #include <QDialog>
 #include <QScopedPointer>
+#include <QStringList>
 
 class Entry;
 
@@ -37,7 +38,7 @@ public:
     explicit BrowserAccessControlDialog(QWidget* parent = nullptr);
     ~BrowserAccessControlDialog();
 
-    void setUrl(const QString& url);
+    void setHosts(const QStringList& hosts);
     void setItems(const QList<Entry*>& items);
     bool remember() const;
     void setRemember(bool r);
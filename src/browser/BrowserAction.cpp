@@ -31,6 +31,12 @@ BrowserAction::BrowserAction(BrowserService& browserService)
     , m_browserService(browserService)
     , m_associated(false)
 {
+    connect(&m_browserService, SIGNAL(databaseLocked()), this, SLOT(clearSharedKey()));
+}
+
+BrowserAction::~BrowserAction()
+{
+    clearSharedKey();
 }
 
 QJsonObject BrowserAction::readResponse(const QJsonObject& json)
@@ -114,6 +120,8 @@ QJsonObject BrowserAction::handleChangePublicKeys(const QJsonObject& json, const
     m_clientPublicKey = clientPublicKey;
     m_publicKey = publicKey;
     m_secretKey = secretKey;
+    clearSharedKey();
+    sodium_memzero(sk, crypto_box_SECRETKEYBYTES);
 
     QJsonObject response = buildMessage(incrementNonce(nonce));
     response["action"] = action;
@@ -233,8 +241,17 @@ QJsonObject BrowserAction::handleGetLogins(const QJsonObject& json, const QStrin
         return getErrorReply(action, ERROR_KEEPASS_CANNOT_DECRYPT_MESSAGE);
     }
 
+    // a batch request carries a list of URLs instead of a single one
     const QString url = decrypted.value("url").toString();
-    if (url.isEmpty()) {
+    QStringList urls;
+    for (const QJsonValue val : decrypted.value("urls").toArray()) {
+        const QString batchUrl = val.toString();
+        if (!batchUrl.isEmpty() && !urls.contains(batchUrl)) {
+            urls.append(batchUrl);
+        }
+    }
+
+    if (url.isEmpty() && urls.isEmpty()) {
         return getErrorReply(action, ERROR_KEEPASS_NO_URL_PROVIDED);
     }
 
@@ -247,6 +264,23 @@ QJsonObject BrowserAction::handleGetLogins(const QJsonObject& json, const QStrin
     }
 
     const QString id = decrypted.value("id").toString();
+    if (url.isEmpty()) {
+        const QJsonObject results = m_browserService.findMatchingEntries(id, urls, keyList);
+        if (results.isEmpty()) {
+            return getErrorReply(action, ERROR_KEEPASS_NO_LOGINS_FOUND);
+        }
+
+        const QString newNonce = incrementNonce(nonce);
+
+        QJsonObject message = buildMessage(newNonce);
+        message["count"] = results.count();
+        message["results"] = results;
+        message["hash"] = hash;
+        message["id"] = id;
+
+        return buildResponse(action, message, newNonce);
+    }
+
     const QString submit = decrypted.value("submitUrl").toString();
     const QJsonArray users = m_browserService.findMatchingEntries(id, url, submit, "", keyList);
 
@@ -268,8 +302,7 @@ QJsonObject BrowserAction::handleGetLogins(const QJsonObject& json, const QStrin
 QJsonObject BrowserAction::handleGeneratePassword(const QJsonObject& json, const QString& action)
 {
     const QString nonce = json.value("nonce").toString();
-    const QString password = BrowserSettings::generatePassword();
-    const QString bits = QString::number(BrowserSettings::getbits()); // For some reason this always returns 1140 bits?
+    const QString password = BrowserSettings::generatePassword(m_browserService.requestSettings());
 
     if (nonce.isEmpty() || password.isEmpty()) {
         return QJsonObject();
@@ -472,22 +505,20 @@ QString BrowserAction::encrypt(const QString plaintext, const QString nonce)
     QMutexLocker locker(&m_mutex);
     const QByteArray ma = plaintext.toUtf8();
     const QByteArray na = base64Decode(nonce);
-    const QByteArray ca = base64Decode(m_clientPublicKey);
-    const QByteArray sa = base64Decode(m_secretKey);
 
     std::vector<unsigned char> m(ma.cbegin(), ma.cend());
     std::vector<unsigned char> n(na.cbegin(), na.cend());
-    std::vector<unsigned char> ck(ca.cbegin(), ca.cend());
-    std::vector<unsigned char> sk(sa.cbegin(), sa.cend());
 
     std::vector<unsigned char> e;
     e.resize(NATIVE_MSG_MAX_LENGTH);
 
-    if (m.empty() || n.empty() || ck.empty() || sk.empty()) {
+    QMutexLocker keyLocker(&m_keyMutex);
+    if (m.empty() || n.size() != crypto_box_NONCEBYTES || !computeSharedKey()) {
         return QString();
     }
 
-    if (crypto_box_easy(e.data(), m.data(), m.size(), n.data(), ck.data(), sk.data()) == 0) {
+    const auto* k = reinterpret_cast<const unsigned char*>(m_sharedKey.constData());
+    if (crypto_box_easy_afternm(e.data(), m.data(), m.size(), n.data(), k) == 0) {
         QByteArray res = getQByteArray(e.data(), (crypto_box_MACBYTES + ma.length()));
         return res.toBase64();
     }
@@ -500,28 +531,78 @@ QByteArray BrowserAction::decrypt(const QString encrypted, const QString nonce)
     QMutexLocker locker(&m_mutex);
     const QByteArray ma = base64Decode(encrypted);
     const QByteArray na = base64Decode(nonce);
-    const QByteArray ca = base64Decode(m_clientPublicKey);
-    const QByteArray sa = base64Decode(m_secretKey);
 
     std::vector<unsigned char> m(ma.cbegin(), ma.cend());
     std::vector<unsigned char> n(na.cbegin(), na.cend());
-    std::vector<unsigned char> ck(ca.cbegin(), ca.cend());
-    std::vector<unsigned char> sk(sa.cbegin(), sa.cend());
 
     std::vector<unsigned char> d;
     d.resize(NATIVE_MSG_MAX_LENGTH);
 
-    if (m.empty() || n.empty() || ck.empty() || sk.empty()) {
+    QMutexLocker keyLocker(&m_keyMutex);
+    if (m.empty() || n.size() != crypto_box_NONCEBYTES || !computeSharedKey()) {
         return QByteArray();
     }
 
-    if (crypto_box_open_easy(d.data(), m.data(), ma.length(), n.data(), ck.data(), sk.data()) == 0) {
+    const auto* k = reinterpret_cast<const unsigned char*>(m_sharedKey.constData());
+    if (crypto_box_open_easy_afternm(d.data(), m.data(), ma.length(), n.data(), k) == 0) {
         return getQByteArray(d.data(), std::char_traits<char>::length(reinterpret_cast<const char*>(d.data())));
     }
 
     return QByteArray();
 }
 
+/**
+ * Derive the key shared with the client once per session instead of on every message.
+ *
+ * The caller holds m_keyMutex.
+ */
+bool BrowserAction::computeSharedKey()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_sharedKey.isEmpty()) {
+        return true;
+    }
+
+    const QByteArray ca = base64Decode(m_clientPublicKey);
+    QByteArray sa = base64Decode(m_secretKey);
+    if (ca.size() != static_cast<int>(crypto_box_PUBLICKEYBYTES)
+        || sa.size() != static_cast<int>(crypto_box_SECRETKEYBYTES)) {
+        sodium_memzero(sa.data(), sa.size());
+        return false;
+    }
+
+    m_sharedKey.resize(crypto_box_BEFORENMBYTES);
+    const bool ok = crypto_box_beforenm(reinterpret_cast<unsigned char*>(m_sharedKey.data()),
+                                        reinterpret_cast<const unsigned char*>(ca.constData()),
+                                        reinterpret_cast<const unsigned char*>(sa.constData()))
+                    == 0;
+    sodium_memzero(sa.data(), sa.size());
+    if (!ok) {
+        wipeSharedKey();
+    }
+    return ok;
+}
+
+/**
+ * Forget the shared key, it is derived again for the next message.
+ *
+ * Only m_keyMutex is taken: the GUI thread calls this when a database gets
+ * locked while a worker may hold m_mutex and wait for the GUI thread.
+ */
+void BrowserAction::clearSharedKey()
+{
+    QMutexLocker locker(&m_keyMutex);
+    wipeSharedKey();
+}
+
+void BrowserAction::wipeSharedKey()
+{
+    if (!m_sharedKey.isEmpty()) {
+        sodium_memzero(m_sharedKey.data(), m_sharedKey.size());
+        m_sharedKey.clear();
+    }
+}
+
 QString BrowserAction::getBase64FromKey(const uchar* array, const uint len)
 {
     return getQByteArray(array, len).toBase64();
@@ -569,6 +650,7 @@ QString BrowserAction::incrementNonce(const QString& nonce)
 void BrowserAction::removeSharedEncryptionKeys()
 {
     QMutexLocker locker(&m_mutex);
+    clearSharedKey();
     m_browserService.removeSharedEncryptionKeys();
 }
 
@@ -50,7 +50,7 @@ class BrowserAction : public QObject
 
 public:
     BrowserAction(BrowserService& browserService);
-    ~BrowserAction() = default;
+    ~BrowserAction();
 
     QJsonObject readResponse(const QJsonObject& json);
 
@@ -58,6 +58,9 @@ public slots:
     void removeSharedEncryptionKeys();
     void removeStoredPermissions();
 
+private slots:
+    void clearSharedKey();
+
 private:
     QJsonObject handleAction(const QJsonObject& json);
     QJsonObject handleChangePublicKeys(const QJsonObject& json, const QString& action);
@@ -79,6 +82,8 @@ private:
     QJsonObject decryptMessage(const QString& message, const QString& nonce, const QString& action = QString());
     QString encrypt(const QString plaintext, const QString nonce);
     QByteArray decrypt(const QString encrypted, const QString nonce);
+    bool computeSharedKey();
+    void wipeSharedKey();
 
     QString getBase64FromKey(const uchar* array, const uint len);
     QByteArray getQByteArray(const uchar* array, const uint len) const;
@@ -89,10 +94,12 @@ private:
 
 private:
     QMutex m_mutex;
+    QMutex m_keyMutex;
     BrowserService& m_browserService;
     QString m_clientPublicKey;
     QString m_publicKey;
     QString m_secretKey;
+    QByteArray m_sharedKey;
     bool m_associated;
 };
 
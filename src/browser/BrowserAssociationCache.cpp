@@ -0,0 +1,108 @@
+/*
+*  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BrowserAssociationCache.h"
+
+#include "BrowserService.h"
+#include "core/Database.h"
+#include "core/Entry.h"
+#include "core/Group.h"
+
+BrowserAssociationCache::BrowserAssociationCache(Database* db)
+    : QObject(db)
+    , m_db(db)
+    , m_valid(false)
+{
+    connect(m_db, SIGNAL(modifiedImmediate()), SLOT(databaseModified()));
+}
+
+/**
+ * @return the cache of the database, created and owned by the database on first use
+ */
+BrowserAssociationCache* BrowserAssociationCache::forDatabase(Database* db)
+{
+    auto* cache = db->findChild<BrowserAssociationCache*>(QString(), Qt::FindDirectChildrenOnly);
+    if (!cache) {
+        cache = new BrowserAssociationCache(db);
+    }
+    return cache;
+}
+
+/**
+ * Look up the public key a client was associated with.
+ *
+ * The keys are read from the KeePassXC-Browser settings entry once and kept
+ * until that entry changes. A settings entry in the recycle bin has no keys.
+ *
+ * @return the public key, or an empty string if the database is not associated
+ */
+QString BrowserAssociationCache::key(const QString& id)
+{
+    if (!m_valid) {
+        rebuild();
+    }
+
+    if (!hasSettingsEntry() || m_entry->isRecycled()) {
+        return QString();
+    }
+
+    return m_keys.value(id);
+}
+
+void BrowserAssociationCache::invalidate()
+{
+    m_valid = false;
+}
+
+void BrowserAssociationCache::databaseModified()
+{
+    // once the settings entry is known only its own changes matter, until then any change may add it
+    if (!hasSettingsEntry()) {
+        m_valid = false;
+    }
+}
+
+void BrowserAssociationCache::rebuild()
+{
+    if (m_entry) {
+        m_entry->disconnect(this);
+    }
+
+    m_keys.clear();
+    m_valid = true;
+    m_entry = m_db->resolveEntry(BrowserService::KEEPASSXCBROWSER_UUID);
+    if (!m_entry) {
+        return;
+    }
+
+    connect(m_entry, SIGNAL(modified()), SLOT(invalidate()));
+    connect(m_entry, SIGNAL(destroyed()), SLOT(invalidate()));
+
+    const QString prefix = QLatin1String(BrowserService::ASSOCIATE_KEY_PREFIX);
+    const EntryAttributes* attributes = m_entry->attributes();
+    for (const QString& key : attributes->keys()) {
+        if (key.startsWith(prefix)) {
+            m_keys.insert(key.mid(prefix.length()), attributes->value(key));
+        }
+    }
+}
+
+bool BrowserAssociationCache::hasSettingsEntry() const
+{
+    // the entry may have been moved to another database since it was found
+    return m_entry && m_entry->group() && m_entry->group()->database() == m_db;
+}
@@ -0,0 +1,54 @@
+/*
+*  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BROWSERASSOCIATIONCACHE_H
+#define BROWSERASSOCIATIONCACHE_H
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+class Database;
+class Entry;
+
+class BrowserAssociationCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static BrowserAssociationCache* forDatabase(Database* db);
+
+    QString key(const QString& id);
+
+private slots:
+    void invalidate();
+    void databaseModified();
+
+private:
+    explicit BrowserAssociationCache(Database* db);
+
+    void rebuild();
+    bool hasSettingsEntry() const;
+
+    Database* const m_db;
+    QPointer<Entry> m_entry;
+    bool m_valid;
+    QHash<QString, QString> m_keys;
+};
+
+#endif // BROWSERASSOCIATIONCACHE_H
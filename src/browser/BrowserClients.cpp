@@ -71,6 +71,8 @@ BrowserClients::ClientPtr BrowserClients::getClient(const QString& clientID)
 
     // clientID not found, create a new client
     QSharedPointer<BrowserAction> ba = QSharedPointer<BrowserAction>::create(m_browserService);
+    // clients are created on request worker threads, which run no event loop
+    ba->moveToThread(m_browserService.thread());
     ClientPtr client = ClientPtr::create(clientID, ba);
     m_clients.push_back(client);
     return m_clients.back();
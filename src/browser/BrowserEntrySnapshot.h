@@ -0,0 +1,44 @@
+/*
+*  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BROWSERENTRYSNAPSHOT_H
+#define BROWSERENTRYSNAPSHOT_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QMetaType>
+#include <QPointer>
+#include <QString>
+
+class Entry;
+
+/**
+ * What a reply needs from an entry, copied on the GUI thread.
+ */
+struct BrowserEntrySnapshot
+{
+    QPointer<Entry> entry;
+    QString host;
+    QString url;
+    QString sortKey;
+    bool allowed;
+    QJsonObject json;
+};
+typedef QList<BrowserEntrySnapshot> BrowserEntrySnapshotList;
+Q_DECLARE_METATYPE(BrowserEntrySnapshot)
+
+#endif // BROWSERENTRYSNAPSHOT_H
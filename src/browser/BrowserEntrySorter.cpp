@@ -0,0 +1,129 @@
+/*
+*  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BrowserEntrySorter.h"
+
+#include <QUrl>
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * @param host host of the page the entries are requested for
+ * @param submitUrl URL the login form is submitted to, it is parsed once for all entries
+ */
+BrowserEntrySorter::BrowserEntrySorter(const QString& host, const QString& submitUrl)
+    : m_host(host)
+{
+    QUrl url(submitUrl);
+    if (url.scheme().isEmpty()) {
+        url.setScheme("http");
+    }
+
+    m_submitUrl = url.toString(QUrl::StripTrailingSlash);
+    m_baseSubmitUrl =
+        url.toString(QUrl::StripTrailingSlash | QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment);
+}
+
+/**
+ * Order entries by how well their URL matches, then by title or username.
+ *
+ * The priority and the collation key of every entry are computed once, the
+ * comparisons while sorting only compare these.
+ *
+ * @param bestMatchOnly keep only the entries with the highest priority
+ */
+BrowserEntrySnapshotList BrowserEntrySorter::sort(const BrowserEntrySnapshotList& entries, bool bestMatchOnly) const
+{
+    struct RankedEntry
+    {
+        int priority;
+        QCollatorSortKey sortKey;
+        const BrowserEntrySnapshot* snapshot;
+    };
+
+    std::vector<RankedEntry> ranked;
+    ranked.reserve(static_cast<size_t>(entries.size()));
+    for (const BrowserEntrySnapshot& snapshot : entries) {
+        ranked.push_back({priority(snapshot.url), m_collator.sortKey(snapshot.sortKey), &snapshot});
+    }
+
+    std::sort(ranked.begin(), ranked.end(), [](const RankedEntry& left, const RankedEntry& right) {
+        if (left.priority != right.priority) {
+            return left.priority > right.priority;
+        }
+        return left.sortKey.compare(right.sortKey) < 0;
+    });
+
+    BrowserEntrySnapshotList results;
+    results.reserve(entries.size());
+    for (const RankedEntry& entry : ranked) {
+        if (bestMatchOnly && entry.priority != ranked.front().priority) {
+            // Early out once we find the highest batch of matches
+            break;
+        }
+        results << *entry.snapshot;
+    }
+
+    return results;
+}
+
+int BrowserEntrySorter::priority(const QString& entryUrl) const
+{
+    QUrl url(entryUrl);
+    if (url.scheme().isEmpty()) {
+        url.setScheme("http");
+    }
+    const QString entryURL = url.toString(QUrl::StripTrailingSlash);
+    const QString baseEntryURL =
+        url.toString(QUrl::StripTrailingSlash | QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment);
+
+    if (m_submitUrl == entryURL) {
+        return 100;
+    }
+    if (m_submitUrl.startsWith(entryURL) && entryURL != m_host && m_baseSubmitUrl != entryURL) {
+        return 90;
+    }
+    if (m_submitUrl.startsWith(baseEntryURL) && entryURL != m_host && m_baseSubmitUrl != baseEntryURL) {
+        return 80;
+    }
+    if (entryURL == m_host) {
+        return 70;
+    }
+    if (entryURL == m_baseSubmitUrl) {
+        return 60;
+    }
+    if (entryURL.startsWith(m_submitUrl)) {
+        return 50;
+    }
+    if (entryURL.startsWith(m_baseSubmitUrl) && m_baseSubmitUrl != m_host) {
+        return 40;
+    }
+    if (m_submitUrl.startsWith(entryURL)) {
+        return 30;
+    }
+    if (m_submitUrl.startsWith(baseEntryURL)) {
+        return 20;
+    }
+    if (entryURL.startsWith(m_host)) {
+        return 10;
+    }
+    if (m_host.startsWith(entryURL)) {
+        return 5;
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+/*
+*  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BROWSERENTRYSORTER_H
+#define BROWSERENTRYSORTER_H
+
+#include "BrowserEntrySnapshot.h"
+#include <QCollator>
+#include <QString>
+
+class BrowserEntrySorter
+{
+public:
+    BrowserEntrySorter(const QString& host, const QString& submitUrl);
+
+    BrowserEntrySnapshotList sort(const BrowserEntrySnapshotList& entries, bool bestMatchOnly) const;
+    int priority(const QString& entryUrl) const;
+
+private:
+    const QString m_host;
+    QString m_submitUrl;
+    QString m_baseSubmitUrl;
+    QCollator m_collator;
+};
+
+#endif // BROWSERENTRYSORTER_H
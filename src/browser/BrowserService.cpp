@@ -27,16 +27,19 @@
 #include "BrowserAccessControlDialog.h"
 #include "BrowserEntryConfig.h"
 #include "BrowserSettings.h"
+#include "BrowserAssociationCache.h"
+#include "BrowserEntrySorter.h"
+#include "BrowserUrlIndex.h"
 #include "core/Database.h"
-#include "core/EntrySearcher.h"
 #include "core/Group.h"
 #include "core/Metadata.h"
 #include "core/PasswordGenerator.h"
 #include "gui/MainWindow.h"
 
-static const QUuid KEEPASSXCBROWSER_UUID = QUuid::fromRfc4122(QByteArray::fromHex("de887cc3036343b8974b5911b8816224"));
+const QUuid BrowserService::KEEPASSXCBROWSER_UUID =
+    QUuid::fromRfc4122(QByteArray::fromHex("de887cc3036343b8974b5911b8816224"));
+const char BrowserService::ASSOCIATE_KEY_PREFIX[] = "Public Key: ";
 static const char KEEPASSXCBROWSER_NAME[] = "KeePassXC-Browser Settings";
-static const char ASSOCIATE_KEY_PREFIX[] = "Public Key: ";
 static const char KEEPASSXCBROWSER_GROUP_NAME[] = "KeePassXC-Browser Passwords";
 static int KEEPASSXCBROWSER_DEFAULT_ICON = 1;
 
@@ -44,7 +47,11 @@ BrowserService::BrowserService(DatabaseTabWidget* parent)
     : m_dbTabWidget(parent)
     , m_dialogActive(false)
     , m_bringToFrontRequested(false)
+    , m_requestSettings(BrowserSettings::requestSettings())
 {
+    qRegisterMetaType<StringPairList>("StringPairList");
+    qRegisterMetaType<BrowserEntrySnapshotList>("BrowserEntrySnapshotList");
+
     connect(m_dbTabWidget, SIGNAL(databaseLocked(DatabaseWidget*)), this, SLOT(databaseLocked(DatabaseWidget*)));
     connect(m_dbTabWidget, SIGNAL(databaseUnlocked(DatabaseWidget*)), this, SLOT(databaseUnlocked(DatabaseWidget*)));
     connect(m_dbTabWidget,
@@ -53,8 +60,39 @@ BrowserService::BrowserService(DatabaseTabWidget* parent)
             SLOT(activateDatabaseChanged(DatabaseWidget*)));
 }
 
-bool BrowserService::isDatabaseOpened() const
+/**
+ * Copy the settings for the requests handled next on worker threads.
+ * Must be called on the GUI thread before a request is dispatched.
+ */
+void BrowserService::updateRequestSettings()
+{
+    Q_ASSERT(thread() == QThread::currentThread());
+    const BrowserRequestSettings settings = BrowserSettings::requestSettings();
+    QMutexLocker locker(&m_settingsMutex);
+    m_requestSettings = settings;
+}
+
+/**
+ * @return the current settings on the GUI thread, the last copy on worker threads
+ */
+BrowserRequestSettings BrowserService::requestSettings()
+{
+    if (thread() == QThread::currentThread()) {
+        return BrowserSettings::requestSettings();
+    }
+
+    QMutexLocker locker(&m_settingsMutex);
+    return m_requestSettings;
+}
+
+bool BrowserService::isDatabaseOpened()
 {
+    if (thread() != QThread::currentThread()) {
+        bool result = false;
+        QMetaObject::invokeMethod(this, "isDatabaseOpened", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, result));
+        return result;
+    }
+
     DatabaseWidget* dbWidget = m_dbTabWidget->currentDatabaseWidget();
     if (!dbWidget) {
         return false;
@@ -65,6 +103,13 @@ bool BrowserService::isDatabaseOpened() const
 
 bool BrowserService::openDatabase(bool triggerUnlock)
 {
+    if (thread() != QThread::currentThread()) {
+        bool result = false;
+        QMetaObject::invokeMethod(
+            this, "openDatabase", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, result), Q_ARG(bool, triggerUnlock));
+        return result;
+    }
+
     if (!BrowserSettings::unlockDatabase()) {
         return false;
     }
@@ -90,6 +135,7 @@ void BrowserService::lockDatabase()
 {
     if (thread() != QThread::currentThread()) {
         QMetaObject::invokeMethod(this, "lockDatabase", Qt::BlockingQueuedConnection);
+        return;
     }
 
     DatabaseWidget* dbWidget = m_dbTabWidget->currentDatabaseWidget();
@@ -104,6 +150,13 @@ void BrowserService::lockDatabase()
 
 QString BrowserService::getDatabaseRootUuid()
 {
+    if (thread() != QThread::currentThread()) {
+        QString result;
+        QMetaObject::invokeMethod(
+            this, "getDatabaseRootUuid", Qt::BlockingQueuedConnection, Q_RETURN_ARG(QString, result));
+        return result;
+    }
+
     Database* db = getDatabase();
     if (!db) {
         return QString();
@@ -119,6 +172,13 @@ QString BrowserService::getDatabaseRootUuid()
 
 QString BrowserService::getDatabaseRecycleBinUuid()
 {
+    if (thread() != QThread::currentThread()) {
+        QString result;
+        QMetaObject::invokeMethod(
+            this, "getDatabaseRecycleBinUuid", Qt::BlockingQueuedConnection, Q_RETURN_ARG(QString, result));
+        return result;
+    }
+
     Database* db = getDatabase();
     if (!db) {
         return QString();
@@ -149,7 +209,7 @@ Entry* BrowserService::getConfigEntry(bool create)
         return entry;
     }
 
-    if (entry && entry->group() == db->metadata()->recycleBin()) {
+    if (entry && entry->isRecycled()) {
         if (!create) {
             return nullptr;
         } else {
@@ -215,87 +275,198 @@ QString BrowserService::storeKey(const QString& key)
 
 QString BrowserService::getKey(const QString& id)
 {
-    Entry* config = getConfigEntry();
-    if (!config) {
+    if (thread() != QThread::currentThread()) {
+        QString result;
+        QMetaObject::invokeMethod(
+            this, "getKey", Qt::BlockingQueuedConnection, Q_RETURN_ARG(QString, result), Q_ARG(const QString&, id));
+        return result;
+    }
+
+    Database* db = getDatabase();
+    if (!db) {
         return QString();
     }
 
-    return config->attributes()->value(QLatin1String(ASSOCIATE_KEY_PREFIX) + id);
+    return BrowserAssociationCache::forDatabase(db)->key(id);
 }
 
+/**
+ * Find the entries a client may fill in for a URL.
+ *
+ * This is called from the request worker threads. Only copying the matching
+ * entries and asking the user for access run on the GUI thread, sorting and
+ * building the reply work on the copies.
+ */
 QJsonArray BrowserService::findMatchingEntries(const QString& id,
                                                const QString& url,
                                                const QString& submitUrl,
                                                const QString& realm,
                                                const StringPairList& keyList)
 {
-    QJsonArray result;
-    if (thread() != QThread::currentThread()) {
-        QMetaObject::invokeMethod(this,
-                                  "findMatchingEntries",
-                                  Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(QJsonArray, result),
-                                  Q_ARG(const QString&, id),
-                                  Q_ARG(const QString&, url),
-                                  Q_ARG(const QString&, submitUrl),
-                                  Q_ARG(const QString&, realm),
-                                  Q_ARG(const StringPairList&, keyList));
-        return result;
-    }
+    Q_UNUSED(id);
 
-    const bool alwaysAllowAccess = BrowserSettings::alwaysAllowAccess();
     const QString host = QUrl(url).host();
     const QString submitHost = QUrl(submitUrl).host();
 
     // Check entries for authorization
-    QList<Entry*> pwEntriesToConfirm;
-    QList<Entry*> pwEntries;
-    for (Entry* entry : searchEntries(url, keyList)) {
-        switch (checkAccess(entry, host, submitHost, realm)) {
-        case Denied:
-            continue;
+    BrowserEntrySnapshotList pwEntriesToConfirm;
+    BrowserEntrySnapshotList pwEntries;
+    for (const BrowserEntrySnapshot& snapshot : snapshotEntries(url, submitUrl, realm, keyList)) {
+        if (snapshot.allowed) {
+            pwEntries.append(snapshot);
+        } else {
+            pwEntriesToConfirm.append(snapshot);
+        }
+    }
 
-        case Unknown:
-            if (alwaysAllowAccess) {
-                pwEntries.append(entry);
+    // Confirm entries, leaving out the ones deleted while the dialog was open
+    if (confirmEntries(pwEntriesToConfirm, submitHost, realm)) {
+        for (const BrowserEntrySnapshot& snapshot : pwEntriesToConfirm) {
+            if (snapshot.entry) {
+                pwEntries.append(snapshot);
+            }
+        }
+    }
+
+    return sortEntries(pwEntries, host, submitUrl);
+}
+
+/**
+ * Find the entries for several URLs at once.
+ *
+ * The entries that need a confirmation are shown in a single dialog for all
+ * URLs. A batch request carries no submit URL, every URL stands in for its
+ * own one so the entries are ranked like for a single request.
+ *
+ * @return the sorted entries keyed by URL, URLs without entries are left out
+ */
+QJsonObject BrowserService::findMatchingEntries(const QString& id,
+                                                const QStringList& urls,
+                                                const StringPairList& keyList)
+{
+    Q_UNUSED(id);
+
+    QList<BrowserEntrySnapshotList> pwEntries;
+    BrowserEntrySnapshotList pwEntriesToConfirm;
+    QList<int> urlIndexes;
+    for (int i = 0; i < urls.size(); ++i) {
+        pwEntries.append(BrowserEntrySnapshotList());
+        for (const BrowserEntrySnapshot& snapshot : snapshotEntries(urls[i], urls[i], QString(), keyList)) {
+            if (snapshot.allowed) {
+                pwEntries[i].append(snapshot);
             } else {
-                pwEntriesToConfirm.append(entry);
+                pwEntriesToConfirm.append(snapshot);
+                urlIndexes.append(i);
             }
-            break;
+        }
+    }
 
-        case Allowed:
-            pwEntries.append(entry);
-            break;
+    // Confirm entries, leaving out the ones deleted while the dialog was open
+    if (confirmEntries(pwEntriesToConfirm, QString(), QString())) {
+        for (int i = 0; i < pwEntriesToConfirm.size(); ++i) {
+            if (pwEntriesToConfirm[i].entry) {
+                pwEntries[urlIndexes[i]].append(pwEntriesToConfirm[i]);
+            }
         }
     }
 
-    // Confirm entries
-    if (confirmEntries(pwEntriesToConfirm, url, host, submitHost, realm)) {
-        pwEntries.append(pwEntriesToConfirm);
+    QJsonObject result;
+    for (int i = 0; i < urls.size(); ++i) {
+        const QJsonArray entries = sortEntries(pwEntries[i], QUrl(urls[i]).host(), urls[i]);
+        if (!entries.isEmpty()) {
+            result[urls[i]] = entries;
+        }
     }
 
+    return result;
+}
+
+QJsonArray BrowserService::sortEntries(const BrowserEntrySnapshotList& pwEntries,
+                                       const QString& host,
+                                       const QString& submitUrl)
+{
+    QJsonArray result;
     if (pwEntries.isEmpty()) {
-        return QJsonArray();
+        return result;
     }
 
-    // Sort results
-    pwEntries = sortEntries(pwEntries, host, submitUrl);
-
-    // Fill the list
-    for (Entry* entry : pwEntries) {
-        result << prepareEntry(entry);
+    const BrowserEntrySorter sorter(host, submitUrl);
+    for (const BrowserEntrySnapshot& snapshot : sorter.sort(pwEntries, requestSettings().bestMatchOnly)) {
+        result << snapshot.json;
     }
 
     return result;
 }
 
-void BrowserService::addEntry(const QString&,
+/**
+ * Copy everything a reply needs from the entries matching the URL, skipping
+ * the entries that deny access.
+ *
+ * The copies stay valid when the database changes or gets locked while the
+ * request is still being handled.
+ */
+BrowserEntrySnapshotList BrowserService::snapshotEntries(const QString& url,
+                                                         const QString& submitUrl,
+                                                         const QString& realm,
+                                                         const StringPairList& keyList)
+{
+    BrowserEntrySnapshotList snapshots;
+    if (thread() != QThread::currentThread()) {
+        QMetaObject::invokeMethod(this,
+                                  "snapshotEntries",
+                                  Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(BrowserEntrySnapshotList, snapshots),
+                                  Q_ARG(const QString&, url),
+                                  Q_ARG(const QString&, submitUrl),
+                                  Q_ARG(const QString&, realm),
+                                  Q_ARG(const StringPairList&, keyList));
+        return snapshots;
+    }
+
+    const bool alwaysAllowAccess = BrowserSettings::alwaysAllowAccess();
+    const QString host = QUrl(url).host();
+    const QString submitHost = QUrl(submitUrl).host();
+    const QString sortField = BrowserSettings::sortByTitle() ? "Title" : "UserName";
+
+    for (Entry* entry : searchEntries(url, keyList)) {
+        const Access access = checkAccess(entry, host, submitHost, realm);
+        if (access == Denied) {
+            continue;
+        }
+
+        BrowserEntrySnapshot snapshot;
+        snapshot.entry = entry;
+        snapshot.host = host;
+        snapshot.url = entry->url();
+        snapshot.sortKey = entry->attributes()->value(sortField);
+        snapshot.allowed = access == Allowed || alwaysAllowAccess;
+        snapshot.json = prepareEntry(entry);
+        snapshots << snapshot;
+    }
+
+    return snapshots;
+}
+
+void BrowserService::addEntry(const QString& id,
                               const QString& login,
                               const QString& password,
                               const QString& url,
                               const QString& submitUrl,
                               const QString& realm)
 {
+    if (thread() != QThread::currentThread()) {
+        QMetaObject::invokeMethod(this,
+                                  "addEntry",
+                                  Qt::BlockingQueuedConnection,
+                                  Q_ARG(const QString&, id),
+                                  Q_ARG(const QString&, login),
+                                  Q_ARG(const QString&, password),
+                                  Q_ARG(const QString&, url),
+                                  Q_ARG(const QString&, submitUrl),
+                                  Q_ARG(const QString&, realm));
+        return;
+    }
+
     Group* group = findCreateAddEntryGroup();
     if (!group) {
         return;
@@ -339,6 +510,7 @@ void BrowserService::updateEntry(const QString& id,
                                   Q_ARG(const QString&, login),
                                   Q_ARG(const QString&, password),
                                   Q_ARG(const QString&, url));
+        return;
     }
 
     Database* db = getDatabase();
@@ -382,25 +554,11 @@ void BrowserService::updateEntry(const QString& id,
 
 QList<Entry*> BrowserService::searchEntries(Database* db, const QString& hostname)
 {
-    QList<Entry*> entries;
-    Group* rootGroup = db->rootGroup();
-    if (!rootGroup) {
-        return entries;
-    }
-
-    for (Entry* entry : EntrySearcher().search(hostname, rootGroup, Qt::CaseInsensitive)) {
-        QString title = entry->title();
-        QString url = entry->url();
-
-        // Filter to match hostname in Title and Url fields
-        if ((!title.isEmpty() && hostname.contains(title)) || (!url.isEmpty() && hostname.contains(url))
-            || (matchUrlScheme(title) && hostname.endsWith(QUrl(title).host()))
-            || (matchUrlScheme(url) && hostname.endsWith(QUrl(url).host()))) {
-            entries.append(entry);
-        }
+    if (!db->rootGroup()) {
+        return QList<Entry*>();
     }
 
-    return entries;
+    return BrowserUrlIndex::forDatabase(db)->entries(hostname);
 }
 
 QList<Entry*> BrowserService::searchEntries(const QString& text, const StringPairList& keyList)
@@ -412,14 +570,13 @@ QList<Entry*> BrowserService::searchEntries(const QString& text, const StringPai
         for (int i = 0; i < count; ++i) {
             if (DatabaseWidget* dbWidget = qobject_cast<DatabaseWidget*>(m_dbTabWidget->widget(i))) {
                 if (Database* db = dbWidget->database()) {
-                     // Check if database is connected with KeePassXC-Browser
-                    for (const StringPair keyPair : keyList) {
-                        Entry* entry = db->resolveEntry(KEEPASSXCBROWSER_UUID);
-                        if (entry) {
-                            QString key = entry->attributes()->value(QLatin1String(ASSOCIATE_KEY_PREFIX) + keyPair.first);
-                            if (!key.isEmpty() && keyPair.second == key) {
-                                databases << db;
-                            }
+                    // Check if database is connected with KeePassXC-Browser
+                    BrowserAssociationCache* associations = BrowserAssociationCache::forDatabase(db);
+                    for (const StringPair& keyPair : keyList) {
+                        const QString key = associations->key(keyPair.first);
+                        if (!key.isEmpty() && keyPair.second == key) {
+                            databases << db;
+                            break;
                         }
                     }
                 }
@@ -539,61 +696,64 @@ void BrowserService::removeStoredPermissions()
     }
 }
 
-QList<Entry*> BrowserService::sortEntries(QList<Entry*>& pwEntries, const QString& host, const QString& entryUrl)
+/**
+ * Ask the user for access to the entries, each for the host it was requested for.
+ *
+ * @return true if the user allowed access to all of them
+ */
+bool BrowserService::confirmEntries(const BrowserEntrySnapshotList& pwEntriesToConfirm,
+                                    const QString& submitHost,
+                                    const QString& realm)
 {
-    QUrl url(entryUrl);
-    if (url.scheme().isEmpty()) {
-        url.setScheme("http");
-    }
-
-    const QString submitUrl = url.toString(QUrl::StripTrailingSlash);
-    const QString baseSubmitUrl =
-        url.toString(QUrl::StripTrailingSlash | QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment);
-
-    // Build map of prioritized entries
-    QMultiMap<int, Entry*> priorities;
-    for (Entry* entry : pwEntries) {
-        priorities.insert(sortPriority(entry, host, submitUrl, baseSubmitUrl), entry);
-    }
-
-    QList<Entry*> results;
-    QString field = BrowserSettings::sortByTitle() ? "Title" : "UserName";
-    for (int i = 100; i >= 0; i -= 5) {
-        if (priorities.count(i) > 0) {
-            // Sort same priority entries by Title or UserName
-            auto entries = priorities.values(i);
-            std::sort(entries.begin(), entries.end(), [&priorities, &field](Entry* left, Entry* right) {
-                return QString::localeAwareCompare(left->attributes()->value(field), right->attributes()->value(field)) < 0;
-            });
-            results << entries;
-            if (BrowserSettings::bestMatchOnly() && !pwEntries.isEmpty()) {
-                // Early out once we find the highest batch of matches
-                break;
-            }
-        }
+    if (pwEntriesToConfirm.isEmpty()) {
+        return false;
     }
 
-    return results;
-}
+    if (thread() != QThread::currentThread()) {
+        bool result = false;
+        QMetaObject::invokeMethod(this,
+                                  "confirmEntries",
+                                  Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, result),
+                                  Q_ARG(const BrowserEntrySnapshotList&, pwEntriesToConfirm),
+                                  Q_ARG(const QString&, submitHost),
+                                  Q_ARG(const QString&, realm));
+        return result;
+    }
 
-bool BrowserService::confirmEntries(QList<Entry*>& pwEntriesToConfirm,
-                                    const QString& url,
-                                    const QString& host,
-                                    const QString& submitHost,
-                                    const QString& realm)
-{
-    if (pwEntriesToConfirm.isEmpty() || m_dialogActive) {
+    // entries removed since the snapshot was taken are not shown
+    QList<Entry*> entries;
+    QStringList hosts;
+    for (const BrowserEntrySnapshot& snapshot : pwEntriesToConfirm) {
+        if (!snapshot.entry) {
+            continue;
+        }
+        if (!entries.contains(snapshot.entry)) {
+            entries.append(snapshot.entry);
+        }
+        if (!hosts.contains(snapshot.host)) {
+            hosts.append(snapshot.host);
+        }
+    }
+
+    if (entries.isEmpty() || m_dialogActive) {
         return false;
     }
 
     m_dialogActive = true;
     BrowserAccessControlDialog accessControlDialog;
-    accessControlDialog.setUrl(url);
-    accessControlDialog.setItems(pwEntriesToConfirm);
+    accessControlDialog.setHosts(hosts);
+    accessControlDialog.setItems(entries);
 
     int res = accessControlDialog.exec();
     if (accessControlDialog.remember()) {
-        for (Entry* entry : pwEntriesToConfirm) {
+        for (const BrowserEntrySnapshot& snapshot : pwEntriesToConfirm) {
+            Entry* entry = snapshot.entry;
+            if (!entry) {
+                continue;
+            }
+
+            const QString& host = snapshot.host;
             BrowserEntryConfig config;
             config.load(entry);
             if (res == QDialog::Accepted) {
@@ -696,61 +856,6 @@ Group* BrowserService::findCreateAddEntryGroup()
     return group;
 }
 
-int BrowserService::sortPriority(const Entry* entry,
-                                 const QString& host,
-                                 const QString& submitUrl,
-                                 const QString& baseSubmitUrl) const
-{
-    QUrl url(entry->url());
-    if (url.scheme().isEmpty()) {
-        url.setScheme("http");
-    }
-    const QString entryURL = url.toString(QUrl::StripTrailingSlash);
-    const QString baseEntryURL =
-        url.toString(QUrl::StripTrailingSlash | QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment);
-
-    if (submitUrl == entryURL) {
-        return 100;
-    }
-    if (submitUrl.startsWith(entryURL) && entryURL != host && baseSubmitUrl != entryURL) {
-        return 90;
-    }
-    if (submitUrl.startsWith(baseEntryURL) && entryURL != host && baseSubmitUrl != baseEntryURL) {
-        return 80;
-    }
-    if (entryURL == host) {
-        return 70;
-    }
-    if (entryURL == baseSubmitUrl) {
-        return 60;
-    }
-    if (entryURL.startsWith(submitUrl)) {
-        return 50;
-    }
-    if (entryURL.startsWith(baseSubmitUrl) && baseSubmitUrl != host) {
-        return 40;
-    }
-    if (submitUrl.startsWith(entryURL)) {
-        return 30;
-    }
-    if (submitUrl.startsWith(baseEntryURL)) {
-        return 20;
-    }
-    if (entryURL.startsWith(host)) {
-        return 10;
-    }
-    if (host.startsWith(entryURL)) {
-        return 5;
-    }
-    return 0;
-}
-
-bool BrowserService::matchUrlScheme(const QString& url)
-{
-    QUrl address(url);
-    return !address.scheme().isEmpty();
-}
-
 bool BrowserService::removeFirstDomain(QString& hostname)
 {
     int pos = hostname.indexOf(".");
@@ -20,6 +20,8 @@
 #ifndef BROWSERSERVICE_H
 #define BROWSERSERVICE_H
 
+#include "BrowserEntrySnapshot.h"
+#include "BrowserSettings.h"
 #include "core/Entry.h"
 #include "gui/DatabaseTabWidget.h"
 #include <QObject>
@@ -38,32 +40,38 @@ class BrowserService : public QObject
     Q_OBJECT
 
 public:
+    static const QUuid KEEPASSXCBROWSER_UUID;
+    static const char ASSOCIATE_KEY_PREFIX[];
+
     explicit BrowserService(DatabaseTabWidget* parent);
 
-    bool isDatabaseOpened() const;
+    Entry* getConfigEntry(bool create = false);
+    QJsonArray findMatchingEntries(const QString& id,
+                                   const QString& url,
+                                   const QString& submitUrl,
+                                   const QString& realm,
+                                   const StringPairList& keyList);
+    QJsonObject findMatchingEntries(const QString& id, const QStringList& urls, const StringPairList& keyList);
+    QList<Entry*> searchEntries(Database* db, const QString& hostname);
+    QList<Entry*> searchEntries(const QString& text, const StringPairList& keyList);
+    void removeSharedEncryptionKeys();
+    void removeStoredPermissions();
+    void updateRequestSettings();
+    BrowserRequestSettings requestSettings();
+
+public slots:
+    bool isDatabaseOpened();
     bool openDatabase(bool triggerUnlock);
     QString getDatabaseRootUuid();
     QString getDatabaseRecycleBinUuid();
-    Entry* getConfigEntry(bool create = false);
     QString getKey(const QString& id);
+    QString storeKey(const QString& key);
     void addEntry(const QString& id,
                   const QString& login,
                   const QString& password,
                   const QString& url,
                   const QString& submitUrl,
                   const QString& realm);
-    QList<Entry*> searchEntries(Database* db, const QString& hostname);
-    QList<Entry*> searchEntries(const QString& text, const StringPairList& keyList);
-    void removeSharedEncryptionKeys();
-    void removeStoredPermissions();
-
-public slots:
-    QJsonArray findMatchingEntries(const QString& id,
-                                   const QString& url,
-                                   const QString& submitUrl,
-                                   const QString& realm,
-                                   const StringPairList& keyList);
-    QString storeKey(const QString& key);
     void updateEntry(const QString& id,
                      const QString& uuid,
                      const QString& login,
@@ -87,19 +95,20 @@ private:
         Allowed
     };
 
-private:
-    QList<Entry*> sortEntries(QList<Entry*>& pwEntries, const QString& host, const QString& submitUrl);
-    bool confirmEntries(QList<Entry*>& pwEntriesToConfirm,
-                        const QString& url,
-                        const QString& host,
+private slots:
+    BrowserEntrySnapshotList snapshotEntries(const QString& url,
+                                             const QString& submitUrl,
+                                             const QString& realm,
+                                             const StringPairList& keyList);
+    bool confirmEntries(const BrowserEntrySnapshotList& pwEntriesToConfirm,
                         const QString& submitHost,
                         const QString& realm);
+
+private:
+    QJsonArray sortEntries(const BrowserEntrySnapshotList& pwEntries, const QString& host, const QString& submitUrl);
     QJsonObject prepareEntry(const Entry* entry);
     Access checkAccess(const Entry* entry, const QString& host, const QString& submitHost, const QString& realm);
     Group* findCreateAddEntryGroup();
-    int
-    sortPriority(const Entry* entry, const QString& host, const QString& submitUrl, const QString& baseSubmitUrl) const;
-    bool matchUrlScheme(const QString& url);
     bool removeFirstDomain(QString& hostname);
     Database* getDatabase();
 
@@ -107,6 +116,8 @@ private:
     DatabaseTabWidget* const m_dbTabWidget;
     bool m_dialogActive;
     bool m_bringToFrontRequested;
+    QMutex m_settingsMutex;
+    BrowserRequestSettings m_requestSettings;
 };
 
 #endif // BROWSERSERVICE_H
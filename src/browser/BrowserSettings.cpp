@@ -20,8 +20,6 @@
 #include "BrowserSettings.h"
 #include "core/Config.h"
 
-PasswordGenerator BrowserSettings::m_passwordGenerator;
-PassphraseGenerator BrowserSettings::m_passPhraseGenerator;
 HostInstaller BrowserSettings::m_hostInstaller;
 
 bool BrowserSettings::isEnabled()
@@ -409,7 +407,6 @@ int BrowserSettings::passwordLength()
 void BrowserSettings::setPasswordLength(int length)
 {
     config()->set("generator/Length", length);
-    m_passwordGenerator.setLength(length);
 }
 
 PasswordGenerator::CharClasses BrowserSettings::passwordCharClasses()
@@ -463,26 +460,42 @@ PasswordGenerator::GeneratorFlags BrowserSettings::passwordGeneratorFlags()
     return flags;
 }
 
-QString BrowserSettings::generatePassword()
-{
-    if (generatorType() == 0) {
-        m_passwordGenerator.setLength(passwordLength());
-        m_passwordGenerator.setCharClasses(passwordCharClasses());
-        m_passwordGenerator.setFlags(passwordGeneratorFlags());
-        return m_passwordGenerator.generatePassword();
+/**
+ * Read the settings a browser request needs, this uses config() and must run on the GUI thread.
+ */
+BrowserRequestSettings BrowserSettings::requestSettings()
+{
+    BrowserRequestSettings settings;
+    settings.bestMatchOnly = bestMatchOnly();
+    settings.generatorType = generatorType();
+    settings.passwordLength = passwordLength();
+    settings.passwordCharClasses = passwordCharClasses();
+    settings.passwordGeneratorFlags = passwordGeneratorFlags();
+    settings.passPhraseWordCount = passPhraseWordCount();
+    settings.passPhraseWordSeparator = passPhraseWordSeparator();
+    return settings;
+}
+
+/**
+ * Generate a password without reading config(), so it can be called on any thread.
+ */
+QString BrowserSettings::generatePassword(const BrowserRequestSettings& settings)
+{
+    if (settings.generatorType == 0) {
+        PasswordGenerator passwordGenerator;
+        passwordGenerator.setLength(settings.passwordLength);
+        passwordGenerator.setCharClasses(settings.passwordCharClasses);
+        passwordGenerator.setFlags(settings.passwordGeneratorFlags);
+        return passwordGenerator.generatePassword();
     } else {
-        m_passPhraseGenerator.setDefaultWordList();
-        m_passPhraseGenerator.setWordCount(passPhraseWordCount());
-        m_passPhraseGenerator.setWordSeparator(passPhraseWordSeparator());
-        return m_passPhraseGenerator.generatePassphrase();
+        PassphraseGenerator passPhraseGenerator;
+        passPhraseGenerator.setDefaultWordList();
+        passPhraseGenerator.setWordCount(settings.passPhraseWordCount);
+        passPhraseGenerator.setWordSeparator(settings.passPhraseWordSeparator);
+        return passPhraseGenerator.generatePassphrase();
     }
 }
 
-int BrowserSettings::getbits()
-{
-    return m_passwordGenerator.getbits();
-}
-
 void BrowserSettings::updateBinaryPaths(QString customProxyLocation)
 {
     bool isProxy = supportBrowserProxy();
@@ -24,6 +24,21 @@
 #include "core/PassphraseGenerator.h"
 #include "core/PasswordGenerator.h"
 
+/**
+ * The settings used while handling a browser request, copied on the GUI thread
+ * so the request can be handled on a worker thread.
+ */
+struct BrowserRequestSettings
+{
+    bool bestMatchOnly = false;
+    int generatorType = 0;
+    int passwordLength = 0;
+    PasswordGenerator::CharClasses passwordCharClasses;
+    PasswordGenerator::GeneratorFlags passwordGeneratorFlags;
+    int passPhraseWordCount = 0;
+    QString passPhraseWordSeparator;
+};
+
 class BrowserSettings
 {
 public:
@@ -108,13 +123,11 @@ public:
     static void setPasswordLength(int length);
     static PasswordGenerator::CharClasses passwordCharClasses();
     static PasswordGenerator::GeneratorFlags passwordGeneratorFlags();
-    static QString generatePassword();
-    static int getbits();
+    static BrowserRequestSettings requestSettings();
+    static QString generatePassword(const BrowserRequestSettings& settings);
     static void updateBinaryPaths(QString customProxyLocation = QString());
 
 private:
-    static PasswordGenerator m_passwordGenerator;
-    static PassphraseGenerator m_passPhraseGenerator;
     static HostInstaller m_hostInstaller;
 };
 
@@ -0,0 +1,221 @@
+/*
+*  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BrowserUrlIndex.h"
+
+#include <QUrl>
+
+#include "core/Database.h"
+#include "core/Entry.h"
+#include "core/Global.h"
+#include "core/Group.h"
+
+BrowserUrlIndex::BrowserUrlIndex(Database* db)
+    : QObject(db)
+    , m_db(db)
+    , m_valid(false)
+{
+    // entries moved between groups are handled per group, new and removed groups rebuild the index
+    connect(m_db, SIGNAL(groupAdded()), SLOT(invalidate()));
+    connect(m_db, SIGNAL(groupAboutToRemove(Group*)), SLOT(invalidate()));
+}
+
+/**
+ * @return the index of the database, created and owned by the database on first use
+ */
+BrowserUrlIndex* BrowserUrlIndex::forDatabase(Database* db)
+{
+    auto* index = db->findChild<BrowserUrlIndex*>(QString(), Qt::FindDirectChildrenOnly);
+    if (!index) {
+        index = new BrowserUrlIndex(db);
+    }
+    return index;
+}
+
+/**
+ * Look up the entries whose title or URL refers to the hostname.
+ *
+ * An entry matches if its title or URL is the hostname itself, or a URL with
+ * exactly this host. Entries in groups excluded from searching are skipped.
+ */
+QList<Entry*> BrowserUrlIndex::entries(const QString& hostname)
+{
+    if (!m_valid || m_rootGroup != m_db->rootGroup()) {
+        rebuild();
+    }
+
+    QList<Entry*> result;
+    const QString key = hostname.toLower();
+    if (key.isEmpty()) {
+        return result;
+    }
+
+    for (auto it = m_entriesByHost.constFind(key); it != m_entriesByHost.constEnd() && it.key() == key; ++it) {
+        if (isSearchable(it.value())) {
+            result.append(it.value());
+        }
+    }
+
+    // placeholders can refer to other entries, so they are resolved on every lookup
+    for (Entry* entry : asConst(m_dynamicEntries)) {
+        const QStringList keys =
+            hostKeys(entry->resolvePlaceholder(entry->title()), entry->resolvePlaceholder(entry->url()));
+        if (keys.contains(key) && isSearchable(entry)) {
+            result.append(entry);
+        }
+    }
+
+    return result;
+}
+
+void BrowserUrlIndex::invalidate()
+{
+    m_valid = false;
+}
+
+void BrowserUrlIndex::rebuild()
+{
+    for (const QPointer<Group>& group : asConst(m_groups)) {
+        if (group) {
+            group->disconnect(this);
+        }
+    }
+    for (Entry* entry : m_hostsByEntry.keys()) {
+        entry->disconnect(this);
+    }
+
+    m_groups.clear();
+    m_entriesByHost.clear();
+    m_hostsByEntry.clear();
+    m_dynamicEntries.clear();
+
+    m_valid = true;
+    m_rootGroup = m_db->rootGroup();
+    if (m_rootGroup) {
+        indexGroup(m_rootGroup);
+    }
+}
+
+void BrowserUrlIndex::indexGroup(Group* group)
+{
+    m_groups.append(group);
+    connect(group, SIGNAL(entryAdded(Entry*)), SLOT(indexEntry(Entry*)));
+    connect(group, SIGNAL(entryDataChanged(Entry*)), SLOT(indexEntry(Entry*)));
+    connect(group, SIGNAL(entryAboutToRemove(Entry*)), SLOT(unindexEntry(Entry*)));
+
+    for (Entry* entry : group->entries()) {
+        indexEntry(entry);
+    }
+    for (Group* child : group->children()) {
+        indexGroup(child);
+    }
+}
+
+/**
+ * Add an entry to the index, or update it after its title or URL changed.
+ */
+void BrowserUrlIndex::indexEntry(Entry* entry)
+{
+    if (!m_valid) {
+        return;
+    }
+
+    if (!m_hostsByEntry.contains(entry)) {
+        connect(entry, SIGNAL(destroyed(QObject*)), SLOT(entryDestroyed(QObject*)));
+    }
+    removeKeys(entry);
+
+    if (hasPlaceholder(entry)) {
+        m_dynamicEntries.insert(entry);
+        m_hostsByEntry.insert(entry, QStringList());
+        return;
+    }
+
+    const QStringList keys = hostKeys(entry->title(), entry->url());
+    for (const QString& key : keys) {
+        m_entriesByHost.insert(key, entry);
+    }
+    m_hostsByEntry.insert(entry, keys);
+}
+
+void BrowserUrlIndex::unindexEntry(Entry* entry)
+{
+    if (!m_valid) {
+        return;
+    }
+
+    entry->disconnect(this);
+    removeKeys(entry);
+    m_hostsByEntry.remove(entry);
+}
+
+void BrowserUrlIndex::entryDestroyed(QObject* object)
+{
+    // only the address is used, the entry is already gone
+    auto* entry = static_cast<Entry*>(object);
+    removeKeys(entry);
+    m_hostsByEntry.remove(entry);
+}
+
+void BrowserUrlIndex::removeKeys(Entry* entry)
+{
+    for (const QString& key : m_hostsByEntry.value(entry)) {
+        m_entriesByHost.remove(key, entry);
+    }
+    m_dynamicEntries.remove(entry);
+}
+
+bool BrowserUrlIndex::isSearchable(const Entry* entry) const
+{
+    // same rules as EntrySearcher: a disabled group hides its whole subtree
+    const Group* group = entry->group();
+    while (group && group != m_rootGroup) {
+        if (group->searchingEnabled() == Group::Disable) {
+            return false;
+        }
+        group = group->parentGroup();
+    }
+    return group && group->resolveSearchingEnabled();
+}
+
+/**
+ * @return normalized hostnames a title and URL refer to
+ */
+QStringList BrowserUrlIndex::hostKeys(const QString& title, const QString& url)
+{
+    QStringList keys;
+    for (const QString& field : {title, url}) {
+        if (field.isEmpty()) {
+            continue;
+        }
+
+        QString key = field.toLower();
+        const QUrl address(field);
+        if (!address.scheme().isEmpty() && !address.host().isEmpty()) {
+            key = address.host();
+        }
+        if (!keys.contains(key)) {
+            keys.append(key);
+        }
+    }
+    return keys;
+}
+
+bool BrowserUrlIndex::hasPlaceholder(const Entry* entry)
+{
+    return entry->title().contains('{') || entry->url().contains('{');
+}
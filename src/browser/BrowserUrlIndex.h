@@ -0,0 +1,67 @@
+/*
+*  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BROWSERURLINDEX_H
+#define BROWSERURLINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QStringList>
+
+class Database;
+class Entry;
+class Group;
+
+class BrowserUrlIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    static BrowserUrlIndex* forDatabase(Database* db);
+
+    QList<Entry*> entries(const QString& hostname);
+
+private slots:
+    void invalidate();
+    void indexEntry(Entry* entry);
+    void unindexEntry(Entry* entry);
+    void entryDestroyed(QObject* object);
+
+private:
+    explicit BrowserUrlIndex(Database* db);
+
+    void rebuild();
+    void indexGroup(Group* group);
+    void removeKeys(Entry* entry);
+    bool isSearchable(const Entry* entry) const;
+
+    static QStringList hostKeys(const QString& title, const QString& url);
+    static bool hasPlaceholder(const Entry* entry);
+
+    Database* const m_db;
+    QPointer<Group> m_rootGroup;
+    QList<QPointer<Group>> m_groups;
+    bool m_valid;
+    QMultiHash<QString, Entry*> m_entriesByHost;
+    QHash<Entry*, QStringList> m_hostsByEntry;
+    QSet<Entry*> m_dynamicEntries;
+};
+
+#endif // BROWSERURLINDEX_H
@@ -0,0 +1,124 @@
+/*
+*  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LocalMessageSplitter.h"
+
+/**
+ * @param maxLength longest message accepted, 0 for no limit
+ */
+LocalMessageSplitter::LocalMessageSplitter(int maxLength)
+    : m_maxLength(maxLength)
+    , m_start(0)
+    , m_scanned(0)
+    , m_depth(0)
+    , m_inString(false)
+    , m_escaped(false)
+    , m_error(false)
+{
+}
+
+void LocalMessageSplitter::append(const QByteArray& data)
+{
+    if (!m_error) {
+        m_buffer.append(data);
+    }
+}
+
+/**
+ * Take the next complete message. The data is only scanned once, no matter
+ * in how many pieces a message arrives.
+ *
+ * @return false if no complete message is buffered or the stream is corrupt
+ */
+bool LocalMessageSplitter::takeMessage(QByteArray& message)
+{
+    if (m_error) {
+        return false;
+    }
+
+    for (; m_scanned < m_buffer.size(); ++m_scanned) {
+        const char c = m_buffer.at(m_scanned);
+
+        if (m_depth == 0) {
+            // whitespace may separate the messages
+            if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+                m_start = m_scanned + 1;
+                continue;
+            }
+            if (c != '{' && c != '[') {
+                m_error = true;
+                return false;
+            }
+        }
+
+        if (m_inString) {
+            if (m_escaped) {
+                m_escaped = false;
+            } else if (c == '\\') {
+                m_escaped = true;
+            } else if (c == '"') {
+                m_inString = false;
+            }
+            continue;
+        }
+
+        if (c == '"') {
+            m_inString = true;
+        } else if (c == '{' || c == '[') {
+            ++m_depth;
+        } else if ((c == '}' || c == ']') && --m_depth == 0) {
+            message = m_buffer.mid(m_start, m_scanned + 1 - m_start);
+            m_start = ++m_scanned;
+            compact();
+            return true;
+        }
+    }
+
+    if (m_maxLength > 0 && m_scanned - m_start > m_maxLength) {
+        m_error = true;
+    }
+    compact();
+    return false;
+}
+
+bool LocalMessageSplitter::hasError() const
+{
+    return m_error;
+}
+
+void LocalMessageSplitter::clear()
+{
+    m_buffer.clear();
+    m_start = 0;
+    m_scanned = 0;
+    m_depth = 0;
+    m_inString = false;
+    m_escaped = false;
+    m_error = false;
+}
+
+void LocalMessageSplitter::compact()
+{
+    // only drop the taken messages once they make up most of the buffer
+    if (m_start == 0 || m_start < m_buffer.size() / 2) {
+        return;
+    }
+
+    m_buffer.remove(0, m_start);
+    m_scanned -= m_start;
+    m_start = 0;
+}
@@ -0,0 +1,51 @@
+/*
+*  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LOCALMESSAGESPLITTER_H
+#define LOCALMESSAGESPLITTER_H
+
+#include <QByteArray>
+
+/**
+ * Splits the data of a local socket between KeePassXC and its clients into
+ * messages. The messages are JSON objects sent back to back without any
+ * delimiter, so their ends are found by matching the brackets.
+ */
+class LocalMessageSplitter
+{
+public:
+    explicit LocalMessageSplitter(int maxLength = 0);
+
+    void append(const QByteArray& data);
+    bool takeMessage(QByteArray& message);
+    bool hasError() const;
+    void clear();
+
+private:
+    void compact();
+
+    int m_maxLength;
+    QByteArray m_buffer;
+    int m_start;
+    int m_scanned;
+    int m_depth;
+    bool m_inString;
+    bool m_escaped;
+    bool m_error;
+};
+
+#endif // LOCALMESSAGESPLITTER_H
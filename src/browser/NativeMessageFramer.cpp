@@ -0,0 +1,196 @@
+/*
+*  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "NativeMessageFramer.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const int HeaderSize = 4;
+    const int ReadChunkSize = 64 * 1024;
+} // namespace
+
+NativeMessageFramer::NativeMessageFramer(int fd, quint32 maxLength)
+    : m_fd(fd)
+    , m_maxLength(maxLength)
+    , m_offset(0)
+    , m_eof(false)
+    , m_error(false)
+{
+}
+
+/**
+ * Read the data that is available without blocking, for use when the
+ * descriptor was reported readable. Complete messages are then taken with
+ * takeMessage().
+ *
+ * @return NeedMoreData if data was read, otherwise EndOfStream or Error
+ */
+NativeMessageFramer::Status NativeMessageFramer::readAvailable()
+{
+    if (m_error) {
+        return Error;
+    }
+
+    const qint64 bytesRead = fill();
+    if (bytesRead < 0) {
+        return Error;
+    }
+    return bytesRead == 0 ? EndOfStream : NeedMoreData;
+}
+
+/**
+ * Block until a complete message has been read.
+ *
+ * A message cut short by the end of the stream is dropped.
+ */
+NativeMessageFramer::Status NativeMessageFramer::readMessage(QByteArray& message)
+{
+    while (!takeMessage(message)) {
+        if (m_error) {
+            return Error;
+        }
+
+        const qint64 bytesRead = fill();
+        if (bytesRead < 0) {
+            return Error;
+        }
+        if (bytesRead == 0) {
+            return EndOfStream;
+        }
+    }
+
+    return MessageRead;
+}
+
+/**
+ * Take the next complete message from the read buffer.
+ *
+ * @return false if no complete message is buffered or the stream is corrupt
+ */
+bool NativeMessageFramer::takeMessage(QByteArray& message)
+{
+    const int available = m_buffer.size() - m_offset;
+    if (m_error || available < HeaderSize) {
+        return false;
+    }
+
+    quint32 length;
+    memcpy(&length, m_buffer.constData() + m_offset, HeaderSize);
+    if (length == 0 || length > m_maxLength) {
+        // the stream can't be resynchronized after a bogus length
+        m_error = true;
+        return false;
+    }
+
+    if (static_cast<quint32>(available - HeaderSize) < length) {
+        return false;
+    }
+
+    message = m_buffer.mid(m_offset + HeaderSize, static_cast<int>(length));
+    m_offset += HeaderSize + static_cast<int>(length);
+    return true;
+}
+
+bool NativeMessageFramer::hasError() const
+{
+    return m_error;
+}
+
+/**
+ * Write a message with its length prefix, retrying partial writes.
+ */
+bool NativeMessageFramer::writeMessage(int fd, const QByteArray& message)
+{
+    const quint32 length = static_cast<quint32>(message.size());
+    QByteArray frame(HeaderSize, '\0');
+    memcpy(frame.data(), &length, HeaderSize);
+    frame.append(message);
+
+    const char* data = frame.constData();
+    qint64 remaining = frame.size();
+    while (remaining > 0) {
+        const auto written = ::write(fd, data, static_cast<size_t>(remaining));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        remaining -= written;
+    }
+
+    return true;
+}
+
+/**
+ * Issue a single read(2), large enough for the rest of the current message.
+ *
+ * @return number of bytes read, 0 at the end of the stream or -1 on error
+ */
+qint64 NativeMessageFramer::fill()
+{
+    if (m_eof) {
+        return 0;
+    }
+
+    compact();
+
+    const int available = m_buffer.size();
+    int wanted = HeaderSize - available;
+    if (available >= HeaderSize) {
+        quint32 length;
+        memcpy(&length, m_buffer.constData(), HeaderSize);
+        if (length <= m_maxLength) {
+            wanted = HeaderSize + static_cast<int>(length) - available;
+        }
+    }
+    wanted = qMax(wanted, ReadChunkSize);
+
+    m_buffer.resize(available + wanted);
+    qint64 bytesRead;
+    do {
+        bytesRead = ::read(m_fd, m_buffer.data() + available, static_cast<size_t>(wanted));
+    } while (bytesRead < 0 && errno == EINTR);
+
+    m_buffer.resize(available + static_cast<int>(qMax<qint64>(bytesRead, 0)));
+    if (bytesRead == 0) {
+        m_eof = true;
+    } else if (bytesRead < 0) {
+        m_error = true;
+    }
+    return bytesRead;
+}
+
+void NativeMessageFramer::compact()
+{
+    if (m_offset == 0) {
+        return;
+    }
+
+    m_buffer.remove(0, m_offset);
+    m_offset = 0;
+}
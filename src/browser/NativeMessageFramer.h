@@ -0,0 +1,59 @@
+/*
+*  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NATIVEMESSAGEFRAMER_H
+#define NATIVEMESSAGEFRAMER_H
+
+#include <QByteArray>
+
+/**
+ * Reads and writes native messages, each prefixed with its length as a
+ * 32-bit integer in native byte order, on a file descriptor.
+ */
+class NativeMessageFramer
+{
+public:
+    enum Status
+    {
+        MessageRead,
+        NeedMoreData,
+        EndOfStream,
+        Error
+    };
+
+    NativeMessageFramer(int fd, quint32 maxLength);
+
+    Status readAvailable();
+    Status readMessage(QByteArray& message);
+    bool takeMessage(QByteArray& message);
+    bool hasError() const;
+
+    static bool writeMessage(int fd, const QByteArray& message);
+
+private:
+    qint64 fill();
+    void compact();
+
+    const int m_fd;
+    const quint32 m_maxLength;
+    QByteArray m_buffer;
+    int m_offset;
+    bool m_eof;
+    bool m_error;
+};
+
+#endif // NATIVEMESSAGEFRAMER_H
@@ -19,24 +19,13 @@
 #include "NativeMessagingBase.h"
 #include <QStandardPaths>
 
-#if defined(Q_OS_UNIX) && !defined(Q_OS_LINUX)
-#include <sys/event.h>
-#include <sys/time.h>
-#include <sys/types.h>
-#include <unistd.h>
-#endif
-
-#ifdef Q_OS_LINUX
-#include <sys/epoll.h>
-#include <unistd.h>
-#endif
-
 #ifdef Q_OS_WIN
 #include <fcntl.h>
 #include <io.h>
 #endif
 
 NativeMessagingBase::NativeMessagingBase(const bool enabled)
+    : m_framer(fileno(stdin), NATIVE_MSG_MAX_LENGTH)
 {
 #ifdef Q_OS_WIN
     Q_UNUSED(enabled);
@@ -50,61 +39,31 @@ NativeMessagingBase::NativeMessagingBase(const bool enabled)
 #endif
 }
 
+/**
+ * Read what is available on stdin and handle every message that is complete,
+ * a partial message is kept until the rest of it arrives.
+ */
 void NativeMessagingBase::newNativeMessage()
 {
-#if defined(Q_OS_UNIX) && !defined(Q_OS_LINUX)
-    struct kevent ev[1];
-    struct timespec ts = {5, 0};
-
-    int fd = kqueue();
-    if (fd == -1) {
-        m_notifier->setEnabled(false);
-        return;
-    }
-
-    EV_SET(ev, fileno(stdin), EVFILT_READ, EV_ADD, 0, 0, nullptr);
-    if (kevent(fd, ev, 1, nullptr, 0, &ts) == -1) {
-        m_notifier->setEnabled(false);
-        return;
-    }
+    const NativeMessageFramer::Status status = m_framer.readAvailable();
 
-    int ret = kevent(fd, NULL, 0, ev, 1, &ts);
-    if (ret < 1) {
-        m_notifier->setEnabled(false);
-        ::close(fd);
-        return;
-    }
-#elif defined(Q_OS_LINUX)
-    int fd = epoll_create(5);
-    struct epoll_event event;
-    event.events = EPOLLIN;
-    event.data.fd = 0;
-    if (epoll_ctl(fd, EPOLL_CTL_ADD, 0, &event) != 0) {
-        m_notifier->setEnabled(false);
-        return;
+    QByteArray message;
+    while (m_framer.takeMessage(message)) {
+        handleNativeMessage(message);
     }
 
-    if (epoll_wait(fd, &event, 1, 5000) < 1) {
+    if (status != NativeMessageFramer::NeedMoreData || m_framer.hasError()) {
         m_notifier->setEnabled(false);
-        ::close(fd);
-        return;
+        nativeMessagesEnded();
     }
-#endif
-    readLength();
-#ifndef Q_OS_WIN
-    ::close(fd);
-#endif
 }
 
 void NativeMessagingBase::readNativeMessages()
 {
 #ifdef Q_OS_WIN
-    quint32 length = 0;
-    while (m_running.load() && !std::cin.eof()) {
-        length = 0;
-        std::cin.read(reinterpret_cast<char*>(&length), 4);
-        readStdIn(length);
-        QThread::msleep(1);
+    QByteArray message;
+    while (m_running.load() && m_framer.readMessage(message) == NativeMessageFramer::MessageRead) {
+        handleNativeMessage(message);
     }
 #endif
 }
@@ -122,13 +81,14 @@ void NativeMessagingBase::sendReply(const QJsonObject& json)
 }
 
 void NativeMessagingBase::sendReply(const QString& reply)
+{
+    sendReply(reply.toUtf8());
+}
+
+void NativeMessagingBase::sendReply(const QByteArray& reply)
 {
     if (!reply.isEmpty()) {
-        QByteArray bytes = reply.toUtf8();
-        uint len = bytes.size();
-        std::cout << char(((len >> 0) & 0xFF)) << char(((len >> 8) & 0xFF)) << char(((len >> 16) & 0xFF))
-                  << char(((len >> 24) & 0xFF));
-        std::cout << reply.toStdString() << std::flush;
+        NativeMessageFramer::writeMessage(fileno(stdout), reply);
     }
 }
 
@@ -30,6 +30,8 @@
 #include <QSocketNotifier>
 #include <QtConcurrent/QtConcurrent>
 #include <iostream>
+
+#include "NativeMessageFramer.h"
 #include <unistd.h>
 
 #ifndef Q_OS_WIN
@@ -51,18 +53,20 @@ protected slots:
     void newNativeMessage();
 
 protected:
-    virtual void readLength() = 0;
-    virtual void readStdIn(const quint32 length) = 0;
+    virtual void handleNativeMessage(const QByteArray& message) = 0;
+    virtual void nativeMessagesEnded() = 0;
     void readNativeMessages();
     QString jsonToString(const QJsonObject& json) const;
     void sendReply(const QJsonObject& json);
     void sendReply(const QString& reply);
+    void sendReply(const QByteArray& reply);
     QString getLocalServerPath() const;
 
 protected:
     QAtomicInteger<quint8> m_running;
     QSharedPointer<QSocketNotifier> m_notifier;
     QFuture<void> m_future;
+    NativeMessageFramer m_framer;
 };
 
 #endif // NATIVEMESSAGINGBASE_H
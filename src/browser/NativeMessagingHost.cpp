@@ -19,7 +19,9 @@
 #include "NativeMessagingHost.h"
 #include "BrowserSettings.h"
 #include "sodium.h"
+#include <QCoreApplication>
 #include <QMutexLocker>
+#include <QThread>
 #include <QtNetwork>
 #include <iostream>
 
@@ -48,6 +50,7 @@ NativeMessagingHost::NativeMessagingHost(DatabaseTabWidget* parent, const bool e
 NativeMessagingHost::~NativeMessagingHost()
 {
     stop();
+    cancelLocalMessages();
 }
 
 int NativeMessagingHost::init()
@@ -70,6 +73,7 @@ void NativeMessagingHost::run()
     }
 
     m_running.store(true);
+    m_stopping = false;
 #ifdef Q_OS_WIN
     m_future =
         QtConcurrent::run(this, static_cast<void (NativeMessagingHost::*)()>(&NativeMessagingHost::readNativeMessages));
@@ -97,6 +101,8 @@ void NativeMessagingHost::run()
 
 void NativeMessagingHost::stop()
 {
+    // requests being handled are still answered, but no further ones are started
+    m_stopping = true;
     databaseLocked();
     QMutexLocker locker(&m_mutex);
     m_socketList.clear();
@@ -105,40 +111,15 @@ void NativeMessagingHost::stop()
     m_localServer->close();
 }
 
-void NativeMessagingHost::readLength()
+void NativeMessagingHost::handleNativeMessage(const QByteArray& message)
 {
-    quint32 length = 0;
-    std::cin.read(reinterpret_cast<char*>(&length), 4);
-    if (!std::cin.eof() && length > 0) {
-        readStdIn(length);
-    } else {
-        m_notifier->setEnabled(false);
-    }
+    QMutexLocker locker(&m_mutex);
+    sendReply(m_browserClients.readResponse(message));
 }
 
-void NativeMessagingHost::readStdIn(const quint32 length)
+void NativeMessagingHost::nativeMessagesEnded()
 {
-    if (length <= 0) {
-        return;
-    }
-
-    QByteArray arr;
-    arr.reserve(length);
-
-    QMutexLocker locker(&m_mutex);
-
-    for (quint32 i = 0; i < length; ++i) {
-        int c = std::getchar();
-        if (c == EOF) {
-            // message ended prematurely, ignore it and return
-            return;
-        }
-        arr.append(static_cast<char>(c));
-    }
-
-    if (arr.length() > 0) {
-        sendReply(m_browserClients.readResponse(arr));
-    }
+    // KeePassXC keeps serving local clients after the browser closed stdin
 }
 
 void NativeMessagingHost::newLocalConnection()
@@ -153,7 +134,7 @@ void NativeMessagingHost::newLocalConnection()
 void NativeMessagingHost::newLocalMessage()
 {
     QLocalSocket* socket = qobject_cast<QLocalSocket*>(QObject::sender());
-    if (!socket || socket->bytesAvailable() <= 0) {
+    if (!socket || socket->bytesAvailable() <= 0 || m_stopping) {
         return;
     }
 
@@ -164,21 +145,102 @@ void NativeMessagingHost::newLocalMessage()
         setsockopt(socketDesc, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<char*>(&max), sizeof(max));
     }
 
-    QByteArray arr = socket->readAll();
-    if (arr.isEmpty()) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_socketList.contains(socket)) {
+            m_socketList.push_back(socket);
+        }
+    }
+
+    auto splitter = m_splitters.find(socket);
+    if (splitter == m_splitters.end()) {
+        splitter = m_splitters.insert(socket, LocalMessageSplitter(NATIVE_MSG_MAX_LENGTH));
+    }
+    splitter->append(socket->readAll());
+
+    handleNextLocalMessage(socket);
+}
+
+/**
+ * Pass the next request of a client to a worker thread.
+ *
+ * Clients have one request in flight at a time so their replies stay in order.
+ * Requests sent meanwhile wait in the splitter until the reply is written.
+ */
+void NativeMessagingHost::handleNextLocalMessage(QLocalSocket* socket)
+{
+    if (m_requests.values().contains(socket)) {
+        return;
+    }
+
+    auto splitter = m_splitters.find(socket);
+    if (splitter == m_splitters.end()) {
         return;
     }
 
-    QMutexLocker locker(&m_mutex);
-    if (!m_socketList.contains(socket)) {
-        m_socketList.push_back(socket);
+    QByteArray arr;
+    if (!splitter->takeMessage(arr)) {
+        if (splitter->hasError()) {
+            // the following messages can't be found in a garbled stream
+            qWarning("Invalid message from a local browser client, closing the connection");
+            m_splitters.erase(splitter);
+            socket->abort();
+        }
+        return;
+    }
+
+    // config() may only be read here, the worker uses this copy of the settings
+    m_browserService.updateRequestSettings();
+
+    auto* watcher = new QFutureWatcher<QByteArray>(this);
+    m_requests.insert(watcher, socket);
+    connect(watcher, SIGNAL(finished()), this, SLOT(localMessageHandled()));
+    watcher->setFuture(QtConcurrent::run(this, &NativeMessagingHost::handleLocalMessage, arr));
+}
+
+/**
+ * Wait for the requests still being handled, without running an event loop.
+ *
+ * Workers can be blocked on a call to the GUI thread, which is waiting here.
+ * Deleting those queued calls instead of running them releases the workers
+ * with an empty result, so no dialog is opened and the requests fail quickly.
+ */
+void NativeMessagingHost::cancelLocalMessages()
+{
+    for (auto* watcher : m_requests.keys()) {
+        const QFuture<QByteArray> future = watcher->future();
+        while (!future.isFinished()) {
+            QCoreApplication::removePostedEvents(&m_browserService, QEvent::MetaCall);
+            QThread::msleep(1);
+        }
     }
 
-    QString reply = jsonToString(m_browserClients.readResponse(arr));
+    qDeleteAll(m_requests.keys());
+    m_requests.clear();
+}
+
+/**
+ * Runs on a worker thread, BrowserService passes everything that touches the
+ * databases or shows a dialog to the GUI thread.
+ */
+QByteArray NativeMessagingHost::handleLocalMessage(const QByteArray& message)
+{
+    return jsonToString(m_browserClients.readResponse(message)).toUtf8();
+}
+
+void NativeMessagingHost::localMessageHandled()
+{
+    auto* watcher = static_cast<QFutureWatcher<QByteArray>*>(QObject::sender());
+    const QPointer<QLocalSocket> socket = m_requests.take(watcher);
+    const QByteArray reply = watcher->result();
+    watcher->deleteLater();
+
     if (socket && socket->isValid() && socket->state() == QLocalSocket::ConnectedState) {
-        QByteArray arr = reply.toUtf8();
-        socket->write(arr.constData(), arr.length());
+        socket->write(reply.constData(), reply.length());
         socket->flush();
+        if (!m_stopping) {
+            handleNextLocalMessage(socket);
+        }
     }
 }
 
@@ -198,6 +260,7 @@ void NativeMessagingHost::sendReplyToAllClients(const QJsonObject& json)
 void NativeMessagingHost::disconnectSocket()
 {
     QLocalSocket* socket(qobject_cast<QLocalSocket*>(QObject::sender()));
+    m_splitters.remove(socket);
     QMutexLocker locker(&m_mutex);
     for (auto s : m_socketList) {
         if (s == socket) {
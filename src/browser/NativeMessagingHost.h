@@ -21,8 +21,12 @@
 
 #include "BrowserClients.h"
 #include "BrowserService.h"
+#include "LocalMessageSplitter.h"
 #include "NativeMessagingBase.h"
 #include "gui/DatabaseTabWidget.h"
+#include <QFutureWatcher>
+#include <QHash>
+#include <QPointer>
 
 class NativeMessagingHost : public NativeMessagingBase
 {
@@ -45,15 +49,19 @@ signals:
     void quit();
 
 private:
-    void readLength();
-    void readStdIn(const quint32 length);
+    void handleNativeMessage(const QByteArray& message) override;
+    void nativeMessagesEnded() override;
     void sendReplyToAllClients(const QJsonObject& json);
+    void handleNextLocalMessage(QLocalSocket* socket);
+    void cancelLocalMessages();
+    QByteArray handleLocalMessage(const QByteArray& message);
 
 private slots:
     void databaseLocked();
     void databaseUnlocked();
     void newLocalConnection();
     void newLocalMessage();
+    void localMessageHandled();
     void disconnectSocket();
 
 private:
@@ -62,6 +70,9 @@ private:
     BrowserService m_browserService;
     QSharedPointer<QLocalServer> m_localServer;
     SocketList m_socketList;
+    QHash<QFutureWatcher<QByteArray>*, QPointer<QLocalSocket>> m_requests;
+    QHash<QLocalSocket*, LocalMessageSplitter> m_splitters;
+    bool m_stopping = false;
 };
 
 #endif // NATIVEMESSAGINGHOST_H
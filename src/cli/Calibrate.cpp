@@ -0,0 +1,147 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <stdio.h>
+
+#include "Calibrate.h"
+
+#include <QCommandLineParser>
+#include <QTextStream>
+
+#include "crypto/kdf/Argon2Kdf.h"
+#include "crypto/kdf/KdfCalibrator.h"
+#include "format/KeePass2.h"
+
+Calibrate::Calibrate()
+{
+    name = QString("calibrate");
+    description = QObject::tr("Find the key derivation rounds for a target unlock time.");
+}
+
+Calibrate::~Calibrate()
+{
+}
+
+int Calibrate::execute(const QStringList& arguments)
+{
+    QTextStream outputTextStream(stdout, QIODevice::WriteOnly);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(this->description);
+    QCommandLineOption time(QStringList() << "t"
+                                          << "time",
+                            QObject::tr("Target time to unlock the database in milliseconds (default: 1000)."),
+                            QObject::tr("msec"));
+    parser.addOption(time);
+    QCommandLineOption kdfOption(QStringList() << "k"
+                                               << "kdf",
+                                 QObject::tr("Key derivation function: argon2 or aes (default: argon2)."),
+                                 QObject::tr("kdf"));
+    parser.addOption(kdfOption);
+    QCommandLineOption memory(QStringList() << "m"
+                                            << "memory",
+                              QObject::tr("Argon2 memory usage in MiB (default: 64)."),
+                              QObject::tr("MiB"));
+    parser.addOption(memory);
+    QCommandLineOption parallelism(QStringList() << "p"
+                                                 << "parallelism",
+                                   QObject::tr("Argon2 parallelism (default: number of CPU cores)."),
+                                   QObject::tr("threads"));
+    parser.addOption(parallelism);
+    QCommandLineOption samples(QStringList() << "s"
+                                             << "samples",
+                               QObject::tr("Number of timed samples (default: %1).")
+                                   .arg(KdfCalibrator::DefaultSampleCount),
+                               QObject::tr("count"));
+    parser.addOption(samples);
+
+    parser.process(arguments);
+
+    const QStringList args = parser.positionalArguments();
+    if (!args.isEmpty()) {
+        outputTextStream << parser.helpText().replace("keepassxc-cli", "keepassxc-cli calibrate");
+        return EXIT_FAILURE;
+    }
+
+    bool ok = true;
+    int msec = 1000;
+    if (parser.isSet(time)) {
+        msec = parser.value(time).toInt(&ok);
+        if (!ok || msec <= 0) {
+            qCritical("Invalid target time %s.", qPrintable(parser.value(time)));
+            return EXIT_FAILURE;
+        }
+    }
+
+    QString kdfName = parser.value(kdfOption).toLower();
+    QSharedPointer<Kdf> kdf;
+    if (kdfName.isEmpty() || kdfName == "argon2") {
+        kdf = KeePass2::uuidToKdf(KeePass2::KDF_ARGON2);
+    } else if (kdfName == "aes") {
+        kdf = KeePass2::uuidToKdf(KeePass2::KDF_AES_KDBX4);
+    } else {
+        qCritical("Unknown key derivation function %s.", qPrintable(kdfName));
+        return EXIT_FAILURE;
+    }
+
+    KdfCalibrator calibrator(kdf);
+    if (kdf->uuid() == KeePass2::KDF_ARGON2) {
+        auto argon2Kdf = kdf.staticCast<Argon2Kdf>();
+        if (parser.isSet(memory)) {
+            quint64 mebibytes = parser.value(memory).toULongLong(&ok);
+            if (!ok || !argon2Kdf->setMemory(mebibytes * 1024)) {
+                qCritical("Invalid memory usage %s.", qPrintable(parser.value(memory)));
+                return EXIT_FAILURE;
+            }
+        }
+        if (parser.isSet(parallelism)) {
+            quint32 threads = parser.value(parallelism).toUInt(&ok);
+            if (!ok || !argon2Kdf->setParallelism(threads)) {
+                qCritical("Invalid parallelism %s.", qPrintable(parser.value(parallelism)));
+                return EXIT_FAILURE;
+            }
+        } else {
+            calibrator.setChooseParallelism(true);
+        }
+    }
+    if (parser.isSet(samples)) {
+        calibrator.setSampleCount(parser.value(samples).toInt());
+    }
+
+    KdfCalibrator::Result result = calibrator.calibrate(msec);
+    if (!result.isValid()) {
+        qCritical("The key derivation failed.");
+        return EXIT_FAILURE;
+    }
+
+    if (kdf->uuid() == KeePass2::KDF_ARGON2) {
+        outputTextStream << QObject::tr("KDF: Argon2") << endl;
+        outputTextStream << QObject::tr("Memory: %1 MiB").arg(kdf.staticCast<Argon2Kdf>()->memory() / 1024) << endl;
+        outputTextStream << QObject::tr("Parallelism: %1").arg(result.parallelism) << endl;
+    } else {
+        outputTextStream << QObject::tr("KDF: AES-KDF") << endl;
+    }
+    outputTextStream << QObject::tr("Rounds: %1").arg(result.rounds) << endl;
+    outputTextStream << QObject::tr("Expected time: %1 ms (± %2 ms, %3 samples)")
+                            .arg(qRound(result.expectedMsec))
+                            .arg(qRound(result.errorMsec))
+                            .arg(result.samples)
+                     << endl;
+
+    return EXIT_SUCCESS;
+}
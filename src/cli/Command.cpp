@@ -23,6 +23,7 @@
 #include "Command.h"
 
 #include "Add.h"
+#include "Calibrate.h"
 #include "Clip.h"
 #include "Diceware.h"
 #include "Edit.h"
@@ -62,6 +63,7 @@ void populateCommands()
 {
     if (commands.isEmpty()) {
         commands.insert(QString("add"), new Add());
+        commands.insert(QString("calibrate"), new Calibrate());
         commands.insert(QString("clip"), new Clip());
         commands.insert(QString("diceware"), new Diceware());
         commands.insert(QString("edit"), new Edit());
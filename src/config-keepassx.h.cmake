@@ -31,5 +31,6 @@
 #cmakedefine HAVE_PR_SET_DUMPABLE 1
 #cmakedefine HAVE_RLIMIT_CORE 1
 #cmakedefine HAVE_PT_DENY_ATTACH 1
+#cmakedefine HAVE_AESNI 1
 
 #endif // KEEPASSX_CONFIG_KEEPASSX_H
@@ -18,20 +18,36 @@
 
 #include "AppBase.h"
 
+#include <QCoreApplication>
+#include <QCryptographicHash>
 #include <QDir>
 #include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QProcess>
+#include <QProcessEnvironment>
 #include <QStandardPaths>
+#include <QThread>
 #include <sodium.h>
 #include <sodium/crypto_box.h>
 #include <sodium/randombytes.h>
 
 #include <sys/socket.h>
 
-// taken from ../browser/NativeMessagingBase.h
-const int NATIVE_MSG_MAX_LENGTH = 1024*1024;
+AppBase::AppBase()
+    : m_clientId("xxx")
+    , m_viaDaemon(false)
+    , m_outstanding(0)
+    , m_splitter(NATIVE_MSG_MAX_LENGTH)
+{
+}
+
+AppBase::~AppBase()
+{
+    disconnect(&m_socket, nullptr, this, nullptr);
+    clearSharedKey();
+}
 
 QString AppBase::default_id_path()
 {
@@ -56,6 +72,8 @@ bool AppBase::loadIdentity()
     m_myPublicKey = obj["myPublicKey"].toString();
     m_mySecretKey = obj["mySecretKey"].toString();
     m_remotePublicKey = obj["remotePublicKey"].toString();
+    m_associationId = obj["id"].toString();
+    clearSharedKey();
 
     return true;
 }
@@ -66,6 +84,7 @@ bool AppBase::storeIdentity()
     obj["myPublicKey"] = m_myPublicKey;
     obj["mySecretKey"] = m_mySecretKey;
     obj["remotePublicKey"] = m_remotePublicKey;
+    obj["id"] = m_associationId;
 
     if (!QFileInfo(m_idPath).dir().mkpath("."))
         return false;
@@ -92,6 +111,8 @@ bool AppBase::generateKeys()
 
     m_myPublicKey = pubkey.toBase64();
     m_mySecretKey = seckey.toBase64();
+    sodium_memzero(seckey.data(), seckey.size());
+    clearSharedKey();
 
     return true;
 }
@@ -100,15 +121,15 @@ QString AppBase::encryptMessage(const QJsonObject& data, const QString& nonce)
 {
     const auto msg = QJsonDocument(data).toJson();
     const auto nonce_val = QByteArray::fromBase64(nonce.toUtf8());
-    const auto remote_pubkey_val = QByteArray::fromBase64(m_remotePublicKey.toUtf8());
-    const auto my_seckey_val = QByteArray::fromBase64(m_mySecretKey.toUtf8());
+    if (nonce_val.length() != static_cast<int>(crypto_box_NONCEBYTES) || !computeSharedKey())
+        return QString();
 
     QByteArray cipher(msg.length() + crypto_box_MACBYTES, '\0');
-    Q_ASSERT(crypto_box_easy(reinterpret_cast<unsigned char*>(cipher.data()),
+    if (crypto_box_easy_afternm(reinterpret_cast<unsigned char*>(cipher.data()),
         reinterpret_cast<const unsigned char*>(msg.constData()), msg.length(),
         reinterpret_cast<const unsigned char*>(nonce_val.constData()),
-        reinterpret_cast<const unsigned char*>(remote_pubkey_val.constData()),
-        reinterpret_cast<const unsigned char*>(my_seckey_val.constData())) == 0);
+        reinterpret_cast<const unsigned char*>(m_sharedKey.constData())) != 0)
+        return QString();
 
     return QString(cipher.toBase64());
 }
@@ -117,15 +138,15 @@ QJsonObject AppBase::decryptMessage(const QString& data, const QString& nonce)
 {
     const auto cipher = QByteArray::fromBase64(data.toUtf8());
     const auto nonce_val = QByteArray::fromBase64(nonce.toUtf8());
-    const auto remote_pubkey_val = QByteArray::fromBase64(m_remotePublicKey.toUtf8());
-    const auto my_seckey_val = QByteArray::fromBase64(m_mySecretKey.toUtf8());
+    if (cipher.length() < static_cast<int>(crypto_box_MACBYTES)
+        || nonce_val.length() != static_cast<int>(crypto_box_NONCEBYTES) || !computeSharedKey())
+        return QJsonObject();
 
     QByteArray msg(cipher.length() - crypto_box_MACBYTES, '\0');
-    if (crypto_box_open_easy(reinterpret_cast<unsigned char*>(msg.data()),
+    if (crypto_box_open_easy_afternm(reinterpret_cast<unsigned char*>(msg.data()),
         reinterpret_cast<const unsigned char*>(cipher.constData()), cipher.length(),
         reinterpret_cast<const unsigned char*>(nonce_val.constData()),
-        reinterpret_cast<const unsigned char*>(remote_pubkey_val.constData()),
-        reinterpret_cast<const unsigned char*>(my_seckey_val.constData())) != 0) {
+        reinterpret_cast<const unsigned char*>(m_sharedKey.constData())) != 0) {
         qDebug() << "decryption of message failed";
         return QJsonObject();
     }
@@ -134,26 +155,103 @@ QJsonObject AppBase::decryptMessage(const QString& data, const QString& nonce)
     return QJsonDocument::fromJson(msg).object();
 }
 
-QString socketPath()
+// the X25519 exchange only depends on the two keys, so it runs once per key pair
+bool AppBase::computeSharedKey()
+{
+    if (!m_sharedKey.isEmpty())
+        return true;
+
+    const auto remote_pubkey_val = QByteArray::fromBase64(m_remotePublicKey.toUtf8());
+    auto my_seckey_val = QByteArray::fromBase64(m_mySecretKey.toUtf8());
+    if (remote_pubkey_val.length() != static_cast<int>(crypto_box_PUBLICKEYBYTES)
+        || my_seckey_val.length() != static_cast<int>(crypto_box_SECRETKEYBYTES)) {
+        sodium_memzero(my_seckey_val.data(), my_seckey_val.size());
+        return false;
+    }
+
+    m_sharedKey.resize(crypto_box_BEFORENMBYTES);
+    const bool ok = crypto_box_beforenm(reinterpret_cast<unsigned char*>(m_sharedKey.data()),
+        reinterpret_cast<const unsigned char*>(remote_pubkey_val.constData()),
+        reinterpret_cast<const unsigned char*>(my_seckey_val.constData())) == 0;
+    sodium_memzero(my_seckey_val.data(), my_seckey_val.size());
+    if (!ok)
+        clearSharedKey();
+
+    return ok;
+}
+
+void AppBase::clearSharedKey()
+{
+    if (m_sharedKey.isEmpty())
+        return;
+
+    sodium_memzero(m_sharedKey.data(), m_sharedKey.size());
+    m_sharedKey.clear();
+}
+
+static QString runtimePath(const QString& name)
 {
-    const QString serverPath = "/kpxc_server";
 #if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
     // Use XDG_RUNTIME_DIR instead of /tmp if it's available
     const auto path = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
     return path.isEmpty()
-        ? QStandardPaths::writableLocation(QStandardPaths::TempLocation) + serverPath
-        : path + serverPath;
+        ? QStandardPaths::writableLocation(QStandardPaths::TempLocation) + name
+        : path + name;
 #else // Q_OS_MAC, Q_OS_WIN and others
-    return QStandardPaths::writableLocation(QStandardPaths::TempLocation) + serverPath;
+    return QStandardPaths::writableLocation(QStandardPaths::TempLocation) + name;
 #endif
 }
 
-bool AppBase::connectToServer()
+QString socketPath()
+{
+    return runtimePath("/kpxc_server");
+}
+
+// one daemon per identity, the identity file lives in the user's home
+QString AppBase::daemonSocketPath(const QString& idPath)
+{
+    const auto hash = QCryptographicHash::hash(QFileInfo(idPath).absoluteFilePath().toUtf8(),
+        QCryptographicHash::Sha1);
+    return runtimePath("/kpxc_connector_" + QString::fromLatin1(hash.toHex().left(16)));
+}
+
+static bool daemonEnabled()
+{
+    const auto val = QProcessEnvironment::systemEnvironment().value("KEEPASSXC_CONNECTOR_DAEMON");
+    return !val.isEmpty() && val != "0";
+}
+
+// connect to the daemon keeping the session with KeePassXC, start it if it doesn't run yet
+bool AppBase::connectToDaemon()
+{
+    const auto path = daemonSocketPath(m_idPath);
+    m_socket.connectToServer(path);
+    if (m_socket.waitForConnected(100))
+        return true;
+
+    if (!QProcess::startDetached(QCoreApplication::applicationFilePath(),
+          {"-m", "daemon", "-i", m_idPath, "detach"}))
+        return false;
+
+    for (int i = 0; i < 20; ++i) {
+        QThread::msleep(100);
+        m_socket.connectToServer(path);
+        if (m_socket.waitForConnected(100))
+            return true;
+    }
+
+    qWarning() << "The connector daemon did not start, connecting to KeePassXC directly";
+    return false;
+}
+
+bool AppBase::connectToServer(bool allowDaemon)
 {
     if (m_socket.state() != QLocalSocket::UnconnectedState)
         return true;
 
-    m_socket.connectToServer(socketPath());
+    m_viaDaemon = allowDaemon && daemonEnabled() && connectToDaemon();
+    if (!m_viaDaemon)
+        m_socket.connectToServer(socketPath());
     m_socket.setReadBufferSize(NATIVE_MSG_MAX_LENGTH);
     if (m_socket.state() == QLocalSocket::UnconnectedState) {
         qCritical() << "Initialization failed. Please check if KeePassXC is running"
@@ -169,6 +267,7 @@ bool AppBase::connectToServer()
     }
 
     connect(&m_socket, SIGNAL(readyRead()), this, SLOT(dataReceived()));
+    connect(&m_socket, SIGNAL(disconnected()), this, SLOT(serverDisconnected()));
     return true;
 }
 
@@ -177,13 +276,43 @@ void AppBase::dataReceived()
     if (m_socket.bytesAvailable() <= 0)
         return;
 
-    auto data = m_socket.readAll();
-    qDebug().noquote() << "Received from KPXC = " << data;
-    emit responseReceived(data);
+    // replies are not delimited, a read may hold several of them or only a part of one
+    m_splitter.append(m_socket.readAll());
+    QByteArray data;
+    while (m_splitter.takeMessage(data)) {
+        qDebug().noquote() << "Received from KPXC = " << data;
+        // KeePassXC notifies about locked and unlocked databases without a request
+        const auto action = QJsonDocument::fromJson(data).object()["action"].toString();
+        if (m_outstanding > 0 && action != "database-locked" && action != "database-unlocked")
+            --m_outstanding;
+        emit responseReceived(data);
+    }
+
+    if (m_splitter.hasError()) {
+        qCritical() << "Received an invalid message, closing the connection";
+        m_splitter.clear();
+        m_socket.abort();
+    }
+}
+
+// a frontend that got all its answers is done, the daemon closing on idle isn't an error
+void AppBase::serverDisconnected()
+{
+    if (m_outstanding == 0) {
+        QCoreApplication::exit(0);
+        return;
+    }
+
+    qCritical() << "The connection to KeePassXC was closed with" << m_outstanding << "requests unanswered";
+    QCoreApplication::exit(1);
 }
 
 QJsonObject AppBase::extractMessage(const QJsonObject& obj)
 {
+    // the daemon already decrypted the message
+    if (m_viaDaemon)
+        return obj["message"].toObject();
+
     return decryptMessage(obj["message"].toString(), obj["nonce"].toString());
 }
 
@@ -193,6 +322,7 @@ bool AppBase::send(const QByteArray& data)
     if (ret == -1)
         return false;
     Q_ASSERT(ret == data.length());
+    ++m_outstanding;
     m_socket.flush();
     qDebug().noquote() << "Send to KPXC =" << data;
     return true;
@@ -212,15 +342,24 @@ QString AppBase::nonce()
 bool AppBase::send(const QString& action,
   std::initializer_list<QPair<QString, QJsonValue> > args)
 {
+    return sendRequest(action, QJsonObject(args));
+}
+
+bool AppBase::sendRequest(const QString& action, const QJsonObject& args)
+{
+    // the daemon encrypts with the session it negotiated
+    if (m_viaDaemon)
+        return send(QJsonObject { {"action", action}, {"message", args} });
+
     auto no = nonce();
     QJsonObject msg {
       {"action", action},
       {"nonce", no},
-      {"clientID", "xxx"},
+      {"clientID", m_clientId},
     };
 
-    if (args.size() > 0)
-        msg["message"] = encryptMessage(QJsonObject(args), no);
+    if (!args.isEmpty())
+        msg["message"] = encryptMessage(args, no);
 
     return send(msg);
 }
@@ -232,7 +371,7 @@ bool AppBase::changePublicKeys()
       {"action", "change-public-keys"},
       {"nonce", nonce()},
       {"publicKey", m_myPublicKey},
-      {"clientID", "xxx"},
+      {"clientID", m_clientId},
     });
 }
 
@@ -246,15 +385,14 @@ bool AppBase::associate()
     return send("associate", { {"key", m_myPublicKey} });
 }
 
-/*
+// KeePassXC stored our public key under the id it returned for associate
 bool AppBase::testAssociate()
 {
     return send("test-associate", {
-      {"key", responseKey},
-      {"id", id},
+      {"id", m_associationId},
+      {"key", m_myPublicKey},
     });
 }
-*/
 
 bool AppBase::generatePassword()
 {
@@ -272,6 +410,14 @@ bool AppBase::getLogins(const QString& url)
     });
 }
 
+bool AppBase::getLogins(const QStringList& urls)
+{
+    return send("get-logins", {
+      {"urls", QJsonArray::fromStringList(urls)},
+      {"keys", QJsonArray {}},
+    });
+}
+
 bool AppBase::setLogin(const QString& url)
 {
     return send("set-login", {
@@ -18,15 +18,24 @@
 #ifndef APPBASE_H
 #define APPBASE_H
 
+#include "LocalMessageSplitter.h"
+
 #include <QFile>
 #include <QLocalSocket>
 
+// taken from ../browser/NativeMessagingBase.h
+const int NATIVE_MSG_MAX_LENGTH = 1024*1024;
+
 class AppBase : public QObject
 {
     Q_OBJECT
 
 public:
+    AppBase();
+    ~AppBase() override;
+
     static QString default_id_path();
+    static QString daemonSocketPath(const QString&);
 
     QString idPath() const { return m_idPath; }
     void setIdPath(const QString& val) { m_idPath = val; }
@@ -36,17 +45,23 @@ public:
 protected:
     bool loadIdentity();
     bool storeIdentity();
-    void setRemotePublicKey(const QString& val) { m_remotePublicKey = val; }
+    void setRemotePublicKey(const QString& val) { m_remotePublicKey = val; clearSharedKey(); }
+    void setClientId(const QString& val) { m_clientId = val; }
+    QString associationId() const { return m_associationId; }
+    void setAssociationId(const QString& val) { m_associationId = val; }
     bool generateKeys();
     QString encryptMessage(const QJsonObject&, const QString&);
     QJsonObject decryptMessage(const QString&, const QString&);
+    bool computeSharedKey();
+    void clearSharedKey();
 
-    bool connectToServer();
+    bool connectToServer(bool allowDaemon = true);
     QString nonce();
     QJsonObject extractMessage(const QJsonObject&);
     bool send(const QByteArray&);
     bool send(const QJsonObject&);
     bool send(const QString&, std::initializer_list<QPair<QString, QJsonValue> >);
+    bool sendRequest(const QString&, const QJsonObject&);
 
     bool changePublicKeys();
     bool associate();
@@ -54,6 +69,7 @@ protected:
     bool getDatabasehash();
     bool generatePassword();
     bool getLogins(const QString&);
+    bool getLogins(const QStringList&);
     bool setLogin(const QString&);
     bool lockDatabase();
 
@@ -62,13 +78,22 @@ signals:
 
 private slots:
     void dataReceived();
+    void serverDisconnected();
 
 private:
+    bool connectToDaemon();
+
     QString m_idPath;
+    QString m_clientId;
+    bool m_viaDaemon;
+    int m_outstanding;
     QLocalSocket m_socket;
+    LocalMessageSplitter m_splitter;
     QString m_myPublicKey;
     QString m_mySecretKey;
     QString m_remotePublicKey;
+    QString m_associationId;
+    QByteArray m_sharedKey;
 };
 
 #endif // APPBASE_H
@@ -0,0 +1,252 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BenchApp.h"
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <algorithm>
+#include <iostream>
+#include <sodium/randombytes.h>
+
+// BrowserAction::ERROR_KEEPASS_ASSOCIATION_FAILED
+const int ERROR_ASSOCIATION_FAILED = 8;
+
+// One connection to KeePassXC with a session of its own
+class BenchClient : public AppBase
+{
+public:
+    BenchClient() : m_ready(false), m_associated(false) {}
+
+    virtual bool start(const QStringList&);
+    bool request(const QString&, const QString&);
+    bool isReady() const { return m_ready; }
+    void setReady(const QString& publicKey) { setRemotePublicKey(publicKey); m_ready = true; }
+    bool isAssociated() const { return m_associated; }
+    void setAssociated() { m_associated = true; }
+    bool checkAssociation() { return testAssociate(); }
+
+    QElapsedTimer timer;
+
+private:
+    bool m_ready;
+    bool m_associated;
+};
+
+bool BenchClient::start(const QStringList&)
+{
+    if (!loadIdentity())
+        return false;
+
+    QByteArray clientId(24, '\0');
+    randombytes_buf(clientId.data(), clientId.size());
+    setClientId(clientId.toBase64());
+
+    return connectToServer(false) && changePublicKeys();
+}
+
+bool BenchClient::request(const QString& action, const QString& url)
+{
+    if (action == "generate-password")
+        return generatePassword();
+    if (action == "get-logins")
+        return getLogins(url);
+    if (action == "set-login")
+        return setLogin(url);
+
+    Q_UNREACHABLE();
+    return false;
+}
+
+// Sends the same request over and over on several connections and reports
+// the latency and the throughput KeePassXC achieves
+BenchApp::BenchApp()
+    : m_requests(1000)
+    , m_associated(0)
+    , m_sent(0)
+    , m_errors(0)
+{
+}
+
+bool BenchApp::start(const QStringList& args)
+{
+    // associate isn't offered, KeePassXC asks the user to confirm every single one
+    static const QStringList actions {"generate-password", "get-logins", "set-login"};
+
+    if (args.isEmpty() || !actions.contains(args.first())) {
+        qCritical().noquote() << "Usage: keepassxc-connector -m bench"
+                              << actions.join('|') << "[requests] [concurrency] < urls";
+        return false;
+    }
+    m_action = args.first();
+
+    bool ok = true;
+    if (args.size() > 1)
+        m_requests = args.at(1).toInt(&ok);
+    if (!ok || m_requests < 1) {
+        qCritical() << "Invalid number of requests:" << args.at(1);
+        return false;
+    }
+
+    int concurrency = 1;
+    if (args.size() > 2)
+        concurrency = args.at(2).toInt(&ok);
+    if (!ok || concurrency < 1) {
+        qCritical() << "Invalid concurrency:" << args.at(2);
+        return false;
+    }
+
+    // a URL given several times is requested as often
+    if (m_action == "get-logins" || m_action == "set-login") {
+        QTextStream stream(stdin, QIODevice::ReadOnly);
+        while (!stream.atEnd()) {
+            const auto line = stream.readLine().trimmed();
+            if (!line.isEmpty())
+                m_urls << line;
+        }
+
+        if (m_urls.isEmpty()) {
+            qCritical() << "No URLs given on stdin";
+            return false;
+        }
+    }
+
+    // every connection proves the association before its first request
+    if (!loadIdentity() || associationId().isEmpty()) {
+        qCritical().noquote() << "The identity" << idPath() << "isn't associated with KeePassXC, run init first";
+        return false;
+    }
+
+    m_latencies.reserve(m_requests);
+    for (int i = 0; i < concurrency; ++i) {
+        auto client = new BenchClient();
+        client->setParent(this);
+        client->setIdPath(idPath());
+        connect(client, &AppBase::responseReceived, this,
+          [this, client](QByteArray data) { handleResponse(client, data); });
+
+        if (!client->start({})) {
+            qCritical().noquote() << "Failed to open connection" << i + 1 << "to KeePassXC with the identity"
+                                  << idPath();
+            return false;
+        }
+        m_clients << client;
+    }
+
+    return true;
+}
+
+void BenchApp::handleResponse(BenchClient* client, const QByteArray& data)
+{
+    const auto obj = QJsonDocument::fromJson(data).object();
+    const auto act = obj["action"].toString();
+
+    if (!client->isReady()) {
+        const auto pk = obj["publicKey"].toString();
+        if (act != "change-public-keys" || pk.isEmpty()) {
+            qCritical().noquote() << "KeePassXC refused the key exchange:" << data;
+            QCoreApplication::exit(1);
+            return;
+        }
+
+        client->setReady(pk);
+        if (!client->checkAssociation()) {
+            qCritical() << "Failed to send the request to KeePassXC";
+            QCoreApplication::exit(1);
+        }
+        return;
+    }
+
+    if (!client->isAssociated()) {
+        if (act == "test-associate")
+            handleAssociation(client, obj);
+        return;
+    }
+
+    // notifications like database-locked are no answers
+    if (!client->timer.isValid() || (!obj.isEmpty() && act != m_action))
+        return;
+
+    m_latencies << client->timer.nsecsElapsed();
+    client->timer.invalidate();
+    // requests KeePassXC refuses to answer would only measure how fast it says no
+    if (obj["errorCode"].toString().toInt() == ERROR_ASSOCIATION_FAILED) {
+        qCritical().noquote() << "KeePassXC dropped the association:" << obj["error"].toString();
+        QCoreApplication::exit(1);
+        return;
+    }
+    if (obj.isEmpty() || obj.contains("error"))
+        ++m_errors;
+
+    if (m_latencies.size() == m_requests) {
+        report();
+        QCoreApplication::quit();
+        return;
+    }
+
+    sendNext(client);
+}
+
+// the timed requests start once KeePassXC accepted the identity on every connection
+void BenchApp::handleAssociation(BenchClient* client, const QJsonObject& obj)
+{
+    if (obj.contains("error")) {
+        qCritical().noquote() << "KeePassXC refused the association of" << idPath() << ":"
+                              << obj["error"].toString();
+        QCoreApplication::exit(1);
+        return;
+    }
+
+    client->setAssociated();
+    if (++m_associated < m_clients.size())
+        return;
+
+    for (auto c : m_clients)
+        sendNext(c);
+}
+
+void BenchApp::sendNext(BenchClient* client)
+{
+    if (m_sent == m_requests)
+        return;
+
+    const auto url = m_urls.isEmpty() ? QString() : m_urls.at(m_sent % m_urls.size());
+    ++m_sent;
+
+    if (!m_elapsed.isValid())
+        m_elapsed.start();
+    client->timer.start();
+    if (!client->request(m_action, url)) {
+        qCritical() << "Failed to send the request to KeePassXC";
+        QCoreApplication::exit(1);
+    }
+}
+
+void BenchApp::report()
+{
+    const double seconds = m_elapsed.nsecsElapsed() / 1e9;
+    std::sort(m_latencies.begin(), m_latencies.end());
+    const auto percentile = [this](int p) { return m_latencies.at((m_latencies.size() - 1) * p / 100) / 1e6; };
+
+    std::cout << m_action.toStdString() << ": " << m_latencies.size() << " requests, "
+              << m_errors << " errors" << std::endl
+              << "p50: " << percentile(50) << " ms" << std::endl
+              << "p99: " << percentile(99) << " ms" << std::endl
+              << "throughput: " << m_latencies.size() / seconds << " requests/s" << std::endl;
+}
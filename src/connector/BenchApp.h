@@ -0,0 +1,52 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHAPP_H_
+#define BENCHAPP_H_
+
+#include "AppBase.h"
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QVector>
+
+class BenchClient;
+
+class BenchApp : public AppBase
+{
+public:
+    BenchApp();
+    virtual bool start(const QStringList&);
+
+private:
+    void handleResponse(BenchClient*, const QByteArray&);
+    void handleAssociation(BenchClient*, const QJsonObject&);
+    void sendNext(BenchClient*);
+    void report();
+
+    QString m_action;
+    QStringList m_urls;
+    QVector<BenchClient*> m_clients;
+    int m_associated;
+    int m_requests;
+    int m_sent;
+    int m_errors;
+    QVector<qint64> m_latencies;
+    QElapsedTimer m_elapsed;
+};
+
+#endif /* BENCHAPP_H_ */
@@ -0,0 +1,219 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DaemonApp.h"
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <sodium/randombytes.h>
+
+#ifndef Q_OS_WIN
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+// the daemon exits when no frontend used it for this long
+const int DAEMON_IDLE_TIMEOUT = 10 * 60 * 1000;
+
+// The daemon keeps one session with KeePassXC for an identity. Frontends
+// connect to it through a per-user socket and send plain requests, the
+// daemon encrypts them, passes them to KeePassXC one at a time and returns
+// the decrypted answers.
+DaemonApp::DaemonApp()
+    : m_ready(false)
+    , m_waiting(false)
+{
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(DAEMON_IDLE_TIMEOUT);
+    connect(&m_idleTimer, &QTimer::timeout, QCoreApplication::instance(), &QCoreApplication::quit);
+}
+
+bool DaemonApp::start(const QStringList& args)
+{
+    if (!loadIdentity()) {
+        qCritical().noquote() << "Failed to load the identity from " << idPath();
+        return false;
+    }
+
+    // a session of its own, frontends connecting directly keep theirs
+    QByteArray clientId(24, '\0');
+    randombytes_buf(clientId.data(), clientId.size());
+    setClientId(clientId.toBase64());
+
+    if (!listen(daemonSocketPath(idPath())))
+        return false;
+    connect(&m_server, &QLocalServer::newConnection, this, &DaemonApp::newFrontend);
+
+    connect(this, &AppBase::responseReceived, this, &DaemonApp::handleResponse);
+
+    if (!connectToServer(false) || !changePublicKeys()) {
+        disconnect(this, &AppBase::responseReceived, this, &DaemonApp::handleResponse);
+        m_server.close();
+        return false;
+    }
+
+    if (args.contains("detach"))
+        detach();
+
+    m_idleTimer.start();
+    return true;
+}
+
+// Two daemons started at the same time must not remove each other's socket.
+// A socket file only gets removed if nobody answers on it, it's a leftover
+// of a daemon that was killed.
+bool DaemonApp::listen(const QString& path)
+{
+    m_server.setSocketOptions(QLocalServer::UserAccessOption);
+    if (m_server.listen(path))
+        return true;
+
+    if (m_server.serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalSocket probe;
+        probe.connectToServer(path);
+        if (probe.waitForConnected(100)) {
+            qCritical() << "A connector daemon for this identity is already running";
+            return false;
+        }
+
+        QLocalServer::removeServer(path);
+        if (m_server.listen(path))
+            return true;
+    }
+
+    qCritical().noquote() << "Failed to listen on" << path << ":" << m_server.errorString();
+    return false;
+}
+
+void DaemonApp::handleResponse(QByteArray data)
+{
+    const auto obj = QJsonDocument::fromJson(data).object();
+    const auto act = obj["action"].toString();
+
+    if (!m_ready) {
+        const auto pk = obj["publicKey"].toString();
+        if (act != "change-public-keys" || pk.isEmpty()) {
+            qCritical().noquote() << "KeePassXC refused the key exchange:" << data;
+            QCoreApplication::exit(1);
+            return;
+        }
+
+        setRemotePublicKey(pk);
+        m_ready = true;
+        dispatch();
+        return;
+    }
+
+    // notifications like database-locked are no answers
+    if (!m_waiting || (!obj.isEmpty() && act != m_action))
+        return;
+
+    QJsonObject answer { {"action", m_action} };
+    if (obj.isEmpty()) {
+        answer["error"] = "Received an unexpected answer from KeePassXC";
+    } else if (obj.contains("error")) {
+        answer["error"] = obj["error"];
+        answer["errorCode"] = obj["errorCode"];
+    } else {
+        answer["message"] = extractMessage(obj);
+    }
+
+    m_waiting = false;
+    reply(m_frontend, answer);
+    m_idleTimer.start();
+    dispatch();
+}
+
+void DaemonApp::newFrontend()
+{
+    while (QLocalSocket* frontend = m_server.nextPendingConnection()) {
+        m_splitters.insert(frontend, LocalMessageSplitter(NATIVE_MSG_MAX_LENGTH));
+        connect(frontend, &QLocalSocket::readyRead, this, [this, frontend]() { readRequest(frontend); });
+        connect(frontend, &QLocalSocket::disconnected, this, [this, frontend]() { m_splitters.remove(frontend); });
+        connect(frontend, &QLocalSocket::disconnected, frontend, &QObject::deleteLater);
+    }
+}
+
+// a frontend may send its next requests before the answers arrive, they are queued one by one
+void DaemonApp::readRequest(QLocalSocket* frontend)
+{
+    auto splitter = m_splitters.find(frontend);
+    if (splitter == m_splitters.end())
+        return;
+
+    splitter->append(frontend->readAll());
+    QByteArray data;
+    while (splitter->takeMessage(data)) {
+        const auto request = QJsonDocument::fromJson(data).object();
+        if (request["action"].toString().isEmpty()) {
+            reply(frontend, { {"error", "Invalid request"} });
+            continue;
+        }
+
+        m_pending.enqueue(qMakePair(QPointer<QLocalSocket>(frontend), request));
+    }
+
+    if (splitter->hasError()) {
+        reply(frontend, { {"error", "Invalid request"} });
+        m_splitters.erase(splitter);
+        frontend->disconnectFromServer();
+    }
+
+    m_idleTimer.start();
+    dispatch();
+}
+
+// KeePassXC answers the requests of a connection one at a time and in order
+void DaemonApp::dispatch()
+{
+    while (m_ready && !m_waiting && !m_pending.isEmpty()) {
+        const auto request = m_pending.dequeue();
+        if (!request.first)
+            continue;
+
+        m_frontend = request.first;
+        m_action = request.second["action"].toString();
+        m_waiting = sendRequest(m_action, request.second["message"].toObject());
+        if (!m_waiting)
+            reply(m_frontend, { {"action", m_action}, {"error", "Failed to send the request to KeePassXC"} });
+    }
+}
+
+void DaemonApp::reply(QLocalSocket* frontend, const QJsonObject& answer)
+{
+    if (!frontend || frontend->state() != QLocalSocket::ConnectedState)
+        return;
+
+    frontend->write(QJsonDocument(answer).toJson(QJsonDocument::Compact));
+    frontend->flush();
+}
+
+void DaemonApp::detach()
+{
+#ifndef Q_OS_WIN
+    // the frontend that started the daemon may wait until its output is closed, git does
+    const int devnull = open("/dev/null", O_RDWR);
+    if (devnull != -1) {
+        dup2(devnull, STDIN_FILENO);
+        dup2(devnull, STDOUT_FILENO);
+        dup2(devnull, STDERR_FILENO);
+        if (devnull > STDERR_FILENO)
+            close(devnull);
+    }
+    setsid();
+#endif
+}
@@ -0,0 +1,60 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DAEMONAPP_H_
+#define DAEMONAPP_H_
+
+#include "AppBase.h"
+
+#include <QHash>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QPair>
+#include <QPointer>
+#include <QQueue>
+#include <QTimer>
+
+class DaemonApp : public AppBase
+{
+    typedef QPair<QPointer<QLocalSocket>, QJsonObject> Request;
+
+public:
+    DaemonApp();
+    virtual bool start(const QStringList&);
+
+private slots:
+    void handleResponse(QByteArray);
+    void newFrontend();
+
+private:
+    bool listen(const QString&);
+    void readRequest(QLocalSocket*);
+    void dispatch();
+    void reply(QLocalSocket*, const QJsonObject&);
+    void detach();
+
+    QLocalServer m_server;
+    QHash<QLocalSocket*, LocalMessageSplitter> m_splitters;
+    QQueue<Request> m_pending;
+    QPointer<QLocalSocket> m_frontend;
+    QString m_action;
+    bool m_ready;
+    bool m_waiting;
+    QTimer m_idleTimer;
+};
+
+#endif /* DAEMONAPP_H_ */
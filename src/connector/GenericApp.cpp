@@ -21,6 +21,7 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QTextStream>
 #include <iostream>
 
 bool GenericApp::start(const QStringList& args)
@@ -41,6 +42,23 @@ bool GenericApp::start(const QStringList& args)
         }
 
         m_action = Action::Get;
+
+        // several URLs, or "-" to read them line by line from stdin, are looked up in one request
+        m_urls = args.mid(1);
+        if (m_urls == QStringList("-")) {
+            m_urls.clear();
+            QTextStream stream(stdin, QIODevice::ReadOnly);
+            while (!stream.atEnd()) {
+                const auto line = stream.readLine().trimmed();
+                if (!line.isEmpty())
+                    m_urls << line;
+            }
+        }
+
+        if (m_urls.isEmpty()) {
+            qCritical() << "No URL to filter given";
+            return false;
+        }
     } else if (args.first() == "init") {
         m_action = Action::Init;
     } else if (args.first() == "lockdb") {
@@ -62,7 +80,9 @@ bool GenericApp::start(const QStringList& args)
 
     connect(this, &AppBase::responseReceived, this, &GenericApp::handleResponse);
 
-    if (!connectToServer()) {
+    // a new identity and the check for KeePassXC itself bypass the daemon
+    const bool allowDaemon = m_action != Action::Init && m_action != Action::Ping;
+    if (!connectToServer(allowDaemon)) {
         disconnect(this, &AppBase::responseReceived, this, &GenericApp::handleResponse);
         return false;
     }
@@ -79,7 +99,7 @@ bool GenericApp::start(const QStringList& args)
         break;
 
     case Action::Get:
-        if (getLogins(args.at(1)))
+        if (m_urls.size() == 1 ? getLogins(m_urls.first()) : getLogins(m_urls))
             return true;
         break;
 
@@ -149,13 +169,29 @@ void GenericApp::handleResponse(QByteArray data)
 
     case Action::Get:
         Q_ASSERT(act == "get-logins");
-        for (auto entry : extractMessage(obj).value("entries").toArray()) {
-            const auto o = entry.toObject();
-            const auto sep = "\t";
-            std::cout << o["name"].toString().toStdString()
-                      << sep << o["login"].toString().toStdString()
-                      << sep << o["password"].toString().toStdString()
-                      << std::endl;
+        if (m_urls.size() == 1) {
+            for (auto entry : extractMessage(obj).value("entries").toArray()) {
+                const auto o = entry.toObject();
+                const auto sep = "\t";
+                std::cout << o["name"].toString().toStdString()
+                          << sep << o["login"].toString().toStdString()
+                          << sep << o["password"].toString().toStdString()
+                          << std::endl;
+            }
+        } else {
+            // a batch prints the URL in front of each entry, in the order the URLs were given
+            const auto results = extractMessage(obj).value("results").toObject();
+            for (const auto& url : m_urls) {
+                for (auto entry : results.value(url).toArray()) {
+                    const auto o = entry.toObject();
+                    const auto sep = "\t";
+                    std::cout << url.toStdString()
+                              << sep << o["name"].toString().toStdString()
+                              << sep << o["login"].toString().toStdString()
+                              << sep << o["password"].toString().toStdString()
+                              << std::endl;
+                }
+            }
         }
         break;
 
@@ -169,7 +205,9 @@ void GenericApp::handleResponse(QByteArray data)
             associate();
             return;
         } else if (act == "associate") {
-            qDebug() << extractMessage(obj);
+            const auto message = extractMessage(obj);
+            qDebug() << message;
+            setAssociationId(message["id"].toString());
 
             if (!storeIdentity())
                 qCritical().noquote() << "Failed to initialize the identity storage"
@@ -39,6 +39,7 @@ private slots:
 
 private:
     Action m_action;
+    QStringList m_urls;
 };
 
 #endif /* GENERICAPP_H_ */
@@ -34,7 +34,8 @@ bool ProxyApp::start(const QStringList& args)
     (void)args;
     connect(this, &AppBase::responseReceived, this, &ProxyApp::handleResponse);
 
-    if (!connectToServer()) {
+    // the browser encrypts its messages itself
+    if (!connectToServer(false)) {
         disconnect(this, &AppBase::responseReceived, this, &ProxyApp::handleResponse);
         return false;
     }
@@ -17,6 +17,8 @@
 *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "BenchApp.h"
+#include "DaemonApp.h"
 #include "GenericApp.h"
 #include "GitApp.h"
 #include "ProxyApp.h"
@@ -57,6 +59,8 @@ void catchUnixSignals(std::initializer_list<int> quitSignals)
 int main(int argc, char* argv[])
 {
     // keepassxc-connector [-i identity-file] [-m mode] init|get|store|erase
+    // keepassxc-connector [-i identity-file] -m daemon
+    // keepassxc-connector [-i identity-file] -m bench action [requests] [concurrency]
     // keepassxc-proxy
     // git-credential-keepassxc [-i identity-file] get|store|erase
     // pinentry-keepassxc [-i identity-file]
@@ -71,7 +75,7 @@ int main(int argc, char* argv[])
     parser.addVersionOption();
     parser.addOption({"i", "Use <file> to identify to KeePassXC.", "file"});
 
-    enum Mode { generic, askpass, git, pinentry, proxy } mode;
+    enum Mode { generic, askpass, bench, daemon, git, pinentry, proxy } mode;
     {
         const auto prog_name = QFileInfo(app.arguments().first()).fileName();
         if (prog_name == "git-credential-keepassxc") {
@@ -85,18 +89,25 @@ int main(int argc, char* argv[])
             mode = proxy;
         } else {
             mode = generic;
-            parser.addOption({"m", "Operation mode: askpass, git-credential, pinentry", "mode"});
             parser.addPositionalArgument("command", "action to execute");
         }
     }
+    // clients spawn the daemon as "<own executable> -m daemon", so every entry point must accept it
+    parser.addOption({"m", "Operation mode: askpass, bench, daemon, git-credential, pinentry", "mode"});
 
     parser.process(app);
 
-    if (mode == generic && parser.isSet("m")) {
+    if (parser.isSet("m") && parser.value("m") == "daemon") {
+        mode = daemon;
+    } else if (mode == generic && parser.isSet("m")) {
         const auto arg_m = parser.value("m");
 
         if (arg_m == "askpass") {
             mode = askpass;
+        } else if (arg_m == "bench") {
+            mode = bench;
+        } else if (arg_m == "daemon") {
+            mode = daemon;
         } else if (arg_m == "git" || arg_m == "git-credential") {
             mode = git;
         } else if (arg_m == "pinentry") {
@@ -112,6 +123,10 @@ int main(int argc, char* argv[])
     QScopedPointer<AppBase> handler;
     if (mode == proxy) {
         handler.reset(new ProxyApp());
+    } else if (mode == bench) {
+        handler.reset(new BenchApp());
+    } else if (mode == daemon) {
+        handler.reset(new DaemonApp());
     } else if (mode == git) {
         handler.reset(new GitApp());
 /*
@@ -20,11 +20,15 @@
 
 #include <QDebug>
 #include <QFile>
+#include <QFutureWatcher>
+#include <QMutexLocker>
 #include <QSaveFile>
 #include <QTemporaryFile>
 #include <QTextStream>
+#include <QThread>
 #include <QTimer>
 #include <QXmlStreamReader>
+#include <QtConcurrent>
 
 #include "cli/Utils.h"
 #include "core/Group.h"
@@ -37,11 +41,27 @@
 #include "keys/PasswordKey.h"
 
 QHash<QUuid, Database*> Database::m_uuidMap;
+// databases may be created and deleted on worker threads while loading
+static QMutex s_uuidMapMutex;
+
+namespace
+{
+    QVariantMap kdfParameters(const QSharedPointer<Kdf>& kdf, bool withSeed = true)
+    {
+        QVariantMap parameters = kdf->writeParameters();
+        if (!withSeed) {
+            parameters.remove(KeePass2::KDFPARAM_AES_SEED);
+            parameters.remove(KeePass2::KDFPARAM_ARGON2_SALT);
+        }
+        return parameters;
+    }
+} // namespace
 
 Database::Database()
     : m_metadata(new Metadata(this))
     , m_timer(new QTimer(this))
     , m_emitModified(false)
+    , m_saveWatcher(new QFutureWatcher<QString>(this))
     , m_uuid(QUuid::createUuid())
 {
     m_data.cipher = KeePass2::CIPHER_AES;
@@ -52,21 +72,30 @@ Database::Database()
     m_data.kdf = QSharedPointer<AesKdf>::create(true);
     m_data.kdf->randomizeSeed();
     m_data.hasKey = false;
+    m_data.hasRawKey = false;
 
     setRootGroup(new Group());
     rootGroup()->setUuid(QUuid::createUuid());
     m_timer->setSingleShot(true);
 
-    m_uuidMap.insert(m_uuid, this);
+    {
+        QMutexLocker locker(&s_uuidMapMutex);
+        m_uuidMap.insert(m_uuid, this);
+    }
 
     connect(m_metadata, SIGNAL(modified()), this, SIGNAL(modifiedImmediate()));
     connect(m_metadata, SIGNAL(nameTextChanged()), this, SIGNAL(nameTextChanged()));
     connect(this, SIGNAL(modifiedImmediate()), this, SLOT(startModifiedTimer()));
     connect(m_timer, SIGNAL(timeout()), SIGNAL(modified()));
+    connect(m_saveWatcher, SIGNAL(finished()), SLOT(asyncSaveFinished()));
 }
 
 Database::~Database()
 {
+    // the snapshot must not be deleted while it is being written
+    m_saveWatcher->waitForFinished();
+
+    QMutexLocker locker(&s_uuidMapMutex);
     m_uuidMap.remove(m_uuid);
 }
 
@@ -284,7 +313,9 @@ bool Database::setKey(const CompositeKey& key, bool updateChangedTime, bool upda
 
     m_data.key = key;
     m_data.transformedMasterKey = transformedMasterKey;
+    m_data.transformedKdfParameters = kdfParameters(m_data.kdf);
     m_data.hasKey = true;
+    m_data.hasRawKey = true;
     if (updateChangedTime) {
         m_metadata->setMasterKeyChanged(QDateTime::currentDateTimeUtc());
     }
@@ -296,11 +327,72 @@ bool Database::setKey(const CompositeKey& key, bool updateChangedTime, bool upda
     return true;
 }
 
+/**
+ * Set the key together with its known transformation, which skips the key derivation.
+ * The transformed key has to be the result of the current KDF and its seed.
+ *
+ * @param key key to set
+ * @param transformedMasterKey key transformed with the current KDF
+ */
+void Database::setTransformedKey(const CompositeKey& key, const QByteArray& transformedMasterKey)
+{
+    QByteArray oldTransformedMasterKey = m_data.transformedMasterKey;
+
+    m_data.key = key;
+    m_data.transformedMasterKey = transformedMasterKey;
+    m_data.transformedKdfParameters = kdfParameters(m_data.kdf);
+    m_data.hasKey = true;
+    m_data.hasRawKey = true;
+
+    if (oldTransformedMasterKey != m_data.transformedMasterKey) {
+        emit modifiedImmediate();
+    }
+}
+
+/**
+ * Set only the transformed key, the key it was derived from stays unknown.
+ * The database can be saved as long as the KDF and its seed are kept, but the
+ * key can't be derived again with a new seed or KDF.
+ *
+ * @param transformedMasterKey key transformed with the current KDF
+ */
+void Database::setTransformedKey(const QByteArray& transformedMasterKey)
+{
+    setTransformedKey(CompositeKey(), transformedMasterKey);
+    m_data.hasRawKey = false;
+}
+
 bool Database::hasKey() const
 {
     return m_data.hasKey;
 }
 
+/**
+ * @return true if the key the transformed key was derived from is known
+ */
+bool Database::hasRawKey() const
+{
+    return m_data.hasRawKey;
+}
+
+/**
+ * @return true if the transformed master key was derived with the current KDF
+ *         parameters and seed, so it doesn't need to be derived again
+ */
+bool Database::isTransformedKeyCurrent() const
+{
+    return m_data.hasKey && !m_data.transformedMasterKey.isEmpty()
+           && m_data.transformedKdfParameters == kdfParameters(m_data.kdf);
+}
+
+/**
+ * @return true if the database KDF has the same type and parameters as the given one, apart from the seed
+ */
+bool Database::hasKdfParameters(QSharedPointer<Kdf> kdf) const
+{
+    return kdf->uuid() == m_data.kdf->uuid() && kdfParameters(kdf, false) == kdfParameters(m_data.kdf, false);
+}
+
 bool Database::verifyKey(const CompositeKey& key) const
 {
     Q_ASSERT(hasKey());
@@ -319,7 +411,7 @@ bool Database::verifyKey(const CompositeKey& key) const
         }
     }
 
-    return (m_data.key.rawKey() == key.rawKey());
+    return m_data.key.matches(key);
 }
 
 QVariantMap& Database::publicCustomData()
@@ -415,6 +507,7 @@ const QUuid& Database::uuid()
 
 Database* Database::databaseByUuid(const QUuid& uuid)
 {
+    QMutexLocker locker(&s_uuidMapMutex);
     return m_uuidMap.value(uuid, 0);
 }
 
@@ -505,6 +598,11 @@ Database* Database::unlockFromStdin(QString databaseFilename, QString keyFilenam
  */
 QString Database::saveToFile(QString filePath, bool atomic, bool backup)
 {
+    // Finish a running background save first, so it can't overwrite this newer state.
+    // Anything queued is covered by this save.
+    waitForAsyncSave();
+    m_pendingSave.reset();
+
     QString error;
     if (atomic) {
         QSaveFile saveFile(filePath);
@@ -562,12 +660,205 @@ QString Database::saveToFile(QString filePath, bool atomic, bool backup)
     return error;
 }
 
+/**
+ * Save the database to a file without blocking the caller.
+ *
+ * A snapshot of the database is taken immediately and written on a worker
+ * thread, saveFinished() is emitted once the file has been written.
+ * If a save is already running, the request is queued and a fresh snapshot
+ * is taken when the running save finishes, so edits made in the meantime
+ * end up in the next save. Multiple queued requests are coalesced.
+ *
+ * @param filePath Absolute path of the file to save
+ * @param atomic Use atomic file transactions
+ * @param backup Backup the existing database file, if exists
+ */
+void Database::saveToFileAsync(const QString& filePath, bool atomic, bool backup)
+{
+    SaveRequest request;
+    request.filePath = filePath;
+    request.atomic = atomic;
+    request.backup = backup;
+
+    if (isSaving()) {
+        m_pendingSave.reset(new SaveRequest(request));
+        return;
+    }
+
+    startAsyncSave(request);
+}
+
+/**
+ * @return true if a background save is running or queued
+ */
+bool Database::isSaving() const
+{
+    return !m_saveSnapshot.isNull() || !m_pendingSave.isNull();
+}
+
+void Database::startAsyncSave(const SaveRequest& request)
+{
+    Q_ASSERT(m_saveSnapshot.isNull());
+
+    m_currentSave = request;
+    m_saveKdf = m_data.kdf;
+    m_saveSnapshot.reset(snapshot());
+
+    // The snapshot and its children belong to the worker while it writes them.
+    // An object without a thread can be pulled by the worker and pushed back when done.
+    Database* snapshot = m_saveSnapshot.data();
+    QThread* owner = thread();
+    snapshot->moveToThread(nullptr);
+    m_saveWatcher->setFuture(QtConcurrent::run([snapshot, request, owner]() {
+        snapshot->moveToThread(QThread::currentThread());
+        QString errorString = snapshot->saveToFile(request.filePath, request.atomic, request.backup);
+        snapshot->moveToThread(owner);
+        return errorString;
+    }));
+}
+
+void Database::asyncSaveFinished()
+{
+    if (m_saveSnapshot.isNull()) {
+        // already collected by waitForAsyncSave()
+        return;
+    }
+
+    QString errorString = m_saveWatcher->result();
+    SaveRequest finished = m_currentSave;
+
+    // The writer re-transforms the key if it was not current. Keep the in-memory key
+    // in sync with the file unless it has been changed while saving.
+    if (errorString.isEmpty() && m_data.kdf == m_saveKdf && m_data.key.matches(m_saveSnapshot->key())) {
+        m_data.kdf = m_saveSnapshot->m_data.kdf;
+        m_data.transformedMasterKey = m_saveSnapshot->m_data.transformedMasterKey;
+        m_data.transformedKdfParameters = m_saveSnapshot->m_data.transformedKdfParameters;
+    }
+
+    m_saveSnapshot.reset();
+    m_saveKdf.reset();
+
+    // start the queued save before notifying, so isSaving() reflects it
+    if (m_pendingSave) {
+        SaveRequest next = *m_pendingSave;
+        m_pendingSave.reset();
+        startAsyncSave(next);
+    }
+
+    emit saveFinished(finished.filePath, errorString);
+}
+
+/**
+ * Block until the running and any queued background save are written.
+ *
+ * Call this before locking or closing a database, deleting it would only wait for
+ * the running save, drop a queued one and never deliver the result.
+ * saveFinished() is emitted for every save like it would have been asynchronously.
+ */
+void Database::finishAsyncSave()
+{
+    while (!m_saveSnapshot.isNull()) {
+        m_saveWatcher->waitForFinished();
+        asyncSaveFinished();
+    }
+}
+
+/**
+ * Wait for a running background save to finish.
+ *
+ * Only the synchronous save calls this, it writes a newer state and reports
+ * its own result, so saveFinished() is not emitted for the superseded save.
+ */
+void Database::waitForAsyncSave()
+{
+    if (m_saveSnapshot.isNull()) {
+        return;
+    }
+
+    m_saveWatcher->waitForFinished();
+    m_saveSnapshot.reset();
+    m_saveKdf.reset();
+}
+
+/**
+ * Create a detached copy of the database for writing it on another thread.
+ *
+ * Strings, binaries and icons are implicitly shared with this database, so
+ * the copy is cheap and later edits of this database don't affect it.
+ * The caller takes ownership of the returned database.
+ *
+ * @return database snapshot
+ */
+Database* Database::snapshot() const
+{
+    auto* db = new Database();
+    db->m_data = m_data;
+    db->m_data.kdf = m_data.kdf->clone();
+    db->m_deletedObjects = m_deletedObjects;
+
+    Group* oldRoot = db->rootGroup();
+    db->setRootGroup(cloneGroupTree(m_rootGroup));
+    delete oldRoot;
+
+    Metadata* metadata = db->metadata();
+    metadata->setUpdateDatetime(false);
+    metadata->copyAttributesFrom(m_metadata);
+    metadata->copyCustomIconsFrom(m_metadata);
+    metadata->customData()->copyDataFrom(m_metadata->customData());
+    if (m_metadata->recycleBin()) {
+        metadata->setRecycleBin(db->resolveGroup(m_metadata->recycleBin()->uuid()));
+    }
+    if (m_metadata->entryTemplatesGroup()) {
+        metadata->setEntryTemplatesGroup(db->resolveGroup(m_metadata->entryTemplatesGroup()->uuid()));
+    }
+    if (m_metadata->lastSelectedGroup()) {
+        metadata->setLastSelectedGroup(db->resolveGroup(m_metadata->lastSelectedGroup()->uuid()));
+    }
+    if (m_metadata->lastTopVisibleGroup()) {
+        metadata->setLastTopVisibleGroup(db->resolveGroup(m_metadata->lastTopVisibleGroup()->uuid()));
+    }
+    metadata->setRecycleBinChanged(m_metadata->recycleBinChanged());
+    metadata->setEntryTemplatesGroupChanged(m_metadata->entryTemplatesGroupChanged());
+    metadata->setMasterKeyChanged(m_metadata->masterKeyChanged());
+    metadata->setSettingsChanged(m_metadata->settingsChanged());
+    metadata->setUpdateDatetime(true);
+
+    return db;
+}
+
+/**
+ * Deep copy a group tree keeping uuids and all time info intact.
+ */
+Group* Database::cloneGroupTree(const Group* group)
+{
+    Group* clonedGroup = group->clone(Entry::CloneNoFlags, Group::CloneNoFlags);
+    clonedGroup->setUpdateTimeinfo(false);
+
+    for (const Entry* entry : group->entries()) {
+        Entry* clonedEntry = entry->clone(Entry::CloneIncludeHistory);
+        clonedEntry->setUpdateTimeinfo(false);
+        clonedEntry->setGroup(clonedGroup);
+        clonedEntry->setUpdateTimeinfo(true);
+    }
+
+    for (const Group* child : group->children()) {
+        Group* clonedChild = cloneGroupTree(child);
+        clonedChild->setUpdateTimeinfo(false);
+        clonedChild->setParent(clonedGroup);
+        clonedChild->setUpdateTimeinfo(true);
+    }
+
+    clonedGroup->setUpdateTimeinfo(true);
+    return clonedGroup;
+}
+
 QString Database::writeDatabase(QIODevice* device)
 {
     KeePass2Writer writer;
+    bool emitModified = m_emitModified;
     setEmitModified(false);
     writer.writeDatabase(device, this);
-    setEmitModified(true);
+    setEmitModified(emitModified);
 
     if (writer.hasError()) {
         // the writer failed
@@ -603,8 +894,22 @@ void Database::setKdf(QSharedPointer<Kdf> kdf)
     m_data.kdf = std::move(kdf);
 }
 
+/**
+ * Change the KDF and transform the key with it and a new seed.
+ * Nothing is transformed if the database already uses a KDF with the same parameters.
+ *
+ * @param kdf new KDF
+ * @return true on success
+ */
 bool Database::changeKdf(QSharedPointer<Kdf> kdf)
 {
+    if (isTransformedKeyCurrent() && hasKdfParameters(kdf)) {
+        return true;
+    }
+    if (!m_data.hasRawKey) {
+        return false;
+    }
+
     kdf->randomizeSeed();
     QByteArray transformedMasterKey;
     if (!m_data.key.transform(*kdf, transformedMasterKey)) {
@@ -613,6 +918,7 @@ bool Database::changeKdf(QSharedPointer<Kdf> kdf)
 
     setKdf(kdf);
     m_data.transformedMasterKey = transformedMasterKey;
+    m_data.transformedKdfParameters = kdfParameters(m_data.kdf);
     emit modifiedImmediate();
 
     return true;
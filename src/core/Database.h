@@ -22,6 +22,7 @@
 #include <QDateTime>
 #include <QHash>
 #include <QObject>
+#include <QScopedPointer>
 
 #include "crypto/kdf/Kdf.h"
 #include "keys/CompositeKey.h"
@@ -32,6 +33,7 @@ class Group;
 class Metadata;
 class QTimer;
 class QIODevice;
+template <typename T> class QFutureWatcher;
 
 struct DeletedObject
 {
@@ -58,9 +60,11 @@ public:
         QUuid cipher;
         CompressionAlgorithm compressionAlgo;
         QByteArray transformedMasterKey;
+        QVariantMap transformedKdfParameters;
         QSharedPointer<Kdf> kdf;
         CompositeKey key;
         bool hasKey;
+        bool hasRawKey;
         QByteArray masterSeed;
         QByteArray challengeResponseKey;
         QVariantMap publicCustomData;
@@ -101,7 +105,12 @@ public:
     void setCompressionAlgo(Database::CompressionAlgorithm algo);
     void setKdf(QSharedPointer<Kdf> kdf);
     bool setKey(const CompositeKey& key, bool updateChangedTime = true, bool updateTransformSalt = false);
+    void setTransformedKey(const CompositeKey& key, const QByteArray& transformedMasterKey);
+    void setTransformedKey(const QByteArray& transformedMasterKey);
     bool hasKey() const;
+    bool hasRawKey() const;
+    bool isTransformedKeyCurrent() const;
+    bool hasKdfParameters(QSharedPointer<Kdf> kdf) const;
     bool verifyKey(const CompositeKey& key) const;
     QVariantMap& publicCustomData();
     const QVariantMap& publicCustomData() const;
@@ -112,6 +121,10 @@ public:
     void setEmitModified(bool value);
     void merge(const Database* other);
     QString saveToFile(QString filePath, bool atomic = true, bool backup = false);
+    void saveToFileAsync(const QString& filePath, bool atomic = true, bool backup = false);
+    bool isSaving() const;
+    void finishAsyncSave();
+    Database* snapshot() const;
 
     /**
      * Returns a unique id that is only valid as long as the Database exists.
@@ -134,18 +147,30 @@ signals:
     void nameTextChanged();
     void modified();
     void modifiedImmediate();
+    void saveFinished(const QString& filePath, const QString& errorString);
 
 private slots:
     void startModifiedTimer();
+    void asyncSaveFinished();
 
 private:
     Entry* findEntryRecursive(const QUuid& uuid, Group* group);
     Entry* findEntryRecursive(const QString& text, EntryReferenceType referenceType, Group* group);
     Group* findGroupRecursive(const QUuid& uuid, Group* group);
 
+    struct SaveRequest
+    {
+        QString filePath;
+        bool atomic;
+        bool backup;
+    };
+
     void createRecycleBin();
     QString writeDatabase(QIODevice* device);
     bool backupDatabase(QString filePath);
+    void startAsyncSave(const SaveRequest& request);
+    void waitForAsyncSave();
+    static Group* cloneGroupTree(const Group* group);
 
     Metadata* const m_metadata;
     Group* m_rootGroup;
@@ -154,6 +179,12 @@ private:
     DatabaseData m_data;
     bool m_emitModified;
 
+    QFutureWatcher<QString>* m_saveWatcher;
+    QScopedPointer<Database> m_saveSnapshot;
+    QSharedPointer<Kdf> m_saveKdf;
+    SaveRequest m_currentSave;
+    QScopedPointer<SaveRequest> m_pendingSave;
+
     QUuid m_uuid;
     static QHash<QUuid, Database*> m_uuidMap;
 };
@@ -0,0 +1,437 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseLoader.h"
+
+#include <QFile>
+#include <QFutureInterface>
+#include <QMutex>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <functional>
+
+#include "core/Database.h"
+#include "core/Entry.h"
+#include "core/Group.h"
+#include "format/KeePass2Reader.h"
+
+const quint64 DatabaseLoader::DefaultMemoryBudget = 2048ull * 1024 * 1024;
+
+namespace
+{
+    QMutex s_memoryMutex;
+    quint64 s_memoryBudget = DatabaseLoader::DefaultMemoryBudget;
+    quint64 s_memoryInUse = 0;
+
+    // key derivations keep their thread busy for seconds, they get a pool of their own
+    Q_GLOBAL_STATIC(QThreadPool, s_loadPool)
+} // namespace
+
+/**
+ * A load waiting in line until the memory of its key derivation fits into
+ * the budget. Only admitted loads are handed to the pool, so a waiting load
+ * doesn't hold a thread.
+ */
+class DatabaseLoader::LoadJob : public QRunnable
+{
+public:
+    LoadJob(const std::function<Result(quint64&)>& work, quint64 memory, const QSharedPointer<QAtomicInt>& cancelled)
+        : m_work(work)
+        , m_memory(memory)
+        , m_cancelled(cancelled)
+    {
+        // a running future can be waited for before the load got a thread
+        m_promise.reportStarted();
+    }
+
+    QFuture<Result> future()
+    {
+        return m_promise.future();
+    }
+
+    void run() override
+    {
+        quint64 reservedMemory = m_memory;
+        const Result result = m_work(reservedMemory);
+        releaseMemory(reservedMemory);
+        m_promise.reportResult(result);
+        m_promise.reportFinished();
+    }
+
+    static void enqueue(LoadJob* job);
+    static void discard(const QAtomicInt* cancelled);
+    static void releaseMemory(quint64 bytes);
+    static void startAdmitted();
+
+    std::function<Result(quint64&)> m_work;
+    const quint64 m_memory;
+    const QSharedPointer<QAtomicInt> m_cancelled;
+    QFutureInterface<Result> m_promise;
+
+    static QList<LoadJob*> s_waiting;
+};
+
+QList<DatabaseLoader::LoadJob*> DatabaseLoader::LoadJob::s_waiting;
+
+void DatabaseLoader::LoadJob::enqueue(LoadJob* job)
+{
+    QMutexLocker locker(&s_memoryMutex);
+    s_waiting.append(job);
+    startAdmitted();
+}
+
+/**
+ * Drop a load that is still waiting for memory, it finishes without a database.
+ */
+void DatabaseLoader::LoadJob::discard(const QAtomicInt* cancelled)
+{
+    QMutexLocker locker(&s_memoryMutex);
+    for (int i = 0; i < s_waiting.size(); ++i) {
+        LoadJob* job = s_waiting.at(i);
+        if (job->m_cancelled.data() == cancelled) {
+            s_waiting.removeAt(i);
+            job->m_promise.reportResult(Result());
+            job->m_promise.reportFinished();
+            delete job;
+            break;
+        }
+    }
+
+    // the loads behind it may fit now
+    startAdmitted();
+}
+
+void DatabaseLoader::LoadJob::releaseMemory(quint64 bytes)
+{
+    if (bytes == 0) {
+        return;
+    }
+
+    QMutexLocker locker(&s_memoryMutex);
+    s_memoryInUse -= bytes;
+    startAdmitted();
+}
+
+/**
+ * Hand the waiting loads that fit into the budget to the pool, in the order
+ * they were started so a big key derivation is not overtaken forever. Loads
+ * that don't derive a key need no memory and never wait.
+ * s_memoryMutex must be locked.
+ */
+void DatabaseLoader::LoadJob::startAdmitted()
+{
+    bool blocked = false;
+    for (int i = 0; i < s_waiting.size();) {
+        LoadJob* job = s_waiting.at(i);
+        if (job->m_memory > 0) {
+            blocked = blocked
+                      || (s_memoryBudget > 0 && s_memoryInUse > 0 && s_memoryInUse + job->m_memory > s_memoryBudget);
+            if (blocked) {
+                ++i;
+                continue;
+            }
+        }
+
+        s_waiting.removeAt(i);
+        s_memoryInUse += job->m_memory;
+        s_loadPool->start(job);
+    }
+}
+
+DatabaseLoader::DatabaseLoader(QObject* parent)
+    : QObject(parent)
+    , m_watcher(nullptr)
+    , m_db(nullptr)
+{
+}
+
+/**
+ * Cancels the current load and waits for loads that are still running,
+ * because they report their progress through this object.
+ */
+DatabaseLoader::~DatabaseLoader()
+{
+    cancel();
+
+    const QList<QFutureWatcherBase*> watchers = findChildren<QFutureWatcherBase*>();
+    for (QFutureWatcherBase* watcherBase : watchers) {
+        auto watcher = static_cast<QFutureWatcher<Result>*>(watcherBase);
+        watcher->waitForFinished();
+        delete watcher->result().db;
+    }
+
+    delete m_db;
+}
+
+/**
+ * Start reading a database file. Any load in progress is canceled.
+ * Emits finished() on completion.
+ *
+ * @param filePath database file
+ * @param key database encryption composite key
+ */
+void DatabaseLoader::load(const QString& filePath, const CompositeKey& key)
+{
+    startLoad(filePath, key, QByteArray(), QByteArray());
+}
+
+/**
+ * Start reading a database file with only the transformed key, the key itself
+ * is not known. Loading fails if the KDF seed of the file has changed since.
+ *
+ * @param filePath database file
+ * @param kdfSeed KDF seed of transformedKey
+ * @param transformedKey key transformed earlier
+ */
+void DatabaseLoader::load(const QString& filePath, const QByteArray& kdfSeed, const QByteArray& transformedKey)
+{
+    startLoad(filePath, CompositeKey(), kdfSeed, transformedKey);
+}
+
+void DatabaseLoader::startLoad(const QString& filePath,
+                               const CompositeKey& key,
+                               const QByteArray& kdfSeed,
+                               const QByteArray& transformedKey)
+{
+    cancel();
+
+    delete m_db;
+    m_db = nullptr;
+    m_errorString.clear();
+
+    // a transformed key without the key itself is never derived again
+    const quint64 memory = transformedKey.isEmpty() ? kdfMemoryUsage(filePath) : 0;
+
+    m_cancelled = QSharedPointer<QAtomicInt>::create(0);
+    QSharedPointer<QAtomicInt> cancelled = m_cancelled;
+    QThread* targetThread = thread();
+    auto job = new LoadJob(
+        [=](quint64& reservedMemory) {
+            return loadDatabase(filePath, key, kdfSeed, transformedKey, cancelled, targetThread, reservedMemory);
+        },
+        memory,
+        cancelled);
+
+    m_watcher = new QFutureWatcher<Result>(this);
+    connect(m_watcher, SIGNAL(finished()), SLOT(loadFinished()));
+    m_watcher->setFuture(job->future());
+    LoadJob::enqueue(job);
+}
+
+/**
+ * Cancel the current load. A load waiting for memory never starts, a running
+ * one stops after the key derivation or while parsing. The result is thrown
+ * away and finished() is not emitted.
+ */
+void DatabaseLoader::cancel()
+{
+    if (!m_watcher) {
+        return;
+    }
+
+    m_cancelled->storeRelease(1);
+    LoadJob::discard(m_cancelled.data());
+    disconnect(m_watcher, SIGNAL(finished()), this, SLOT(loadFinished()));
+    connect(m_watcher, SIGNAL(finished()), SLOT(discardResult()));
+    m_watcher = nullptr;
+}
+
+bool DatabaseLoader::isLoading() const
+{
+    return m_watcher != nullptr;
+}
+
+/**
+ * @return loaded database, the caller takes ownership
+ */
+Database* DatabaseLoader::takeDatabase()
+{
+    Database* db = m_db;
+    m_db = nullptr;
+    return db;
+}
+
+QString DatabaseLoader::errorString() const
+{
+    return m_errorString;
+}
+
+QString DatabaseLoader::phaseText(KdbxReader::ReadPhase phase)
+{
+    switch (phase) {
+    case KdbxReader::ReadPhase::DeriveKey:
+        return tr("Deriving the master key…");
+    case KdbxReader::ReadPhase::Decrypt:
+        return tr("Decrypting the database…");
+    case KdbxReader::ReadPhase::Parse:
+        return tr("Reading the database…");
+    }
+    return QString();
+}
+
+/**
+ * Set the total memory the key derivations of all running loads may use.
+ * A key derivation that needs more than the whole budget runs alone.
+ *
+ * @param bytes memory budget, 0 for no limit
+ */
+void DatabaseLoader::setMemoryBudget(quint64 bytes)
+{
+    QMutexLocker locker(&s_memoryMutex);
+    s_memoryBudget = bytes;
+    LoadJob::startAdmitted();
+}
+
+quint64 DatabaseLoader::memoryBudget()
+{
+    QMutexLocker locker(&s_memoryMutex);
+    return s_memoryBudget;
+}
+
+/**
+ * @return memory currently reserved by admitted key derivations
+ */
+quint64 DatabaseLoader::memoryInUse()
+{
+    QMutexLocker locker(&s_memoryMutex);
+    return s_memoryInUse;
+}
+
+void DatabaseLoader::loadFinished()
+{
+    auto watcher = static_cast<QFutureWatcher<Result>*>(sender());
+    Q_ASSERT(watcher == m_watcher);
+
+    const Result result = watcher->result();
+    m_db = result.db;
+    m_errorString = result.errorString;
+
+    m_watcher = nullptr;
+    watcher->setParent(nullptr);
+    watcher->deleteLater();
+
+    emit finished(m_db != nullptr);
+}
+
+void DatabaseLoader::discardResult()
+{
+    auto watcher = static_cast<QFutureWatcher<Result>*>(sender());
+    delete watcher->result().db;
+
+    watcher->setParent(nullptr);
+    watcher->deleteLater();
+}
+
+/**
+ * Read the database file. This runs on a worker thread once the memory
+ * of the key derivation has been reserved.
+ *
+ * @param reservedMemory memory reserved for the load, set to 0 once it is released
+ */
+DatabaseLoader::Result DatabaseLoader::loadDatabase(const QString& filePath,
+                                                    const CompositeKey& key,
+                                                    const QByteArray& kdfSeed,
+                                                    const QByteArray& transformedKey,
+                                                    QSharedPointer<QAtomicInt> cancelled,
+                                                    QThread* targetThread,
+                                                    quint64& reservedMemory)
+{
+    Result result;
+    if (cancelled->loadAcquire()) {
+        return result;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.errorString = file.errorString();
+        return result;
+    }
+
+    KeePass2Reader reader;
+    reader.setCancelFlag(cancelled.data());
+    if (!transformedKey.isEmpty()) {
+        reader.setTransformedKey(kdfSeed, transformedKey, true);
+    }
+    reader.setProgressCallback([this, cancelled, &reservedMemory](KdbxReader::ReadPhase phase) {
+        if (!cancelled->loadAcquire()) {
+            emit phaseChanged(static_cast<int>(phase));
+        }
+
+        // the key is derived, let the next load in
+        if (phase == KdbxReader::ReadPhase::Decrypt) {
+            LoadJob::releaseMemory(reservedMemory);
+            reservedMemory = 0;
+        }
+    });
+
+    QScopedPointer<Database> db(reader.readDatabase(&file, key));
+    if (!db) {
+        result.errorString = reader.errorString();
+        return result;
+    }
+    if (cancelled->loadAcquire()) {
+        return result;
+    }
+
+    // hand the complete database over to the thread of the loader at once
+    moveDatabaseToThread(db.data(), targetThread);
+    result.db = db.take();
+    return result;
+}
+
+void DatabaseLoader::moveDatabaseToThread(Database* db, QThread* thread)
+{
+    db->moveToThread(thread);
+
+    // history items are not part of the object tree
+    const QList<Entry*> entries = db->rootGroup()->entriesRecursive(true);
+    for (Entry* entry : entries) {
+        if (!entry->parent()) {
+            entry->moveToThread(thread);
+        }
+    }
+}
+
+/**
+ * Read the header of a database file to find out how much memory its key
+ * derivation needs. Only the header is read, on the calling thread.
+ *
+ * @return memory in bytes, 0 if the file can't be read
+ */
+quint64 DatabaseLoader::kdfMemoryUsage(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    KeePass2Reader reader;
+    QAtomicInt stop(0);
+    quint64 memory = 0;
+    reader.setCancelFlag(&stop);
+    reader.setProgressCallback([&reader, &stop, &memory](KdbxReader::ReadPhase phase) {
+        if (phase == KdbxReader::ReadPhase::DeriveKey) {
+            memory = reader.reader()->kdfMemoryUsage();
+            stop.storeRelease(1);
+        }
+    });
+
+    delete reader.readDatabase(&file, CompositeKey());
+    return memory;
+}
@@ -0,0 +1,97 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSXC_DATABASELOADER_H
+#define KEEPASSXC_DATABASELOADER_H
+
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QSharedPointer>
+
+#include "format/KdbxReader.h"
+#include "keys/CompositeKey.h"
+
+class Database;
+class QThread;
+
+/**
+ * Reads a KDBX database on a worker thread.
+ *
+ * Any number of loaders may run at the same time. The memory needed by
+ * their key derivations is limited by a budget shared between all loaders,
+ * a load only gets a thread once its key derivation fits into the budget.
+ */
+class DatabaseLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DatabaseLoader(QObject* parent = nullptr);
+    ~DatabaseLoader() override;
+
+    void load(const QString& filePath, const CompositeKey& key);
+    void load(const QString& filePath, const QByteArray& kdfSeed, const QByteArray& transformedKey);
+    void cancel();
+    bool isLoading() const;
+    Database* takeDatabase();
+    QString errorString() const;
+
+    static QString phaseText(KdbxReader::ReadPhase phase);
+    static void setMemoryBudget(quint64 bytes);
+    static quint64 memoryBudget();
+    static quint64 memoryInUse();
+
+    static const quint64 DefaultMemoryBudget;
+
+signals:
+    void phaseChanged(int phase);
+    void finished(bool success);
+
+private slots:
+    void loadFinished();
+    void discardResult();
+
+private:
+    struct Result
+    {
+        Database* db = nullptr;
+        QString errorString;
+    };
+    class LoadJob;
+
+    void startLoad(const QString& filePath,
+                   const CompositeKey& key,
+                   const QByteArray& kdfSeed,
+                   const QByteArray& transformedKey);
+    Result loadDatabase(const QString& filePath,
+                        const CompositeKey& key,
+                        const QByteArray& kdfSeed,
+                        const QByteArray& transformedKey,
+                        QSharedPointer<QAtomicInt> cancelled,
+                        QThread* targetThread,
+                        quint64& reservedMemory);
+    static void moveDatabaseToThread(Database* db, QThread* thread);
+    static quint64 kdfMemoryUsage(const QString& filePath);
+
+    QFutureWatcher<Result>* m_watcher;
+    QSharedPointer<QAtomicInt> m_cancelled;
+    Database* m_db;
+    QString m_errorString;
+};
+
+#endif // KEEPASSXC_DATABASELOADER_H
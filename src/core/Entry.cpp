@@ -305,6 +305,11 @@ bool Entry::isExpired() const
     return m_data.timeInfo.expires() && m_data.timeInfo.expiryTime() < QDateTime::currentDateTimeUtc();
 }
 
+bool Entry::isRecycled() const
+{
+    return m_group && m_group->isRecycled();
+}
+
 bool Entry::hasReferences() const
 {
     const QList<QString> keyList = EntryAttributes::DefaultAttributes;
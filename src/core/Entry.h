@@ -104,6 +104,7 @@ public:
 
     bool hasTotp() const;
     bool isExpired() const;
+    bool isRecycled() const;
     bool hasReferences() const;
     EntryAttributes* attributes();
     const EntryAttributes* attributes() const;
@@ -249,6 +249,24 @@ bool Group::isExpired() const
     return m_data.timeInfo.expires() && m_data.timeInfo.expiryTime() < QDateTime::currentDateTimeUtc();
 }
 
+/**
+ * @return true if the group is the recycle bin or somewhere inside it
+ */
+bool Group::isRecycled() const
+{
+    if (!m_db) {
+        return false;
+    }
+
+    const Group* recycleBin = m_db->metadata()->recycleBin();
+    for (const Group* group = this; group; group = group->m_parent) {
+        if (group == recycleBin) {
+            return true;
+        }
+    }
+    return false;
+}
+
 CustomData* Group::customData()
 {
     return m_customData;
@@ -95,6 +95,7 @@ public:
     bool resolveAutoTypeEnabled() const;
     Entry* lastTopVisibleEntry() const;
     bool isExpired() const;
+    bool isRecycled() const;
     CustomData* customData();
     const CustomData* customData() const;
 
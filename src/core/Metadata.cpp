@@ -447,6 +447,20 @@ void Metadata::copyCustomIcons(const QSet<QUuid>& iconList, const Metadata* othe
     }
 }
 
+/**
+ * Replace all custom icons with the ones of other, keeping their order.
+ * The image data is implicitly shared, so this is cheap.
+ */
+void Metadata::copyCustomIconsFrom(const Metadata* other)
+{
+    m_customIcons = other->m_customIcons;
+    m_customIconsOrder = other->m_customIconsOrder;
+    m_customIconsHashes = other->m_customIconsHashes;
+    m_customIconCacheKeys.clear();
+    m_customIconScaledCacheKeys.clear();
+    emit modified();
+}
+
 QByteArray Metadata::hashImage(const QImage& image)
 {
     auto data = QByteArray(reinterpret_cast<const char*>(image.bits()), image.byteCount());
@@ -123,6 +123,7 @@ public:
     void addCustomIconScaled(const QUuid& uuid, const QImage& icon);
     void removeCustomIcon(const QUuid& uuid);
     void copyCustomIcons(const QSet<QUuid>& iconList, const Metadata* otherMetadata);
+    void copyCustomIconsFrom(const Metadata* other);
     QUuid findCustomIcon(const QImage& candidate);
     void setRecycleBinEnabled(bool value);
     void setRecycleBin(Group* group);
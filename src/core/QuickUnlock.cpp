@@ -0,0 +1,311 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "QuickUnlock.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+
+#include "core/Config.h"
+#include "core/Database.h"
+#include "core/Tools.h"
+#include "crypto/CryptoHash.h"
+#include "crypto/Random.h"
+#include "crypto/SymmetricCipher.h"
+#include "crypto/kdf/Argon2Kdf.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+const int QuickUnlock::MaxAttempts = 3;
+
+QuickUnlock* QuickUnlock::m_instance = nullptr;
+
+namespace
+{
+    // the PIN only has to withstand the attempt limit, so the stretching is kept well below a second
+    const quint64 PinKdfMemory = 32 * 1024;
+    const int PinKdfRounds = 2;
+    const int IvSize = 16;
+    const int MacSize = 32;
+
+    void zero(QByteArray& data)
+    {
+        volatile char* bytes = data.data();
+        for (int i = 0; i < data.size(); ++i) {
+            bytes[i] = 0;
+        }
+    }
+
+    void wipe(QByteArray& data)
+    {
+        zero(data);
+        data.clear();
+    }
+
+    void lockMemory(QByteArray& data)
+    {
+#ifdef Q_OS_UNIX
+        if (!data.isEmpty()) {
+            mlock(data.constData(), static_cast<size_t>(data.size()));
+        }
+#else
+        Q_UNUSED(data);
+#endif
+    }
+
+    void unlockAndWipe(QByteArray& data)
+    {
+        zero(data);
+#ifdef Q_OS_UNIX
+        if (!data.isEmpty()) {
+            munlock(data.constData(), static_cast<size_t>(data.size()));
+        }
+#endif
+        data.clear();
+    }
+
+    QByteArray encryptionKey(const QByteArray& pinKey)
+    {
+        return CryptoHash::hmac(QByteArray("quick unlock encryption"), pinKey, CryptoHash::Sha256);
+    }
+
+    QByteArray authenticationKey(const QByteArray& pinKey)
+    {
+        return CryptoHash::hmac(QByteArray("quick unlock authentication"), pinKey, CryptoHash::Sha256);
+    }
+} // namespace
+
+QuickUnlock::QuickUnlock(QObject* parent)
+    : QObject(parent)
+{
+}
+
+QuickUnlock::~QuickUnlock()
+{
+    clearAll();
+    m_instance = nullptr;
+}
+
+QuickUnlock* QuickUnlock::instance()
+{
+    if (!m_instance) {
+        m_instance = new QuickUnlock(qApp);
+    }
+
+    return m_instance;
+}
+
+bool QuickUnlock::isEnabled() const
+{
+    return config()->get("security/quickunlock").toBool();
+}
+
+/**
+ * Remember the PIN of a freshly unlocked database for sealing its key on the next lock.
+ *
+ * Only the stretched PIN is kept, the PIN itself is not stored.
+ */
+void QuickUnlock::prepare(const QString& filePath, const QString& pin)
+{
+    clear(filePath);
+    if (!isEnabled() || pin.isEmpty()) {
+        return;
+    }
+
+    Slot& slot = m_slots[filePath];
+    slot.salt = randomGen()->randomArray(32);
+    slot.pinKey = derivePinKey(pin, slot.salt);
+    lockMemory(slot.pinKey);
+    if (slot.pinKey.isEmpty()) {
+        m_slots.remove(filePath);
+    }
+}
+
+/**
+ * Seal the transformed master key of a database that is about to be locked.
+ *
+ * Only the KDF seed and the transformed key are sealed, never the password or
+ * key file data, so the PIN can't reveal the key of the database. The stretched
+ * PIN is wiped afterwards, so the sealed key can only be recovered by entering
+ * the PIN again. Databases with challenge-response keys are never sealed since
+ * their key depends on the hardware token.
+ *
+ * @return true if the database can be quick unlocked
+ */
+bool QuickUnlock::seal(const QString& filePath, const Database* db)
+{
+    auto it = m_slots.find(filePath);
+    if (it == m_slots.end() || it->pinKey.isEmpty()) {
+        return false;
+    }
+
+    if (!isEnabled() || !db || !db->hasKey() || db->key().hasChallengeResponseKeys()) {
+        clear(filePath);
+        return false;
+    }
+
+    QByteArray payload;
+    {
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream << db->kdf()->seed() << db->transformedMasterKey();
+    }
+
+    const QByteArray iv = randomGen()->randomArray(IvSize);
+    SymmetricCipher cipher(SymmetricCipher::Aes256, SymmetricCipher::Ctr, SymmetricCipher::Encrypt);
+    if (!cipher.init(encryptionKey(it->pinKey), iv) || !cipher.processInPlace(payload)) {
+        unlockAndWipe(payload);
+        clear(filePath);
+        return false;
+    }
+
+    QByteArray sealed = iv + payload;
+    sealed.append(CryptoHash::hmac(sealed, authenticationKey(it->pinKey), CryptoHash::Sha256));
+
+    unlockAndWipe(it->pinKey);
+    it->sealed = sealed;
+    it->failedAttempts = 0;
+    it->sealedTime.start();
+    return true;
+}
+
+/**
+ * @return true if a sealed key for the database exists and has not expired
+ */
+bool QuickUnlock::isAvailable(const QString& filePath)
+{
+    auto it = m_slots.find(filePath);
+    if (it == m_slots.end() || it->sealed.isEmpty() || !isEnabled()) {
+        return false;
+    }
+
+    qint64 timeout = config()->get("security/quickunlocktimeout").toLongLong() * 60 * 1000;
+    if (timeout > 0 && it->sealedTime.hasExpired(timeout)) {
+        clear(filePath);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Recover the sealed key of a database with the PIN entered on the previous unlock.
+ *
+ * The transformed key only opens the database as long as its KDF seed hasn't
+ * changed, otherwise the database has to be unlocked with its full key. After
+ * MaxAttempts wrong PINs the sealed key is wiped.
+ */
+QuickUnlock::Result
+QuickUnlock::unseal(const QString& filePath, const QString& pin, QByteArray& kdfSeed, QByteArray& transformedKey)
+{
+    if (!isAvailable(filePath)) {
+        return Result::Unavailable;
+    }
+
+    Slot& slot = m_slots[filePath];
+    QByteArray pinKey = derivePinKey(pin, slot.salt);
+    lockMemory(pinKey);
+    if (pinKey.isEmpty() || slot.sealed.size() < IvSize + MacSize) {
+        unlockAndWipe(pinKey);
+        return Result::Unavailable;
+    }
+
+    const QByteArray data = slot.sealed.left(slot.sealed.size() - MacSize);
+    const QByteArray mac = slot.sealed.right(MacSize);
+    if (!Tools::constantTimeEquals(mac, CryptoHash::hmac(data, authenticationKey(pinKey), CryptoHash::Sha256))) {
+        unlockAndWipe(pinKey);
+        if (++slot.failedAttempts >= MaxAttempts) {
+            clear(filePath);
+        }
+        return Result::WrongPin;
+    }
+
+    QByteArray payload = data.mid(IvSize);
+    lockMemory(payload);
+    SymmetricCipher cipher(SymmetricCipher::Aes256, SymmetricCipher::Ctr, SymmetricCipher::Decrypt);
+    bool ok = cipher.init(encryptionKey(pinKey), data.left(IvSize)) && cipher.processInPlace(payload);
+    unlockAndWipe(pinKey);
+    if (!ok) {
+        unlockAndWipe(payload);
+        clear(filePath);
+        return Result::Unavailable;
+    }
+
+    QDataStream stream(payload);
+    stream >> kdfSeed >> transformedKey;
+    unlockAndWipe(payload);
+
+    // the key is released on unlock and sealed again on the next lock
+    clear(filePath);
+    return Result::Unlocked;
+}
+
+/**
+ * @return number of PIN attempts left before the sealed key is wiped
+ */
+int QuickUnlock::remainingAttempts(const QString& filePath) const
+{
+    auto it = m_slots.constFind(filePath);
+    if (it == m_slots.constEnd() || it->sealed.isEmpty()) {
+        return 0;
+    }
+    return MaxAttempts - it->failedAttempts;
+}
+
+void QuickUnlock::clear(const QString& filePath)
+{
+    auto it = m_slots.find(filePath);
+    if (it != m_slots.end()) {
+        wipeSlot(*it);
+        m_slots.erase(it);
+    }
+}
+
+void QuickUnlock::clearAll()
+{
+    for (Slot& slot : m_slots) {
+        wipeSlot(slot);
+    }
+    m_slots.clear();
+}
+
+QByteArray QuickUnlock::derivePinKey(const QString& pin, const QByteArray& salt)
+{
+    Argon2Kdf kdf;
+    kdf.setMemory(PinKdfMemory);
+    kdf.setParallelism(1);
+    kdf.setRounds(PinKdfRounds);
+    if (!kdf.setSeed(salt)) {
+        return QByteArray();
+    }
+
+    QByteArray pinData = pin.toUtf8();
+    QByteArray result;
+    if (!kdf.transform(pinData, result)) {
+        result.clear();
+    }
+    wipe(pinData);
+    return result;
+}
+
+void QuickUnlock::wipeSlot(Slot& slot)
+{
+    unlockAndWipe(slot.pinKey);
+    wipe(slot.sealed);
+    slot.failedAttempts = 0;
+}
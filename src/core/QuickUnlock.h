@@ -0,0 +1,83 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSXC_QUICKUNLOCK_H
+#define KEEPASSXC_QUICKUNLOCK_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+
+class Database;
+
+/**
+ * Keeps the transformed keys of locked databases sealed under a short PIN, so
+ * they can be unlocked again without running the expensive key derivation.
+ */
+class QuickUnlock : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Result
+    {
+        Unlocked,
+        WrongPin,
+        Unavailable
+    };
+
+    ~QuickUnlock() override;
+
+    static QuickUnlock* instance();
+
+    bool isEnabled() const;
+    void prepare(const QString& filePath, const QString& pin);
+    bool seal(const QString& filePath, const Database* db);
+    bool isAvailable(const QString& filePath);
+    Result unseal(const QString& filePath, const QString& pin, QByteArray& kdfSeed, QByteArray& transformedKey);
+    int remainingAttempts(const QString& filePath) const;
+    void clear(const QString& filePath);
+    void clearAll();
+
+    static const int MaxAttempts;
+
+private:
+    struct Slot
+    {
+        QByteArray salt;
+        QByteArray pinKey;
+        QByteArray sealed;
+        QElapsedTimer sealedTime;
+        int failedAttempts = 0;
+    };
+
+    explicit QuickUnlock(QObject* parent);
+
+    static QByteArray derivePinKey(const QString& pin, const QByteArray& salt);
+    static void wipeSlot(Slot& slot);
+
+    QHash<QString, Slot> m_slots;
+
+    static QuickUnlock* m_instance;
+};
+
+inline QuickUnlock* quickUnlock()
+{
+    return QuickUnlock::instance();
+}
+
+#endif // KEEPASSXC_QUICKUNLOCK_H
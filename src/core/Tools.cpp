@@ -168,6 +168,23 @@ namespace Tools
         return regexp.exactMatch(base64);
     }
 
+    /**
+     * Compare two byte arrays in a time that only depends on their size,
+     * so comparing secrets doesn't reveal how many leading bytes match.
+     */
+    bool constantTimeEquals(const QByteArray& a, const QByteArray& b)
+    {
+        if (a.size() != b.size()) {
+            return false;
+        }
+
+        quint8 diff = 0;
+        for (int i = 0; i < a.size(); ++i) {
+            diff |= static_cast<quint8>(a[i] ^ b[i]);
+        }
+        return diff == 0;
+    }
+
     void sleep(int ms)
     {
         Q_ASSERT(ms >= 0);
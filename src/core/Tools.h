@@ -39,6 +39,7 @@ namespace Tools
     QString imageReaderFilter();
     bool isHex(const QByteArray& ba);
     bool isBase64(const QByteArray& ba);
+    bool constantTimeEquals(const QByteArray& a, const QByteArray& b);
     void sleep(int ms);
     void wait(int ms);
     void disableCoreDumps();
@@ -18,9 +18,23 @@
 #include "SymmetricCipher.h"
 
 #include "config-keepassx.h"
+#include "core/Global.h"
+#include "crypto/SymmetricCipherAesNi.h"
 #include "crypto/SymmetricCipherGcrypt.h"
 
+#include <QAtomicInt>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+
+namespace
+{
+    QAtomicInt forcedBackend(SymmetricCipher::AutomaticBackend);
+
+    const int BenchmarkSize = 64 * 1024;
+    const int BenchmarkRuns = 3;
+} // namespace
 
 SymmetricCipher::SymmetricCipher(Algorithm algo, Mode mode, Direction direction)
     : m_backend(createBackend(algo, mode, direction))
@@ -58,6 +72,19 @@ bool SymmetricCipher::isInitalized() const
 
 SymmetricCipherBackend* SymmetricCipher::createBackend(Algorithm algo, Mode mode, Direction direction)
 {
+    auto backend = static_cast<Backend>(forcedBackend.loadAcquire());
+    if (backend == AutomaticBackend || !isBackendAvailable(backend, algo, mode)) {
+        backend = fastestBackend(algo, mode, direction);
+    }
+    return createBackend(backend, algo, mode, direction);
+}
+
+SymmetricCipherBackend* SymmetricCipher::createBackend(Backend backend, Algorithm algo, Mode mode, Direction direction)
+{
+    if (backend == AesNiBackend && SymmetricCipherAesNi::isSupported(algo, mode)) {
+        return new SymmetricCipherAesNi(algo, mode, direction);
+    }
+
     switch (algo) {
     case Aes128:
     case Aes256:
@@ -72,6 +99,91 @@ SymmetricCipherBackend* SymmetricCipher::createBackend(Algorithm algo, Mode mode
     }
 }
 
+/**
+ * Pick the backend with the highest throughput for a cipher.
+ *
+ * When more than one backend implements the cipher, each of them processes a
+ * small buffer a few times on first use and the fastest one is remembered for
+ * the rest of the session.
+ */
+SymmetricCipher::Backend SymmetricCipher::fastestBackend(Algorithm algo, Mode mode, Direction direction)
+{
+    static QMutex mutex;
+    static QHash<int, Backend> choices;
+
+    QList<Backend> candidates;
+    for (Backend backend : {AesNiBackend, GcryptBackend}) {
+        if (isBackendAvailable(backend, algo, mode)) {
+            candidates.append(backend);
+        }
+    }
+    if (candidates.size() == 1) {
+        return candidates.first();
+    }
+
+    QMutexLocker locker(&mutex);
+    const int id = (algo << 8) | (mode << 1) | direction;
+    auto it = choices.constFind(id);
+    if (it != choices.constEnd()) {
+        return it.value();
+    }
+
+    Backend fastest = GcryptBackend;
+    qint64 fastestTime = -1;
+    QByteArray data(BenchmarkSize, '\0');
+    for (Backend backend : asConst(candidates)) {
+        QScopedPointer<SymmetricCipherBackend> cipher(createBackend(backend, algo, mode, direction));
+        if (!cipher->init() || !cipher->setKey(QByteArray(cipher->keySize(), '\x5a'))
+            || !cipher->setIv(QByteArray(cipher->blockSize(), '\xa5'))) {
+            continue;
+        }
+
+        qint64 bestRun = -1;
+        for (int i = 0; i < BenchmarkRuns; ++i) {
+            QElapsedTimer timer;
+            timer.start();
+            if (!cipher->processInPlace(data)) {
+                bestRun = -1;
+                break;
+            }
+            qint64 elapsed = timer.nsecsElapsed();
+            if (bestRun < 0 || elapsed < bestRun) {
+                bestRun = elapsed;
+            }
+        }
+
+        if (bestRun >= 0 && (fastestTime < 0 || bestRun < fastestTime)) {
+            fastest = backend;
+            fastestTime = bestRun;
+        }
+    }
+
+    choices.insert(id, fastest);
+    return fastest;
+}
+
+/**
+ * Force all ciphers created from now on to use the given backend where it
+ * implements the cipher. AutomaticBackend restores the benchmark based choice.
+ */
+void SymmetricCipher::setBackend(Backend backend)
+{
+    forcedBackend.storeRelease(backend);
+}
+
+bool SymmetricCipher::isBackendAvailable(Backend backend, Algorithm algo, Mode mode)
+{
+    switch (backend) {
+    case AutomaticBackend:
+    case GcryptBackend:
+        return algo != InvalidAlgorithm;
+    case AesNiBackend:
+        return SymmetricCipherAesNi::isSupported(algo, mode);
+    default:
+        return false;
+    }
+}
+
 bool SymmetricCipher::reset()
 {
     return m_backend->reset();
@@ -54,6 +54,13 @@ public:
         Encrypt
     };
 
+    enum Backend
+    {
+        AutomaticBackend,
+        GcryptBackend,
+        AesNiBackend
+    };
+
     SymmetricCipher(Algorithm algo, Mode mode, Direction direction);
     ~SymmetricCipher();
     Q_DISABLE_COPY(SymmetricCipher)
@@ -88,8 +95,13 @@ public:
     static int algorithmIvSize(Algorithm algo);
     static Mode algorithmMode(Algorithm algo);
 
+    static void setBackend(Backend backend);
+    static bool isBackendAvailable(Backend backend, Algorithm algo, Mode mode);
+
 private:
     static SymmetricCipherBackend* createBackend(Algorithm algo, Mode mode, Direction direction);
+    static SymmetricCipherBackend* createBackend(Backend backend, Algorithm algo, Mode mode, Direction direction);
+    static Backend fastestBackend(Algorithm algo, Mode mode, Direction direction);
 
     const QScopedPointer<SymmetricCipherBackend> m_backend;
     bool m_initialized;
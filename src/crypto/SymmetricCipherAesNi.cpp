@@ -0,0 +1,512 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SymmetricCipherAesNi.h"
+
+#include <cstring>
+
+#include "config-keepassx.h"
+
+#ifdef HAVE_AESNI
+#include <wmmintrin.h>
+
+namespace
+{
+    const int BlockSize = 16;
+
+    __attribute__((target("aes,sse2"))) inline __m128i shiftXor(__m128i key)
+    {
+        key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+        key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+        return _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    }
+
+    __attribute__((target("aes,sse2"))) inline __m128i expandKeyEven(__m128i key, __m128i assist)
+    {
+        return _mm_xor_si128(shiftXor(key), _mm_shuffle_epi32(assist, 0xff));
+    }
+
+    __attribute__((target("aes,sse2"))) inline __m128i expandKeyOdd(__m128i key, __m128i assist)
+    {
+        return _mm_xor_si128(shiftXor(key), _mm_shuffle_epi32(assist, 0xaa));
+    }
+
+    __attribute__((target("aes,sse2"))) void expandKey128(const quint8* key, __m128i* k)
+    {
+        k[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+        k[1] = expandKeyEven(k[0], _mm_aeskeygenassist_si128(k[0], 0x01));
+        k[2] = expandKeyEven(k[1], _mm_aeskeygenassist_si128(k[1], 0x02));
+        k[3] = expandKeyEven(k[2], _mm_aeskeygenassist_si128(k[2], 0x04));
+        k[4] = expandKeyEven(k[3], _mm_aeskeygenassist_si128(k[3], 0x08));
+        k[5] = expandKeyEven(k[4], _mm_aeskeygenassist_si128(k[4], 0x10));
+        k[6] = expandKeyEven(k[5], _mm_aeskeygenassist_si128(k[5], 0x20));
+        k[7] = expandKeyEven(k[6], _mm_aeskeygenassist_si128(k[6], 0x40));
+        k[8] = expandKeyEven(k[7], _mm_aeskeygenassist_si128(k[7], 0x80));
+        k[9] = expandKeyEven(k[8], _mm_aeskeygenassist_si128(k[8], 0x1b));
+        k[10] = expandKeyEven(k[9], _mm_aeskeygenassist_si128(k[9], 0x36));
+    }
+
+    __attribute__((target("aes,sse2"))) void expandKey256(const quint8* key, __m128i* k)
+    {
+        k[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+        k[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 16));
+        k[2] = expandKeyEven(k[0], _mm_aeskeygenassist_si128(k[1], 0x01));
+        k[3] = expandKeyOdd(k[1], _mm_aeskeygenassist_si128(k[2], 0x00));
+        k[4] = expandKeyEven(k[2], _mm_aeskeygenassist_si128(k[3], 0x02));
+        k[5] = expandKeyOdd(k[3], _mm_aeskeygenassist_si128(k[4], 0x00));
+        k[6] = expandKeyEven(k[4], _mm_aeskeygenassist_si128(k[5], 0x04));
+        k[7] = expandKeyOdd(k[5], _mm_aeskeygenassist_si128(k[6], 0x00));
+        k[8] = expandKeyEven(k[6], _mm_aeskeygenassist_si128(k[7], 0x08));
+        k[9] = expandKeyOdd(k[7], _mm_aeskeygenassist_si128(k[8], 0x00));
+        k[10] = expandKeyEven(k[8], _mm_aeskeygenassist_si128(k[9], 0x10));
+        k[11] = expandKeyOdd(k[9], _mm_aeskeygenassist_si128(k[10], 0x00));
+        k[12] = expandKeyEven(k[10], _mm_aeskeygenassist_si128(k[11], 0x20));
+        k[13] = expandKeyOdd(k[11], _mm_aeskeygenassist_si128(k[12], 0x00));
+        k[14] = expandKeyEven(k[12], _mm_aeskeygenassist_si128(k[13], 0x40));
+    }
+
+    /**
+     * Expand the key into the encryption round keys and the matching
+     * round keys of the equivalent inverse cipher.
+     */
+    __attribute__((target("aes,sse2"))) void
+    expandKeys(const quint8* key, int rounds, quint8* encryptKeys, quint8* decryptKeys)
+    {
+        __m128i k[15];
+        if (rounds == 10) {
+            expandKey128(key, k);
+        } else {
+            expandKey256(key, k);
+        }
+
+        auto* ek = reinterpret_cast<__m128i*>(encryptKeys);
+        auto* dk = reinterpret_cast<__m128i*>(decryptKeys);
+        for (int i = 0; i <= rounds; ++i) {
+            _mm_store_si128(ek + i, k[i]);
+        }
+        _mm_store_si128(dk, k[rounds]);
+        for (int i = 1; i < rounds; ++i) {
+            _mm_store_si128(dk + i, _mm_aesimc_si128(k[rounds - i]));
+        }
+        _mm_store_si128(dk + rounds, k[0]);
+
+        for (__m128i& roundKey : k) {
+            roundKey = _mm_setzero_si128();
+        }
+    }
+
+    __attribute__((target("aes,sse2"))) inline __m128i encryptBlock(__m128i block, const __m128i* k, int rounds)
+    {
+        block = _mm_xor_si128(block, k[0]);
+        for (int i = 1; i < rounds; ++i) {
+            block = _mm_aesenc_si128(block, k[i]);
+        }
+        return _mm_aesenclast_si128(block, k[rounds]);
+    }
+
+    __attribute__((target("aes,sse2"))) inline __m128i decryptBlock(__m128i block, const __m128i* k, int rounds)
+    {
+        block = _mm_xor_si128(block, k[0]);
+        for (int i = 1; i < rounds; ++i) {
+            block = _mm_aesdec_si128(block, k[i]);
+        }
+        return _mm_aesdeclast_si128(block, k[rounds]);
+    }
+
+    __attribute__((target("aes,sse2"))) inline void
+    encryptBlocks4(__m128i& b0, __m128i& b1, __m128i& b2, __m128i& b3, const __m128i* k, int rounds)
+    {
+        b0 = _mm_xor_si128(b0, k[0]);
+        b1 = _mm_xor_si128(b1, k[0]);
+        b2 = _mm_xor_si128(b2, k[0]);
+        b3 = _mm_xor_si128(b3, k[0]);
+        for (int i = 1; i < rounds; ++i) {
+            b0 = _mm_aesenc_si128(b0, k[i]);
+            b1 = _mm_aesenc_si128(b1, k[i]);
+            b2 = _mm_aesenc_si128(b2, k[i]);
+            b3 = _mm_aesenc_si128(b3, k[i]);
+        }
+        b0 = _mm_aesenclast_si128(b0, k[rounds]);
+        b1 = _mm_aesenclast_si128(b1, k[rounds]);
+        b2 = _mm_aesenclast_si128(b2, k[rounds]);
+        b3 = _mm_aesenclast_si128(b3, k[rounds]);
+    }
+
+    __attribute__((target("aes,sse2"))) inline void
+    decryptBlocks4(__m128i& b0, __m128i& b1, __m128i& b2, __m128i& b3, const __m128i* k, int rounds)
+    {
+        b0 = _mm_xor_si128(b0, k[0]);
+        b1 = _mm_xor_si128(b1, k[0]);
+        b2 = _mm_xor_si128(b2, k[0]);
+        b3 = _mm_xor_si128(b3, k[0]);
+        for (int i = 1; i < rounds; ++i) {
+            b0 = _mm_aesdec_si128(b0, k[i]);
+            b1 = _mm_aesdec_si128(b1, k[i]);
+            b2 = _mm_aesdec_si128(b2, k[i]);
+            b3 = _mm_aesdec_si128(b3, k[i]);
+        }
+        b0 = _mm_aesdeclast_si128(b0, k[rounds]);
+        b1 = _mm_aesdeclast_si128(b1, k[rounds]);
+        b2 = _mm_aesdeclast_si128(b2, k[rounds]);
+        b3 = _mm_aesdeclast_si128(b3, k[rounds]);
+    }
+
+    __attribute__((target("aes,sse2"))) inline __m128i load(const char* data)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    }
+
+    __attribute__((target("aes,sse2"))) inline void store(char* data, __m128i block)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data), block);
+    }
+
+    __attribute__((target("aes,sse2"))) void
+    ecbEncrypt(const quint8* keys, int rounds, char* data, int blocks)
+    {
+        const auto* k = reinterpret_cast<const __m128i*>(keys);
+        int i = 0;
+        for (; i + 4 <= blocks; i += 4) {
+            char* p = data + i * BlockSize;
+            __m128i b0 = load(p), b1 = load(p + 16), b2 = load(p + 32), b3 = load(p + 48);
+            encryptBlocks4(b0, b1, b2, b3, k, rounds);
+            store(p, b0);
+            store(p + 16, b1);
+            store(p + 32, b2);
+            store(p + 48, b3);
+        }
+        for (; i < blocks; ++i) {
+            char* p = data + i * BlockSize;
+            store(p, encryptBlock(load(p), k, rounds));
+        }
+    }
+
+    __attribute__((target("aes,sse2"))) void
+    ecbDecrypt(const quint8* keys, int rounds, char* data, int blocks)
+    {
+        const auto* k = reinterpret_cast<const __m128i*>(keys);
+        int i = 0;
+        for (; i + 4 <= blocks; i += 4) {
+            char* p = data + i * BlockSize;
+            __m128i b0 = load(p), b1 = load(p + 16), b2 = load(p + 32), b3 = load(p + 48);
+            decryptBlocks4(b0, b1, b2, b3, k, rounds);
+            store(p, b0);
+            store(p + 16, b1);
+            store(p + 32, b2);
+            store(p + 48, b3);
+        }
+        for (; i < blocks; ++i) {
+            char* p = data + i * BlockSize;
+            store(p, decryptBlock(load(p), k, rounds));
+        }
+    }
+
+    __attribute__((target("aes,sse2"))) void
+    cbcEncrypt(const quint8* keys, int rounds, quint8* iv, char* data, int blocks)
+    {
+        // every block depends on the previous one, so CBC encryption can't be interleaved
+        const auto* k = reinterpret_cast<const __m128i*>(keys);
+        __m128i chain = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+        for (int i = 0; i < blocks; ++i) {
+            char* p = data + i * BlockSize;
+            chain = encryptBlock(_mm_xor_si128(load(p), chain), k, rounds);
+            store(p, chain);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(iv), chain);
+    }
+
+    __attribute__((target("aes,sse2"))) void
+    cbcDecrypt(const quint8* keys, int rounds, quint8* iv, char* data, int blocks)
+    {
+        const auto* k = reinterpret_cast<const __m128i*>(keys);
+        __m128i chain = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+        int i = 0;
+        for (; i + 4 <= blocks; i += 4) {
+            char* p = data + i * BlockSize;
+            __m128i c0 = load(p), c1 = load(p + 16), c2 = load(p + 32), c3 = load(p + 48);
+            __m128i b0 = c0, b1 = c1, b2 = c2, b3 = c3;
+            decryptBlocks4(b0, b1, b2, b3, k, rounds);
+            store(p, _mm_xor_si128(b0, chain));
+            store(p + 16, _mm_xor_si128(b1, c0));
+            store(p + 32, _mm_xor_si128(b2, c1));
+            store(p + 48, _mm_xor_si128(b3, c2));
+            chain = c3;
+        }
+        for (; i < blocks; ++i) {
+            char* p = data + i * BlockSize;
+            __m128i c = load(p);
+            store(p, _mm_xor_si128(decryptBlock(c, k, rounds), chain));
+            chain = c;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(iv), chain);
+    }
+
+    inline void incrementCounter(quint8* counter)
+    {
+        for (int i = BlockSize - 1; i >= 0; --i) {
+            if (++counter[i] != 0) {
+                break;
+            }
+        }
+    }
+
+    __attribute__((target("aes,sse2"))) inline __m128i nextCounter(quint8* counter)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(counter));
+        incrementCounter(counter);
+        return block;
+    }
+
+    __attribute__((target("aes,sse2"))) void
+    ctrCrypt(const quint8* keys, int rounds, quint8* counter, char* data, int blocks)
+    {
+        const auto* k = reinterpret_cast<const __m128i*>(keys);
+        int i = 0;
+        for (; i + 4 <= blocks; i += 4) {
+            char* p = data + i * BlockSize;
+            __m128i b0 = nextCounter(counter);
+            __m128i b1 = nextCounter(counter);
+            __m128i b2 = nextCounter(counter);
+            __m128i b3 = nextCounter(counter);
+            encryptBlocks4(b0, b1, b2, b3, k, rounds);
+            store(p, _mm_xor_si128(load(p), b0));
+            store(p + 16, _mm_xor_si128(load(p + 16), b1));
+            store(p + 32, _mm_xor_si128(load(p + 32), b2));
+            store(p + 48, _mm_xor_si128(load(p + 48), b3));
+        }
+        for (; i < blocks; ++i) {
+            char* p = data + i * BlockSize;
+            store(p, _mm_xor_si128(load(p), encryptBlock(nextCounter(counter), k, rounds)));
+        }
+    }
+
+    __attribute__((target("aes,sse2"))) void
+    ctrKeyStream(const quint8* keys, int rounds, quint8* counter, quint8* keyStream)
+    {
+        const auto* k = reinterpret_cast<const __m128i*>(keys);
+        __m128i block = encryptBlock(nextCounter(counter), k, rounds);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(keyStream), block);
+    }
+} // namespace
+#endif
+
+SymmetricCipherAesNi::SymmetricCipherAesNi(SymmetricCipher::Algorithm algo,
+                                           SymmetricCipher::Mode mode,
+                                           SymmetricCipher::Direction direction)
+    : m_algo(algo)
+    , m_mode(mode)
+    , m_direction(direction)
+    , m_rounds(algo == SymmetricCipher::Aes128 ? 10 : 14)
+    , m_hasKey(false)
+    , m_keyStreamUsed(16)
+{
+    wipeState();
+}
+
+SymmetricCipherAesNi::~SymmetricCipherAesNi()
+{
+    wipeState();
+}
+
+/**
+ * @return true if the CPU supports AES-NI and the backend implements the algorithm and mode
+ */
+bool SymmetricCipherAesNi::isSupported(SymmetricCipher::Algorithm algo, SymmetricCipher::Mode mode)
+{
+#ifdef HAVE_AESNI
+    static const bool cpuSupported = __builtin_cpu_supports("aes");
+    return cpuSupported && (algo == SymmetricCipher::Aes128 || algo == SymmetricCipher::Aes256)
+           && (mode == SymmetricCipher::Ecb || mode == SymmetricCipher::Cbc || mode == SymmetricCipher::Ctr);
+#else
+    Q_UNUSED(algo);
+    Q_UNUSED(mode);
+    return false;
+#endif
+}
+
+void SymmetricCipherAesNi::wipeState()
+{
+    volatile quint8* encryptKeys = m_encryptKeys;
+    volatile quint8* decryptKeys = m_decryptKeys;
+    for (int i = 0; i < static_cast<int>(sizeof(m_encryptKeys)); ++i) {
+        encryptKeys[i] = 0;
+        decryptKeys[i] = 0;
+    }
+    volatile quint8* keyStream = m_keyStream;
+    for (int i = 0; i < 16; ++i) {
+        keyStream[i] = 0;
+    }
+    memset(m_iv, 0, sizeof(m_iv));
+    memset(m_state, 0, sizeof(m_state));
+    m_hasKey = false;
+    m_keyStreamUsed = 16;
+}
+
+bool SymmetricCipherAesNi::init()
+{
+    if (!isSupported(m_algo, m_mode)) {
+        m_errorString = QObject::tr("AES-NI is not supported for this cipher.");
+        return false;
+    }
+
+    wipeState();
+    return true;
+}
+
+bool SymmetricCipherAesNi::setKey(const QByteArray& key)
+{
+    if (key.size() != keySize()) {
+        m_errorString = QObject::tr("Invalid key length.");
+        return false;
+    }
+
+#ifdef HAVE_AESNI
+    expandKeys(reinterpret_cast<const quint8*>(key.constData()), m_rounds, m_encryptKeys, m_decryptKeys);
+    m_hasKey = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool SymmetricCipherAesNi::setIv(const QByteArray& iv)
+{
+    if (m_mode == SymmetricCipher::Ecb) {
+        return true;
+    }
+
+    if (iv.size() != blockSize()) {
+        m_errorString = QObject::tr("Invalid IV length.");
+        return false;
+    }
+
+    memcpy(m_iv, iv.constData(), sizeof(m_iv));
+    return reset();
+}
+
+QByteArray SymmetricCipherAesNi::process(const QByteArray& data, bool* ok)
+{
+    QByteArray result = data;
+    *ok = processBlocks(result.data(), result.size());
+    return result;
+}
+
+bool SymmetricCipherAesNi::processInPlace(QByteArray& data)
+{
+    return processBlocks(data.data(), data.size());
+}
+
+bool SymmetricCipherAesNi::processInPlace(QByteArray& data, quint64 rounds)
+{
+    char* rawData = data.data();
+    int size = data.size();
+
+    for (quint64 i = 0; i != rounds; ++i) {
+        if (!processBlocks(rawData, size)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool SymmetricCipherAesNi::processBlocks(char* data, int size)
+{
+    if (!m_hasKey) {
+        m_errorString = QObject::tr("No key set.");
+        return false;
+    }
+
+    if (m_mode != SymmetricCipher::Ctr && size % 16 != 0) {
+        m_errorString = QObject::tr("Invalid length.");
+        return false;
+    }
+
+#ifdef HAVE_AESNI
+    const int blocks = size / 16;
+    switch (m_mode) {
+    case SymmetricCipher::Ecb:
+        if (m_direction == SymmetricCipher::Encrypt) {
+            ecbEncrypt(m_encryptKeys, m_rounds, data, blocks);
+        } else {
+            ecbDecrypt(m_decryptKeys, m_rounds, data, blocks);
+        }
+        return true;
+
+    case SymmetricCipher::Cbc:
+        if (m_direction == SymmetricCipher::Encrypt) {
+            cbcEncrypt(m_encryptKeys, m_rounds, m_state, data, blocks);
+        } else {
+            cbcDecrypt(m_decryptKeys, m_rounds, m_state, data, blocks);
+        }
+        return true;
+
+    case SymmetricCipher::Ctr: {
+        // use up the key stream left over from the previous call first
+        int offset = 0;
+        while (offset < size && m_keyStreamUsed < 16) {
+            data[offset++] ^= static_cast<char>(m_keyStream[m_keyStreamUsed++]);
+        }
+
+        const int fullBlocks = (size - offset) / 16;
+        ctrCrypt(m_encryptKeys, m_rounds, m_state, data + offset, fullBlocks);
+        offset += fullBlocks * 16;
+
+        if (offset < size) {
+            ctrKeyStream(m_encryptKeys, m_rounds, m_state, m_keyStream);
+            m_keyStreamUsed = 0;
+            while (offset < size) {
+                data[offset++] ^= static_cast<char>(m_keyStream[m_keyStreamUsed++]);
+            }
+        }
+        return true;
+    }
+
+    default:
+        Q_ASSERT(false);
+        return false;
+    }
+#else
+    Q_UNUSED(data);
+    return false;
+#endif
+}
+
+/**
+ * Restart the chain or counter at the IV.
+ */
+bool SymmetricCipherAesNi::reset()
+{
+    memcpy(m_state, m_iv, sizeof(m_state));
+    m_keyStreamUsed = 16;
+    return true;
+}
+
+int SymmetricCipherAesNi::keySize() const
+{
+    return m_algo == SymmetricCipher::Aes128 ? 16 : 32;
+}
+
+int SymmetricCipherAesNi::blockSize() const
+{
+    return 16;
+}
+
+QString SymmetricCipherAesNi::errorString() const
+{
+    return m_errorString;
+}
@@ -0,0 +1,72 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_SYMMETRICCIPHERAESNI_H
+#define KEEPASSX_SYMMETRICCIPHERAESNI_H
+
+#include "crypto/SymmetricCipher.h"
+#include "crypto/SymmetricCipherBackend.h"
+
+/**
+ * AES backend using the AES-NI instructions of x86 CPUs.
+ *
+ * Independent blocks of CBC decryption and CTR mode are processed four at a
+ * time to keep the AES unit busy.
+ */
+class SymmetricCipherAesNi : public SymmetricCipherBackend
+{
+public:
+    SymmetricCipherAesNi(SymmetricCipher::Algorithm algo,
+                         SymmetricCipher::Mode mode,
+                         SymmetricCipher::Direction direction);
+    ~SymmetricCipherAesNi() override;
+
+    static bool isSupported(SymmetricCipher::Algorithm algo, SymmetricCipher::Mode mode);
+
+    bool init() override;
+    bool setKey(const QByteArray& key) override;
+    bool setIv(const QByteArray& iv) override;
+
+    QByteArray process(const QByteArray& data, bool* ok) override;
+    Q_REQUIRED_RESULT bool processInPlace(QByteArray& data) override;
+    Q_REQUIRED_RESULT bool processInPlace(QByteArray& data, quint64 rounds) override;
+
+    bool reset() override;
+    int keySize() const override;
+    int blockSize() const override;
+
+    QString errorString() const override;
+
+private:
+    bool processBlocks(char* data, int size);
+    void wipeState();
+
+    const SymmetricCipher::Algorithm m_algo;
+    const SymmetricCipher::Mode m_mode;
+    const SymmetricCipher::Direction m_direction;
+    int m_rounds;
+    bool m_hasKey;
+    alignas(16) quint8 m_encryptKeys[15 * 16];
+    alignas(16) quint8 m_decryptKeys[15 * 16];
+    quint8 m_iv[16];
+    quint8 m_state[16];
+    quint8 m_keyStream[16];
+    int m_keyStreamUsed;
+    QString m_errorString;
+};
+
+#endif // KEEPASSX_SYMMETRICCIPHERAESNI_H
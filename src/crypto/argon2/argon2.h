@@ -26,6 +26,7 @@
 
 #ifdef Q_OS_WIN
 #define argon2_hash libargon2_argon2_hash
+#define argon2_ctx libargon2_argon2_ctx
 #define argon2_error_message libargon2_argon2_error_message
 #endif
 
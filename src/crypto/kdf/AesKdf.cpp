@@ -19,9 +19,88 @@
 
 #include <QtConcurrent>
 
+#include "config-keepassx.h"
 #include "crypto/CryptoHash.h"
 #include "format/KeePass2.h"
 
+#ifdef HAVE_AESNI
+#include <wmmintrin.h>
+
+namespace
+{
+    /**
+     * Zero memory through a volatile pointer, so the compiler can't drop the stores.
+     */
+    void wipeMemory(void* data, size_t size)
+    {
+        volatile quint8* bytes = static_cast<quint8*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            bytes[i] = 0;
+        }
+    }
+
+    __attribute__((target("aes,sse2"))) inline __m128i shiftXor(__m128i key)
+    {
+        key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+        key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+        return _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    }
+
+    __attribute__((target("aes,sse2"))) inline __m128i expandKeyEven(__m128i key, __m128i assist)
+    {
+        return _mm_xor_si128(shiftXor(key), _mm_shuffle_epi32(assist, 0xff));
+    }
+
+    __attribute__((target("aes,sse2"))) inline __m128i expandKeyOdd(__m128i key, __m128i assist)
+    {
+        return _mm_xor_si128(shiftXor(key), _mm_shuffle_epi32(assist, 0xaa));
+    }
+
+    /**
+     * Encrypt both 16 byte halves of the key rounds times with AES-256-ECB.
+     * The halves are independent, so interleaving them keeps the AES unit busy
+     * while each one waits for the result of its previous round.
+     */
+    __attribute__((target("aes,sse2"))) void transformKeyAesNi(const char* seed, char* key, int rounds)
+    {
+        __m128i k[15];
+        k[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(seed));
+        k[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(seed + 16));
+        // AES-256 key schedule
+        k[2] = expandKeyEven(k[0], _mm_aeskeygenassist_si128(k[1], 0x01));
+        k[3] = expandKeyOdd(k[1], _mm_aeskeygenassist_si128(k[2], 0x00));
+        k[4] = expandKeyEven(k[2], _mm_aeskeygenassist_si128(k[3], 0x02));
+        k[5] = expandKeyOdd(k[3], _mm_aeskeygenassist_si128(k[4], 0x00));
+        k[6] = expandKeyEven(k[4], _mm_aeskeygenassist_si128(k[5], 0x04));
+        k[7] = expandKeyOdd(k[5], _mm_aeskeygenassist_si128(k[6], 0x00));
+        k[8] = expandKeyEven(k[6], _mm_aeskeygenassist_si128(k[7], 0x08));
+        k[9] = expandKeyOdd(k[7], _mm_aeskeygenassist_si128(k[8], 0x00));
+        k[10] = expandKeyEven(k[8], _mm_aeskeygenassist_si128(k[9], 0x10));
+        k[11] = expandKeyOdd(k[9], _mm_aeskeygenassist_si128(k[10], 0x00));
+        k[12] = expandKeyEven(k[10], _mm_aeskeygenassist_si128(k[11], 0x20));
+        k[13] = expandKeyOdd(k[11], _mm_aeskeygenassist_si128(k[12], 0x00));
+        k[14] = expandKeyEven(k[12], _mm_aeskeygenassist_si128(k[13], 0x40));
+
+        __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+        __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 16));
+        for (int i = 0; i < rounds; ++i) {
+            left = _mm_xor_si128(left, k[0]);
+            right = _mm_xor_si128(right, k[0]);
+            for (int j = 1; j < 14; ++j) {
+                left = _mm_aesenc_si128(left, k[j]);
+                right = _mm_aesenc_si128(right, k[j]);
+            }
+            left = _mm_aesenclast_si128(left, k[14]);
+            right = _mm_aesenclast_si128(right, k[14]);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(key), left);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(key + 16), right);
+
+        wipeMemory(k, sizeof(k));
+    }
+} // namespace
+#endif
+
 AesKdf::AesKdf()
     : Kdf::Kdf(KeePass2::KDF_AES_KDBX4)
 {
@@ -61,6 +140,16 @@ QVariantMap AesKdf::writeParameters()
 
 bool AesKdf::transform(const QByteArray& raw, QByteArray& result) const
 {
+#ifdef HAVE_AESNI
+    if (hasAesNi() && raw.size() == 32 && m_seed.size() == 32) {
+        QByteArray transformed = raw;
+        transformKeyAesNi(m_seed.constData(), transformed.data(), m_rounds);
+        result = CryptoHash::hash(transformed, CryptoHash::Sha256);
+        wipeMemory(transformed.data(), static_cast<size_t>(transformed.size()));
+        return true;
+    }
+#endif
+
     QByteArray resultLeft;
     QByteArray resultRight;
 
@@ -101,27 +190,21 @@ bool AesKdf::transformKeyRaw(const QByteArray& key, const QByteArray& seed, int
     return true;
 }
 
-QSharedPointer<Kdf> AesKdf::clone() const
+/**
+ * @return true if the key is transformed with the AES instructions of the CPU
+ *         instead of libgcrypt
+ */
+bool AesKdf::hasAesNi()
 {
-    return QSharedPointer<AesKdf>::create(*this);
+#ifdef HAVE_AESNI
+    static const bool supported = __builtin_cpu_supports("aes");
+    return supported;
+#else
+    return false;
+#endif
 }
 
-int AesKdf::benchmarkImpl(int msec) const
+QSharedPointer<Kdf> AesKdf::clone() const
 {
-    QByteArray key = QByteArray(16, '\x7E');
-    QByteArray seed = QByteArray(32, '\x4B');
-    QByteArray iv(16, 0);
-
-    SymmetricCipher cipher(SymmetricCipher::Aes256, SymmetricCipher::Ecb, SymmetricCipher::Encrypt);
-    cipher.init(seed, iv);
-
-    quint64 rounds = 1000000;
-    QElapsedTimer timer;
-    timer.start();
-
-    if (!cipher.processInPlace(key, rounds)) {
-        return -1;
-    }
-
-    return static_cast<int>(rounds * (static_cast<float>(msec) / timer.elapsed()));
+    return QSharedPointer<AesKdf>::create(*this);
 }
@@ -31,8 +31,7 @@ public:
     bool transform(const QByteArray& raw, QByteArray& result) const override;
     QSharedPointer<Kdf> clone() const override;
 
-protected:
-    int benchmarkImpl(int msec) const override;
+    static bool hasAesNi();
 
 private:
     static bool
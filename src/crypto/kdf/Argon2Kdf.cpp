@@ -19,9 +19,71 @@
 
 #include <QtConcurrent>
 
+#include <cstring>
+
 #include "crypto/argon2/argon2.h"
 #include "format/KeePass2.h"
 
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+
+namespace
+{
+    const size_t HugePageSize = 2 * 1024 * 1024;
+
+    size_t mappingSize(size_t size)
+    {
+        if (size < HugePageSize) {
+            return size;
+        }
+        return (size + HugePageSize - 1) / HugePageSize * HugePageSize;
+    }
+
+    /**
+     * Allocate the Argon2 memory in huge pages to reduce TLB misses and lock it
+     * to keep the KDF state out of swap. Both are optional and fall back to
+     * normal pages and unlocked memory if the system doesn't allow them.
+     */
+    int allocateMemory(uint8_t** memory, size_t size)
+    {
+        const size_t mapSize = mappingSize(size);
+        void* mapped = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        // only succeeds if the administrator reserved huge pages
+        if (mapSize >= HugePageSize) {
+            mapped = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+#endif
+        if (mapped == MAP_FAILED) {
+            mapped = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mapped == MAP_FAILED) {
+                return ARGON2_MEMORY_ALLOCATION_ERROR;
+            }
+#ifdef MADV_HUGEPAGE
+            madvise(mapped, mapSize, MADV_HUGEPAGE);
+#endif
+        }
+
+        // fails beyond RLIMIT_MEMLOCK, the memory is still usable then
+        mlock(mapped, mapSize);
+
+        *memory = static_cast<uint8_t*>(mapped);
+        return ARGON2_OK;
+    }
+
+    void freeMemory(uint8_t* memory, size_t size)
+    {
+        const size_t mapSize = mappingSize(size);
+        memset(memory, 0, mapSize);
+        // keep the compiler from dropping the memset of memory that is never read again
+        __asm__ __volatile__("" : : "r"(memory) : "memory");
+
+        munlock(memory, mapSize);
+        munmap(memory, mapSize);
+    }
+} // namespace
+#endif
+
 /**
  * KeePass' Argon2 implementation supports all parameters that are defined in the official specification,
  * but only the number of iterations, the memory size and the degree of parallelism can be configured by
@@ -70,6 +132,11 @@ bool Argon2Kdf::setMemory(quint64 kibibytes)
     return false;
 }
 
+quint64 Argon2Kdf::memoryUsage() const
+{
+    return m_memory * 1024;
+}
+
 quint32 Argon2Kdf::parallelism() const
 {
     return m_parallelism;
@@ -169,20 +236,26 @@ bool Argon2Kdf::transformKeyRaw(const QByteArray& key,
                                 quint32 parallelism,
                                 QByteArray& result)
 {
-    // Time Cost, Mem Cost, Threads/Lanes, Password, length, Salt, length, out, length
-    int rc = argon2_hash(rounds,
-                         memory,
-                         parallelism,
-                         key.data(),
-                         key.size(),
-                         seed.data(),
-                         seed.size(),
-                         result.data(),
-                         result.size(),
-                         nullptr,
-                         0,
-                         Argon2_d,
-                         version);
+    argon2_context context;
+    memset(&context, 0, sizeof(context));
+    context.out = reinterpret_cast<uint8_t*>(result.data());
+    context.outlen = static_cast<uint32_t>(result.size());
+    context.pwd = reinterpret_cast<uint8_t*>(const_cast<char*>(key.data()));
+    context.pwdlen = static_cast<uint32_t>(key.size());
+    context.salt = reinterpret_cast<uint8_t*>(const_cast<char*>(seed.data()));
+    context.saltlen = static_cast<uint32_t>(seed.size());
+    context.t_cost = rounds;
+    context.m_cost = static_cast<uint32_t>(memory);
+    context.lanes = parallelism;
+    context.threads = parallelism;
+    context.version = version;
+#ifdef Q_OS_UNIX
+    context.allocate_cbk = allocateMemory;
+    context.free_cbk = freeMemory;
+#endif
+    context.flags = ARGON2_DEFAULT_FLAGS;
+
+    int rc = argon2_ctx(&context, Argon2_d);
     if (rc != ARGON2_OK) {
         qWarning("Argon2 error: %s", argon2_error_message(rc));
         return false;
@@ -195,19 +268,3 @@ QSharedPointer<Kdf> Argon2Kdf::clone() const
 {
     return QSharedPointer<Argon2Kdf>::create(*this);
 }
-
-int Argon2Kdf::benchmarkImpl(int msec) const
-{
-    QByteArray key = QByteArray(16, '\x7E');
-    QByteArray seed = QByteArray(32, '\x4B');
-
-    QElapsedTimer timer;
-    timer.start();
-
-    int rounds = 4;
-    if (transformKeyRaw(key, seed, version(), rounds, memory(), parallelism(), key)) {
-        return static_cast<int>(rounds * (static_cast<float>(msec) / timer.elapsed()));
-    }
-
-    return 1;
-}
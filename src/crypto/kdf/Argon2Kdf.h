@@ -29,6 +29,7 @@ public:
     QVariantMap writeParameters() override;
     bool transform(const QByteArray& raw, QByteArray& result) const override;
     QSharedPointer<Kdf> clone() const override;
+    quint64 memoryUsage() const override;
 
     quint32 version() const;
     bool setVersion(quint32 version);
@@ -38,8 +39,6 @@ public:
     bool setParallelism(quint32 threads);
 
 protected:
-    int benchmarkImpl(int msec) const override;
-
     quint32 m_version;
     quint64 m_memory;
     quint32 m_parallelism;
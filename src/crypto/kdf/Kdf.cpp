@@ -16,7 +16,6 @@
  */
 
 #include "Kdf.h"
-#include "Kdf_p.h"
 
 #include <QtConcurrent>
 
@@ -44,6 +43,14 @@ QByteArray Kdf::seed() const
     return m_seed;
 }
 
+/**
+ * @return number of bytes allocated by a single transform() call
+ */
+quint64 Kdf::memoryUsage() const
+{
+    return 0;
+}
+
 bool Kdf::setRounds(int rounds)
 {
     if (rounds >= 1 && rounds < INT_MAX) {
@@ -68,33 +75,3 @@ void Kdf::randomizeSeed()
 {
     setSeed(randomGen()->randomArray(m_seed.size()));
 }
-
-int Kdf::benchmark(int msec) const
-{
-    BenchmarkThread thread1(msec, this);
-    BenchmarkThread thread2(msec, this);
-
-    thread1.start();
-    thread2.start();
-
-    thread1.wait();
-    thread2.wait();
-
-    return qMax(1, qMin(thread1.rounds(), thread2.rounds()));
-}
-
-Kdf::BenchmarkThread::BenchmarkThread(int msec, const Kdf* kdf)
-    : m_msec(msec)
-    , m_kdf(kdf)
-{
-}
-
-int Kdf::BenchmarkThread::rounds()
-{
-    return m_rounds;
-}
-
-void Kdf::BenchmarkThread::run()
-{
-    m_rounds = m_kdf->benchmarkImpl(m_msec);
-}
@@ -42,17 +42,13 @@ public:
     virtual QVariantMap writeParameters() = 0;
     virtual bool transform(const QByteArray& raw, QByteArray& result) const = 0;
     virtual QSharedPointer<Kdf> clone() const = 0;
-
-    int benchmark(int msec) const;
+    virtual quint64 memoryUsage() const;
 
 protected:
-    virtual int benchmarkImpl(int msec) const = 0;
-
     int m_rounds;
     QByteArray m_seed;
 
 private:
-    class BenchmarkThread;
     const QUuid m_uuid;
 };
 #endif // KEEPASSX_KDF_H
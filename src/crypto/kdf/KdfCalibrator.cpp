@@ -0,0 +1,190 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "KdfCalibrator.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+#include <QVector>
+
+#include <climits>
+#include <cmath>
+
+#include "crypto/kdf/Argon2Kdf.h"
+#include "format/KeePass2.h"
+
+const int KdfCalibrator::DefaultSampleCount = 5;
+
+namespace
+{
+    // shortest measurement that is not dominated by timer resolution and scheduling
+    const double MinProbeMsec = 10.0;
+    const int MaxRounds = INT_MAX - 1;
+
+    int clampRounds(double rounds)
+    {
+        return static_cast<int>(qBound(1.0, std::round(rounds), static_cast<double>(MaxRounds)));
+    }
+} // namespace
+
+bool KdfCalibrator::Result::isValid() const
+{
+    return rounds > 0;
+}
+
+KdfCalibrator::KdfCalibrator(QSharedPointer<Kdf> kdf)
+    : m_kdf(kdf)
+    , m_sampleCount(DefaultSampleCount)
+    , m_chooseParallelism(false)
+{
+}
+
+/**
+ * @param samples number of timed transforms used for the estimate, at least 3
+ */
+void KdfCalibrator::setSampleCount(int samples)
+{
+    m_sampleCount = qMax(3, samples);
+}
+
+/**
+ * Let the calibration set the Argon2 parallelism to the number of available cores
+ * instead of using the parallelism of the given KDF.
+ */
+void KdfCalibrator::setChooseParallelism(bool choose)
+{
+    m_chooseParallelism = choose;
+}
+
+quint32 KdfCalibrator::idealParallelism()
+{
+    return static_cast<quint32>(qMax(1, QThread::idealThreadCount()));
+}
+
+/**
+ * Find the number of rounds a transform needs to take the given time.
+ *
+ * After a warm-up probe the transform is timed at several round counts up to
+ * half of the estimated result. A line fitted through these samples separates
+ * the fixed cost of a transform from the cost per round, and the spread of
+ * the samples around the line gives the error of the expected time.
+ *
+ * This blocks for about one and a half times the target time.
+ *
+ * @param msec target time of a transform in milliseconds
+ * @return calibration result, invalid if the KDF failed
+ */
+KdfCalibrator::Result KdfCalibrator::calibrate(int msec) const
+{
+    Result result;
+
+    QSharedPointer<Kdf> kdf = m_kdf->clone();
+    if (kdf->uuid() == KeePass2::KDF_ARGON2) {
+        auto argon2Kdf = kdf.staticCast<Argon2Kdf>();
+        if (m_chooseParallelism) {
+            argon2Kdf->setParallelism(idealParallelism());
+        }
+        result.parallelism = argon2Kdf->parallelism();
+    }
+
+    // warm up the caches and the CPU clock while growing the rounds to a measurable time
+    const double probeMsec = qMax(MinProbeMsec, msec / 16.0);
+    int probeRounds = 1;
+    double elapsed = measure(*kdf, probeRounds);
+    while (elapsed >= 0.0 && elapsed < probeMsec && probeRounds < MaxRounds) {
+        double factor = elapsed > 0.5 ? probeMsec / elapsed * 1.2 : 64.0;
+        probeRounds = clampRounds(probeRounds * qBound(2.0, factor, 64.0));
+        elapsed = measure(*kdf, probeRounds);
+    }
+    if (elapsed < 0.0) {
+        return result;
+    }
+
+    const double targetRounds = msec * probeRounds / qMax(elapsed, 0.001);
+
+    QVector<double> rounds;
+    QVector<double> times;
+    for (int i = 1; i <= m_sampleCount; ++i) {
+        int sampleRounds = clampRounds(targetRounds * i / (2.0 * m_sampleCount));
+        double time = measure(*kdf, sampleRounds);
+        if (time < 0.0) {
+            return result;
+        }
+        rounds.append(sampleRounds);
+        times.append(time);
+    }
+
+    // least squares fit of time = overhead + perRound * rounds
+    const int n = rounds.size();
+    double meanRounds = 0.0;
+    double meanTime = 0.0;
+    for (int i = 0; i < n; ++i) {
+        meanRounds += rounds[i];
+        meanTime += times[i];
+    }
+    meanRounds /= n;
+    meanTime /= n;
+
+    double sxx = 0.0;
+    double sxy = 0.0;
+    for (int i = 0; i < n; ++i) {
+        sxx += (rounds[i] - meanRounds) * (rounds[i] - meanRounds);
+        sxy += (rounds[i] - meanRounds) * (times[i] - meanTime);
+    }
+
+    double perRound = sxx > 0.0 ? sxy / sxx : 0.0;
+    double overhead = meanTime - perRound * meanRounds;
+    if (perRound <= 0.0 || overhead < 0.0) {
+        // too noisy or too few distinct round counts, fall back to a line through the origin
+        perRound = meanTime / meanRounds;
+        overhead = 0.0;
+    }
+
+    result.rounds = clampRounds((msec - overhead) / perRound);
+    result.expectedMsec = overhead + perRound * result.rounds;
+    result.samples = n;
+
+    double residuals = 0.0;
+    for (int i = 0; i < n; ++i) {
+        double residual = times[i] - overhead - perRound * rounds[i];
+        residuals += residual * residual;
+    }
+    // standard error of the expected time, which grows with the distance to the sampled rounds
+    double deviation = std::sqrt(residuals / (n - 2));
+    double distance = result.rounds - meanRounds;
+    double leverage = 1.0 / n + (sxx > 0.0 ? distance * distance / sxx : 0.0);
+    result.errorMsec = deviation * std::sqrt(leverage);
+
+    return result;
+}
+
+/**
+ * @return duration of a single transform in milliseconds, -1 on failure
+ */
+double KdfCalibrator::measure(Kdf& kdf, int rounds)
+{
+    QByteArray key(32, '\x7E');
+    QByteArray result;
+    kdf.setRounds(rounds);
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!kdf.transform(key, result)) {
+        return -1.0;
+    }
+    return timer.nsecsElapsed() / 1000000.0;
+}
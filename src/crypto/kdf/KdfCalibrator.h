@@ -0,0 +1,60 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSXC_KDFCALIBRATOR_H
+#define KEEPASSXC_KDFCALIBRATOR_H
+
+#include <QSharedPointer>
+
+#include "Kdf.h"
+
+/**
+ * Determines the KDF rounds that take a given time on this computer.
+ */
+class KdfCalibrator
+{
+public:
+    struct Result
+    {
+        int rounds = 0;
+        quint32 parallelism = 0;
+        double expectedMsec = 0.0;
+        double errorMsec = 0.0;
+        int samples = 0;
+
+        bool isValid() const;
+    };
+
+    explicit KdfCalibrator(QSharedPointer<Kdf> kdf);
+
+    void setSampleCount(int samples);
+    void setChooseParallelism(bool choose);
+    Result calibrate(int msec) const;
+
+    static quint32 idealParallelism();
+
+    static const int DefaultSampleCount;
+
+private:
+    static double measure(Kdf& kdf, int rounds);
+
+    QSharedPointer<Kdf> m_kdf;
+    int m_sampleCount;
+    bool m_chooseParallelism;
+};
+
+#endif // KEEPASSXC_KDFCALIBRATOR_H
@@ -48,11 +48,20 @@ Database* Kdbx3Reader::readDatabaseImpl(QIODevice* device,
         return nullptr;
     }
 
-    if (!m_db->setKey(key, false)) {
+    reportPhase(ReadPhase::DeriveKey);
+    if (abortIfCancelled()) {
+        return nullptr;
+    }
+    if (!deriveKey(key)) {
         raiseError(tr("Unable to calculate master key"));
         return nullptr;
     }
 
+    if (abortIfCancelled()) {
+        return nullptr;
+    }
+    reportPhase(ReadPhase::Decrypt);
+
     if (!m_db->challengeMasterSeed(m_masterSeed)) {
         raiseError(tr("Unable to issue challenge-response."));
         return nullptr;
@@ -120,7 +129,13 @@ Database* Kdbx3Reader::readDatabaseImpl(QIODevice* device,
 
     Q_ASSERT(xmlDevice);
 
+    if (abortIfCancelled()) {
+        return nullptr;
+    }
+    reportPhase(ReadPhase::Parse);
+
     KdbxXmlReader xmlReader(KeePass2::FILE_VERSION_3_1);
+    xmlReader.setCancelFlag(cancelFlag());
     xmlReader.readDatabase(xmlDevice, m_db.data(), &randomStream);
 
     if (xmlReader.hasError()) {
@@ -46,7 +46,8 @@ bool Kdbx3Writer::writeDatabase(QIODevice* device, Database* db)
         return false;
     }
 
-    if (!db->setKey(db->key(), false, true)) {
+    // only derive the key again if it or the KDF parameters changed since the last derivation
+    if (!db->isTransformedKeyCurrent() && (!db->hasRawKey() || !db->setKey(db->key(), false, true))) {
         raiseError(tr("Unable to calculate master key"));
         return false;
     }
@@ -47,11 +47,20 @@ Database* Kdbx4Reader::readDatabaseImpl(QIODevice* device,
         return nullptr;
     }
 
-    if (!m_db->setKey(key, false, false)) {
+    reportPhase(ReadPhase::DeriveKey);
+    if (abortIfCancelled()) {
+        return nullptr;
+    }
+    if (!deriveKey(key)) {
         raiseError(tr("Unable to calculate master key"));
         return nullptr;
     }
 
+    if (abortIfCancelled()) {
+        return nullptr;
+    }
+    reportPhase(ReadPhase::Decrypt);
+
     CryptoHash hash(CryptoHash::Sha256);
     hash.addData(m_masterSeed);
     hash.addData(m_db->transformedMasterKey());
@@ -134,7 +143,13 @@ Database* Kdbx4Reader::readDatabaseImpl(QIODevice* device,
 
     Q_ASSERT(xmlDevice);
 
+    if (abortIfCancelled()) {
+        return nullptr;
+    }
+    reportPhase(ReadPhase::Parse);
+
     KdbxXmlReader xmlReader(KeePass2::FILE_VERSION_4, binaryPool());
+    xmlReader.setCancelFlag(cancelFlag());
     xmlReader.readDatabase(xmlDevice, m_db.data(), &randomStream);
 
     if (xmlReader.hasError()) {
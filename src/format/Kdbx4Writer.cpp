@@ -53,7 +53,8 @@ bool Kdbx4Writer::writeDatabase(QIODevice* device, Database* db)
     QByteArray startBytes;
     QByteArray endOfHeader = "\r\n\r\n";
 
-    if (!db->setKey(db->key(), false, true)) {
+    // only derive the key again if it or the KDF parameters changed since the last derivation
+    if (!db->isTransformedKeyCurrent() && (!db->hasRawKey() || !db->setKey(db->key(), false, true))) {
         raiseError(tr("Unable to calculate master key"));
         return false;
     }
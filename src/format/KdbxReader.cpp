@@ -130,6 +130,105 @@ KeePass2::ProtectedStreamAlgo KdbxReader::protectedStreamAlgo() const
     return m_irsAlgo;
 }
 
+/**
+ * @return memory needed to derive the key of the database being read,
+ *         available once the header has been read
+ */
+quint64 KdbxReader::kdfMemoryUsage() const
+{
+    if (!m_db || !m_db->kdf()) {
+        return 0;
+    }
+    return m_db->kdf()->memoryUsage();
+}
+
+/**
+ * Set a function that is called whenever reading enters a new phase.
+ * It is called on the thread that reads the database.
+ *
+ * @param callback progress callback
+ */
+void KdbxReader::setProgressCallback(const std::function<void(ReadPhase)>& callback)
+{
+    m_progressCallback = callback;
+}
+
+/**
+ * Set a flag that aborts reading as soon as it is set to a non-zero value.
+ * It is checked between the read phases and while parsing the XML,
+ * the key derivation itself always runs to completion.
+ *
+ * @param cancelled cancel flag, must outlive the read
+ */
+void KdbxReader::setCancelFlag(const QAtomicInt* cancelled)
+{
+    m_cancelled = cancelled;
+}
+
+/**
+ * Provide the result of an earlier key derivation. It is used instead of
+ * deriving the key again if the database still has the same KDF seed.
+ *
+ * @param kdfSeed KDF seed the key was transformed with
+ * @param transformedKey transformed master key
+ * @param keyUnknown true if the key passed to readDatabase() is not the real
+ *        key, reading then fails unless the KDF seed matches
+ */
+void KdbxReader::setTransformedKey(const QByteArray& kdfSeed, const QByteArray& transformedKey, bool keyUnknown)
+{
+    m_transformedKeySeed = kdfSeed;
+    m_transformedKey = transformedKey;
+    m_keyUnknown = keyUnknown;
+}
+
+/**
+ * Set the key of the database being read, deriving it unless a matching
+ * transformed key was provided.
+ *
+ * @return true on success
+ */
+bool KdbxReader::deriveKey(const CompositeKey& key)
+{
+    if (!m_transformedKey.isEmpty() && m_db->kdf()->seed() == m_transformedKeySeed) {
+        if (m_keyUnknown) {
+            m_db->setTransformedKey(m_transformedKey);
+        } else {
+            m_db->setTransformedKey(key, m_transformedKey);
+        }
+        return true;
+    }
+    if (m_keyUnknown) {
+        return false;
+    }
+    return m_db->setKey(key, false, false);
+}
+
+void KdbxReader::reportPhase(ReadPhase phase)
+{
+    if (m_progressCallback) {
+        m_progressCallback(phase);
+    }
+}
+
+/**
+ * Raise an error if reading has been canceled.
+ *
+ * @return true if reading has to be aborted
+ */
+bool KdbxReader::abortIfCancelled()
+{
+    if (m_cancelled && m_cancelled->load()) {
+        raiseError(tr("Reading the database was canceled."));
+        return true;
+    }
+    return false;
+}
+
+const QAtomicInt* KdbxReader::cancelFlag() const
+{
+    return m_cancelled;
+}
+
 /**
  * @param data stream cipher UUID as bytes
  */
@@ -22,9 +22,12 @@
 #include "keys/CompositeKey.h"
 #include "streams/StoreDataStream.h"
 
+#include <QAtomicInt>
 #include <QCoreApplication>
 #include <QPointer>
 
+#include <functional>
+
 class Database;
 class QIODevice;
 
@@ -36,6 +39,17 @@ class KdbxReader
     Q_DECLARE_TR_FUNCTIONS(KdbxReader)
 
 public:
+    /**
+     * Steps of reading a database in the order they are reported.
+     * Decompression is streamed together with parsing.
+     */
+    enum class ReadPhase
+    {
+        DeriveKey,
+        Decrypt,
+        Parse
+    };
+
     KdbxReader() = default;
     virtual ~KdbxReader() = default;
 
@@ -50,6 +64,11 @@ public:
     QByteArray xmlData() const;
     QByteArray streamKey() const;
     KeePass2::ProtectedStreamAlgo protectedStreamAlgo() const;
+    quint64 kdfMemoryUsage() const;
+
+    void setProgressCallback(const std::function<void(ReadPhase)>& callback);
+    void setCancelFlag(const QAtomicInt* cancelled);
+    void setTransformedKey(const QByteArray& kdfSeed, const QByteArray& transformedKey, bool keyUnknown = false);
 
 protected:
     /**
@@ -83,6 +102,10 @@ protected:
     virtual void setInnerRandomStreamID(const QByteArray& data);
 
     void raiseError(const QString& errorMessage);
+    bool deriveKey(const CompositeKey& key);
+    void reportPhase(ReadPhase phase);
+    bool abortIfCancelled();
+    const QAtomicInt* cancelFlag() const;
 
     QScopedPointer<Database> m_db;
 
@@ -99,6 +122,11 @@ protected:
 
 private:
     bool m_saveXml = false;
+    std::function<void(ReadPhase)> m_progressCallback;
+    const QAtomicInt* m_cancelled = nullptr;
+    QByteArray m_transformedKeySeed;
+    QByteArray m_transformedKey;
+    bool m_keyUnknown = false;
     bool m_error = false;
     QString m_errorStr = "";
 };
@@ -18,7 +18,6 @@
 #include "KdbxXmlReader.h"
 #include "KeePass2RandomStream.h"
 #include "core/DatabaseIcons.h"
-#include "core/Endian.h"
 #include "core/Entry.h"
 #include "core/Global.h"
 #include "core/Group.h"
@@ -27,9 +26,154 @@
 
 #include <QBuffer>
 #include <QFile>
+#include <QtEndian>
+
+#include <cstring>
 
 #define UUID_LENGTH 16
 
+namespace
+{
+    using Tag = KdbxXmlTokenizer::Tag;
+    using Attribute = KdbxXmlTokenizer::Attribute;
+
+    int base64Value(char c)
+    {
+        if (c >= 'A' && c <= 'Z') {
+            return c - 'A';
+        }
+        if (c >= 'a' && c <= 'z') {
+            return c - 'a' + 26;
+        }
+        if (c >= '0' && c <= '9') {
+            return c - '0' + 52;
+        }
+        if (c == '+') {
+            return 62;
+        }
+        if (c == '/') {
+            return 63;
+        }
+        return -1;
+    }
+
+    /**
+     * Decode the canonical base64 encoding of exactly outSize bytes
+     * straight into the output buffer.
+     *
+     * @return false if text is not such an encoding
+     */
+    bool decodeBase64(const QByteArray& text, uchar* out, int outSize)
+    {
+        const int padding = (3 - outSize % 3) % 3;
+        if (text.size() != (outSize + padding) / 3 * 4) {
+            return false;
+        }
+
+        const char* in = text.constData();
+        const int dataChars = text.size() - padding;
+        int written = 0;
+        for (int i = 0; i < text.size(); i += 4) {
+            quint32 bits = 0;
+            for (int j = i; j < i + 4; ++j) {
+                int value = 0;
+                if (j < dataChars) {
+                    value = base64Value(in[j]);
+                    if (value < 0) {
+                        return false;
+                    }
+                } else if (in[j] != '=') {
+                    return false;
+                }
+                bits = (bits << 6) | static_cast<quint32>(value);
+            }
+
+            for (int shift = 16; shift >= 0 && written < outSize; shift -= 8) {
+                out[written++] = static_cast<uchar>(bits >> shift);
+            }
+        }
+
+        return true;
+    }
+
+    int decimalValue(const char* str, int digits)
+    {
+        int value = 0;
+        for (int i = 0; i < digits; ++i) {
+            if (str[i] < '0' || str[i] > '9') {
+                return -1;
+            }
+            value = value * 10 + (str[i] - '0');
+        }
+        return value;
+    }
+
+    /**
+     * Parse the "yyyy-MM-ddTHH:mm:ssZ" times of KDBX 3 files.
+     *
+     * @return invalid time if text has a different format
+     */
+    QDateTime parseUtcDateTime(const QByteArray& text)
+    {
+        const char* str = text.constData();
+        if (text.size() != 20 || str[4] != '-' || str[7] != '-' || str[10] != 'T' || str[13] != ':' || str[16] != ':'
+            || str[19] != 'Z') {
+            return QDateTime();
+        }
+
+        const int year = decimalValue(str, 4);
+        const int month = decimalValue(str + 5, 2);
+        const int day = decimalValue(str + 8, 2);
+        const int hour = decimalValue(str + 11, 2);
+        const int minute = decimalValue(str + 14, 2);
+        const int second = decimalValue(str + 17, 2);
+        if (year < 0 || month < 0 || day < 0 || hour < 0 || minute < 0 || second < 0) {
+            return QDateTime();
+        }
+
+        const QDate date(year, month, day);
+        const QTime time(hour, minute, second);
+        if (!date.isValid() || !time.isValid()) {
+            return QDateTime();
+        }
+        return QDateTime(date, time, Qt::UTC);
+    }
+
+    QUuid uuidFromRfc4122(const uchar* data)
+    {
+        return QUuid(qFromBigEndian<quint32>(data),
+                     qFromBigEndian<quint16>(data + 4),
+                     qFromBigEndian<quint16>(data + 6),
+                     data[8],
+                     data[9],
+                     data[10],
+                     data[11],
+                     data[12],
+                     data[13],
+                     data[14],
+                     data[15]);
+    }
+
+    int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    bool equalsIgnoreCase(const QByteArray& text, const char* value)
+    {
+        return qstricmp(text.constData(), value) == 0;
+    }
+} // namespace
+
 /**
  * @param version KDBX version
  */
@@ -87,7 +231,6 @@ void KdbxXmlReader::readDatabase(QIODevice* device, Database* db, KeePass2Random
     m_error = false;
     m_errorStr.clear();
 
-    m_xml.clear();
     m_xml.setDevice(device);
 
     m_db = db;
@@ -101,12 +244,7 @@ void KdbxXmlReader::readDatabase(QIODevice* device, Database* db, KeePass2Random
 
     bool rootGroupParsed = false;
 
-    if (m_xml.hasError()) {
-        raiseError(tr("XML parsing failure: %1").arg(m_xml.error()));
-        return;
-    }
-
-    if (m_xml.readNextStartElement() && m_xml.name() == "KeePassFile") {
+    if (m_xml.readNextStartElement() && m_xml.tag() == Tag::KeePassFile) {
         rootGroupParsed = parseKeePassFile();
     }
 
@@ -170,6 +308,16 @@ void KdbxXmlReader::setStrictMode(bool strictMode)
     m_strictMode = strictMode;
 }
 
+/**
+ * Set a flag that aborts parsing as soon as it is set to a non-zero value.
+ *
+ * @param cancelled cancel flag, must outlive the read
+ */
+void KdbxXmlReader::setCancelFlag(const QAtomicInt* cancelled)
+{
+    m_cancelled = cancelled;
+}
+
 bool KdbxXmlReader::hasError() const
 {
     return m_error || m_xml.hasError();
@@ -189,9 +337,9 @@ QString KdbxXmlReader::errorString() const
     return QString();
 }
 
-bool KdbxXmlReader::isTrueValue(const QStringRef& value)
+bool KdbxXmlReader::isTrueValue(const QByteArray& value)
 {
-    return value.compare(QLatin1String("true"), Qt::CaseInsensitive) == 0 || value == "1";
+    return equalsIgnoreCase(value, "true") || value == "1";
 }
 
 void KdbxXmlReader::raiseError(const QString& errorMessage)
@@ -207,18 +355,17 @@ QByteArray KdbxXmlReader::headerHash() const
 
 bool KdbxXmlReader::parseKeePassFile()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "KeePassFile");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::KeePassFile);
 
     bool rootElementFound = false;
     bool rootParsedSuccessfully = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Meta") {
+        switch (m_xml.tag()) {
+        case Tag::Meta:
             parseMeta();
-            continue;
-        }
-
-        if (m_xml.name() == "Root") {
+            break;
+        case Tag::Root:
             if (rootElementFound) {
                 rootParsedSuccessfully = false;
                 qWarning("Multiple root elements");
@@ -226,10 +373,11 @@ bool KdbxXmlReader::parseKeePassFile()
                 rootParsedSuccessfully = parseRoot();
                 rootElementFound = true;
             }
-            continue;
+            break;
+        default:
+            skipCurrentElement();
+            break;
         }
-
-        skipCurrentElement();
     }
 
     return rootParsedSuccessfully;
@@ -237,106 +385,144 @@ bool KdbxXmlReader::parseKeePassFile()
 
 void KdbxXmlReader::parseMeta()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Meta");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::Meta);
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Generator") {
+        switch (m_xml.tag()) {
+        case Tag::Generator:
             m_meta->setGenerator(readString());
-        } else if (m_xml.name() == "HeaderHash") {
+            break;
+        case Tag::HeaderHash:
             m_headerHash = readBinary();
-        } else if (m_xml.name() == "DatabaseName") {
+            break;
+        case Tag::DatabaseName:
             m_meta->setName(readString());
-        } else if (m_xml.name() == "DatabaseNameChanged") {
+            break;
+        case Tag::DatabaseNameChanged:
             m_meta->setNameChanged(readDateTime());
-        } else if (m_xml.name() == "DatabaseDescription") {
+            break;
+        case Tag::DatabaseDescription:
             m_meta->setDescription(readString());
-        } else if (m_xml.name() == "DatabaseDescriptionChanged") {
+            break;
+        case Tag::DatabaseDescriptionChanged:
             m_meta->setDescriptionChanged(readDateTime());
-        } else if (m_xml.name() == "DefaultUserName") {
+            break;
+        case Tag::DefaultUserName:
             m_meta->setDefaultUserName(readString());
-        } else if (m_xml.name() == "DefaultUserNameChanged") {
+            break;
+        case Tag::DefaultUserNameChanged:
             m_meta->setDefaultUserNameChanged(readDateTime());
-        } else if (m_xml.name() == "MaintenanceHistoryDays") {
+            break;
+        case Tag::MaintenanceHistoryDays:
             m_meta->setMaintenanceHistoryDays(readNumber());
-        } else if (m_xml.name() == "Color") {
+            break;
+        case Tag::Color:
             m_meta->setColor(readColor());
-        } else if (m_xml.name() == "MasterKeyChanged") {
+            break;
+        case Tag::MasterKeyChanged:
             m_meta->setMasterKeyChanged(readDateTime());
-        } else if (m_xml.name() == "MasterKeyChangeRec") {
+            break;
+        case Tag::MasterKeyChangeRec:
             m_meta->setMasterKeyChangeRec(readNumber());
-        } else if (m_xml.name() == "MasterKeyChangeForce") {
+            break;
+        case Tag::MasterKeyChangeForce:
             m_meta->setMasterKeyChangeForce(readNumber());
-        } else if (m_xml.name() == "MemoryProtection") {
+            break;
+        case Tag::MemoryProtection:
             parseMemoryProtection();
-        } else if (m_xml.name() == "CustomIcons") {
+            break;
+        case Tag::CustomIcons:
             parseCustomIcons();
-        } else if (m_xml.name() == "RecycleBinEnabled") {
+            break;
+        case Tag::RecycleBinEnabled:
             m_meta->setRecycleBinEnabled(readBool());
-        } else if (m_xml.name() == "RecycleBinUUID") {
+            break;
+        case Tag::RecycleBinUUID:
             m_meta->setRecycleBin(getGroup(readUuid()));
-        } else if (m_xml.name() == "RecycleBinChanged") {
+            break;
+        case Tag::RecycleBinChanged:
             m_meta->setRecycleBinChanged(readDateTime());
-        } else if (m_xml.name() == "EntryTemplatesGroup") {
+            break;
+        case Tag::EntryTemplatesGroup:
             m_meta->setEntryTemplatesGroup(getGroup(readUuid()));
-        } else if (m_xml.name() == "EntryTemplatesGroupChanged") {
+            break;
+        case Tag::EntryTemplatesGroupChanged:
             m_meta->setEntryTemplatesGroupChanged(readDateTime());
-        } else if (m_xml.name() == "LastSelectedGroup") {
+            break;
+        case Tag::LastSelectedGroup:
             m_meta->setLastSelectedGroup(getGroup(readUuid()));
-        } else if (m_xml.name() == "LastTopVisibleGroup") {
+            break;
+        case Tag::LastTopVisibleGroup:
             m_meta->setLastTopVisibleGroup(getGroup(readUuid()));
-        } else if (m_xml.name() == "HistoryMaxItems") {
+            break;
+        case Tag::HistoryMaxItems: {
             int value = readNumber();
             if (value >= -1) {
                 m_meta->setHistoryMaxItems(value);
             } else {
                 qWarning("HistoryMaxItems invalid number");
             }
-        } else if (m_xml.name() == "HistoryMaxSize") {
+            break;
+        }
+        case Tag::HistoryMaxSize: {
             int value = readNumber();
             if (value >= -1) {
                 m_meta->setHistoryMaxSize(value);
             } else {
                 qWarning("HistoryMaxSize invalid number");
             }
-        } else if (m_xml.name() == "Binaries") {
+            break;
+        }
+        case Tag::Binaries:
             parseBinaries();
-        } else if (m_xml.name() == "CustomData") {
+            break;
+        case Tag::CustomData:
             parseCustomData(m_meta->customData());
-        } else if (m_xml.name() == "SettingsChanged") {
+            break;
+        case Tag::SettingsChanged:
             m_meta->setSettingsChanged(readDateTime());
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 }
 
 void KdbxXmlReader::parseMemoryProtection()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "MemoryProtection");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::MemoryProtection);
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "ProtectTitle") {
+        switch (m_xml.tag()) {
+        case Tag::ProtectTitle:
             m_meta->setProtectTitle(readBool());
-        } else if (m_xml.name() == "ProtectUserName") {
+            break;
+        case Tag::ProtectUserName:
             m_meta->setProtectUsername(readBool());
-        } else if (m_xml.name() == "ProtectPassword") {
+            break;
+        case Tag::ProtectPassword:
             m_meta->setProtectPassword(readBool());
-        } else if (m_xml.name() == "ProtectURL") {
+            break;
+        case Tag::ProtectURL:
             m_meta->setProtectUrl(readBool());
-        } else if (m_xml.name() == "ProtectNotes") {
+            break;
+        case Tag::ProtectNotes:
             m_meta->setProtectNotes(readBool());
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 }
 
 void KdbxXmlReader::parseCustomIcons()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "CustomIcons");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::CustomIcons);
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Icon") {
+        if (m_xml.tag() == Tag::Icon) {
             parseIcon();
         } else {
             skipCurrentElement();
@@ -346,7 +532,7 @@ void KdbxXmlReader::parseCustomIcons()
 
 void KdbxXmlReader::parseIcon()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Icon");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::Icon);
 
     QUuid uuid;
     QImage icon;
@@ -354,14 +540,18 @@ void KdbxXmlReader::parseIcon()
     bool iconSet = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "UUID") {
+        switch (m_xml.tag()) {
+        case Tag::UUID:
             uuid = readUuid();
             uuidSet = !uuid.isNull();
-        } else if (m_xml.name() == "Data") {
+            break;
+        case Tag::Data:
             icon.loadFromData(readBinary());
             iconSet = true;
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 
@@ -375,17 +565,16 @@ void KdbxXmlReader::parseIcon()
 
 void KdbxXmlReader::parseBinaries()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Binaries");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::Binaries);
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() != "Binary") {
+        if (m_xml.tag() != Tag::Binary) {
             skipCurrentElement();
             continue;
         }
 
-        QXmlStreamAttributes attr = m_xml.attributes();
-        QString id = attr.value("ID").toString();
-        QByteArray data = isTrueValue(attr.value("Compressed")) ? readCompressedBinary() : readBinary();
+        QString id = QString::fromUtf8(m_xml.attribute(Attribute::ID));
+        QByteArray data = isTrueValue(m_xml.attribute(Attribute::Compressed)) ? readCompressedBinary() : readBinary();
 
         if (m_binaryPool.contains(id)) {
             qWarning("KdbxXmlReader::parseBinaries: overwriting binary item \"%s\"", qPrintable(id));
@@ -397,10 +586,10 @@ void KdbxXmlReader::parseBinaries()
 
 void KdbxXmlReader::parseCustomData(CustomData* customData)
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "CustomData");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::CustomData);
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Item") {
+        if (m_xml.tag() == Tag::Item) {
             parseCustomDataItem(customData);
             continue;
         }
@@ -410,7 +599,7 @@ void KdbxXmlReader::parseCustomData(CustomData* customData)
 
 void KdbxXmlReader::parseCustomDataItem(CustomData* customData)
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Item");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::Item);
 
     QString key;
     QString value;
@@ -418,14 +607,18 @@ void KdbxXmlReader::parseCustomDataItem(CustomData* customData)
     bool valueSet = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Key") {
+        switch (m_xml.tag()) {
+        case Tag::Key:
             key = readString();
             keySet = true;
-        } else if (m_xml.name() == "Value") {
+            break;
+        case Tag::Value:
             value = readString();
             valueSet = true;
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 
@@ -439,17 +632,18 @@ void KdbxXmlReader::parseCustomDataItem(CustomData* customData)
 
 bool KdbxXmlReader::parseRoot()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Root");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::Root);
 
     bool groupElementFound = false;
     bool groupParsedSuccessfully = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Group") {
+        switch (m_xml.tag()) {
+        case Tag::Group: {
             if (groupElementFound) {
                 groupParsedSuccessfully = false;
                 raiseError(tr("Multiple group elements"));
-                continue;
+                break;
             }
 
             Group* rootGroup = parseGroup();
@@ -461,26 +655,52 @@ bool KdbxXmlReader::parseRoot()
             }
 
             groupElementFound = true;
-        } else if (m_xml.name() == "DeletedObjects") {
+            break;
+        }
+        case Tag::DeletedObjects:
             parseDeletedObjects();
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 
     return groupParsedSuccessfully;
 }
 
+/**
+ * Parse "null", "true" or "false" of EnableAutoType and EnableSearching.
+ *
+ * @return false if the value is none of them
+ */
+bool KdbxXmlReader::readTriState(Group::TriState& state)
+{
+    const QByteArray& str = readValue();
+
+    if (equalsIgnoreCase(str, "null")) {
+        state = Group::Inherit;
+    } else if (equalsIgnoreCase(str, "true")) {
+        state = Group::Enable;
+    } else if (equalsIgnoreCase(str, "false")) {
+        state = Group::Disable;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 Group* KdbxXmlReader::parseGroup()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Group");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::Group);
 
     auto group = new Group();
     group->setUpdateTimeinfo(false);
     QList<Group*> children;
     QList<Entry*> entries;
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "UUID") {
+        switch (m_xml.tag()) {
+        case Tag::UUID: {
             QUuid uuid = readUuid();
             if (uuid.isNull()) {
                 if (m_strictMode) {
@@ -491,17 +711,15 @@ Group* KdbxXmlReader::parseGroup()
             } else {
                 group->setUuid(uuid);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "Name") {
+        case Tag::Name:
             group->setName(readString());
-            continue;
-        }
-        if (m_xml.name() == "Notes") {
+            break;
+        case Tag::Notes:
             group->setNotes(readString());
-            continue;
-        }
-        if (m_xml.name() == "IconID") {
+            break;
+        case Tag::IconID: {
             int iconId = readNumber();
             if (iconId < 0) {
                 if (m_strictMode) {
@@ -514,79 +732,71 @@ Group* KdbxXmlReader::parseGroup()
             }
 
             group->setIcon(iconId);
-            continue;
+            break;
         }
-        if (m_xml.name() == "CustomIconUUID") {
+        case Tag::CustomIconUUID: {
             QUuid uuid = readUuid();
             if (!uuid.isNull()) {
                 group->setIcon(uuid);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "Times") {
+        case Tag::Times:
             group->setTimeInfo(parseTimes());
-            continue;
-        }
-        if (m_xml.name() == "IsExpanded") {
+            break;
+        case Tag::IsExpanded:
             group->setExpanded(readBool());
-            continue;
-        }
-        if (m_xml.name() == "DefaultAutoTypeSequence") {
+            break;
+        case Tag::DefaultAutoTypeSequence:
             group->setDefaultAutoTypeSequence(readString());
-            continue;
-        }
-        if (m_xml.name() == "EnableAutoType") {
-            QString str = readString();
-
-            if (str.compare("null", Qt::CaseInsensitive) == 0) {
-                group->setAutoTypeEnabled(Group::Inherit);
-            } else if (str.compare("true", Qt::CaseInsensitive) == 0) {
-                group->setAutoTypeEnabled(Group::Enable);
-            } else if (str.compare("false", Qt::CaseInsensitive) == 0) {
-                group->setAutoTypeEnabled(Group::Disable);
+            break;
+        case Tag::EnableAutoType: {
+            Group::TriState state;
+            if (readTriState(state)) {
+                group->setAutoTypeEnabled(state);
             } else {
                 raiseError(tr("Invalid EnableAutoType value"));
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "EnableSearching") {
-            QString str = readString();
-
-            if (str.compare("null", Qt::CaseInsensitive) == 0) {
-                group->setSearchingEnabled(Group::Inherit);
-            } else if (str.compare("true", Qt::CaseInsensitive) == 0) {
-                group->setSearchingEnabled(Group::Enable);
-            } else if (str.compare("false", Qt::CaseInsensitive) == 0) {
-                group->setSearchingEnabled(Group::Disable);
+        case Tag::EnableSearching: {
+            Group::TriState state;
+            if (readTriState(state)) {
+                group->setSearchingEnabled(state);
             } else {
                 raiseError(tr("Invalid EnableSearching value"));
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "LastTopVisibleEntry") {
+        case Tag::LastTopVisibleEntry:
             group->setLastTopVisibleEntry(getEntry(readUuid()));
-            continue;
-        }
-        if (m_xml.name() == "Group") {
+            break;
+        case Tag::Group: {
             Group* newGroup = parseGroup();
             if (newGroup) {
                 children.append(newGroup);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "Entry") {
+        case Tag::Entry: {
+            if (m_cancelled && m_cancelled->load()) {
+                // stop the parser loops right away
+                m_xml.raiseError(tr("Reading the database was canceled."));
+                break;
+            }
             Entry* newEntry = parseEntry(false);
             if (newEntry) {
                 entries.append(newEntry);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "CustomData") {
+        case Tag::CustomData:
             parseCustomData(group->customData());
-            continue;
+            break;
+        default:
+            skipCurrentElement();
+            break;
         }
-
-        skipCurrentElement();
     }
 
     if (group->uuid().isNull() && !m_strictMode) {
@@ -616,10 +826,10 @@ Group* KdbxXmlReader::parseGroup()
 
 void KdbxXmlReader::parseDeletedObjects()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "DeletedObjects");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::DeletedObjects);
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "DeletedObject") {
+        if (m_xml.tag() == Tag::DeletedObject) {
             parseDeletedObject();
         } else {
             skipCurrentElement();
@@ -629,28 +839,31 @@ void KdbxXmlReader::parseDeletedObjects()
 
 void KdbxXmlReader::parseDeletedObject()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "DeletedObject");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::DeletedObject);
 
     DeletedObject delObj{{}, {}};
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "UUID") {
+        switch (m_xml.tag()) {
+        case Tag::UUID: {
             QUuid uuid = readUuid();
             if (uuid.isNull()) {
                 if (m_strictMode) {
                     raiseError(tr("Null DeleteObject uuid"));
                     return;
                 }
-                continue;
+                break;
             }
             delObj.uuid = uuid;
-            continue;
+            break;
         }
-        if (m_xml.name() == "DeletionTime") {
+        case Tag::DeletionTime:
             delObj.deletionTime = readDateTime();
-            continue;
+            break;
+        default:
+            skipCurrentElement();
+            break;
         }
-        skipCurrentElement();
     }
 
     if (!delObj.uuid.isNull() && !delObj.deletionTime.isNull()) {
@@ -665,7 +878,7 @@ void KdbxXmlReader::parseDeletedObject()
 
 Entry* KdbxXmlReader::parseEntry(bool history)
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Entry");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::Entry);
 
     auto entry = new Entry();
     entry->setUpdateTimeinfo(false);
@@ -673,7 +886,8 @@ Entry* KdbxXmlReader::parseEntry(bool history)
     QList<StringPair> binaryRefs;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "UUID") {
+        switch (m_xml.tag()) {
+        case Tag::UUID: {
             QUuid uuid = readUuid();
             if (uuid.isNull()) {
                 if (m_strictMode) {
@@ -684,9 +898,9 @@ Entry* KdbxXmlReader::parseEntry(bool history)
             } else {
                 entry->setUuid(uuid);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "IconID") {
+        case Tag::IconID: {
             int iconId = readNumber();
             if (iconId < 0) {
                 if (m_strictMode) {
@@ -695,63 +909,57 @@ Entry* KdbxXmlReader::parseEntry(bool history)
                 iconId = 0;
             }
             entry->setIcon(iconId);
-            continue;
+            break;
         }
-        if (m_xml.name() == "CustomIconUUID") {
+        case Tag::CustomIconUUID: {
             QUuid uuid = readUuid();
             if (!uuid.isNull()) {
                 entry->setIcon(uuid);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "ForegroundColor") {
+        case Tag::ForegroundColor:
             entry->setForegroundColor(readColor());
-            continue;
-        }
-        if (m_xml.name() == "BackgroundColor") {
+            break;
+        case Tag::BackgroundColor:
             entry->setBackgroundColor(readColor());
-            continue;
-        }
-        if (m_xml.name() == "OverrideURL") {
+            break;
+        case Tag::OverrideURL:
             entry->setOverrideUrl(readString());
-            continue;
-        }
-        if (m_xml.name() == "Tags") {
+            break;
+        case Tag::Tags:
             entry->setTags(readString());
-            continue;
-        }
-        if (m_xml.name() == "Times") {
+            break;
+        case Tag::Times:
             entry->setTimeInfo(parseTimes());
-            continue;
-        }
-        if (m_xml.name() == "String") {
+            break;
+        case Tag::String:
             parseEntryString(entry);
-            continue;
-        }
-        if (m_xml.name() == "Binary") {
+            break;
+        case Tag::Binary: {
             QPair<QString, QString> ref = parseEntryBinary(entry);
             if (!ref.first.isNull() && !ref.second.isNull()) {
                 binaryRefs.append(ref);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "AutoType") {
+        case Tag::AutoType:
             parseAutoType(entry);
-            continue;
-        }
-        if (m_xml.name() == "History") {
+            break;
+        case Tag::History:
             if (history) {
                 raiseError(tr("History element in history entry"));
             } else {
                 historyItems = parseEntryHistory();
             }
-            continue;
-        }
-        if (m_xml.name() == "CustomData") {
+            break;
+        case Tag::CustomData:
             parseCustomData(entry->customData());
-            continue;
+            break;
+        default:
+            skipCurrentElement();
+            break;
         }
-        skipCurrentElement();
     }
 
     if (entry->uuid().isNull() && !m_strictMode) {
@@ -794,7 +1002,7 @@ Entry* KdbxXmlReader::parseEntry(bool history)
 
 void KdbxXmlReader::parseEntryString(Entry* entry)
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "String");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::String);
 
     QString key;
     QString value;
@@ -803,23 +1011,23 @@ void KdbxXmlReader::parseEntryString(Entry* entry)
     bool valueSet = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Key") {
+        switch (m_xml.tag()) {
+        case Tag::Key:
             key = readString();
             keySet = true;
-            continue;
-        }
-
-        if (m_xml.name() == "Value") {
-            QXmlStreamAttributes attr = m_xml.attributes();
+            break;
+        case Tag::Value: {
             bool isProtected;
             bool protectInMemory;
             value = readString(isProtected, protectInMemory);
             protect = isProtected || protectInMemory;
             valueSet = true;
-            continue;
+            break;
+        }
+        default:
+            skipCurrentElement();
+            break;
         }
-
-        skipCurrentElement();
     }
 
     if (keySet && valueSet) {
@@ -837,7 +1045,7 @@ void KdbxXmlReader::parseEntryString(Entry* entry)
 
 QPair<QString, QString> KdbxXmlReader::parseEntryBinary(Entry* entry)
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Binary");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::Binary);
 
     QPair<QString, QString> poolRef;
 
@@ -847,16 +1055,14 @@ QPair<QString, QString> KdbxXmlReader::parseEntryBinary(Entry* entry)
     bool valueSet = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Key") {
+        switch (m_xml.tag()) {
+        case Tag::Key:
             key = readString();
             keySet = true;
-            continue;
-        }
-        if (m_xml.name() == "Value") {
-            QXmlStreamAttributes attr = m_xml.attributes();
-
-            if (attr.hasAttribute("Ref")) {
-                poolRef = qMakePair(attr.value("Ref").toString(), key);
+            break;
+        case Tag::Value:
+            if (m_xml.hasAttribute(Attribute::Ref)) {
+                poolRef = qMakePair(QString::fromUtf8(m_xml.attribute(Attribute::Ref)), key);
                 m_xml.skipCurrentElement();
             } else {
                 // format compatibility
@@ -864,9 +1070,11 @@ QPair<QString, QString> KdbxXmlReader::parseEntryBinary(Entry* entry)
             }
 
             valueSet = true;
-            continue;
+            break;
+        default:
+            skipCurrentElement();
+            break;
         }
-        skipCurrentElement();
     }
 
     if (keySet && valueSet) {
@@ -884,40 +1092,50 @@ QPair<QString, QString> KdbxXmlReader::parseEntryBinary(Entry* entry)
 
 void KdbxXmlReader::parseAutoType(Entry* entry)
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "AutoType");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::AutoType);
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Enabled") {
+        switch (m_xml.tag()) {
+        case Tag::Enabled:
             entry->setAutoTypeEnabled(readBool());
-        } else if (m_xml.name() == "DataTransferObfuscation") {
+            break;
+        case Tag::DataTransferObfuscation:
             entry->setAutoTypeObfuscation(readNumber());
-        } else if (m_xml.name() == "DefaultSequence") {
+            break;
+        case Tag::DefaultSequence:
             entry->setDefaultAutoTypeSequence(readString());
-        } else if (m_xml.name() == "Association") {
+            break;
+        case Tag::Association:
             parseAutoTypeAssoc(entry);
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 }
 
 void KdbxXmlReader::parseAutoTypeAssoc(Entry* entry)
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Association");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::Association);
 
     AutoTypeAssociations::Association assoc;
     bool windowSet = false;
     bool sequenceSet = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Window") {
+        switch (m_xml.tag()) {
+        case Tag::Window:
             assoc.window = readString();
             windowSet = true;
-        } else if (m_xml.name() == "KeystrokeSequence") {
+            break;
+        case Tag::KeystrokeSequence:
             assoc.sequence = readString();
             sequenceSet = true;
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 
@@ -930,12 +1148,12 @@ void KdbxXmlReader::parseAutoTypeAssoc(Entry* entry)
 
 QList<Entry*> KdbxXmlReader::parseEntryHistory()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "History");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::History);
 
     QList<Entry*> historyItems;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Entry") {
+        if (m_xml.tag() == Tag::Entry) {
             historyItems.append(parseEntry(true));
         } else {
             skipCurrentElement();
@@ -947,26 +1165,35 @@ QList<Entry*> KdbxXmlReader::parseEntryHistory()
 
 TimeInfo KdbxXmlReader::parseTimes()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Times");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.tag() == Tag::Times);
 
     TimeInfo timeInfo;
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "LastModificationTime") {
+        switch (m_xml.tag()) {
+        case Tag::LastModificationTime:
             timeInfo.setLastModificationTime(readDateTime());
-        } else if (m_xml.name() == "CreationTime") {
+            break;
+        case Tag::CreationTime:
             timeInfo.setCreationTime(readDateTime());
-        } else if (m_xml.name() == "LastAccessTime") {
+            break;
+        case Tag::LastAccessTime:
             timeInfo.setLastAccessTime(readDateTime());
-        } else if (m_xml.name() == "ExpiryTime") {
+            break;
+        case Tag::ExpiryTime:
             timeInfo.setExpiryTime(readDateTime());
-        } else if (m_xml.name() == "Expires") {
+            break;
+        case Tag::Expires:
             timeInfo.setExpires(readBool());
-        } else if (m_xml.name() == "UsageCount") {
+            break;
+        case Tag::UsageCount:
             timeInfo.setUsageCount(readNumber());
-        } else if (m_xml.name() == "LocationChanged") {
+            break;
+        case Tag::LocationChanged:
             timeInfo.setLocationChanged(readDateTime());
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 
@@ -983,38 +1210,51 @@ QString KdbxXmlReader::readString()
 
 QString KdbxXmlReader::readString(bool& isProtected, bool& protectInMemory)
 {
-    QXmlStreamAttributes attr = m_xml.attributes();
-    isProtected = isTrueValue(attr.value("Protected"));
-    protectInMemory = isTrueValue(attr.value("ProtectInMemory"));
-    QString value = m_xml.readElementText();
-
-    if (isProtected && !value.isEmpty()) {
-        QByteArray ciphertext = QByteArray::fromBase64(value.toLatin1());
-        bool ok;
-        QByteArray plaintext = m_randomStream->process(ciphertext, &ok);
-        if (!ok) {
-            value.clear();
+    isProtected = isTrueValue(m_xml.attribute(Attribute::Protected));
+    protectInMemory = isTrueValue(m_xml.attribute(Attribute::ProtectInMemory));
+    const QByteArray& text = m_xml.readText();
+
+    if (isProtected && !text.isEmpty()) {
+        QByteArray plaintext = QByteArray::fromBase64(text);
+        if (!m_randomStream->processInPlace(plaintext)) {
             raiseError(m_randomStream->errorString());
-            return value;
+            return QString();
         }
 
-        value = QString::fromUtf8(plaintext);
+        return QString::fromUtf8(plaintext);
     }
 
-    return value;
+    return QString::fromUtf8(text);
+}
+
+/**
+ * Read the text of the current element for a value that is converted
+ * right away, like numbers and times. Unless the value is protected no
+ * string is created for it.
+ *
+ * @return UTF-8 encoded element text, only valid until the next read
+ */
+const QByteArray& KdbxXmlReader::readValue()
+{
+    if (isTrueValue(m_xml.attribute(Attribute::Protected))) {
+        m_protectedValue = readString().toUtf8();
+        return m_protectedValue;
+    }
+
+    return m_xml.readText();
 }
 
 bool KdbxXmlReader::readBool()
 {
-    QString str = readString();
+    const QByteArray& str = readValue();
 
-    if (str.compare("true", Qt::CaseInsensitive) == 0) {
+    if (equalsIgnoreCase(str, "true")) {
         return true;
     }
-    if (str.compare("false", Qt::CaseInsensitive) == 0) {
+    if (equalsIgnoreCase(str, "false")) {
         return false;
     }
-    if (str.length() == 0) {
+    if (str.isEmpty()) {
         return false;
     }
     raiseError(tr("Invalid bool value"));
@@ -1023,16 +1263,31 @@ bool KdbxXmlReader::readBool()
 
 QDateTime KdbxXmlReader::readDateTime()
 {
+    static const QDateTime epoch(QDate(1, 1, 1), QTime(0, 0, 0, 0), Qt::UTC);
     static QRegularExpression b64regex("^(?:[A-Za-z0-9+/]{4})*(?:[A-Za-z0-9+/]{2}==|[A-Za-z0-9+/]{3}=)?$");
-    QString str = readString();
+    const QByteArray& text = readValue();
+
+    // KDBX 4 stores times as base64 encoded 64 bit seconds
+    uchar secsData[8];
+    if (decodeBase64(text, secsData, sizeof(secsData))) {
+        return epoch.addSecs(static_cast<qint64>(qFromLittleEndian<quint64>(secsData)));
+    }
 
+    // KDBX 3 stores them as UTC ISO 8601 times
+    QDateTime dt = parseUtcDateTime(text);
+    if (dt.isValid()) {
+        return dt;
+    }
+
+    const QString str = QString::fromUtf8(text);
     if (b64regex.match(str).hasMatch()) {
-        QByteArray secsBytes = QByteArray::fromBase64(str.toUtf8()).leftJustified(8, '\0', true).left(8);
-        qint64 secs = Endian::bytesToSizedInt<quint64>(secsBytes, KeePass2::BYTEORDER);
-        return QDateTime(QDate(1, 1, 1), QTime(0, 0, 0, 0), Qt::UTC).addSecs(secs);
+        uchar secsBytes[8] = {};
+        const QByteArray decoded = QByteArray::fromBase64(text);
+        std::memcpy(secsBytes, decoded.constData(), static_cast<size_t>(qMin(decoded.size(), 8)));
+        return epoch.addSecs(static_cast<qint64>(qFromLittleEndian<quint64>(secsBytes)));
     }
 
-    QDateTime dt = QDateTime::fromString(str, Qt::ISODate);
+    dt = QDateTime::fromString(str, Qt::ISODate);
     if (dt.isValid()) {
         return dt;
     }
@@ -1046,7 +1301,7 @@ QDateTime KdbxXmlReader::readDateTime()
 
 QColor KdbxXmlReader::readColor()
 {
-    QString colorStr = readString();
+    const QByteArray& colorStr = readValue();
 
     if (colorStr.isEmpty()) {
         return {};
@@ -1061,16 +1316,16 @@ QColor KdbxXmlReader::readColor()
 
     QColor color;
     for (int i = 0; i <= 2; ++i) {
-        QString rgbPartStr = colorStr.mid(1 + 2 * i, 2);
-        bool ok;
-        int rgbPart = rgbPartStr.toInt(&ok, 16);
-        if (!ok || rgbPart > 255) {
+        const int high = hexValue(colorStr[1 + 2 * i]);
+        const int low = hexValue(colorStr[2 + 2 * i]);
+        if (high < 0 || low < 0) {
             if (m_strictMode) {
                 raiseError(tr("Invalid color rgb part"));
             }
             return {};
         }
 
+        const int rgbPart = high * 16 + low;
         if (i == 0) {
             color.setRed(rgbPart);
         } else if (i == 1) {
@@ -1086,7 +1341,7 @@ QColor KdbxXmlReader::readColor()
 int KdbxXmlReader::readNumber()
 {
     bool ok;
-    int result = readString().toInt(&ok);
+    int result = readValue().toInt(&ok);
     if (!ok) {
         raiseError(tr("Invalid number value"));
     }
@@ -1095,7 +1350,18 @@ int KdbxXmlReader::readNumber()
 
 QUuid KdbxXmlReader::readUuid()
 {
-    QByteArray uuidBin = readBinary();
+    QByteArray uuidBin;
+    if (isTrueValue(m_xml.attribute(Attribute::Protected))) {
+        uuidBin = readBinary();
+    } else {
+        const QByteArray& text = m_xml.readText();
+        uchar uuidData[UUID_LENGTH];
+        if (decodeBase64(text, uuidData, UUID_LENGTH)) {
+            return uuidFromRfc4122(uuidData);
+        }
+        uuidBin = QByteArray::fromBase64(text);
+    }
+
     if (uuidBin.isEmpty()) {
         return QUuid();
     }
@@ -1110,21 +1376,14 @@ QUuid KdbxXmlReader::readUuid()
 
 QByteArray KdbxXmlReader::readBinary()
 {
-    QXmlStreamAttributes attr = m_xml.attributes();
-    bool isProtected = isTrueValue(attr.value("Protected"));
-    QString value = m_xml.readElementText();
-    QByteArray data = QByteArray::fromBase64(value.toLatin1());
+    const bool isProtected = isTrueValue(m_xml.attribute(Attribute::Protected));
+    QByteArray data = QByteArray::fromBase64(m_xml.readText());
 
     if (isProtected && !data.isEmpty()) {
-        bool ok;
-        QByteArray plaintext = m_randomStream->process(data, &ok);
-        if (!ok) {
+        if (!m_randomStream->processInPlace(data)) {
             data.clear();
             raiseError(m_randomStream->errorString());
-            return data;
         }
-
-        data = plaintext;
     }
 
     return data;
@@ -1187,6 +1446,6 @@ Entry* KdbxXmlReader::getEntry(const QUuid& uuid)
 
 void KdbxXmlReader::skipCurrentElement()
 {
-    qWarning("KdbxXmlReader::skipCurrentElement: skip element \"%s\"", qPrintable(m_xml.name().toString()));
+    qWarning("KdbxXmlReader::skipCurrentElement: skip element \"%s\"", qPrintable(m_xml.name()));
     m_xml.skipCurrentElement();
 }
@@ -19,17 +19,17 @@
 #define KEEPASSXC_KDBXXMLREADER_H
 
 #include "core/Database.h"
+#include "core/Group.h"
 #include "core/Metadata.h"
 #include "core/TimeInfo.h"
-#include "core/Database.h"
+#include "format/KdbxXmlTokenizer.h"
 
+#include <QAtomicInt>
 #include <QCoreApplication>
 #include <QPair>
 #include <QString>
-#include <QXmlStreamReader>
 
 class QIODevice;
-class Group;
 class Entry;
 class KeePass2RandomStream;
 
@@ -56,6 +56,7 @@ public:
 
     bool strictMode() const;
     void setStrictMode(bool strictMode);
+    void setCancelFlag(const QAtomicInt* cancelled);
 
 protected:
     typedef QPair<QString, QString> StringPair;
@@ -82,7 +83,9 @@ protected:
 
     virtual QString readString();
     virtual QString readString(bool& isProtected, bool& protectInMemory);
+    virtual const QByteArray& readValue();
     virtual bool readBool();
+    virtual bool readTriState(Group::TriState& state);
     virtual QDateTime readDateTime();
     virtual QColor readColor();
     virtual int readNumber();
@@ -95,22 +98,25 @@ protected:
     virtual Group* getGroup(const QUuid& uuid);
     virtual Entry* getEntry(const QUuid& uuid);
 
-    virtual bool isTrueValue(const QStringRef& value);
+    virtual bool isTrueValue(const QByteArray& value);
     virtual void raiseError(const QString& errorMessage);
 
     const quint32 m_kdbxVersion;
 
     bool m_strictMode = false;
+    const QAtomicInt* m_cancelled = nullptr;
 
     QPointer<Database> m_db;
     QPointer<Metadata> m_meta;
     KeePass2RandomStream* m_randomStream = nullptr;
-    QXmlStreamReader m_xml;
+    KdbxXmlTokenizer m_xml;
 
     QScopedPointer<Group> m_tmpParent;
     QHash<QUuid, Group*> m_groups;
     QHash<QUuid, Entry*> m_entries;
 
+    QByteArray m_protectedValue;
+
     QHash<QString, QByteArray> m_binaryPool;
     QHash<QString, QPair<Entry*, QString>> m_binaryMap;
     QByteArray m_headerHash;
@@ -0,0 +1,925 @@
+/*
+ * Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 or (at your option)
+ * version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "KdbxXmlTokenizer.h"
+
+#include <QIODevice>
+
+#include <cstring>
+
+namespace
+{
+    using Tag = KdbxXmlTokenizer::Tag;
+    using Attribute = KdbxXmlTokenizer::Attribute;
+
+    struct TagName
+    {
+        const char* name;
+        Tag tag;
+    };
+
+    // sorted by name for the binary search in lookupTag()
+    const TagName TagNames[] = {
+        {"Association", Tag::Association},
+        {"AutoType", Tag::AutoType},
+        {"BackgroundColor", Tag::BackgroundColor},
+        {"Binaries", Tag::Binaries},
+        {"Binary", Tag::Binary},
+        {"Color", Tag::Color},
+        {"CreationTime", Tag::CreationTime},
+        {"CustomData", Tag::CustomData},
+        {"CustomIconUUID", Tag::CustomIconUUID},
+        {"CustomIcons", Tag::CustomIcons},
+        {"Data", Tag::Data},
+        {"DataTransferObfuscation", Tag::DataTransferObfuscation},
+        {"DatabaseDescription", Tag::DatabaseDescription},
+        {"DatabaseDescriptionChanged", Tag::DatabaseDescriptionChanged},
+        {"DatabaseName", Tag::DatabaseName},
+        {"DatabaseNameChanged", Tag::DatabaseNameChanged},
+        {"DefaultAutoTypeSequence", Tag::DefaultAutoTypeSequence},
+        {"DefaultSequence", Tag::DefaultSequence},
+        {"DefaultUserName", Tag::DefaultUserName},
+        {"DefaultUserNameChanged", Tag::DefaultUserNameChanged},
+        {"DeletedObject", Tag::DeletedObject},
+        {"DeletedObjects", Tag::DeletedObjects},
+        {"DeletionTime", Tag::DeletionTime},
+        {"EnableAutoType", Tag::EnableAutoType},
+        {"EnableSearching", Tag::EnableSearching},
+        {"Enabled", Tag::Enabled},
+        {"Entry", Tag::Entry},
+        {"EntryTemplatesGroup", Tag::EntryTemplatesGroup},
+        {"EntryTemplatesGroupChanged", Tag::EntryTemplatesGroupChanged},
+        {"Expires", Tag::Expires},
+        {"ExpiryTime", Tag::ExpiryTime},
+        {"ForegroundColor", Tag::ForegroundColor},
+        {"Generator", Tag::Generator},
+        {"Group", Tag::Group},
+        {"HeaderHash", Tag::HeaderHash},
+        {"History", Tag::History},
+        {"HistoryMaxItems", Tag::HistoryMaxItems},
+        {"HistoryMaxSize", Tag::HistoryMaxSize},
+        {"Icon", Tag::Icon},
+        {"IconID", Tag::IconID},
+        {"IsExpanded", Tag::IsExpanded},
+        {"Item", Tag::Item},
+        {"KeePassFile", Tag::KeePassFile},
+        {"Key", Tag::Key},
+        {"KeystrokeSequence", Tag::KeystrokeSequence},
+        {"LastAccessTime", Tag::LastAccessTime},
+        {"LastModificationTime", Tag::LastModificationTime},
+        {"LastSelectedGroup", Tag::LastSelectedGroup},
+        {"LastTopVisibleEntry", Tag::LastTopVisibleEntry},
+        {"LastTopVisibleGroup", Tag::LastTopVisibleGroup},
+        {"LocationChanged", Tag::LocationChanged},
+        {"MaintenanceHistoryDays", Tag::MaintenanceHistoryDays},
+        {"MasterKeyChangeForce", Tag::MasterKeyChangeForce},
+        {"MasterKeyChangeRec", Tag::MasterKeyChangeRec},
+        {"MasterKeyChanged", Tag::MasterKeyChanged},
+        {"MemoryProtection", Tag::MemoryProtection},
+        {"Meta", Tag::Meta},
+        {"Name", Tag::Name},
+        {"Notes", Tag::Notes},
+        {"OverrideURL", Tag::OverrideURL},
+        {"ProtectNotes", Tag::ProtectNotes},
+        {"ProtectPassword", Tag::ProtectPassword},
+        {"ProtectTitle", Tag::ProtectTitle},
+        {"ProtectURL", Tag::ProtectURL},
+        {"ProtectUserName", Tag::ProtectUserName},
+        {"RecycleBinChanged", Tag::RecycleBinChanged},
+        {"RecycleBinEnabled", Tag::RecycleBinEnabled},
+        {"RecycleBinUUID", Tag::RecycleBinUUID},
+        {"Root", Tag::Root},
+        {"SettingsChanged", Tag::SettingsChanged},
+        {"String", Tag::String},
+        {"Tags", Tag::Tags},
+        {"Times", Tag::Times},
+        {"UUID", Tag::UUID},
+        {"UsageCount", Tag::UsageCount},
+        {"Value", Tag::Value},
+        {"Window", Tag::Window},
+    };
+
+    struct AttributeName
+    {
+        const char* name;
+        Attribute attribute;
+    };
+
+    const AttributeName AttributeNames[] = {
+        {"Protected", Attribute::Protected},
+        {"ProtectInMemory", Attribute::ProtectInMemory},
+        {"ID", Attribute::ID},
+        {"Compressed", Attribute::Compressed},
+        {"Ref", Attribute::Ref},
+    };
+
+    /**
+     * Compare a name that is not null terminated with a C string.
+     */
+    int compareName(const char* name, int size, const char* other)
+    {
+        const int cmp = qstrncmp(name, other, static_cast<uint>(size));
+        if (cmp == 0 && other[size] != '\0') {
+            return -1;
+        }
+        return cmp;
+    }
+
+    Tag lookupTag(const char* name, int size)
+    {
+        int low = 0;
+        int high = static_cast<int>(sizeof(TagNames) / sizeof(TagNames[0])) - 1;
+        while (low <= high) {
+            const int mid = (low + high) / 2;
+            const int cmp = compareName(name, size, TagNames[mid].name);
+            if (cmp == 0) {
+                return TagNames[mid].tag;
+            }
+            if (cmp < 0) {
+                high = mid - 1;
+            } else {
+                low = mid + 1;
+            }
+        }
+        return Tag::Unknown;
+    }
+
+    bool isWhitespace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    bool isNameStartChar(char c)
+    {
+        const auto u = static_cast<uchar>(c);
+        return (u >= 'A' && u <= 'Z') || (u >= 'a' && u <= 'z') || u == '_' || u == ':' || u >= 0x80;
+    }
+
+    bool isNameChar(char c)
+    {
+        return isNameStartChar(c) || (c >= '0' && c <= '9') || c == '-' || c == '.';
+    }
+
+    /**
+     * Character data that is taken over as it is.
+     */
+    bool isPlainChar(char c)
+    {
+        const auto u = static_cast<uchar>(c);
+        if (u >= 0x20) {
+            return u != '<' && u != '&';
+        }
+        return u == '\t' || u == '\n';
+    }
+
+    bool isXmlChar(uint c)
+    {
+        return c == 0x9 || c == 0xA || c == 0xD || (c >= 0x20 && c <= 0xD7FF) || (c >= 0xE000 && c <= 0xFFFD)
+               || (c >= 0x10000 && c <= 0x10FFFF);
+    }
+
+    int digitValue(char c)
+    {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    void appendUtf8(QByteArray& out, uint c)
+    {
+        if (c < 0x80) {
+            out.append(static_cast<char>(c));
+        } else if (c < 0x800) {
+            out.append(static_cast<char>(0xC0 | (c >> 6)));
+            out.append(static_cast<char>(0x80 | (c & 0x3F)));
+        } else if (c < 0x10000) {
+            out.append(static_cast<char>(0xE0 | (c >> 12)));
+            out.append(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+            out.append(static_cast<char>(0x80 | (c & 0x3F)));
+        } else {
+            out.append(static_cast<char>(0xF0 | (c >> 18)));
+            out.append(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+            out.append(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+            out.append(static_cast<char>(0x80 | (c & 0x3F)));
+        }
+    }
+} // namespace
+
+/**
+ * The tokenizer works on the whole document in memory and only supports
+ * what KDBX files need: UTF-8, the predefined entities, character
+ * references, CDATA sections, comments and processing instructions.
+ * Element and attribute names that KDBX uses are turned into tags when
+ * they are read, so the reader never compares strings. Element text is
+ * collected in a buffer that is reused for all elements.
+ */
+KdbxXmlTokenizer::KdbxXmlTokenizer()
+    : m_pos(nullptr)
+    , m_end(nullptr)
+    , m_token(TokenType::NoToken)
+    , m_tag(Tag::Unknown)
+    , m_prologRead(false)
+    , m_selfClosing(false)
+    , m_errorLine(0)
+    , m_errorColumn(0)
+{
+    // reserved buffers keep their memory when they are truncated
+    m_text.reserve(256);
+    for (int i = 0; i < static_cast<int>(Attribute::Count); ++i) {
+        m_attributes[i].reserve(16);
+        m_hasAttribute[i] = false;
+    }
+    clear();
+}
+
+/**
+ * Read the whole document from a device.
+ *
+ * @param device input device
+ */
+void KdbxXmlTokenizer::setDevice(QIODevice* device)
+{
+    setData(device ? device->readAll() : QByteArray());
+}
+
+/**
+ * @param data UTF-8 encoded document
+ */
+void KdbxXmlTokenizer::setData(const QByteArray& data)
+{
+    m_data = data;
+    m_pos = m_data.constData();
+    m_end = m_pos + m_data.size();
+
+    m_token = TokenType::NoToken;
+    m_tag = Tag::Unknown;
+    m_elements.clear();
+    m_elements.reserve(16);
+    m_prologRead = false;
+    m_selfClosing = false;
+
+    m_text.resize(0);
+    for (int i = 0; i < static_cast<int>(Attribute::Count); ++i) {
+        m_attributes[i].resize(0);
+        m_hasAttribute[i] = false;
+    }
+
+    m_errorString.clear();
+    m_errorLine = 0;
+    m_errorColumn = 0;
+}
+
+void KdbxXmlTokenizer::clear()
+{
+    setData(QByteArray());
+}
+
+/**
+ * Read the next start or end element. Character data between elements,
+ * comments and processing instructions are skipped.
+ *
+ * @return the token that was read
+ */
+KdbxXmlTokenizer::TokenType KdbxXmlTokenizer::readNext()
+{
+    if (m_token == TokenType::Invalid || m_token == TokenType::EndDocument) {
+        return m_token;
+    }
+
+    if (m_selfClosing) {
+        m_selfClosing = false;
+        return endElement();
+    }
+
+    if (!m_prologRead) {
+        if (readProlog()) {
+            m_prologRead = true;
+            readStartTag();
+        }
+        return m_token;
+    }
+
+    // anything after the root element is not looked at
+    if (m_elements.isEmpty()) {
+        m_token = TokenType::EndDocument;
+        m_tag = Tag::Unknown;
+        return m_token;
+    }
+
+    if (readCharacters(nullptr)) {
+        if (startsWith("</")) {
+            readEndTag();
+        } else {
+            readStartTag();
+        }
+    }
+    return m_token;
+}
+
+/**
+ * Read until the next start element within the current element.
+ *
+ * @return true if a start element was read, false at the end of the current element or on errors
+ */
+bool KdbxXmlTokenizer::readNextStartElement()
+{
+    return readNext() == TokenType::StartElement;
+}
+
+/**
+ * Read the text of the current element up to its end element.
+ *
+ * @return UTF-8 encoded text, only valid until the next read
+ */
+const QByteArray& KdbxXmlTokenizer::readText()
+{
+    m_text.resize(0);
+    if (m_token != TokenType::StartElement) {
+        return m_text;
+    }
+
+    if (m_selfClosing) {
+        m_selfClosing = false;
+        endElement();
+        return m_text;
+    }
+
+    if (readCharacters(&m_text)) {
+        if (startsWith("</")) {
+            readEndTag();
+        } else {
+            raiseError(tr("Expected character data."));
+        }
+    }
+    return m_text;
+}
+
+/**
+ * Read until the end of the current element, skipping all child elements.
+ */
+void KdbxXmlTokenizer::skipCurrentElement()
+{
+    int depth = 1;
+    while (depth > 0) {
+        switch (readNext()) {
+        case TokenType::StartElement:
+            ++depth;
+            break;
+        case TokenType::EndElement:
+            --depth;
+            break;
+        default:
+            return;
+        }
+    }
+}
+
+KdbxXmlTokenizer::TokenType KdbxXmlTokenizer::tokenType() const
+{
+    return m_token;
+}
+
+bool KdbxXmlTokenizer::isStartElement() const
+{
+    return m_token == TokenType::StartElement;
+}
+
+/**
+ * @return tag of the current start or end element, Tag::Unknown for names KDBX does not use
+ */
+KdbxXmlTokenizer::Tag KdbxXmlTokenizer::tag() const
+{
+    return m_tag;
+}
+
+/**
+ * @return name of the current start element
+ */
+QString KdbxXmlTokenizer::name() const
+{
+    if (m_token != TokenType::StartElement || m_elements.isEmpty()) {
+        return QString();
+    }
+    const Element& element = m_elements.last();
+    return QString::fromUtf8(element.name, element.size);
+}
+
+/**
+ * @return true if the last start element has the attribute
+ */
+bool KdbxXmlTokenizer::hasAttribute(Attribute attribute) const
+{
+    return m_hasAttribute[static_cast<int>(attribute)];
+}
+
+/**
+ * @return UTF-8 encoded value of an attribute of the last start element, empty if it is missing
+ */
+const QByteArray& KdbxXmlTokenizer::attribute(Attribute attribute) const
+{
+    return m_attributes[static_cast<int>(attribute)];
+}
+
+bool KdbxXmlTokenizer::atEnd() const
+{
+    return m_token == TokenType::EndDocument || m_token == TokenType::Invalid;
+}
+
+bool KdbxXmlTokenizer::hasError() const
+{
+    return m_token == TokenType::Invalid;
+}
+
+QString KdbxXmlTokenizer::errorString() const
+{
+    return m_errorString;
+}
+
+qint64 KdbxXmlTokenizer::lineNumber() const
+{
+    return m_errorLine;
+}
+
+qint64 KdbxXmlTokenizer::columnNumber() const
+{
+    return m_errorColumn;
+}
+
+/**
+ * Stop reading with an error at the current position. Only the first error is kept.
+ *
+ * @param message error message
+ */
+void KdbxXmlTokenizer::raiseError(const QString& message)
+{
+    if (hasError()) {
+        return;
+    }
+
+    m_token = TokenType::Invalid;
+    m_tag = Tag::Unknown;
+    m_errorString = message;
+
+    m_errorLine = 1;
+    m_errorColumn = 0;
+    for (const char* p = m_data.constData(); p < m_pos; ++p) {
+        if (*p == '\n') {
+            ++m_errorLine;
+            m_errorColumn = 0;
+        } else if ((static_cast<uchar>(*p) & 0xC0) != 0x80) {
+            ++m_errorColumn;
+        }
+    }
+}
+
+/**
+ * Read everything up to the root element.
+ */
+bool KdbxXmlTokenizer::readProlog()
+{
+    if (startsWith("\xEF\xBB\xBF")) {
+        m_pos += 3;
+    }
+
+    if (startsWith("<?xml") && m_end - m_pos > 5 && (isWhitespace(m_pos[5]) || m_pos[5] == '?')) {
+        const char* declaration = m_pos;
+        if (!skipPast("?>")) {
+            return false;
+        }
+
+        const QByteArray text(declaration, static_cast<int>(m_pos - declaration));
+        int i = text.indexOf("encoding");
+        if (i >= 0) {
+            i += 8;
+            while (i < text.size() && (isWhitespace(text[i]) || text[i] == '=')) {
+                ++i;
+            }
+            const char quote = i < text.size() ? text[i] : '\0';
+            const int close = (quote == '"' || quote == '\'') ? text.indexOf(quote, i + 1) : -1;
+            if (close < 0) {
+                raiseError(tr("Invalid XML declaration."));
+                return false;
+            }
+            const QByteArray encoding = text.mid(i + 1, close - i - 1);
+            if (qstricmp(encoding.constData(), "utf-8") != 0) {
+                raiseError(tr("Unsupported encoding: %1").arg(QString::fromLatin1(encoding)));
+                return false;
+            }
+        }
+    }
+
+    for (;;) {
+        skipWhitespace();
+        if (m_pos == m_end) {
+            raiseError(tr("Premature end of document."));
+            return false;
+        }
+        if (startsWith("<!--")) {
+            if (!skipPast("-->")) {
+                return false;
+            }
+        } else if (startsWith("<!DOCTYPE")) {
+            raiseError(tr("Document type declarations are not supported."));
+            return false;
+        } else if (startsWith("<?")) {
+            if (!skipPast("?>")) {
+                return false;
+            }
+        } else if (*m_pos == '<') {
+            return true;
+        } else {
+            raiseError(tr("Start tag expected."));
+            return false;
+        }
+    }
+}
+
+bool KdbxXmlTokenizer::readStartTag()
+{
+    Q_ASSERT(*m_pos == '<');
+    ++m_pos;
+
+    Element element;
+    if (!readName(element.name, element.size)) {
+        return false;
+    }
+    element.tag = lookupTag(element.name, element.size);
+
+    for (int i = 0; i < static_cast<int>(Attribute::Count); ++i) {
+        if (m_hasAttribute[i]) {
+            m_attributes[i].resize(0);
+            m_hasAttribute[i] = false;
+        }
+    }
+
+    for (;;) {
+        const char* whitespace = m_pos;
+        skipWhitespace();
+        if (m_pos == m_end) {
+            raiseError(tr("Premature end of document."));
+            return false;
+        }
+        if (*m_pos == '>') {
+            ++m_pos;
+            m_selfClosing = false;
+            break;
+        }
+        if (startsWith("/>")) {
+            m_pos += 2;
+            m_selfClosing = true;
+            break;
+        }
+        if (m_pos == whitespace) {
+            raiseError(tr("Invalid start tag."));
+            return false;
+        }
+
+        const char* name;
+        int size;
+        if (!readName(name, size)) {
+            return false;
+        }
+        skipWhitespace();
+        if (m_pos == m_end || *m_pos != '=') {
+            raiseError(tr("Invalid attribute."));
+            return false;
+        }
+        ++m_pos;
+        skipWhitespace();
+
+        // values of attributes KDBX does not use are checked but not kept
+        QByteArray* value = nullptr;
+        for (const AttributeName& known : AttributeNames) {
+            if (compareName(name, size, known.name) == 0) {
+                const int index = static_cast<int>(known.attribute);
+                if (m_hasAttribute[index]) {
+                    raiseError(tr("Attribute redefined."));
+                    return false;
+                }
+                m_hasAttribute[index] = true;
+                value = &m_attributes[index];
+                break;
+            }
+        }
+        if (!readAttributeValue(value)) {
+            return false;
+        }
+    }
+
+    m_elements.append(element);
+    m_token = TokenType::StartElement;
+    m_tag = element.tag;
+    return true;
+}
+
+bool KdbxXmlTokenizer::readEndTag()
+{
+    Q_ASSERT(startsWith("</"));
+    m_pos += 2;
+
+    const char* name;
+    int size;
+    if (!readName(name, size)) {
+        return false;
+    }
+    skipWhitespace();
+    if (m_pos == m_end || *m_pos != '>') {
+        raiseError(tr("Invalid end tag."));
+        return false;
+    }
+    ++m_pos;
+
+    const Element& element = m_elements.last();
+    if (element.size != size || std::memcmp(element.name, name, static_cast<size_t>(size)) != 0) {
+        raiseError(tr("Opening and ending tag mismatch."));
+        return false;
+    }
+
+    endElement();
+    return true;
+}
+
+/**
+ * Read character data up to the next start or end tag. References are
+ * resolved and line breaks are normalized to \n.
+ *
+ * @param out buffer the text is appended to, nullptr to drop it
+ * @return true if a tag follows, false on errors
+ */
+bool KdbxXmlTokenizer::readCharacters(QByteArray* out)
+{
+    for (;;) {
+        const char* run = m_pos;
+        while (m_pos < m_end && isPlainChar(*m_pos)) {
+            ++m_pos;
+        }
+        if (out && m_pos > run) {
+            out->append(run, static_cast<int>(m_pos - run));
+        }
+
+        if (m_pos == m_end) {
+            raiseError(tr("Premature end of document."));
+            return false;
+        }
+
+        switch (*m_pos) {
+        case '<':
+            if (startsWith("<!--")) {
+                if (!skipPast("-->")) {
+                    return false;
+                }
+            } else if (startsWith("<![CDATA[")) {
+                if (!readCdata(out)) {
+                    return false;
+                }
+            } else if (startsWith("<?")) {
+                if (!skipPast("?>")) {
+                    return false;
+                }
+            } else {
+                return true;
+            }
+            break;
+        case '&':
+            if (!readReference(out)) {
+                return false;
+            }
+            break;
+        case '\r':
+            ++m_pos;
+            if (m_pos < m_end && *m_pos == '\n') {
+                ++m_pos;
+            }
+            if (out) {
+                out->append('\n');
+            }
+            break;
+        default:
+            raiseError(tr("Invalid XML character."));
+            return false;
+        }
+    }
+}
+
+/**
+ * Read a quoted attribute value. Whitespace characters are normalized to spaces.
+ *
+ * @param out buffer the value is appended to, nullptr to drop it
+ */
+bool KdbxXmlTokenizer::readAttributeValue(QByteArray* out)
+{
+    if (m_pos == m_end || (*m_pos != '"' && *m_pos != '\'')) {
+        raiseError(tr("Invalid attribute."));
+        return false;
+    }
+    const char quote = *m_pos++;
+
+    for (;;) {
+        const char* run = m_pos;
+        while (m_pos < m_end && *m_pos != quote && isPlainChar(*m_pos) && *m_pos != '\t' && *m_pos != '\n') {
+            ++m_pos;
+        }
+        if (out && m_pos > run) {
+            out->append(run, static_cast<int>(m_pos - run));
+        }
+
+        if (m_pos == m_end) {
+            raiseError(tr("Premature end of document."));
+            return false;
+        }
+
+        const char c = *m_pos;
+        if (c == quote) {
+            ++m_pos;
+            return true;
+        }
+        if (c == '&') {
+            if (!readReference(out)) {
+                return false;
+            }
+            continue;
+        }
+        if (c == '\t' || c == '\n' || c == '\r') {
+            if (c == '\r' && m_end - m_pos > 1 && m_pos[1] == '\n') {
+                ++m_pos;
+            }
+            ++m_pos;
+            if (out) {
+                out->append(' ');
+            }
+            continue;
+        }
+
+        raiseError(c == '<' ? tr("'<' is not allowed in attribute values.") : tr("Invalid XML character."));
+        return false;
+    }
+}
+
+/**
+ * Resolve a predefined entity or a character reference.
+ *
+ * @param out buffer the character is appended to, nullptr to drop it
+ */
+bool KdbxXmlTokenizer::readReference(QByteArray* out)
+{
+    Q_ASSERT(*m_pos == '&');
+    const char* start = m_pos + 1;
+    const char* semicolon = start;
+    while (semicolon < m_end && semicolon - start < 32 && *semicolon != ';') {
+        ++semicolon;
+    }
+    if (semicolon == m_end || *semicolon != ';') {
+        raiseError(tr("Invalid entity reference."));
+        return false;
+    }
+
+    const int size = static_cast<int>(semicolon - start);
+    uint c = 0;
+    if (size > 1 && start[0] == '#') {
+        const char* digit = start + 1;
+        uint base = 10;
+        if (*digit == 'x') {
+            base = 16;
+            ++digit;
+        }
+        if (digit == semicolon) {
+            raiseError(tr("Invalid character reference."));
+            return false;
+        }
+        for (; digit < semicolon; ++digit) {
+            const int value = digitValue(*digit);
+            if (value < 0 || static_cast<uint>(value) >= base || c > 0x10FFFF) {
+                raiseError(tr("Invalid character reference."));
+                return false;
+            }
+            c = c * base + static_cast<uint>(value);
+        }
+        if (!isXmlChar(c)) {
+            raiseError(tr("Invalid character reference."));
+            return false;
+        }
+    } else if (compareName(start, size, "lt") == 0) {
+        c = '<';
+    } else if (compareName(start, size, "gt") == 0) {
+        c = '>';
+    } else if (compareName(start, size, "amp") == 0) {
+        c = '&';
+    } else if (compareName(start, size, "quot") == 0) {
+        c = '"';
+    } else if (compareName(start, size, "apos") == 0) {
+        c = '\'';
+    } else {
+        raiseError(tr("Entity '%1' not declared.").arg(QString::fromUtf8(start, size)));
+        return false;
+    }
+
+    if (out) {
+        appendUtf8(*out, c);
+    }
+    m_pos = semicolon + 1;
+    return true;
+}
+
+/**
+ * @param out buffer the contents are appended to, nullptr to drop them
+ */
+bool KdbxXmlTokenizer::readCdata(QByteArray* out)
+{
+    Q_ASSERT(startsWith("<![CDATA["));
+    m_pos += 9;
+    const char* start = m_pos;
+    if (!skipPast("]]>")) {
+        return false;
+    }
+    const char* end = m_pos - 3;
+
+    for (const char* p = start; p < end; ++p) {
+        const auto c = static_cast<uchar>(*p);
+        if (c >= 0x20 || c == '\t' || c == '\n') {
+            if (out) {
+                out->append(*p);
+            }
+        } else if (c == '\r') {
+            if (out && (p + 1 == end || p[1] != '\n')) {
+                out->append('\n');
+            }
+        } else {
+            m_pos = p;
+            raiseError(tr("Invalid XML character."));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool KdbxXmlTokenizer::readName(const char*& name, int& size)
+{
+    if (m_pos == m_end || !isNameStartChar(*m_pos)) {
+        raiseError(tr("Invalid XML name."));
+        return false;
+    }
+
+    name = m_pos++;
+    while (m_pos < m_end && isNameChar(*m_pos)) {
+        ++m_pos;
+    }
+    size = static_cast<int>(m_pos - name);
+    return true;
+}
+
+/**
+ * Move behind the next occurrence of terminator.
+ */
+bool KdbxXmlTokenizer::skipPast(const char* terminator)
+{
+    const int index = m_data.indexOf(terminator, static_cast<int>(m_pos - m_data.constData()));
+    if (index < 0) {
+        m_pos = m_end;
+        raiseError(tr("Premature end of document."));
+        return false;
+    }
+    m_pos = m_data.constData() + index + qstrlen(terminator);
+    return true;
+}
+
+void KdbxXmlTokenizer::skipWhitespace()
+{
+    while (m_pos < m_end && isWhitespace(*m_pos)) {
+        ++m_pos;
+    }
+}
+
+bool KdbxXmlTokenizer::startsWith(const char* str) const
+{
+    const auto length = static_cast<qint64>(qstrlen(str));
+    return m_end - m_pos >= length && std::memcmp(m_pos, str, static_cast<size_t>(length)) == 0;
+}
+
+KdbxXmlTokenizer::TokenType KdbxXmlTokenizer::endElement()
+{
+    m_tag = m_elements.last().tag;
+    m_elements.removeLast();
+    m_token = TokenType::EndElement;
+    return m_token;
+}
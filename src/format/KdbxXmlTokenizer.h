@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 or (at your option)
+ * version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSXC_KDBXXMLTOKENIZER_H
+#define KEEPASSXC_KDBXXMLTOKENIZER_H
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QString>
+#include <QVector>
+
+class QIODevice;
+
+/**
+ * Pull tokenizer for the UTF-8 XML payload of KDBX files.
+ */
+class KdbxXmlTokenizer
+{
+    Q_DECLARE_TR_FUNCTIONS(KdbxXmlTokenizer)
+
+public:
+    enum class TokenType
+    {
+        NoToken,
+        StartElement,
+        EndElement,
+        EndDocument,
+        Invalid
+    };
+
+    enum class Tag
+    {
+        Unknown,
+        KeePassFile,
+        Meta,
+        Root,
+        Generator,
+        HeaderHash,
+        DatabaseName,
+        DatabaseNameChanged,
+        DatabaseDescription,
+        DatabaseDescriptionChanged,
+        DefaultUserName,
+        DefaultUserNameChanged,
+        MaintenanceHistoryDays,
+        Color,
+        MasterKeyChanged,
+        MasterKeyChangeRec,
+        MasterKeyChangeForce,
+        MemoryProtection,
+        CustomIcons,
+        RecycleBinEnabled,
+        RecycleBinUUID,
+        RecycleBinChanged,
+        EntryTemplatesGroup,
+        EntryTemplatesGroupChanged,
+        LastSelectedGroup,
+        LastTopVisibleGroup,
+        HistoryMaxItems,
+        HistoryMaxSize,
+        Binaries,
+        CustomData,
+        SettingsChanged,
+        ProtectTitle,
+        ProtectUserName,
+        ProtectPassword,
+        ProtectURL,
+        ProtectNotes,
+        Icon,
+        UUID,
+        Data,
+        Binary,
+        Item,
+        Key,
+        Value,
+        Group,
+        DeletedObjects,
+        Name,
+        Notes,
+        IconID,
+        CustomIconUUID,
+        Times,
+        IsExpanded,
+        DefaultAutoTypeSequence,
+        EnableAutoType,
+        EnableSearching,
+        LastTopVisibleEntry,
+        Entry,
+        DeletedObject,
+        DeletionTime,
+        ForegroundColor,
+        BackgroundColor,
+        OverrideURL,
+        Tags,
+        String,
+        AutoType,
+        History,
+        Enabled,
+        DataTransferObfuscation,
+        DefaultSequence,
+        Association,
+        Window,
+        KeystrokeSequence,
+        LastModificationTime,
+        CreationTime,
+        LastAccessTime,
+        ExpiryTime,
+        Expires,
+        UsageCount,
+        LocationChanged
+    };
+
+    enum class Attribute
+    {
+        Protected,
+        ProtectInMemory,
+        ID,
+        Compressed,
+        Ref,
+        Count
+    };
+
+    KdbxXmlTokenizer();
+
+    void setDevice(QIODevice* device);
+    void setData(const QByteArray& data);
+    void clear();
+
+    TokenType readNext();
+    bool readNextStartElement();
+    const QByteArray& readText();
+    void skipCurrentElement();
+
+    TokenType tokenType() const;
+    bool isStartElement() const;
+    Tag tag() const;
+    QString name() const;
+    bool hasAttribute(Attribute attribute) const;
+    const QByteArray& attribute(Attribute attribute) const;
+
+    bool atEnd() const;
+    bool hasError() const;
+    QString errorString() const;
+    qint64 lineNumber() const;
+    qint64 columnNumber() const;
+    void raiseError(const QString& message);
+
+private:
+    struct Element
+    {
+        const char* name;
+        int size;
+        Tag tag;
+    };
+
+    bool readProlog();
+    bool readStartTag();
+    bool readEndTag();
+    bool readCharacters(QByteArray* out);
+    bool readAttributeValue(QByteArray* out);
+    bool readReference(QByteArray* out);
+    bool readCdata(QByteArray* out);
+    bool readName(const char*& name, int& size);
+    bool skipPast(const char* terminator);
+    void skipWhitespace();
+    bool startsWith(const char* str) const;
+    TokenType endElement();
+
+    QByteArray m_data;
+    const char* m_pos;
+    const char* m_end;
+
+    TokenType m_token;
+    Tag m_tag;
+    QVector<Element> m_elements;
+    bool m_prologRead;
+    bool m_selfClosing;
+
+    QByteArray m_text;
+    QByteArray m_attributes[static_cast<int>(Attribute::Count)];
+    bool m_hasAttribute[static_cast<int>(Attribute::Count)];
+
+    QString m_errorString;
+    qint64 m_errorLine;
+    qint64 m_errorColumn;
+};
+
+#endif // KEEPASSXC_KDBXXMLTOKENIZER_H
@@ -19,12 +19,46 @@
 
 #include <QBuffer>
 #include <QFile>
+#include <QtConcurrent>
+
+#include <functional>
 
 #include "core/Endian.h"
 #include "core/Metadata.h"
 #include "format/KeePass2RandomStream.h"
 #include "streams/QtIOCompressor"
 
+namespace
+{
+    // serialize entries in parallel only for databases of at least this size
+    const int MinParallelEntries = 256;
+    // number of entries that are serialized ahead of the sequential writer
+    const int EntryBatchSize = 4096;
+
+    /**
+     * Cheap, branchless pre-check for the characters that might have to be
+     * stripped. Also matches surrogates and the private use area, which are
+     * only sorted out by the exact check.
+     */
+    inline uint maybeInvalidXml10Char(ushort uc)
+    {
+        // tab, line feed and carriage return are the only valid control characters
+        const uint control = (uc < 0x20) & ~(0x2600u >> (uc & 0x1F));
+        const uint c1Control = static_cast<ushort>(uc - 0x7F) <= (0x9F - 0x7F);
+        const uint high = uc >= 0xD800;
+        return (control | c1Control | high) & 1;
+    }
+
+    bool isInvalidXml10Char(ushort uc)
+    {
+        return (uc < 0x20 && uc != 0x09 && uc != 0x0A && uc != 0x0D) // control characters
+               || (uc >= 0x7F && uc <= 0x84) // control characters, valid but discouraged by XML
+               || (uc >= 0x86 && uc <= 0x9F) // control characters, valid but discouraged by XML
+               || (uc > 0xFFFD) // noncharacter
+               || QChar::isSurrogate(uc); // single surrogate, pairs are handled by the caller
+    }
+} // namespace
+
 /**
  * @param version KDBX version
  */
@@ -48,6 +82,9 @@ void KdbxXmlWriter::writeDatabase(QIODevice* device,
     m_xml.setCodec("UTF-8");
 
     generateIdMap();
+    if (m_parallel) {
+        prepareEntryJobs();
+    }
 
     m_xml.setDevice(device);
     m_xml.writeStartDocument("1.0", true);
@@ -71,6 +108,17 @@ void KdbxXmlWriter::writeDatabase(const QString& filename, Database* db)
     writeDatabase(&file, db);
 }
 
+/**
+ * Enable or disable serializing entries on multiple threads.
+ * The output is identical in both modes.
+ *
+ * @param parallel use the global thread pool for large databases
+ */
+void KdbxXmlWriter::setParallel(bool parallel)
+{
+    m_parallel = parallel;
+}
+
 bool KdbxXmlWriter::hasError()
 {
     return m_error;
@@ -92,11 +140,127 @@ void KdbxXmlWriter::generateIdMap()
             QByteArray data = entry->attachments()->value(key);
             if (!m_idMap.contains(data)) {
                 m_idMap.insert(data, nextId++);
+                m_binaries.append(data);
             }
         }
     }
 }
 
+/**
+ * First pass of the parallel writer: collect all entries in document order
+ * and assign each one its slice of the inner random stream. The keystream
+ * only depends on the number of protected bytes written before a value,
+ * so it is generated once up front and the entries can then be serialized
+ * independently of each other.
+ */
+void KdbxXmlWriter::prepareEntryJobs()
+{
+    int keystreamSize = 0;
+    // entries of the root group are nested in <KeePassFile><Root><Group>
+    collectEntryJobs(m_db->rootGroup(), 3, keystreamSize);
+
+    if (m_entryJobs.size() < MinParallelEntries) {
+        m_entryJobs.clear();
+        return;
+    }
+
+    if (m_randomStream) {
+        bool ok;
+        m_keystream = m_randomStream->randomBytes(keystreamSize, &ok);
+        if (!ok) {
+            raiseError(m_randomStream->errorString());
+            m_entryJobs.clear();
+            return;
+        }
+        m_useKeystream = true;
+    }
+}
+
+void KdbxXmlWriter::collectEntryJobs(const Group* group, int depth, int& keystreamOffset)
+{
+    const QList<Entry*>& entryList = group->entries();
+    for (const Entry* entry : entryList) {
+        EntryJob job;
+        job.entry = entry;
+        job.depth = depth;
+        job.keystreamOffset = keystreamOffset;
+        job.keystreamSize = m_randomStream ? protectedSize(entry) : 0;
+        keystreamOffset += job.keystreamSize;
+        m_entryJobs.append(job);
+    }
+
+    const QList<Group*>& children = group->children();
+    for (const Group* child : children) {
+        collectEntryJobs(child, depth + 1, keystreamOffset);
+    }
+}
+
+/**
+ * Serialize a single entry into a standalone buffer.
+ * This is called from worker threads and must not modify the writer state.
+ *
+ * The fragment writer is first brought into the same state as the main
+ * writer at the entry's position so auto-formatting produces the same
+ * indentation; only the bytes written for the entry itself are returned.
+ */
+QByteArray KdbxXmlWriter::serializeEntry(const EntryJob& job) const
+{
+    KdbxXmlWriter writer(m_kdbxVersion);
+    writer.m_db = m_db;
+    writer.m_meta = m_meta;
+    writer.m_randomStream = m_randomStream;
+    writer.m_binaryIds = m_binaryIds;
+    writer.m_useKeystream = m_useKeystream;
+    if (m_useKeystream) {
+        writer.m_keystream = m_keystream.mid(job.keystreamOffset, job.keystreamSize);
+    }
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+
+    writer.m_xml.setAutoFormatting(true);
+    writer.m_xml.setAutoFormattingIndent(-1);
+    writer.m_xml.setCodec("UTF-8");
+    writer.m_xml.setDevice(&buffer);
+
+    for (int i = 0; i < job.depth; ++i) {
+        writer.m_xml.writeStartElement("Group");
+    }
+    // close the innermost start tag like a preceding sibling element would
+    writer.m_xml.writeStartElement("Times");
+    writer.m_xml.writeEndElement();
+
+    const qint64 start = buffer.pos();
+    writer.writeEntry(job.entry);
+
+    return buffer.data().mid(static_cast<int>(start));
+}
+
+/**
+ * Second pass of the parallel writer: copy the next entry to the output,
+ * serializing the following batch of entries first if necessary.
+ */
+void KdbxXmlWriter::writeSerializedEntry()
+{
+    if (m_nextEntryJob >= m_serializedStart + m_serializedEntries.size()) {
+        const std::function<QByteArray(const EntryJob&)> serialize = [this](const EntryJob& job) {
+            return serializeEntry(job);
+        };
+
+        m_serializedStart = m_nextEntryJob;
+        m_serializedEntries = QtConcurrent::blockingMapped(m_entryJobs.mid(m_nextEntryJob, EntryBatchSize), serialize);
+    }
+
+    const QByteArray& data = m_serializedEntries.at(m_nextEntryJob - m_serializedStart);
+    ++m_nextEntryJob;
+
+    // the stream writer doesn't buffer, so the fragment can be written to the device directly
+    QIODevice* device = m_xml.device();
+    if (device->write(data) != data.size()) {
+        raiseError(device->errorString());
+    }
+}
+
 void KdbxXmlWriter::writeMetadata()
 {
     m_xml.writeStartElement("Meta");
@@ -181,45 +345,78 @@ void KdbxXmlWriter::writeIcon(const QUuid& uuid, const QImage& icon)
 
 void KdbxXmlWriter::writeBinaries()
 {
-    m_xml.writeStartElement("Binaries");
-
-    QHash<QByteArray, int>::const_iterator i;
-    for (i = m_idMap.constBegin(); i != m_idMap.constEnd(); ++i) {
-        m_xml.writeStartElement("Binary");
+    // upper bound for the attachment data encoded at the same time
+    const qint64 maxBatchSize = 64 * 1024 * 1024;
 
-        m_xml.writeAttribute("ID", QString::number(i.value()));
+    m_xml.writeStartElement("Binaries");
 
-        QByteArray data;
-        if (m_db->compressionAlgo() == Database::CompressionGZip) {
-            m_xml.writeAttribute("Compressed", "True");
+    const bool compress = (m_db->compressionAlgo() == Database::CompressionGZip);
+    const std::function<QByteArray(const QByteArray&)> encode = [compress](const QByteArray& data) {
+        return encodeBinary(data, compress);
+    };
+
+    // Compress and encode the binaries in parallel, but write them in ID order
+    int batchStart = 0;
+    while (batchStart < m_binaries.size()) {
+        int batchEnd = batchStart + 1;
+        qint64 batchSize = m_binaries[batchStart].size();
+        while (batchEnd < m_binaries.size() && batchSize + m_binaries[batchEnd].size() <= maxBatchSize) {
+            batchSize += m_binaries[batchEnd].size();
+            ++batchEnd;
+        }
 
-            QBuffer buffer;
-            buffer.open(QIODevice::ReadWrite);
+        const QList<QByteArray> batch = m_binaries.mid(batchStart, batchEnd - batchStart);
+        const QList<QByteArray> encodedBatch = QtConcurrent::blockingMapped(batch, encode);
 
-            QtIOCompressor compressor(&buffer);
-            compressor.setStreamFormat(QtIOCompressor::GzipFormat);
-            compressor.open(QIODevice::WriteOnly);
+        for (int i = 0; i < encodedBatch.size(); ++i) {
+            m_xml.writeStartElement("Binary");
 
-            qint64 bytesWritten = compressor.write(i.key());
-            Q_ASSERT(bytesWritten == i.key().size());
-            Q_UNUSED(bytesWritten);
-            compressor.close();
+            m_xml.writeAttribute("ID", QString::number(batchStart + i));
+            if (compress) {
+                m_xml.writeAttribute("Compressed", "True");
+            }
 
-            buffer.seek(0);
-            data = buffer.readAll();
-        } else {
-            data = i.key();
+            if (!encodedBatch[i].isEmpty()) {
+                m_xml.writeCharacters(QString::fromLatin1(encodedBatch[i]));
+            }
+            m_xml.writeEndElement();
         }
 
-        if (!data.isEmpty()) {
-            m_xml.writeCharacters(QString::fromLatin1(data.toBase64()));
-        }
-        m_xml.writeEndElement();
+        batchStart = batchEnd;
     }
 
     m_xml.writeEndElement();
 }
 
+/**
+ * Encode attachment data for the <Binary> element of the KDBX 3 meta data.
+ * This is called from worker threads and must not touch the writer state.
+ *
+ * @param data raw attachment data
+ * @param compress gzip the data before encoding
+ * @return base64 encoded data
+ */
+QByteArray KdbxXmlWriter::encodeBinary(const QByteArray& data, bool compress)
+{
+    if (!compress) {
+        return data.toBase64();
+    }
+
+    QBuffer buffer;
+    buffer.open(QIODevice::ReadWrite);
+
+    QtIOCompressor compressor(&buffer);
+    compressor.setStreamFormat(QtIOCompressor::GzipFormat);
+    compressor.open(QIODevice::WriteOnly);
+
+    qint64 bytesWritten = compressor.write(data);
+    Q_ASSERT(bytesWritten == data.size());
+    Q_UNUSED(bytesWritten);
+    compressor.close();
+
+    return buffer.data().toBase64();
+}
+
 void KdbxXmlWriter::writeCustomData(const CustomData* customData)
 {
     if (customData->isEmpty()) {
@@ -287,7 +484,12 @@ void KdbxXmlWriter::writeGroup(const Group* group)
 
     const QList<Entry*>& entryList = group->entries();
     for (const Entry* entry : entryList) {
-        writeEntry(entry);
+        if (m_entryJobs.isEmpty()) {
+            writeEntry(entry);
+        } else {
+            Q_ASSERT(m_entryJobs.at(m_nextEntryJob).entry == entry);
+            writeSerializedEntry();
+        }
     }
 
     const QList<Group*>& children = group->children();
@@ -356,12 +558,7 @@ void KdbxXmlWriter::writeEntry(const Entry* entry)
     for (const QString& key : attributesKeyList) {
         m_xml.writeStartElement("String");
 
-        bool protect =
-            (((key == "Title") && m_meta->protectTitle()) || ((key == "UserName") && m_meta->protectUsername())
-             || ((key == "Password") && m_meta->protectPassword())
-             || ((key == "URL") && m_meta->protectUrl())
-             || ((key == "Notes") && m_meta->protectNotes())
-             || entry->attributes()->isProtected(key));
+        bool protect = isProtected(entry, key);
 
         writeString("Key", key);
 
@@ -372,7 +569,7 @@ void KdbxXmlWriter::writeEntry(const Entry* entry)
             if (m_randomStream) {
                 m_xml.writeAttribute("Protected", "True");
                 bool ok;
-                QByteArray rawData = m_randomStream->process(entry->attributes()->value(key).toUtf8(), &ok);
+                QByteArray rawData = protectValue(entry->attributes()->value(key).toUtf8(), &ok);
                 if (!ok) {
                     raiseError(m_randomStream->errorString());
                 }
@@ -400,7 +597,7 @@ void KdbxXmlWriter::writeEntry(const Entry* entry)
         writeString("Key", key);
 
         m_xml.writeStartElement("Value");
-        m_xml.writeAttribute("Ref", QString::number(m_idMap[entry->attachments()->value(key)]));
+        m_xml.writeAttribute("Ref", QString::number(m_binaryIds->value(entry->attachments()->value(key))));
         m_xml.writeEndElement();
 
         m_xml.writeEndElement();
@@ -458,6 +655,60 @@ void KdbxXmlWriter::writeEntryHistory(const Entry* entry)
     m_xml.writeEndElement();
 }
 
+bool KdbxXmlWriter::isProtected(const Entry* entry, const QString& key) const
+{
+    return (((key == "Title") && m_meta->protectTitle()) || ((key == "UserName") && m_meta->protectUsername())
+            || ((key == "Password") && m_meta->protectPassword())
+            || ((key == "URL") && m_meta->protectUrl())
+            || ((key == "Notes") && m_meta->protectNotes())
+            || entry->attributes()->isProtected(key));
+}
+
+/**
+ * @return number of inner random stream bytes consumed by writing the entry
+ *         including its history
+ */
+int KdbxXmlWriter::protectedSize(const Entry* entry) const
+{
+    int size = 0;
+
+    const QList<QString> attributesKeyList = entry->attributes()->keys();
+    for (const QString& key : attributesKeyList) {
+        if (isProtected(entry, key)) {
+            size += entry->attributes()->value(key).toUtf8().size();
+        }
+    }
+
+    if (entry->parent()) {
+        const QList<Entry*>& historyItems = entry->historyItems();
+        for (const Entry* item : historyItems) {
+            size += protectedSize(item);
+        }
+    }
+
+    return size;
+}
+
+QByteArray KdbxXmlWriter::protectValue(const QByteArray& data, bool* ok)
+{
+    if (!m_useKeystream) {
+        return m_randomStream->process(data, ok);
+    }
+
+    Q_ASSERT(m_keystreamOffset + data.size() <= m_keystream.size());
+
+    QByteArray result(data);
+    char* resultData = result.data();
+    const char* keystreamData = m_keystream.constData() + m_keystreamOffset;
+    for (int i = 0; i < result.size(); ++i) {
+        resultData[i] ^= keystreamData[i];
+    }
+    m_keystreamOffset += data.size();
+
+    *ok = true;
+    return result;
+}
+
 void KdbxXmlWriter::writeString(const QString& qualifiedName, const QString& string)
 {
     if (string.isEmpty()) {
@@ -567,28 +818,57 @@ QString KdbxXmlWriter::colorPartToString(int value)
     return str;
 }
 
-QString KdbxXmlWriter::stripInvalidXml10Chars(QString str)
+/**
+ * Remove code points that are not allowed in XML 1.0 documents.
+ *
+ * Strings are scanned in blocks first, which the compiler can vectorize.
+ * Clean strings, by far the most common case, are returned without a copy;
+ * otherwise the string is rebuilt in a single pass.
+ */
+QString KdbxXmlWriter::stripInvalidXml10Chars(const QString& str)
 {
-    for (int i = str.size() - 1; i >= 0; i--) {
-        const QChar ch = str.at(i);
-        const ushort uc = ch.unicode();
+    const int blockSize = 16;
+    const ushort* data = str.utf16();
+    const int size = str.size();
+
+    int i = 0;
+    for (; i + blockSize <= size; i += blockSize) {
+        uint suspicious = 0;
+        for (int j = 0; j < blockSize; ++j) {
+            suspicious |= maybeInvalidXml10Char(data[i + j]);
+        }
+        if (suspicious) {
+            break;
+        }
+    }
+    while (i < size && !maybeInvalidXml10Char(data[i])) {
+        ++i;
+    }
+    if (i == size) {
+        return str;
+    }
+
+    QString result;
+    result.reserve(size);
+    result.append(str.constData(), i);
+    bool stripped = false;
 
-        if (ch.isLowSurrogate() && i != 0 && str.at(i - 1).isHighSurrogate()) {
+    for (; i < size; ++i) {
+        const ushort uc = data[i];
+
+        if (QChar::isHighSurrogate(uc) && i + 1 < size && QChar::isLowSurrogate(data[i + 1])) {
             // keep valid surrogate pair
-            i--;
-        } else if ((uc < 0x20 && uc != 0x09 && uc != 0x0A && uc != 0x0D) // control characters
-                   || (uc >= 0x7F && uc <= 0x84) // control characters, valid but discouraged by XML
-                   || (uc >= 0x86 && uc <= 0x9F) // control characters, valid but discouraged by XML
-                   || (uc > 0xFFFD) // noncharacter
-                   || ch.isLowSurrogate() // single low surrogate
-                   || ch.isHighSurrogate()) // single high surrogate
-        {
+            result.append(QChar(uc));
+            result.append(QChar(data[++i]));
+        } else if (isInvalidXml10Char(uc)) {
             qWarning("Stripping invalid XML 1.0 codepoint %x", uc);
-            str.remove(i, 1);
+            stripped = true;
+        } else {
+            result.append(QChar(uc));
         }
     }
 
-    return str;
+    return stripped ? result : str;
 }
 
 void KdbxXmlWriter::raiseError(const QString& errorMessage)
@@ -41,11 +41,26 @@ public:
                        KeePass2RandomStream* randomStream = nullptr,
                        const QByteArray& headerHash = QByteArray());
     void writeDatabase(const QString& filename, Database* db);
+    void setParallel(bool parallel);
     bool hasError();
     QString errorString();
 
+    static QString stripInvalidXml10Chars(const QString& str);
+
 private:
+    struct EntryJob
+    {
+        const Entry* entry;
+        int depth;
+        int keystreamOffset;
+        int keystreamSize;
+    };
+
     void generateIdMap();
+    void prepareEntryJobs();
+    void collectEntryJobs(const Group* group, int depth, int& keystreamOffset);
+    QByteArray serializeEntry(const EntryJob& job) const;
+    void writeSerializedEntry();
 
     void writeMetadata();
     void writeMemoryProtection();
@@ -63,6 +78,9 @@ private:
     void writeAutoType(const Entry* entry);
     void writeAutoTypeAssoc(const AutoTypeAssociations::Association& assoc);
     void writeEntryHistory(const Entry* entry);
+    bool isProtected(const Entry* entry, const QString& key) const;
+    int protectedSize(const Entry* entry) const;
+    QByteArray protectValue(const QByteArray& data, bool* ok);
 
     void writeString(const QString& qualifiedName, const QString& string);
     void writeNumber(const QString& qualifiedName, int number);
@@ -75,7 +93,7 @@ private:
     void writeColor(const QString& qualifiedName, const QColor& color);
     void writeTriState(const QString& qualifiedName, Group::TriState triState);
     QString colorPartToString(int value);
-    QString stripInvalidXml10Chars(QString str);
+    static QByteArray encodeBinary(const QByteArray& data, bool compress);
 
     void raiseError(const QString& errorMessage);
 
@@ -86,8 +104,20 @@ private:
     QPointer<Metadata> m_meta;
     KeePass2RandomStream* m_randomStream = nullptr;
     QHash<QByteArray, int> m_idMap;
+    // fragment writers look up binary ids in the main writer's map instead of copying it
+    const QHash<QByteArray, int>* m_binaryIds = &m_idMap;
+    QList<QByteArray> m_binaries;
     QByteArray m_headerHash;
 
+    bool m_parallel = true;
+    QList<EntryJob> m_entryJobs;
+    QList<QByteArray> m_serializedEntries;
+    int m_serializedStart = 0;
+    int m_nextEntryJob = 0;
+    QByteArray m_keystream;
+    int m_keystreamOffset = 0;
+    bool m_useKeystream = false;
+
     bool m_error = false;
 
     QString m_errorStr = "";
@@ -93,6 +93,9 @@ Database* KeePass2Reader::readDatabase(QIODevice* device, const CompositeKey& ke
     }
 
     m_reader->setSaveXml(m_saveXml);
+    m_reader->setProgressCallback(m_progressCallback);
+    m_reader->setCancelFlag(m_cancelled);
+    m_reader->setTransformedKey(m_transformedKeySeed, m_transformedKey, m_keyUnknown);
     return m_reader->readDatabase(device, key, keepDatabase);
 }
 
@@ -116,6 +119,32 @@ void KeePass2Reader::setSaveXml(bool save)
     m_saveXml = save;
 }
 
+/**
+ * @see KdbxReader::setProgressCallback()
+ */
+void KeePass2Reader::setProgressCallback(const std::function<void(KdbxReader::ReadPhase)>& callback)
+{
+    m_progressCallback = callback;
+}
+
+/**
+ * @see KdbxReader::setCancelFlag()
+ */
+void KeePass2Reader::setCancelFlag(const QAtomicInt* cancelled)
+{
+    m_cancelled = cancelled;
+}
+
+/**
+ * @see KdbxReader::setTransformedKey()
+ */
+void KeePass2Reader::setTransformedKey(const QByteArray& kdfSeed, const QByteArray& transformedKey, bool keyUnknown)
+{
+    m_transformedKeySeed = kdfSeed;
+    m_transformedKey = transformedKey;
+    m_keyUnknown = keyUnknown;
+}
+
 /**
  * @return detected KDBX version
  */
@@ -43,6 +43,9 @@ public:
 
     bool saveXml() const;
     void setSaveXml(bool save);
+    void setProgressCallback(const std::function<void(KdbxReader::ReadPhase)>& callback);
+    void setCancelFlag(const QAtomicInt* cancelled);
+    void setTransformedKey(const QByteArray& kdfSeed, const QByteArray& transformedKey, bool keyUnknown = false);
 
     QSharedPointer<KdbxReader> reader() const;
     quint32 version() const;
@@ -51,6 +54,11 @@ private:
     void raiseError(const QString& errorMessage);
 
     bool m_saveXml = false;
+    std::function<void(KdbxReader::ReadPhase)> m_progressCallback;
+    const QAtomicInt* m_cancelled = nullptr;
+    QByteArray m_transformedKeySeed;
+    QByteArray m_transformedKey;
+    bool m_keyUnknown = false;
     bool m_error = false;
     QString m_errorStr = "";
 
@@ -21,9 +21,10 @@
 
 #include "core/Config.h"
 #include "core/Database.h"
+#include "core/DatabaseLoader.h"
 #include "core/FilePath.h"
+#include "core/QuickUnlock.h"
 #include "crypto/Random.h"
-#include "format/KeePass2Reader.h"
 #include "gui/FileDialog.h"
 #include "gui/MainWindow.h"
 #include "gui/MessageBox.h"
@@ -40,10 +41,12 @@ DatabaseOpenWidget::DatabaseOpenWidget(QWidget* parent)
     : DialogyWidget(parent)
     , m_ui(new Ui::DatabaseOpenWidget())
     , m_db(nullptr)
+    , m_loader(new DatabaseLoader(this))
 {
     m_ui->setupUi(this);
 
     m_ui->messageWidget->setHidden(true);
+    m_ui->unlockProgress->setVisible(false);
     m_ui->checkPassword->setChecked(true);
 
     QFont font = m_ui->labelHeadline->font();
@@ -61,6 +64,9 @@ DatabaseOpenWidget::DatabaseOpenWidget(QWidget* parent)
     connect(m_ui->buttonBox, SIGNAL(accepted()), SLOT(openDatabase()));
     connect(m_ui->buttonBox, SIGNAL(rejected()), SLOT(reject()));
 
+    connect(m_loader, SIGNAL(phaseChanged(int)), SLOT(unlockPhaseChanged(int)));
+    connect(m_loader, SIGNAL(finished(bool)), SLOT(unlockFinished(bool)));
+
 #ifdef WITH_XC_YUBIKEY
     m_ui->yubikeyProgress->setVisible(false);
     QSizePolicy sp = m_ui->yubikeyProgress->sizePolicy();
@@ -132,17 +138,28 @@ void DatabaseOpenWidget::load(const QString& filename)
         }
     }
 
-    m_ui->editPassword->setFocus();
+    bool quickUnlockEnabled = quickUnlock()->isEnabled();
+    m_ui->labelQuickUnlockPin->setVisible(quickUnlockEnabled);
+    m_ui->editQuickUnlockPin->setVisible(quickUnlockEnabled);
+
+    if (quickUnlock()->isAvailable(m_filename)) {
+        m_ui->editQuickUnlockPin->setFocus();
+    } else {
+        m_ui->editPassword->setFocus();
+    }
 }
 
 void DatabaseOpenWidget::clearForms()
 {
     m_ui->editPassword->clear();
+    m_ui->editQuickUnlockPin->clear();
     m_ui->comboKeyFile->clear();
     m_ui->checkPassword->setChecked(true);
     m_ui->checkKeyFile->setChecked(false);
     m_ui->checkChallengeResponse->setChecked(false);
     m_ui->buttonTogglePassword->setChecked(false);
+    m_loader->cancel();
+    setUnlocking(false);
     m_db = nullptr;
 }
 
@@ -165,37 +182,133 @@ void DatabaseOpenWidget::enterKey(const QString& pw, const QString& keyFile)
 
 void DatabaseOpenWidget::openDatabase()
 {
-    KeePass2Reader reader;
+    if (m_loader->isLoading()) {
+        return;
+    }
+
+    if (openWithQuickUnlock()) {
+        return;
+    }
+
     QSharedPointer<CompositeKey> masterKey = databaseKey();
     if (masterKey.isNull()) {
+        emit unlockFailed();
         return;
     }
 
     m_ui->editPassword->setShowPassword(false);
-    QCoreApplication::processEvents();
 
-    QFile file(m_filename);
-    if (!file.open(QIODevice::ReadOnly)) {
-        m_ui->messageWidget->showMessage(tr("Unable to open the database.").append("\n").append(file.errorString()),
-                                         MessageWidget::Error);
-        return;
-    }
     if (m_db) {
         delete m_db;
+        m_db = nullptr;
+    }
+
+    // read the database on a worker thread so the other tabs stay responsive
+    m_quickUnlocking = false;
+    setUnlocking(true);
+    m_loader->load(m_filename, *masterKey);
+}
+
+/**
+ * Open the database with the key sealed on the last lock if only a PIN was entered.
+ *
+ * @return true if the PIN was used, false to open the database with the entered key
+ */
+bool DatabaseOpenWidget::openWithQuickUnlock()
+{
+    QString pin = m_ui->editQuickUnlockPin->text();
+    if (pin.isEmpty() || !m_ui->editPassword->text().isEmpty() || m_ui->checkKeyFile->isChecked()
+        || !quickUnlock()->isAvailable(m_filename)) {
+        return false;
+    }
+
+    QByteArray kdfSeed;
+    QByteArray transformedKey;
+    QuickUnlock::Result result = quickUnlock()->unseal(m_filename, pin, kdfSeed, transformedKey);
+    if (result == QuickUnlock::Result::Unavailable) {
+        return false;
+    }
+
+    if (result == QuickUnlock::Result::WrongPin) {
+        int attempts = quickUnlock()->remainingAttempts(m_filename);
+        if (attempts > 0) {
+            m_ui->messageWidget->showMessage(tr("Wrong PIN, %n attempt(s) left.", "", attempts),
+                                             MessageWidget::Error);
+        } else {
+            m_ui->messageWidget->showMessage(tr("Wrong PIN, please unlock the database with its full key."),
+                                             MessageWidget::Error);
+        }
+        m_ui->editQuickUnlockPin->clear();
+        return true;
     }
-    QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-    m_db = reader.readDatabase(&file, *masterKey);
-    QApplication::restoreOverrideCursor();
 
     if (m_db) {
+        delete m_db;
+        m_db = nullptr;
+    }
+
+    m_quickUnlocking = true;
+    setUnlocking(true);
+    m_loader->load(m_filename, kdfSeed, transformedKey);
+    return true;
+}
+
+void DatabaseOpenWidget::unlockPhaseChanged(int phase)
+{
+    auto readPhase = static_cast<KdbxReader::ReadPhase>(phase);
+    m_ui->unlockProgress->setValue(phase + 1);
+    m_ui->unlockProgress->setFormat(DatabaseLoader::phaseText(readPhase));
+}
+
+void DatabaseOpenWidget::unlockFinished(bool success)
+{
+    setUnlocking(false);
+
+    if (success) {
+        m_db = m_loader->takeDatabase();
+        quickUnlock()->prepare(m_filename, m_ui->editQuickUnlockPin->text());
+        m_ui->editQuickUnlockPin->clear();
         if (m_ui->messageWidget->isVisible()) {
             m_ui->messageWidget->animatedHide();
         }
         emit editFinished(true);
+    } else if (m_quickUnlocking) {
+        // the sealed key only fits the file it was sealed for
+        m_ui->messageWidget->showMessage(
+            tr("The database has changed since it was locked, please unlock it with its full key."),
+            MessageWidget::Error);
+        m_ui->editQuickUnlockPin->clear();
+        emit unlockFailed();
     } else {
-        m_ui->messageWidget->showMessage(tr("Unable to open the database.").append("\n").append(reader.errorString()),
-                                         MessageWidget::Error);
+        m_ui->messageWidget->showMessage(
+            tr("Unable to open the database.").append("\n").append(m_loader->errorString()), MessageWidget::Error);
         m_ui->editPassword->clear();
+        m_ui->editQuickUnlockPin->clear();
+        emit unlockFailed();
+    }
+}
+
+/**
+ * Lock the form while the database is being read.
+ * The cancel button stays enabled to abort the unlock.
+ */
+void DatabaseOpenWidget::setUnlocking(bool unlocking)
+{
+    m_ui->unlockProgress->setVisible(unlocking);
+    m_ui->unlockProgress->setValue(0);
+    m_ui->unlockProgress->setFormat(QString());
+
+    m_ui->editPassword->setEnabled(!unlocking);
+    m_ui->buttonTogglePassword->setEnabled(!unlocking);
+    m_ui->checkPassword->setEnabled(!unlocking);
+    m_ui->checkKeyFile->setEnabled(!unlocking);
+    m_ui->comboKeyFile->setEnabled(!unlocking);
+    m_ui->buttonBrowseFile->setEnabled(!unlocking);
+    m_ui->editQuickUnlockPin->setEnabled(!unlocking);
+    m_ui->buttonBox->button(QDialogButtonBox::Ok)->setEnabled(!unlocking);
+
+    if (!unlocking) {
+        m_ui->editPassword->setFocus();
     }
 }
 
@@ -273,6 +386,12 @@ QSharedPointer<CompositeKey> DatabaseOpenWidget::databaseKey()
 
 void DatabaseOpenWidget::reject()
 {
+    if (m_loader->isLoading()) {
+        m_loader->cancel();
+        setUnlocking(false);
+        return;
+    }
+
     emit editFinished(false);
 }
 
@@ -25,6 +25,7 @@
 #include "keys/CompositeKey.h"
 
 class Database;
+class DatabaseLoader;
 class QFile;
 
 namespace Ui
@@ -49,6 +50,7 @@ public slots:
 
 signals:
     void editFinished(bool accepted);
+    void unlockFailed();
 
 protected:
     void showEvent(QShowEvent* event) override;
@@ -67,6 +69,8 @@ private slots:
     void yubikeyDetected(int slot, bool blocking);
     void yubikeyDetectComplete();
     void noYubikeyFound();
+    void unlockPhaseChanged(int phase);
+    void unlockFinished(bool success);
 
 protected:
     const QScopedPointer<Ui::DatabaseOpenWidget> m_ui;
@@ -74,7 +78,12 @@ protected:
     QString m_filename;
 
 private:
+    void setUnlocking(bool unlocking);
+    bool openWithQuickUnlock();
+
+    DatabaseLoader* m_loader;
     bool m_yubiKeyBeingPolled = false;
+    bool m_quickUnlocking = false;
     Q_DISABLE_COPY(DatabaseOpenWidget)
 };
 
@@ -22,6 +22,7 @@
 #include "ui_DatabaseSettingsWidgetGeneral.h"
 
 #include <QMessageBox>
+#include <QPointer>
 #include <QPushButton>
 #include <QThread>
 
@@ -34,6 +35,7 @@
 #include "core/Metadata.h"
 #include "crypto/SymmetricCipher.h"
 #include "crypto/kdf/Argon2Kdf.h"
+#include "crypto/kdf/KdfCalibrator.h"
 
 DatabaseSettingsWidget::DatabaseSettingsWidget(QWidget* parent)
     : DialogyWidget(parent)
@@ -226,11 +228,42 @@ void DatabaseSettingsWidget::save()
         argon2Kdf->setParallelism(static_cast<quint32>(m_uiEncryption->parallelismSpinBox->value()));
     }
 
-    QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-    // TODO: we should probably use AsyncTask::runAndWaitForFuture() here,
-    //       but not without making Database thread-safe
-    bool ok = m_db->changeKdf(kdf);
-    QApplication::restoreOverrideCursor();
+    // only derive the key again if the KDF parameters have changed
+    bool ok = true;
+    if (!m_db->isTransformedKeyCurrent() || !m_db->hasKdfParameters(kdf)) {
+        // a database unlocked with a PIN only knows its transformed key
+        if (!m_db->hasRawKey()) {
+            MessageBox::warning(this,
+                                tr("KDF unchanged"),
+                                tr("The database was unlocked with a PIN. Unlock it with its full key "
+                                   "to change the KDF parameters; KDF unchanged."),
+                                QMessageBox::Ok);
+            emit editFinished(true);
+            return;
+        }
+
+        kdf->randomizeSeed();
+        CompositeKey key = m_db->key();
+        QByteArray transformedKey;
+        QPointer<Database> db = m_db;
+
+        // the database is not thread-safe, so only the key transformation runs on the worker thread
+        setEnabled(false);
+        QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+        ok = AsyncTask::runAndWaitForFuture([&key, &kdf, &transformedKey]() {
+            return key.transform(*kdf, transformedKey);
+        });
+        QApplication::restoreOverrideCursor();
+        setEnabled(true);
+
+        if (!db) {
+            return;
+        }
+        if (ok) {
+            m_db->setKdf(kdf);
+            m_db->setTransformedKey(key, transformedKey);
+        }
+    }
 
     if (!ok) {
         MessageBox::warning(this,
@@ -267,9 +300,17 @@ void DatabaseSettingsWidget::transformRoundsBenchmark()
     }
 
     // Determine the number of rounds required to meet 1 second delay
-    int rounds = AsyncTask::runAndWaitForFuture([&kdf]() { return kdf->benchmark(1000); });
-
-    m_uiEncryption->transformRoundsSpinBox->setValue(rounds);
+    KdfCalibrator calibrator(kdf);
+    KdfCalibrator::Result result =
+        AsyncTask::runAndWaitForFuture([&calibrator]() { return calibrator.calibrate(1000); });
+
+    if (result.isValid()) {
+        m_uiEncryption->transformRoundsSpinBox->setValue(result.rounds);
+        m_uiEncryption->transformRoundsSpinBox->setToolTip(
+            tr("Expected time on this computer: %1 ms (± %2 ms)")
+                .arg(qRound(result.expectedMsec))
+                .arg(qRound(result.errorMsec)));
+    }
     m_uiEncryption->transformBenchmarkButton->setEnabled(true);
     QApplication::restoreOverrideCursor();
 }
@@ -43,6 +43,7 @@
 DatabaseManagerStruct::DatabaseManagerStruct()
     : dbWidget(nullptr)
     , modified(false)
+    , modifiedDuringSave(false)
     , readOnly(false)
     , saveAttempts(0)
 {
@@ -175,6 +176,45 @@ void DatabaseTabWidget::openDatabase(const QString& fileName, const QString& pw,
     emit messageDismissTab();
 }
 
+/**
+ * Unlock several databases with the same key, e.g. vaults sharing a key file.
+ * Databases that are not open yet get a tab of their own. All of them are
+ * read at the same time, as far as the memory budget of their key derivations
+ * allows, and each one reports databaseUnlockFinished().
+ *
+ * @param fileNames database files
+ * @param pw password, a null string if the key has no password
+ * @param keyFile key file, empty if the key has none
+ */
+void DatabaseTabWidget::unlockDatabases(const QStringList& fileNames, const QString& pw, const QString& keyFile)
+{
+    Q_ASSERT(!pw.isNull() || !keyFile.isEmpty());
+
+    for (const QString& fileName : fileNames) {
+        QFileInfo fileInfo(fileName);
+        DatabaseWidget* dbWidget = nullptr;
+        QHashIterator<Database*, DatabaseManagerStruct> i(m_dbList);
+        while (i.hasNext() && !dbWidget) {
+            i.next();
+            if (i.value().fileInfo.canonicalFilePath() == fileInfo.canonicalFilePath()) {
+                dbWidget = i.value().dbWidget;
+            }
+        }
+
+        if (dbWidget && dbWidget->dbHasKey()) {
+            emit databaseUnlockFinished(fileInfo.absoluteFilePath(), true);
+            continue;
+        }
+
+        // starts reading the file with the key, a file that can't be opened gets no tab
+        const int count = m_dbList.size();
+        openDatabase(fileName, pw, keyFile);
+        if (!dbWidget && m_dbList.size() == count) {
+            emit databaseUnlockFinished(fileInfo.absoluteFilePath(), false);
+        }
+    }
+}
+
 void DatabaseTabWidget::importCsv()
 {
     QString filter = QString("%1 (*.csv);;%2 (*)").arg(tr("CSV file"), tr("All files"));
@@ -230,6 +270,9 @@ bool DatabaseTabWidget::closeDatabase(Database* db)
 {
     Q_ASSERT(db);
 
+    // a failed background save marks the database as modified again
+    db->finishAsyncSave();
+
     const DatabaseManagerStruct& dbStruct = m_dbList.value(db);
     int index = databaseIndex(db);
     Q_ASSERT(index != -1);
@@ -324,39 +367,19 @@ bool DatabaseTabWidget::saveDatabase(Database* db, QString filePath)
         }
 
         dbStruct.dbWidget->blockAutoReload(true);
-        // TODO: Make this async, but lock out the database widget to prevent re-entrance
         bool useAtomicSaves = config()->get("UseAtomicSaves", true).toBool();
         QString errorMessage = db->saveToFile(filePath, useAtomicSaves, config()->get("BackupBeforeSave").toBool());
         dbStruct.dbWidget->blockAutoReload(false);
 
         if (errorMessage.isEmpty()) {
-            // successfully saved database file
-            dbStruct.modified = false;
-            dbStruct.saveAttempts = 0;
-            dbStruct.fileInfo = QFileInfo(filePath);
-            dbStruct.dbWidget->databaseSaved();
-            updateTabName(db);
-            emit messageDismissTab();
+            databaseSaved(db, filePath);
             return true;
         } else {
             dbStruct.modified = true;
             updateTabName(db);
 
-            if (++dbStruct.saveAttempts > 2 && useAtomicSaves) {
-                // Saving failed 3 times, issue a warning and attempt to resolve
-                auto choice = MessageBox::question(this,
-                                                   tr("Disable safe saves?"),
-                                                   tr("KeePassXC has failed to save the database multiple times. "
-                                                      "This is likely caused by file sync services holding a lock on "
-                                                      "the save file.\nDisable safe saves and try again?"),
-                                                   QMessageBox::Yes | QMessageBox::No,
-                                                   QMessageBox::Yes);
-                if (choice == QMessageBox::Yes) {
-                    config()->set("UseAtomicSaves", false);
-                    return saveDatabase(db, filePath);
-                }
-                // Reset save attempts without changing anything
-                dbStruct.saveAttempts = 0;
+            if (askDisableAtomicSaves(db)) {
+                return saveDatabase(db, filePath);
             }
 
             emit messageTab(tr("Writing the database failed.").append("\n").append(errorMessage), MessageWidget::Error);
@@ -367,6 +390,113 @@ bool DatabaseTabWidget::saveDatabase(Database* db, QString filePath)
     }
 }
 
+/**
+ * Save the database in the background. The result is handled by databaseSaveFinished().
+ * Read-only databases fall back to the blocking "save as" flow.
+ */
+void DatabaseTabWidget::saveDatabaseAsync(Database* db)
+{
+    DatabaseManagerStruct& dbStruct = m_dbList[db];
+
+    // Never allow saving a locked database; it causes corruption
+    Q_ASSERT(dbStruct.dbWidget->currentMode() != DatabaseWidget::LockedMode);
+    if (dbStruct.dbWidget->currentMode() == DatabaseWidget::LockedMode) {
+        return;
+    }
+
+    if (dbStruct.readOnly) {
+        saveDatabaseAs(db);
+        return;
+    }
+
+    // edits made up to now are part of the snapshot
+    dbStruct.modifiedDuringSave = false;
+    dbStruct.dbWidget->blockAutoReload(true);
+    db->saveToFileAsync(dbStruct.fileInfo.canonicalFilePath(),
+                        config()->get("UseAtomicSaves", true).toBool(),
+                        config()->get("BackupBeforeSave").toBool());
+}
+
+void DatabaseTabWidget::databaseSaveFinished(const QString& filePath, const QString& errorMessage)
+{
+    Q_ASSERT(qobject_cast<Database*>(sender()));
+
+    Database* db = static_cast<Database*>(sender());
+    if (!m_dbList.contains(db)) {
+        return;
+    }
+
+    DatabaseManagerStruct& dbStruct = m_dbList[db];
+    if (db->isSaving()) {
+        // changes made during this save are written by the queued one
+        return;
+    }
+    dbStruct.dbWidget->blockAutoReload(false);
+
+    if (errorMessage.isEmpty()) {
+        if (!dbStruct.modifiedDuringSave) {
+            databaseSaved(db, filePath);
+        } else {
+            dbStruct.saveAttempts = 0;
+            dbStruct.fileInfo = QFileInfo(filePath);
+            updateTabName(db);
+        }
+        return;
+    }
+
+    dbStruct.modified = true;
+    dbStruct.dbWidget->databaseModified();
+    updateTabName(db);
+
+    if (askDisableAtomicSaves(db)) {
+        saveDatabaseAsync(db);
+        return;
+    }
+
+    emit messageTab(tr("Writing the database failed.").append("\n").append(errorMessage), MessageWidget::Error);
+}
+
+void DatabaseTabWidget::databaseSaved(Database* db, const QString& filePath)
+{
+    DatabaseManagerStruct& dbStruct = m_dbList[db];
+    dbStruct.modified = false;
+    dbStruct.saveAttempts = 0;
+    dbStruct.fileInfo = QFileInfo(filePath);
+    dbStruct.dbWidget->databaseSaved();
+    updateTabName(db);
+    emit messageDismissTab();
+}
+
+/**
+ * Count a failed save and, after three failures with atomic saves enabled,
+ * offer to disable them.
+ *
+ * @return true if atomic saves were disabled and the save should be retried
+ */
+bool DatabaseTabWidget::askDisableAtomicSaves(Database* db)
+{
+    DatabaseManagerStruct& dbStruct = m_dbList[db];
+    if (++dbStruct.saveAttempts <= 2 || !config()->get("UseAtomicSaves", true).toBool()) {
+        return false;
+    }
+
+    // Saving failed 3 times, issue a warning and attempt to resolve
+    auto choice = MessageBox::question(this,
+                                       tr("Disable safe saves?"),
+                                       tr("KeePassXC has failed to save the database multiple times. "
+                                          "This is likely caused by file sync services holding a lock on "
+                                          "the save file.\nDisable safe saves and try again?"),
+                                       QMessageBox::Yes | QMessageBox::No,
+                                       QMessageBox::Yes);
+    if (choice == QMessageBox::Yes) {
+        config()->set("UseAtomicSaves", false);
+        return true;
+    }
+    // Reset save attempts without changing anything
+    dbStruct.saveAttempts = 0;
+    return false;
+}
+
 bool DatabaseTabWidget::saveDatabaseAs(Database* db)
 {
     while (true) {
@@ -433,6 +563,15 @@ bool DatabaseTabWidget::saveDatabase(int index)
     return saveDatabase(indexDatabase(index));
 }
 
+void DatabaseTabWidget::saveDatabaseAsync(int index)
+{
+    if (index == -1) {
+        index = currentIndex();
+    }
+
+    saveDatabaseAsync(indexDatabase(index));
+}
+
 bool DatabaseTabWidget::saveDatabaseAs(int index)
 {
     if (index == -1) {
@@ -654,6 +793,7 @@ void DatabaseTabWidget::insertDatabase(Database* db, const DatabaseManagerStruct
     connect(dbStruct.dbWidget, SIGNAL(databaseChanged(Database*, bool)), SLOT(changeDatabase(Database*, bool)));
     connect(dbStruct.dbWidget, SIGNAL(unlockedDatabase()), SLOT(updateTabNameFromDbWidgetSender()));
     connect(dbStruct.dbWidget, SIGNAL(unlockedDatabase()), SLOT(emitDatabaseUnlockedFromDbWidgetSender()));
+    connect(dbStruct.dbWidget, SIGNAL(unlockFailed()), SLOT(emitDatabaseUnlockFailedFromDbWidgetSender()));
 }
 
 DatabaseWidget* DatabaseTabWidget::currentDatabaseWidget()
@@ -709,6 +849,8 @@ void DatabaseTabWidget::lockDatabases()
             }
         }
 
+        // collect a running background save first, its failure is asked about below
+        db->finishAsyncSave();
         if (m_dbList[db].modified) {
             QMessageBox::StandardButton result =
                 MessageBox::question(this,
@@ -752,6 +894,10 @@ void DatabaseTabWidget::relockPendingDatabase()
         return;
     }
 
+    Database* db = databaseFromDatabaseWidget(m_dbPendingLock);
+    if (db) {
+        db->finishAsyncSave();
+    }
     m_dbPendingLock->lock();
 
     emit databaseLocked(m_dbPendingLock);
@@ -766,10 +912,14 @@ void DatabaseTabWidget::modified()
     DatabaseManagerStruct& dbStruct = m_dbList[db];
 
     if (config()->get("AutoSaveAfterEveryChange").toBool() && !dbStruct.readOnly) {
-        saveDatabase(db);
+        saveDatabaseAsync(db);
         return;
     }
 
+    if (db->isSaving()) {
+        dbStruct.modifiedDuringSave = true;
+    }
+
     if (!dbStruct.modified) {
         dbStruct.modified = true;
         dbStruct.dbWidget->databaseModified();
@@ -816,7 +966,15 @@ void DatabaseTabWidget::emitActivateDatabaseChanged()
 
 void DatabaseTabWidget::emitDatabaseUnlockedFromDbWidgetSender()
 {
-    emit databaseUnlocked(static_cast<DatabaseWidget*>(sender()));
+    auto dbWidget = static_cast<DatabaseWidget*>(sender());
+    emit databaseUnlocked(dbWidget);
+    emit databaseUnlockFinished(m_dbList.value(databaseFromDatabaseWidget(dbWidget)).fileInfo.absoluteFilePath(), true);
+}
+
+void DatabaseTabWidget::emitDatabaseUnlockFailedFromDbWidgetSender()
+{
+    auto dbWidget = static_cast<DatabaseWidget*>(sender());
+    emit databaseUnlockFinished(m_dbList.value(databaseFromDatabaseWidget(dbWidget)).fileInfo.absoluteFilePath(), false);
 }
 
 void DatabaseTabWidget::connectDatabase(Database* newDb, Database* oldDb)
@@ -827,6 +985,7 @@ void DatabaseTabWidget::connectDatabase(Database* newDb, Database* oldDb)
 
     connect(newDb, SIGNAL(nameTextChanged()), SLOT(updateTabNameFromDbSender()));
     connect(newDb, SIGNAL(modified()), SLOT(modified()));
+    connect(newDb, SIGNAL(saveFinished(QString, QString)), SLOT(databaseSaveFinished(QString, QString)));
     newDb->setEmitModified(true);
 }
 
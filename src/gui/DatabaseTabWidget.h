@@ -39,6 +39,7 @@ struct DatabaseManagerStruct
     DatabaseWidget* dbWidget;
     QFileInfo fileInfo;
     bool modified;
+    bool modifiedDuringSave;
     bool readOnly;
     int saveAttempts;
 };
@@ -53,6 +54,7 @@ public:
     explicit DatabaseTabWidget(QWidget* parent = nullptr);
     ~DatabaseTabWidget() override;
     void openDatabase(const QString& fileName, const QString& pw = QString(), const QString& keyFile = QString());
+    void unlockDatabases(const QStringList& fileNames, const QString& pw, const QString& keyFile);
     void mergeDatabase(const QString& fileName);
     DatabaseWidget* currentDatabaseWidget();
     bool hasLockableDatabases() const;
@@ -66,6 +68,7 @@ public slots:
     void mergeDatabase();
     void importKeePass1Database();
     bool saveDatabase(int index = -1);
+    void saveDatabaseAsync(int index = -1);
     bool saveDatabaseAs(int index = -1);
     void exportToCsv();
     bool closeDatabase(int index = -1);
@@ -87,6 +90,7 @@ signals:
     void activateDatabaseChanged(DatabaseWidget* dbWidget);
     void databaseLocked(DatabaseWidget* dbWidget);
     void databaseUnlocked(DatabaseWidget* dbWidget);
+    void databaseUnlockFinished(const QString& filePath, bool success);
     void messageGlobal(const QString&, MessageWidget::MessageType type);
     void messageTab(const QString&, MessageWidget::MessageType type);
     void messageDismissGlobal();
@@ -101,9 +105,14 @@ private slots:
     void changeDatabase(Database* newDb, bool unsavedChanges);
     void emitActivateDatabaseChanged();
     void emitDatabaseUnlockedFromDbWidgetSender();
+    void emitDatabaseUnlockFailedFromDbWidgetSender();
+    void databaseSaveFinished(const QString& filePath, const QString& errorMessage);
 
 private:
     bool saveDatabase(Database* db, QString filePath = "");
+    void saveDatabaseAsync(Database* db);
+    void databaseSaved(Database* db, const QString& filePath);
+    bool askDisableAtomicSaves(Database* db);
     bool saveDatabaseAs(Database* db);
     bool closeDatabase(Database* db);
     void deleteDatabase(Database* db);
@@ -28,15 +28,18 @@
 #include <QKeyEvent>
 #include <QLabel>
 #include <QLineEdit>
+#include <QPointer>
 #include <QProcess>
 #include <QSplitter>
 
 #include "autotype/AutoType.h"
+#include "core/AsyncTask.h"
 #include "core/Config.h"
 #include "core/EntrySearcher.h"
 #include "core/FilePath.h"
 #include "core/Group.h"
 #include "core/Metadata.h"
+#include "core/QuickUnlock.h"
 #include "core/Tools.h"
 #include "format/KeePass2Reader.h"
 #include "gui/ChangeMasterKeyWidget.h"
@@ -198,10 +201,12 @@ DatabaseWidget::DatabaseWidget(Database* db, QWidget* parent)
     connect(m_changeMasterKeyWidget, SIGNAL(editFinished(bool)), SLOT(updateMasterKey(bool)));
     connect(m_databaseSettingsWidget, SIGNAL(editFinished(bool)), SLOT(switchToView(bool)));
     connect(m_databaseOpenWidget, SIGNAL(editFinished(bool)), SLOT(openDatabase(bool)));
+    connect(m_databaseOpenWidget, SIGNAL(unlockFailed()), SIGNAL(unlockFailed()));
     connect(m_databaseOpenMergeWidget, SIGNAL(editFinished(bool)), SLOT(mergeDatabase(bool)));
     connect(m_keepass1OpenWidget, SIGNAL(editFinished(bool)), SLOT(openDatabase(bool)));
     connect(m_csvImportWizard, SIGNAL(importFinished(bool)), SLOT(csvImportFinished(bool)));
     connect(m_unlockDatabaseWidget, SIGNAL(editFinished(bool)), SLOT(unlockDatabase(bool)));
+    connect(m_unlockDatabaseWidget, SIGNAL(unlockFailed()), SIGNAL(unlockFailed()));
     connect(m_unlockDatabaseDialog, SIGNAL(unlockDone(bool)), SLOT(unlockDatabase(bool)));
     connect(&m_fileWatcher, SIGNAL(fileChanged(QString)), this, SLOT(onWatchedFileChanged()));
     connect(&m_fileWatchTimer, SIGNAL(timeout()), this, SLOT(reloadDatabaseFile()));
@@ -238,6 +243,7 @@ DatabaseWidget::DatabaseWidget(Database* db, QWidget* parent)
 
 DatabaseWidget::~DatabaseWidget()
 {
+    quickUnlock()->clear(m_filePath);
 }
 
 DatabaseWidget::Mode DatabaseWidget::currentMode() const
@@ -826,14 +832,32 @@ void DatabaseWidget::updateMasterKey(bool accepted)
     }
 
     if (accepted) {
+        CompositeKey newKey = m_changeMasterKeyWidget->newMasterKey();
+        QSharedPointer<Kdf> kdf = m_db->kdf()->clone();
+        kdf->randomizeSeed();
+        QByteArray transformedKey;
+        QPointer<Database> db = m_db;
+
+        // the database is not thread-safe, so only the key transformation runs on the worker thread
+        m_changeMasterKeyWidget->setEnabled(false);
         QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-        bool result = m_db->setKey(m_changeMasterKeyWidget->newMasterKey(), true, true);
+        bool result = AsyncTask::runAndWaitForFuture([&newKey, &kdf, &transformedKey]() {
+            return newKey.transform(*kdf, transformedKey);
+        });
         QApplication::restoreOverrideCursor();
+        m_changeMasterKeyWidget->setEnabled(true);
 
+        if (!db || db != m_db) {
+            return;
+        }
         if (!result) {
             m_messageWidget->showMessage(tr("Unable to calculate master key"), MessageWidget::Error);
             return;
         }
+
+        m_db->setKdf(kdf);
+        m_db->setTransformedKey(newKey, transformedKey);
+        m_db->metadata()->setMasterKeyChanged(QDateTime::currentDateTimeUtc());
     } else if (!m_db->hasKey()) {
         emit closeRequest();
         return;
@@ -1200,6 +1224,9 @@ void DatabaseWidget::lock()
         m_entryBeforeLock = m_entryView->currentEntry()->uuid();
     }
 
+    // only the sealed transformed key survives the lock, the decrypted database is deleted below
+    quickUnlock()->seal(m_filePath, m_db);
+
     endSearch();
     clearAllWidgets();
     m_unlockDatabaseWidget->load(m_filePath);
@@ -1213,6 +1240,9 @@ void DatabaseWidget::updateFilePath(const QString& filePath)
 {
     if (!m_filePath.isEmpty()) {
         m_fileWatcher.removePath(m_filePath);
+        if (filePath != m_filePath) {
+            quickUnlock()->clear(m_filePath);
+        }
     }
 
     m_fileWatcher.addPath(filePath);
@@ -1275,6 +1305,9 @@ void DatabaseWidget::reloadDatabaseFile()
     }
 
     KeePass2Reader reader;
+    if (!database()->hasRawKey()) {
+        reader.setTransformedKey(database()->kdf()->seed(), database()->transformedMasterKey(), true);
+    }
     QFile file(m_filePath);
     if (file.open(QIODevice::ReadOnly)) {
         Database* db = reader.readDatabase(&file, database()->key());
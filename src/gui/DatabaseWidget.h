@@ -125,6 +125,7 @@ signals:
     void pressedEntry(Entry* selectedEntry);
     void pressedGroup(Group* selectedGroup);
     void unlockedDatabase();
+    void unlockFailed();
     void listModeAboutToActivate();
     void listModeActivated();
     void searchModeAboutToActivate();
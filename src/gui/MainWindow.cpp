@@ -28,6 +28,7 @@
 
 #include "autotype/AutoType.h"
 #include "core/Config.h"
+#include "core/DatabaseLoader.h"
 #include "core/FilePath.h"
 #include "core/InactivityTimer.h"
 #include "core/Metadata.h"
@@ -263,7 +264,7 @@ MainWindow::MainWindow()
 
     connect(m_ui->actionDatabaseNew, SIGNAL(triggered()), m_ui->tabWidget, SLOT(newDatabase()));
     connect(m_ui->actionDatabaseOpen, SIGNAL(triggered()), m_ui->tabWidget, SLOT(openDatabase()));
-    connect(m_ui->actionDatabaseSave, SIGNAL(triggered()), m_ui->tabWidget, SLOT(saveDatabase()));
+    connect(m_ui->actionDatabaseSave, SIGNAL(triggered()), m_ui->tabWidget, SLOT(saveDatabaseAsync()));
     connect(m_ui->actionDatabaseSaveAs, SIGNAL(triggered()), m_ui->tabWidget, SLOT(saveDatabaseAs()));
     connect(m_ui->actionDatabaseClose, SIGNAL(triggered()), m_ui->tabWidget, SLOT(closeDatabase()));
     connect(m_ui->actionDatabaseMerge, SIGNAL(triggered()), m_ui->tabWidget, SLOT(mergeDatabase()));
@@ -418,6 +419,11 @@ void MainWindow::openDatabase(const QString& fileName, const QString& pw, const
     m_ui->tabWidget->openDatabase(fileName, pw, keyFile);
 }
 
+void MainWindow::unlockDatabases(const QStringList& fileNames, const QString& pw, const QString& keyFile)
+{
+    m_ui->tabWidget->unlockDatabases(fileNames, pw, keyFile);
+}
+
 void MainWindow::setMenuActionState(DatabaseWidget::Mode mode)
 {
     int currentIndex = m_ui->stackedWidget->currentIndex();
@@ -841,6 +847,9 @@ void MainWindow::applySettingsChanges()
         m_inactivityTimer->deactivate();
     }
 
+    // memory in MiB the key derivations of concurrently unlocking databases may use
+    DatabaseLoader::setMemoryBudget(config()->get("security/kdfmemorybudget").toULongLong() * 1024 * 1024);
+
     m_ui->toolBar->setHidden(config()->get("GUI/HideToolbar").toBool());
 
     updateTrayIcon();
@@ -57,6 +57,7 @@ public:
 
 public slots:
     void openDatabase(const QString& fileName, const QString& pw = QString(), const QString& keyFile = QString());
+    void unlockDatabases(const QStringList& fileNames, const QString& pw, const QString& keyFile);
     void appExit();
     void displayGlobalMessage(const QString& text,
                               MessageWidget::MessageType type,
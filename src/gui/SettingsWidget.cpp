@@ -25,6 +25,7 @@
 #include "core/Config.h"
 #include "core/FilePath.h"
 #include "core/Global.h"
+#include "core/QuickUnlock.h"
 #include "core/Translator.h"
 
 class SettingsWidget::ExtraPage
@@ -168,6 +169,7 @@ void SettingsWidget::loadSettings()
     m_secUi->lockDatabaseMinimizeCheckBox->setChecked(config()->get("security/lockdatabaseminimize").toBool());
     m_secUi->lockDatabaseOnScreenLockCheckBox->setChecked(config()->get("security/lockdatabasescreenlock").toBool());
     m_secUi->relockDatabaseAutoTypeCheckBox->setChecked(config()->get("security/relockautotype").toBool());
+    m_secUi->quickUnlockCheckBox->setChecked(config()->get("security/quickunlock").toBool());
     m_secUi->fallbackToGoogle->setChecked(config()->get("security/IconDownloadFallbackToGoogle").toBool());
 
     m_secUi->passwordCleartextCheckBox->setChecked(config()->get("security/passwordscleartext").toBool());
@@ -234,6 +236,7 @@ void SettingsWidget::saveSettings()
     config()->set("security/lockdatabaseminimize", m_secUi->lockDatabaseMinimizeCheckBox->isChecked());
     config()->set("security/lockdatabasescreenlock", m_secUi->lockDatabaseOnScreenLockCheckBox->isChecked());
     config()->set("security/relockautotype", m_secUi->relockDatabaseAutoTypeCheckBox->isChecked());
+    config()->set("security/quickunlock", m_secUi->quickUnlockCheckBox->isChecked());
     config()->set("security/IconDownloadFallbackToGoogle", m_secUi->fallbackToGoogle->isChecked());
 
     config()->set("security/passwordscleartext", m_secUi->passwordCleartextCheckBox->isChecked());
@@ -251,6 +254,10 @@ void SettingsWidget::saveSettings()
         config()->set("LastDir", "");
     }
 
+    if (!config()->get("security/quickunlock").toBool()) {
+        quickUnlock()->clearAll();
+    }
+
     for (const ExtraPage& page : asConst(m_extraPages)) {
         page.saveSettings();
     }
@@ -18,13 +18,99 @@
 
 #include "CompositeKey.h"
 #include <QFile>
+#include <cstring>
 #include <QtConcurrent>
 #include <format/KeePass2.h>
 
 #include "core/Global.h"
+#include "core/Tools.h"
 #include "crypto/CryptoHash.h"
 #include "crypto/kdf/AesKdf.h"
 
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+    const int RawKeySize = 32;
+
+    QAtomicInt s_lockWarningShown;
+
+    /**
+     * Allocate memory for a raw key that is not swapped out or included in core dumps.
+     * The key gets a page of its own, so unlocking it never unlocks other data.
+     *
+     * @return key memory or nullptr if it couldn't be allocated
+     */
+    quint8* allocateKeyMemory()
+    {
+#ifdef Q_OS_UNIX
+        void* memory = mmap(nullptr, RawKeySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            return nullptr;
+        }
+        // the key is still usable, only warn about the first failure instead of every key
+        if (mlock(memory, RawKeySize) != 0 && s_lockWarningShown.testAndSetRelaxed(0, 1)) {
+            qWarning("Failed to lock key memory, keys may be swapped to disk");
+        }
+#ifdef MADV_DONTDUMP
+        madvise(memory, RawKeySize, MADV_DONTDUMP);
+#endif
+        return static_cast<quint8*>(memory);
+#else
+        return new quint8[RawKeySize];
+#endif
+    }
+
+    void freeKeyMemory(quint8* memory)
+    {
+        volatile quint8* bytes = memory;
+        for (int i = 0; i < RawKeySize; ++i) {
+            bytes[i] = 0;
+        }
+#ifdef Q_OS_UNIX
+        munlock(memory, RawKeySize);
+        munmap(memory, RawKeySize);
+#else
+        delete[] memory;
+#endif
+    }
+} // namespace
+
+/**
+ * Locked memory holding the raw key hash.
+ * Copies of a composite key share it until one of them adds a key.
+ */
+class CompositeKey::RawKeyData : public QSharedData
+{
+public:
+    RawKeyData()
+        : memory(allocateKeyMemory())
+    {
+    }
+
+    RawKeyData(const RawKeyData& other)
+        : QSharedData(other)
+        , memory(allocateKeyMemory())
+    {
+        if (memory && other.memory) {
+            memcpy(memory, other.memory, RawKeySize);
+        }
+    }
+
+    ~RawKeyData()
+    {
+        if (memory) {
+            freeKeyMemory(memory);
+        }
+    }
+
+    RawKeyData& operator=(const RawKeyData&) = delete;
+
+    quint8* const memory;
+};
+
 CompositeKey::CompositeKey()
 {
 }
@@ -44,6 +130,7 @@ void CompositeKey::clear()
     qDeleteAll(m_keys);
     m_keys.clear();
     m_challengeResponseKeys.clear();
+    releaseRawKey();
 }
 
 bool CompositeKey::isEmpty() const
@@ -66,11 +153,13 @@ CompositeKey& CompositeKey::operator=(const CompositeKey& key)
     clear();
 
     for (const Key* subKey : asConst(key.m_keys)) {
-        addKey(*subKey);
+        m_keys.append(subKey->clone());
     }
     for (const auto subKey : asConst(key.m_challengeResponseKeys)) {
         addChallengeResponseKey(subKey);
     }
+    // share the hash instead of hashing all keys again
+    m_rawKey = key.m_rawKey;
 
     return *this;
 }
@@ -87,7 +176,10 @@ CompositeKey& CompositeKey::operator=(const CompositeKey& key)
  */
 QByteArray CompositeKey::rawKey() const
 {
-    return rawKey(nullptr, nullptr);
+    if (m_rawKey) {
+        return QByteArray(reinterpret_cast<const char*>(m_rawKey->memory), RawKeySize);
+    }
+    return hashKeys();
 }
 
 /**
@@ -102,28 +194,85 @@ QByteArray CompositeKey::rawKey() const
  */
 QByteArray CompositeKey::rawKey(const QByteArray* transformSeed, bool* ok) const
 {
+    if (!transformSeed) {
+        if (ok) {
+            *ok = true;
+        }
+        return rawKey();
+    }
+
     CryptoHash cryptoHash(CryptoHash::Sha256);
 
     for (const Key* key : m_keys) {
         cryptoHash.addData(key->rawKey());
     }
 
+    QByteArray challengeResult;
+    bool challengeOk = challenge(*transformSeed, challengeResult);
     if (ok) {
-        *ok = true;
+        *ok = challengeOk;
     }
+    cryptoHash.addData(challengeResult);
 
-    if (transformSeed) {
-        QByteArray challengeResult;
-        bool challengeOk = challenge(*transformSeed, challengeResult);
-        if (ok) {
-            *ok = challengeOk;
-        }
-        cryptoHash.addData(challengeResult);
-    }
+    return cryptoHash.result();
+}
+
+bool CompositeKey::hasChallengeResponseKeys() const
+{
+    return !m_challengeResponseKeys.isEmpty();
+}
+
+/**
+ * Compare the raw keys of two composite keys in constant time.
+ * Challenge-response components are not compared.
+ *
+ * @return true if both keys have the same raw key
+ */
+bool CompositeKey::matches(const CompositeKey& other) const
+{
+    return Tools::constantTimeEquals(rawKey(), other.rawKey());
+}
 
+/**
+ * @return hash of the static key components
+ */
+QByteArray CompositeKey::hashKeys() const
+{
+    CryptoHash cryptoHash(CryptoHash::Sha256);
+    for (const Key* key : m_keys) {
+        cryptoHash.addData(key->rawKey());
+    }
     return cryptoHash.result();
 }
 
+/**
+ * Hash the static key components once, so rawKey() doesn't have to hash them on every call.
+ * Without key memory rawKey() falls back to hashing them each time.
+ */
+void CompositeKey::updateRawKey()
+{
+    if (!m_rawKey) {
+        m_rawKey = new RawKeyData();
+    }
+
+    // writing detaches the memory from copies of this key
+    quint8* memory = m_rawKey->memory;
+    if (!memory) {
+        releaseRawKey();
+        return;
+    }
+
+    QByteArray hash = hashKeys();
+    Q_ASSERT(hash.size() == RawKeySize);
+    memcpy(memory, hash.constData(), RawKeySize);
+    hash.fill('\0');
+}
+
+void CompositeKey::releaseRawKey()
+{
+    m_rawKey = nullptr;
+}
+
 /**
  * Transform this composite key.
  *
@@ -177,6 +326,7 @@ bool CompositeKey::challenge(const QByteArray& seed, QByteArray& result) const
 void CompositeKey::addKey(const Key& key)
 {
     m_keys.append(key.clone());
+    updateRawKey();
 }
 
 void CompositeKey::addChallengeResponseKey(QSharedPointer<ChallengeResponseKey> key)
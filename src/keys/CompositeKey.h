@@ -20,6 +20,7 @@
 #define KEEPASSX_COMPOSITEKEY_H
 
 #include <QList>
+#include <QSharedDataPointer>
 #include <QSharedPointer>
 #include <QString>
 
@@ -42,13 +43,22 @@ public:
     QByteArray rawKey(const QByteArray* transformSeed, bool* ok = nullptr) const;
     bool transform(const Kdf& kdf, QByteArray& result) const Q_REQUIRED_RESULT;
     bool challenge(const QByteArray& seed, QByteArray& result) const;
+    bool hasChallengeResponseKeys() const;
+    bool matches(const CompositeKey& other) const;
 
     void addKey(const Key& key);
     void addChallengeResponseKey(QSharedPointer<ChallengeResponseKey> key);
 
 private:
+    class RawKeyData;
+
+    QByteArray hashKeys() const;
+    void updateRawKey();
+    void releaseRawKey();
+
     QList<Key*> m_keys;
     QList<QSharedPointer<ChallengeResponseKey>> m_challengeResponseKeys;
+    QSharedDataPointer<RawKeyData> m_rawKey;
 };
 
 #endif // KEEPASSX_COMPOSITEKEY_H
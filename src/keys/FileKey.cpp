@@ -19,11 +19,65 @@
 #include "FileKey.h"
 
 #include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 
 #include "core/Tools.h"
 #include "crypto/CryptoHash.h"
 #include "crypto/Random.h"
 
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+    // files smaller than this are hashed quickly enough to not keep their hash around
+    const qint64 MinCachedFileSize = 1024 * 1024;
+    const int HashChunkSize = 1024 * 1024;
+    const int XmlPrefixSize = 1024;
+
+    /**
+     * Identifies a version of a key file without reading it.
+     */
+    struct FileStamp
+    {
+        qint64 size = -1;
+        qint64 modified = 0;
+        quint64 inode = 0;
+
+        bool operator==(const FileStamp& other) const
+        {
+            return size == other.size && modified == other.modified && inode == other.inode;
+        }
+    };
+
+    struct CachedKey
+    {
+        FileStamp stamp;
+        QByteArray key;
+    };
+
+    QMutex s_cacheMutex;
+    QHash<QString, CachedKey> s_cache;
+
+    FileStamp fileStamp(const QFileInfo& info)
+    {
+        FileStamp stamp;
+        stamp.size = info.size();
+        stamp.modified = info.lastModified().toMSecsSinceEpoch();
+#ifdef Q_OS_UNIX
+        struct stat st;
+        if (::stat(QFile::encodeName(info.absoluteFilePath()).constData(), &st) == 0) {
+            stamp.inode = static_cast<quint64>(st.st_ino);
+        }
+#endif
+        return stamp;
+    }
+} // namespace
+
 /**
  * Read key file from device while trying to detect its file format.
  *
@@ -60,7 +114,7 @@ bool FileKey::load(QIODevice* device)
     if (!device->reset()) {
         return false;
     }
-    if (loadXml(device)) {
+    if (isXmlPrefix(device) && loadXml(device)) {
         m_type = KeePass2XML;
         return true;
     }
@@ -122,6 +176,21 @@ bool FileKey::load(const QString& fileName, QString* errorMsg)
         }
         return false;
     }
+
+    // large hashed key files are only read once per session as long as they are unchanged
+    const QFileInfo info(file);
+    const QString cachePath = info.canonicalFilePath();
+    const FileStamp stamp = fileStamp(info);
+    if (stamp.size >= MinCachedFileSize) {
+        QMutexLocker locker(&s_cacheMutex);
+        auto it = s_cache.constFind(cachePath);
+        if (it != s_cache.constEnd() && it->stamp == stamp) {
+            m_key = it->key;
+            m_type = Hashed;
+            return true;
+        }
+    }
+
     bool result = load(&file);
 
     file.close();
@@ -133,9 +202,23 @@ bool FileKey::load(const QString& fileName, QString* errorMsg)
         }
     }
 
+    if (result && m_type == Hashed && stamp.size >= MinCachedFileSize && !cachePath.isEmpty()) {
+        QMutexLocker locker(&s_cacheMutex);
+        s_cache.insert(cachePath, {stamp, m_key});
+    }
+
     return result;
 }
 
+/**
+ * Forget the hashes of all key files loaded so far.
+ */
+void FileKey::clearCache()
+{
+    QMutexLocker locker(&s_cacheMutex);
+    s_cache.clear();
+}
+
 /**
  * @return key data as bytes
  */
@@ -194,6 +277,23 @@ bool FileKey::create(const QString& fileName, QString* errorMsg, int size)
     return true;
 }
 
+/**
+ * Check whether the device starts like an XML document, so large binary
+ * key files don't have to go through the XML parser.
+ *
+ * @param device input device positioned at the start of the key file
+ * @return true if the key file may be a KeePass 2 XML key file
+ */
+bool FileKey::isXmlPrefix(QIODevice* device)
+{
+    const QByteArray prefix = device->peek(XmlPrefixSize);
+    int i = prefix.startsWith("\xEF\xBB\xBF") ? 3 : 0;
+    while (i < prefix.size() && (prefix[i] == ' ' || prefix[i] == '\t' || prefix[i] == '\r' || prefix[i] == '\n')) {
+        ++i;
+    }
+    return i < prefix.size() && prefix[i] == '<';
+}
+
 /**
  * Load key file in legacy KeePass 2 XML format.
  *
@@ -341,13 +441,26 @@ bool FileKey::loadHashed(QIODevice* device)
 {
     CryptoHash cryptoHash(CryptoHash::Sha256);
 
-    QByteArray buffer;
-    do {
-        if (!Tools::readFromDevice(device, buffer)) {
+    // hash files in place if they can be mapped, otherwise read them in fixed-size chunks
+    auto* file = qobject_cast<QFileDevice*>(device);
+    const qint64 size = device->size();
+    uchar* data = file && size > 0 ? file->map(0, size) : nullptr;
+    if (data) {
+        for (qint64 offset = 0; offset < size; offset += HashChunkSize) {
+            int length = static_cast<int>(qMin<qint64>(HashChunkSize, size - offset));
+            cryptoHash.addData(QByteArray::fromRawData(reinterpret_cast<const char*>(data + offset), length));
+        }
+        file->unmap(data);
+    } else {
+        QByteArray buffer(HashChunkSize, '\0');
+        qint64 readResult;
+        while ((readResult = device->read(buffer.data(), buffer.size())) > 0) {
+            cryptoHash.addData(QByteArray::fromRawData(buffer.constData(), static_cast<int>(readResult)));
+        }
+        if (readResult < 0) {
             return false;
         }
-        cryptoHash.addData(buffer);
-    } while (!buffer.isEmpty());
+    }
 
     m_key = cryptoHash.result();
 
@@ -44,8 +44,10 @@ public:
     Type type() const;
     static void create(QIODevice* device, int size = 128);
     static bool create(const QString& fileName, QString* errorMsg = nullptr, int size = 128);
+    static void clearCache();
 
 private:
+    static bool isXmlPrefix(QIODevice* device);
     bool loadXml(QIODevice* device);
     bool loadXmlMeta(QXmlStreamReader& xmlReader);
     QByteArray loadXmlKey(QXmlStreamReader& xmlReader);
@@ -171,19 +171,31 @@ int main(int argc, char** argv)
     }
 
     const bool pwstdin = parser.isSet(pwstdinOption);
-    for (const QString& filename : fileNames) {
-        QString password;
-        if (pwstdin) {
-            // we always need consume a line of STDIN if --pw-stdin is set to clear out the
-            // buffer for native messaging, even if the specified file does not exist
-            static QTextStream in(stdin, QIODevice::ReadOnly);
-            static QTextStream out(stdout, QIODevice::WriteOnly);
-            out << QCoreApplication::translate("Main", "Database password: ") << flush;
-            password = Utils::getPassword();
+    const QString keyFile = parser.value(keyfileOption);
+    if (!pwstdin && !keyFile.isEmpty()) {
+        // databases sharing a key file are unlocked all at once
+        QStringList batch;
+        for (const QString& filename : fileNames) {
+            if (!filename.isEmpty() && QFile::exists(filename) && !filename.endsWith(".json", Qt::CaseInsensitive)) {
+                batch.append(filename);
+            }
         }
+        mainWindow.unlockDatabases(batch, QString(), keyFile);
+    } else {
+        for (const QString& filename : fileNames) {
+            QString password;
+            if (pwstdin) {
+                // we always need consume a line of STDIN if --pw-stdin is set to clear out the
+                // buffer for native messaging, even if the specified file does not exist
+                static QTextStream in(stdin, QIODevice::ReadOnly);
+                static QTextStream out(stdout, QIODevice::WriteOnly);
+                out << QCoreApplication::translate("Main", "Database password: ") << flush;
+                password = Utils::getPassword();
+            }
 
-        if (!filename.isEmpty() && QFile::exists(filename) && !filename.endsWith(".json", Qt::CaseInsensitive)) {
-            mainWindow.openDatabase(filename, password, parser.value(keyfileOption));
+            if (!filename.isEmpty() && QFile::exists(filename) && !filename.endsWith(".json", Qt::CaseInsensitive)) {
+                mainWindow.openDatabase(filename, password, keyFile);
+            }
         }
     }
 
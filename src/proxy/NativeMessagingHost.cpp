@@ -16,13 +16,16 @@
 */
 
 #include "NativeMessagingHost.h"
+#include "ProxyRelay.h"
 #include <QCoreApplication>
 
 #ifdef Q_OS_WIN
 #include <Winsock2.h>
 #endif
 
-NativeMessagingHost::NativeMessagingHost() : NativeMessagingBase(true)
+NativeMessagingHost::NativeMessagingHost()
+    : NativeMessagingBase(true)
+    , m_splitter(NATIVE_MSG_MAX_LENGTH)
 {
     m_localSocket = new QLocalSocket();
     m_localSocket->connectToServer(getLocalServerPath());
@@ -53,51 +56,60 @@ NativeMessagingHost::~NativeMessagingHost()
 #endif
 }
 
-void NativeMessagingHost::readLength()
+/**
+ * Forward all messages with the zero-copy relay when stdin, stdout and the
+ * socket allow it.
+ *
+ * @return false if the relay can't be used and the event loop has to run instead
+ */
+bool NativeMessagingHost::runRelay()
 {
-    quint32 length = 0;
-    std::cin.read(reinterpret_cast<char*>(&length), 4);
-    if (!std::cin.eof() && length > 0) {
-        readStdIn(length);
-    } else {
-        QCoreApplication::quit();
+    if (!ProxyRelay::isSupported(fileno(stdin), fileno(stdout)) || !m_localSocket
+        || !m_localSocket->waitForConnected(1000)) {
+        return false;
     }
-}
 
-void NativeMessagingHost::readStdIn(const quint32 length)
-{
-    if (length <= 0) {
-        return;
+    if (m_notifier) {
+        m_notifier->setEnabled(false);
     }
 
-    QByteArray arr;
-    arr.reserve(length);
-
-    for (quint32 i = 0; i < length; ++i) {
-        int c = std::getchar();
-        if (c == EOF) {
-            // message ended prematurely, ignore it and return
-            return;
-        }
-        arr.append(static_cast<char>(c));
-    }
+    const int socketDesc = static_cast<int>(m_localSocket->socketDescriptor());
+    ProxyRelay relay(fileno(stdin), fileno(stdout), socketDesc, NATIVE_MSG_MAX_LENGTH);
+    relay.run();
+    return true;
+}
 
-    if (arr.length() > 0 && m_localSocket && m_localSocket->state() == QLocalSocket::ConnectedState) {
-        m_localSocket->write(arr.constData(), arr.length());
+void NativeMessagingHost::handleNativeMessage(const QByteArray& message)
+{
+    if (m_localSocket && m_localSocket->state() == QLocalSocket::ConnectedState) {
+        m_localSocket->write(message);
         m_localSocket->flush();
     }
 }
 
+void NativeMessagingHost::nativeMessagesEnded()
+{
+    QCoreApplication::quit();
+}
+
 void NativeMessagingHost::newLocalMessage()
 {
     if (!m_localSocket || m_localSocket->bytesAvailable() <= 0) {
         return;
     }
 
-    QByteArray arr = m_localSocket->readAll();
-    if (!arr.isEmpty()) {
+    // a single read may hold several replies or only a part of one, each is sent in its own frame
+    m_splitter.append(m_localSocket->readAll());
+    QByteArray arr;
+    while (m_splitter.takeMessage(arr)) {
         sendReply(arr);
     }
+
+    if (m_splitter.hasError()) {
+        qWarning("Invalid message from KeePassXC, closing the connection");
+        m_splitter.clear();
+        m_localSocket->abort();
+    }
 }
 
 void NativeMessagingHost::deleteSocket()
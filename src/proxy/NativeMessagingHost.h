@@ -18,6 +18,7 @@
 #ifndef NATIVEMESSAGINGHOST_H
 #define NATIVEMESSAGINGHOST_H
 
+#include "LocalMessageSplitter.h"
 #include "NativeMessagingBase.h"
 
 class NativeMessagingHost : public NativeMessagingBase
@@ -27,17 +28,20 @@ public:
     NativeMessagingHost();
     ~NativeMessagingHost();
 
+    bool runRelay();
+
 public slots:
     void newLocalMessage();
     void deleteSocket();
     void socketStateChanged(QLocalSocket::LocalSocketState socketState);
 
 private:
-    void readLength();
-    void readStdIn(const quint32 length);
+    void handleNativeMessage(const QByteArray& message) override;
+    void nativeMessagesEnded() override;
 
 private:
     QLocalSocket* m_localSocket;
+    LocalMessageSplitter m_splitter;
 };
 
 #endif // NATIVEMESSAGINGHOST_H
@@ -0,0 +1,196 @@
+/*
+*  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ProxyRelay.h"
+#include "NativeMessageFramer.h"
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const int HeaderSize = 4;
+    const int ReadSize = 64 * 1024;
+} // namespace
+
+ProxyRelay::ProxyRelay(int inFd, int outFd, int socketFd, quint32 maxLength)
+    : m_inFd(inFd)
+    , m_outFd(outFd)
+    , m_socketFd(socketFd)
+    , m_maxLength(maxLength)
+    , m_splitter(static_cast<int>(maxLength))
+{
+}
+
+/**
+ * splice(2) needs a pipe on one end of every transfer, which is what browsers
+ * connect to stdin and stdout of a native messaging host.
+ */
+bool ProxyRelay::isSupported(int inFd, int outFd)
+{
+#ifdef Q_OS_LINUX
+    struct stat inStat;
+    struct stat outStat;
+    return fstat(inFd, &inStat) == 0 && S_ISFIFO(inStat.st_mode) && fstat(outFd, &outStat) == 0
+           && S_ISFIFO(outStat.st_mode);
+#else
+    Q_UNUSED(inFd);
+    Q_UNUSED(outFd);
+    return false;
+#endif
+}
+
+/**
+ * Relay messages until either side closes the connection or a signal arrives.
+ *
+ * @return false if relaying failed
+ */
+bool ProxyRelay::run()
+{
+#ifdef Q_OS_LINUX
+    // the relay owns the socket from now on, blocking transfers keep the loop simple
+    const int flags = fcntl(m_socketFd, F_GETFL);
+    if (flags < 0 || fcntl(m_socketFd, F_SETFL, flags & ~O_NONBLOCK) < 0) {
+        return false;
+    }
+
+    struct pollfd fds[2];
+    fds[0].fd = m_inFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_socketFd;
+    fds[1].events = POLLIN;
+
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            // quit signals interrupt the wait
+            return errno == EINTR;
+        }
+
+        Result result = Relayed;
+        if (fds[0].revents & (POLLIN | POLLHUP)) {
+            result = relayFromBrowser();
+        }
+        if (result == Relayed && fds[1].revents & (POLLIN | POLLHUP)) {
+            result = relayToBrowser();
+        }
+        if (result != Relayed) {
+            return result == Closed;
+        }
+        if ((fds[0].revents | fds[1].revents) & (POLLERR | POLLNVAL)) {
+            return false;
+        }
+    }
+#else
+    return false;
+#endif
+}
+
+/**
+ * Forward one message from stdin to KeePassXC, which expects the bare message.
+ */
+ProxyRelay::Result ProxyRelay::relayFromBrowser()
+{
+#ifdef Q_OS_LINUX
+    char header[HeaderSize];
+    int headerRead = 0;
+    while (headerRead < HeaderSize) {
+        const auto bytesRead = ::read(m_inFd, header + headerRead, HeaderSize - headerRead);
+        if (bytesRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRead <= 0) {
+            return bytesRead == 0 ? Closed : Failed;
+        }
+        headerRead += static_cast<int>(bytesRead);
+    }
+
+    quint32 length;
+    memcpy(&length, header, HeaderSize);
+    if (length == 0 || length > m_maxLength) {
+        return Failed;
+    }
+
+    return splice(m_inFd, m_socketFd, length) ? Relayed : Failed;
+#else
+    return Failed;
+#endif
+}
+
+/**
+ * Forward the replies waiting on the socket to stdout, each with its own
+ * length header.
+ *
+ * KeePassXC doesn't delimit its replies, a read may end in the middle of one
+ * or hold several. Incomplete replies are kept until the rest arrives.
+ */
+ProxyRelay::Result ProxyRelay::relayToBrowser()
+{
+#ifdef Q_OS_LINUX
+    QByteArray data(ReadSize, '\0');
+    ssize_t bytesRead;
+    do {
+        bytesRead = ::read(m_socketFd, data.data(), ReadSize);
+    } while (bytesRead < 0 && errno == EINTR);
+
+    if (bytesRead <= 0) {
+        return bytesRead == 0 ? Closed : Failed;
+    }
+
+    data.resize(static_cast<int>(bytesRead));
+    m_splitter.append(data);
+
+    QByteArray message;
+    while (m_splitter.takeMessage(message)) {
+        if (!NativeMessageFramer::writeMessage(m_outFd, message)) {
+            return Failed;
+        }
+    }
+
+    return m_splitter.hasError() ? Failed : Relayed;
+#else
+    return Failed;
+#endif
+}
+
+bool ProxyRelay::splice(int fromFd, int toFd, quint32 length)
+{
+#ifdef Q_OS_LINUX
+    quint32 remaining = length;
+    while (remaining > 0) {
+        const auto moved = ::splice(fromFd, nullptr, toFd, nullptr, remaining, SPLICE_F_MOVE);
+        if (moved < 0 && errno == EINTR) {
+            continue;
+        }
+        if (moved <= 0) {
+            return false;
+        }
+        remaining -= static_cast<quint32>(moved);
+    }
+    return true;
+#else
+    Q_UNUSED(fromFd);
+    Q_UNUSED(toFd);
+    Q_UNUSED(length);
+    return false;
+#endif
+}
@@ -0,0 +1,58 @@
+/*
+*  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROXYRELAY_H
+#define PROXYRELAY_H
+
+#include "LocalMessageSplitter.h"
+
+#include <QtGlobal>
+
+/**
+ * Forwards native messages between the browser and KeePassXC. Messages from
+ * the browser stay inside the kernel, only their length headers pass through
+ * user space and the bodies are moved with splice(2). Replies of KeePassXC
+ * carry no length, they are split in user space and framed one by one.
+ */
+class ProxyRelay
+{
+public:
+    ProxyRelay(int inFd, int outFd, int socketFd, quint32 maxLength);
+
+    static bool isSupported(int inFd, int outFd);
+    bool run();
+
+private:
+    enum Result
+    {
+        Relayed,
+        Closed,
+        Failed
+    };
+
+    Result relayFromBrowser();
+    Result relayToBrowser();
+    bool splice(int fromFd, int toFd, quint32 length);
+
+    const int m_inFd;
+    const int m_outFd;
+    const int m_socketFd;
+    const quint32 m_maxLength;
+    LocalMessageSplitter m_splitter;
+};
+
+#endif // PROXYRELAY_H
@@ -57,5 +57,8 @@ int main(int argc, char* argv[])
     catchUnixSignals({SIGQUIT, SIGINT, SIGTERM, SIGHUP});
 #endif
     NativeMessagingHost host;
+    if (host.runRelay()) {
+        return 0;
+    }
     return a.exec();
 }
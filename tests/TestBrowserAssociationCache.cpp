@@ -0,0 +1,98 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestBrowserAssociationCache.h"
+#include "TestGlobal.h"
+
+#include <QUuid>
+
+#include "browser/BrowserAssociationCache.h"
+#include "browser/BrowserService.h"
+#include "core/Database.h"
+#include "core/Entry.h"
+#include "core/Group.h"
+#include "core/Metadata.h"
+#include "crypto/Crypto.h"
+
+QTEST_GUILESS_MAIN(TestBrowserAssociationCache)
+
+namespace
+{
+    Entry* createSettingsEntry(Group* group)
+    {
+        auto* entry = new Entry();
+        entry->setUuid(BrowserService::KEEPASSXCBROWSER_UUID);
+        entry->setTitle("KeePassXC-Browser Settings");
+        entry->attributes()->set(QString(BrowserService::ASSOCIATE_KEY_PREFIX) + "firefox", "key1");
+        entry->setGroup(group);
+        return entry;
+    }
+} // namespace
+
+void TestBrowserAssociationCache::initTestCase()
+{
+    QVERIFY(Crypto::init());
+}
+
+void TestBrowserAssociationCache::testKeys()
+{
+    Database db;
+    BrowserAssociationCache* cache = BrowserAssociationCache::forDatabase(&db);
+    QCOMPARE(BrowserAssociationCache::forDatabase(&db), cache);
+    QVERIFY(cache->key("firefox").isEmpty());
+
+    // the settings entry is found once it is added
+    Entry* entry = createSettingsEntry(db.rootGroup());
+    QCOMPARE(cache->key("firefox"), QString("key1"));
+    QVERIFY(cache->key("chromium").isEmpty());
+
+    entry->attributes()->set(QString(BrowserService::ASSOCIATE_KEY_PREFIX) + "chromium", "key2");
+    entry->attributes()->set(QString(BrowserService::ASSOCIATE_KEY_PREFIX) + "firefox", "key3");
+    QCOMPARE(cache->key("chromium"), QString("key2"));
+    QCOMPARE(cache->key("firefox"), QString("key3"));
+
+    delete entry;
+    QVERIFY(cache->key("firefox").isEmpty());
+}
+
+void TestBrowserAssociationCache::testRecycledSettingsEntry()
+{
+    Database db;
+    db.metadata()->setRecycleBinEnabled(true);
+    BrowserAssociationCache* cache = BrowserAssociationCache::forDatabase(&db);
+
+    auto* group = new Group();
+    group->setUuid(QUuid::createUuid());
+    group->setName("Settings");
+    group->setParent(db.rootGroup());
+    Entry* entry = createSettingsEntry(group);
+    QCOMPARE(cache->key("firefox"), QString("key1"));
+
+    db.recycleEntry(entry);
+    QVERIFY(cache->key("firefox").isEmpty());
+
+    entry->setGroup(group);
+    QCOMPARE(cache->key("firefox"), QString("key1"));
+
+    // the entry is just as deleted when its group is in the recycle bin
+    db.recycleGroup(group);
+    QVERIFY(entry->isRecycled());
+    QVERIFY(cache->key("firefox").isEmpty());
+
+    group->setParent(db.rootGroup());
+    QCOMPARE(cache->key("firefox"), QString("key1"));
+}
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestBrowserEntrySorter.h"
+#include "TestGlobal.h"
+
+#include "browser/BrowserEntrySorter.h"
+
+QTEST_GUILESS_MAIN(TestBrowserEntrySorter)
+
+void TestBrowserEntrySorter::testPriority()
+{
+    const BrowserEntrySorter sorter("example.com", "https://example.com/login");
+
+    QCOMPARE(sorter.priority("https://example.com/login"), 100);
+    QCOMPARE(sorter.priority("https://example.com/login/"), 100);
+    QCOMPARE(sorter.priority("https://example.com"), 60);
+    QCOMPARE(sorter.priority("https://example.com/login/sso"), 50);
+    QCOMPARE(sorter.priority("https://other.org"), 0);
+}
+
+void TestBrowserEntrySorter::testSortOrder()
+{
+    const BrowserEntrySorter sorter("example.com", "https://example.com/login");
+
+    BrowserEntrySnapshotList entries;
+    entries << snapshot("https://example.com", "gamma") << snapshot("https://other.org", "Alpha")
+            << snapshot("https://example.com/login", "zeta") << snapshot("https://example.com", "Alpha")
+            << snapshot("https://example.com", "beta");
+
+    const BrowserEntrySnapshotList sorted = sorter.sort(entries, false);
+    QCOMPARE(sorted.size(), 5);
+    QCOMPARE(sorted[0].sortKey, QString("zeta"));
+    QCOMPARE(sorted[1].sortKey, QString("Alpha"));
+    QCOMPARE(sorted[1].url, QString("https://example.com"));
+    QCOMPARE(sorted[2].sortKey, QString("beta"));
+    QCOMPARE(sorted[3].sortKey, QString("gamma"));
+    QCOMPARE(sorted[4].url, QString("https://other.org"));
+}
+
+void TestBrowserEntrySorter::testBestMatchOnly()
+{
+    const BrowserEntrySorter sorter("example.com", "https://example.com/login");
+
+    BrowserEntrySnapshotList entries;
+    entries << snapshot("https://example.com", "a") << snapshot("https://example.com/login", "c")
+            << snapshot("https://example.com/login", "b");
+
+    const BrowserEntrySnapshotList sorted = sorter.sort(entries, true);
+    QCOMPARE(sorted.size(), 2);
+    QCOMPARE(sorted[0].sortKey, QString("b"));
+    QCOMPARE(sorted[1].sortKey, QString("c"));
+
+    QVERIFY(sorter.sort(BrowserEntrySnapshotList(), true).isEmpty());
+}
+
+void TestBrowserEntrySorter::benchmarkSort()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    // a single sign-on host shared by thousands of entries
+    const BrowserEntrySorter sorter("sso.example.com", "https://sso.example.com/auth/realms/corp/login");
+
+    BrowserEntrySnapshotList entries;
+    for (int i = 0; i < 5000; ++i) {
+        const QString path = (i % 3 == 0) ? "/auth/realms/corp/login" : (i % 3 == 1) ? "/auth" : "";
+        entries << snapshot(QString("https://sso.example.com%1").arg(path),
+                            QString("Service account %1 (%2)").arg((i * 7919) % 5000).arg(i % 17));
+    }
+
+    QBENCHMARK
+    {
+        QCOMPARE(sorter.sort(entries, false).size(), entries.size());
+    };
+}
+
+BrowserEntrySnapshot TestBrowserEntrySorter::snapshot(const QString& url, const QString& sortKey)
+{
+    BrowserEntrySnapshot snapshot;
+    snapshot.url = url;
+    snapshot.sortKey = sortKey;
+    snapshot.allowed = true;
+    return snapshot;
+}
@@ -0,0 +1,193 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestBrowserLoad.h"
+#include "TestGlobal.h"
+
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QJsonObject>
+#include <QUrl>
+#include <QVector>
+#include <QtConcurrent>
+#include <algorithm>
+
+#include "browser/BrowserEntrySnapshot.h"
+#include "browser/BrowserEntrySorter.h"
+#include "browser/BrowserUrlIndex.h"
+#include "core/Database.h"
+#include "core/Entry.h"
+#include "core/Group.h"
+#include "crypto/Crypto.h"
+
+QTEST_GUILESS_MAIN(TestBrowserLoad)
+
+void TestBrowserLoad::initTestCase()
+{
+    QVERIFY(Crypto::init());
+}
+
+void TestBrowserLoad::testRequest()
+{
+    QScopedPointer<Database> db(createDatabase(40, 4));
+    BrowserUrlIndex* index = BrowserUrlIndex::forDatabase(db.data());
+    QMutex guiMutex;
+
+    const QJsonArray result = request(index, &guiMutex, "https://sso.example.com/auth/realms/corp/login");
+    QCOMPARE(result.size(), 4);
+    QCOMPARE(result.first().toObject().value("login").toString(), QString("user0"));
+
+    QVERIFY(request(index, &guiMutex, "https://unknown.example.com").isEmpty());
+}
+
+void TestBrowserLoad::benchmarkRequests_data()
+{
+    QTest::addColumn<int>("entries");
+    QTest::addColumn<int>("concurrency");
+
+    QTest::newRow("1000 entries, 1 client") << 1000 << 1;
+    QTest::newRow("10000 entries, 1 client") << 10000 << 1;
+    QTest::newRow("10000 entries, 8 clients") << 10000 << 8;
+}
+
+/**
+ * Stand-in for KeePassXC answering get-logins requests of browsers and
+ * connectors, without the GUI and the encryption.
+ *
+ * Prints the latency of the requests and the throughput of the last run.
+ */
+void TestBrowserLoad::benchmarkRequests()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QFETCH(int, entries);
+    QFETCH(int, concurrency);
+
+    const int hosts = entries / 10;
+    QScopedPointer<Database> db(createDatabase(entries, hosts));
+    BrowserUrlIndex* index = BrowserUrlIndex::forDatabase(db.data());
+    QMutex guiMutex;
+    const QStringList urls = requestUrls(2000, hosts);
+    QVector<qint64> latencies(urls.size());
+    qint64 elapsed = 0;
+
+    // the first lookup builds the index
+    request(index, &guiMutex, urls.first());
+
+    QBENCHMARK
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        QList<QFuture<void>> clients;
+        for (int client = 0; client < concurrency; ++client) {
+            clients << QtConcurrent::run([&, client]() {
+                for (int i = client; i < urls.size(); i += concurrency) {
+                    QElapsedTimer latency;
+                    latency.start();
+                    request(index, &guiMutex, urls[i]);
+                    latencies[i] = latency.nsecsElapsed();
+                }
+            });
+        }
+        for (QFuture<void>& future : clients) {
+            future.waitForFinished();
+        }
+
+        elapsed = timer.nsecsElapsed();
+    };
+
+    std::sort(latencies.begin(), latencies.end());
+    qDebug("p50: %.3f ms, p99: %.3f ms, %.0f requests/s",
+           latencies[latencies.size() / 2] / 1e6,
+           latencies[(latencies.size() - 1) * 99 / 100] / 1e6,
+           urls.size() * 1e9 / elapsed);
+}
+
+/**
+ * A database with the entries spread over the hosts, every tenth entry of a
+ * host belongs to the single sign-on host shared by all.
+ */
+Database* TestBrowserLoad::createDatabase(int entries, int hosts)
+{
+    Database* db = new Database();
+    for (int i = 0; i < entries; ++i) {
+        const QString host = (i % 10 == 0) ? QString("sso.example.com") : QString("host%1.example.com").arg(i % hosts);
+
+        Entry* entry = new Entry();
+        entry->setTitle(QString("Account %1").arg(i));
+        entry->setUsername(QString("user%1").arg(i));
+        entry->setPassword(QString("password%1").arg(i));
+        entry->setUrl(QString("https://%1/login").arg(host));
+        entry->setGroup(db->rootGroup());
+    }
+    return db;
+}
+
+/**
+ * URLs to request, skewed towards few hosts as with single sign-on, where
+ * most requests go to the same identity provider.
+ */
+QStringList TestBrowserLoad::requestUrls(int requests, int hosts)
+{
+    QStringList urls;
+    quint32 seed = 1;
+    for (int i = 0; i < requests; ++i) {
+        seed = seed * 1103515245 + 12345;
+        const double x = (seed >> 16) / 65536.0;
+        const int host = static_cast<int>(hosts * x * x * x);
+        urls << (host == 0 ? QString("https://sso.example.com/auth/realms/corp/login")
+                           : QString("https://host%1.example.com/login").arg(host));
+    }
+    return urls;
+}
+
+/**
+ * The work of a get-logins request: the entries are looked up and copied on
+ * the GUI thread, one request at a time, and sorted on the worker.
+ */
+QJsonArray TestBrowserLoad::request(BrowserUrlIndex* index, QMutex* guiMutex, const QString& url)
+{
+    const QString host = QUrl(url).host();
+
+    BrowserEntrySnapshotList snapshots;
+    {
+        QMutexLocker locker(guiMutex);
+        for (Entry* entry : index->entries(host)) {
+            BrowserEntrySnapshot snapshot;
+            snapshot.host = host;
+            snapshot.url = entry->url();
+            snapshot.sortKey = entry->username();
+            snapshot.allowed = true;
+            snapshot.json["login"] = entry->username();
+            snapshot.json["password"] = entry->password();
+            snapshot.json["name"] = entry->title();
+            snapshots << snapshot;
+        }
+    }
+
+    QJsonArray result;
+    const BrowserEntrySorter sorter(host, url);
+    for (const BrowserEntrySnapshot& snapshot : sorter.sort(snapshots, false)) {
+        result << snapshot.json;
+    }
+    return result;
+}
@@ -0,0 +1,46 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSXC_TESTBROWSERLOAD_H
+#define KEEPASSXC_TESTBROWSERLOAD_H
+
+#include <QJsonArray>
+#include <QMutex>
+#include <QObject>
+#include <QScopedPointer>
+#include <QStringList>
+
+class BrowserUrlIndex;
+class Database;
+
+class TestBrowserLoad : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testRequest();
+    void benchmarkRequests_data();
+    void benchmarkRequests();
+
+private:
+    static Database* createDatabase(int entries, int hosts);
+    static QStringList requestUrls(int requests, int hosts);
+    static QJsonArray request(BrowserUrlIndex* index, QMutex* guiMutex, const QString& url);
+};
+
+#endif // KEEPASSXC_TESTBROWSERLOAD_H
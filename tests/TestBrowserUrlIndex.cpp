@@ -0,0 +1,211 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestBrowserUrlIndex.h"
+#include "TestGlobal.h"
+
+#include <QUuid>
+
+#include "browser/BrowserUrlIndex.h"
+#include "core/Database.h"
+#include "core/Entry.h"
+#include "core/Group.h"
+#include "core/Metadata.h"
+#include "crypto/Crypto.h"
+
+QTEST_GUILESS_MAIN(TestBrowserUrlIndex)
+
+void TestBrowserUrlIndex::initTestCase()
+{
+    QVERIFY(Crypto::init());
+}
+
+void TestBrowserUrlIndex::testAddEntry()
+{
+    Database db;
+    BrowserUrlIndex* index = BrowserUrlIndex::forDatabase(&db);
+    QCOMPARE(BrowserUrlIndex::forDatabase(&db), index);
+
+    Entry* byUrl = createEntry(db.rootGroup(), "Login", "https://www.example.com/login");
+    Entry* byTitle = createEntry(db.rootGroup(), "Example.org", "");
+    QCOMPARE(index->entries("www.example.com"), QList<Entry*>() << byUrl);
+    QCOMPARE(index->entries("EXAMPLE.ORG"), QList<Entry*>() << byTitle);
+    QVERIFY(index->entries("example.com").isEmpty());
+    QVERIFY(index->entries("").isEmpty());
+
+    // entries added after the index was built are picked up without a rebuild
+    Entry* added = createEntry(db.rootGroup(), "Other login", "https://www.example.com");
+    const QList<Entry*> entries = index->entries("www.example.com");
+    QCOMPARE(entries.size(), 2);
+    QVERIFY(entries.contains(byUrl));
+    QVERIFY(entries.contains(added));
+}
+
+void TestBrowserUrlIndex::testChangeUrl()
+{
+    Database db;
+    BrowserUrlIndex* index = BrowserUrlIndex::forDatabase(&db);
+    Entry* entry = createEntry(db.rootGroup(), "Login", "https://example.com");
+    QCOMPARE(index->entries("example.com"), QList<Entry*>() << entry);
+
+    entry->setUrl("https://example.net/login");
+    QVERIFY(index->entries("example.com").isEmpty());
+    QCOMPARE(index->entries("example.net"), QList<Entry*>() << entry);
+
+    entry->setTitle("example.com");
+    QCOMPARE(index->entries("example.com"), QList<Entry*>() << entry);
+    QCOMPARE(index->entries("example.net"), QList<Entry*>() << entry);
+}
+
+void TestBrowserUrlIndex::testMoveEntry()
+{
+    Database db;
+    BrowserUrlIndex* index = BrowserUrlIndex::forDatabase(&db);
+    Group* group = createGroup(db.rootGroup(), "Web");
+    Group* hidden = createGroup(db.rootGroup(), "Hidden");
+    hidden->setSearchingEnabled(Group::Disable);
+    Entry* entry = createEntry(db.rootGroup(), "Login", "https://example.com");
+    QCOMPARE(index->entries("example.com"), QList<Entry*>() << entry);
+
+    entry->setGroup(group);
+    QCOMPARE(index->entries("example.com"), QList<Entry*>() << entry);
+
+    entry->setGroup(hidden);
+    QVERIFY(index->entries("example.com").isEmpty());
+
+    // a moved entry is still updated in its new group
+    entry->setGroup(group);
+    entry->setUrl("https://example.net");
+    QVERIFY(index->entries("example.com").isEmpty());
+    QCOMPARE(index->entries("example.net"), QList<Entry*>() << entry);
+}
+
+void TestBrowserUrlIndex::testDeleteEntry()
+{
+    Database db;
+    db.metadata()->setRecycleBinEnabled(false);
+    BrowserUrlIndex* index = BrowserUrlIndex::forDatabase(&db);
+    Entry* entry = createEntry(db.rootGroup(), "Login", "https://example.com");
+    Entry* other = createEntry(db.rootGroup(), "Other login", "https://example.com");
+    QCOMPARE(index->entries("example.com").size(), 2);
+
+    delete entry;
+    QCOMPARE(index->entries("example.com"), QList<Entry*>() << other);
+
+    db.recycleEntry(other);
+    QVERIFY(index->entries("example.com").isEmpty());
+
+    Group* group = createGroup(db.rootGroup(), "Web");
+    createEntry(group, "Login", "https://example.com");
+    QCOMPARE(index->entries("example.com").size(), 1);
+    delete group;
+    QVERIFY(index->entries("example.com").isEmpty());
+}
+
+void TestBrowserUrlIndex::testSearchDisabledGroup()
+{
+    Database db;
+    BrowserUrlIndex* index = BrowserUrlIndex::forDatabase(&db);
+    Group* group = createGroup(db.rootGroup(), "Web");
+    Group* child = createGroup(group, "Child");
+    Entry* entry = createEntry(group, "Login", "https://example.com");
+    Entry* childEntry = createEntry(child, "Child login", "https://example.com");
+    QCOMPARE(index->entries("example.com").size(), 2);
+
+    // a disabled group hides its whole subtree, even where children enable searching again
+    group->setSearchingEnabled(Group::Disable);
+    child->setSearchingEnabled(Group::Enable);
+    QVERIFY(index->entries("example.com").isEmpty());
+
+    group->setSearchingEnabled(Group::Inherit);
+    child->setSearchingEnabled(Group::Disable);
+    QCOMPARE(index->entries("example.com"), QList<Entry*>() << entry);
+
+    child->setSearchingEnabled(Group::Inherit);
+    QCOMPARE(index->entries("example.com").size(), 2);
+    QVERIFY(index->entries("example.com").contains(childEntry));
+}
+
+void TestBrowserUrlIndex::testRecycledEntry()
+{
+    Database db;
+    BrowserUrlIndex* index = BrowserUrlIndex::forDatabase(&db);
+    Group* group = createGroup(db.rootGroup(), "Web");
+    Entry* entry = createEntry(db.rootGroup(), "Login", "https://example.com");
+    createEntry(group, "Group login", "https://example.net");
+    QCOMPARE(index->entries("example.com"), QList<Entry*>() << entry);
+    QCOMPARE(index->entries("example.net").size(), 1);
+
+    db.recycleEntry(entry);
+    QVERIFY(db.metadata()->recycleBin());
+    QVERIFY(index->entries("example.com").isEmpty());
+
+    db.recycleGroup(group);
+    QVERIFY(index->entries("example.net").isEmpty());
+
+    // restoring an entry makes it visible again
+    entry->setGroup(db.rootGroup());
+    QCOMPARE(index->entries("example.com"), QList<Entry*>() << entry);
+}
+
+/**
+ * Entries with placeholders in their title or URL can't be indexed by host,
+ * they are resolved on every lookup instead.
+ */
+void TestBrowserUrlIndex::testPlaceholder()
+{
+    Database db;
+    BrowserUrlIndex* index = BrowserUrlIndex::forDatabase(&db);
+    Entry* target = createEntry(db.rootGroup(), "Login", "https://example.com");
+    Entry* reference = createEntry(
+        db.rootGroup(), "Reference", QString("{REF:A@I:%1}").arg(QString(target->uuid().toRfc4122().toHex())));
+
+    QList<Entry*> entries = index->entries("example.com");
+    QCOMPARE(entries.size(), 2);
+    QVERIFY(entries.contains(reference));
+
+    // the reference follows the entry it points to
+    target->setUrl("https://example.net");
+    QVERIFY(index->entries("example.com").isEmpty());
+    entries = index->entries("example.net");
+    QCOMPARE(entries.size(), 2);
+    QVERIFY(entries.contains(reference));
+
+    // without the placeholder the entry is indexed by host again
+    reference->setUrl("https://example.org");
+    QCOMPARE(index->entries("example.net"), QList<Entry*>() << target);
+    QCOMPARE(index->entries("example.org"), QList<Entry*>() << reference);
+}
+
+Entry* TestBrowserUrlIndex::createEntry(Group* group, const QString& title, const QString& url)
+{
+    auto* entry = new Entry();
+    entry->setUuid(QUuid::createUuid());
+    entry->setTitle(title);
+    entry->setUrl(url);
+    entry->setGroup(group);
+    return entry;
+}
+
+Group* TestBrowserUrlIndex::createGroup(Group* parent, const QString& name)
+{
+    auto* group = new Group();
+    group->setUuid(QUuid::createUuid());
+    group->setName(name);
+    group->setParent(parent);
+    return group;
+}
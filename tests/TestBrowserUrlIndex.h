@@ -0,0 +1,45 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSXC_TESTBROWSERURLINDEX_H
+#define KEEPASSXC_TESTBROWSERURLINDEX_H
+
+#include <QObject>
+
+class Entry;
+class Group;
+
+class TestBrowserUrlIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testAddEntry();
+    void testChangeUrl();
+    void testMoveEntry();
+    void testDeleteEntry();
+    void testSearchDisabledGroup();
+    void testRecycledEntry();
+    void testPlaceholder();
+
+private:
+    static Entry* createEntry(Group* group, const QString& title, const QString& url);
+    static Group* createGroup(Group* parent, const QString& name);
+};
+
+#endif // KEEPASSXC_TESTBROWSERURLINDEX_H
@@ -0,0 +1,215 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestConnectorDaemon.h"
+#include "TestGlobal.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QSharedPointer>
+#include <QTemporaryDir>
+
+#include <sodium.h>
+
+#include "browser/LocalMessageSplitter.h"
+#include "connector/DaemonApp.h"
+
+QTEST_GUILESS_MAIN(TestConnectorDaemon)
+
+namespace
+{
+    const int MaxLength = 1024 * 1024;
+    const QString DatabaseHash = "29234e32274a32276e25666a42";
+
+    QByteArray newKey(int length)
+    {
+        return QByteArray(length, '\0');
+    }
+
+    unsigned char* bytes(QByteArray& data)
+    {
+        return reinterpret_cast<unsigned char*>(data.data());
+    }
+
+    const unsigned char* bytes(const QByteArray& data)
+    {
+        return reinterpret_cast<const unsigned char*>(data.constData());
+    }
+} // namespace
+
+void TestConnectorDaemon::initTestCase()
+{
+    QVERIFY(sodium_init() >= 0);
+}
+
+// KeePassXC and the daemon meet in a runtime directory of their own
+void TestConnectorDaemon::init()
+{
+    m_runtimeDir.reset(new QTemporaryDir());
+    QVERIFY(m_runtimeDir->isValid());
+    qputenv("XDG_RUNTIME_DIR", QFile::encodeName(m_runtimeDir->path()));
+
+    m_clientPublicKey = newKey(crypto_box_PUBLICKEYBYTES);
+    QByteArray clientSecretKey = newKey(crypto_box_SECRETKEYBYTES);
+    QCOMPARE(crypto_box_keypair(bytes(m_clientPublicKey), bytes(clientSecretKey)), 0);
+    m_serverPublicKey = newKey(crypto_box_PUBLICKEYBYTES);
+    m_serverSecretKey = newKey(crypto_box_SECRETKEYBYTES);
+    QCOMPARE(crypto_box_keypair(bytes(m_serverPublicKey), bytes(m_serverSecretKey)), 0);
+
+    m_idPath = m_runtimeDir->path() + "/id_test";
+    QFile identity(m_idPath);
+    QVERIFY(identity.open(QIODevice::WriteOnly | QIODevice::Text));
+    QJsonObject keys;
+    keys["myPublicKey"] = QString(m_clientPublicKey.toBase64());
+    keys["mySecretKey"] = QString(clientSecretKey.toBase64());
+    identity.write(QJsonDocument(keys).toJson());
+    identity.close();
+
+    m_connections = 0;
+    m_keePassXC.reset(new QLocalServer());
+    QVERIFY(m_keePassXC->listen(m_runtimeDir->path() + "/kpxc_server"));
+    connect(m_keePassXC.data(), &QLocalServer::newConnection, this, &TestConnectorDaemon::newKeePassXCConnection);
+}
+
+void TestConnectorDaemon::cleanup()
+{
+    m_keePassXC.reset();
+    m_runtimeDir.reset();
+}
+
+void TestConnectorDaemon::newKeePassXCConnection()
+{
+    while (QLocalSocket* socket = m_keePassXC->nextPendingConnection()) {
+        ++m_connections;
+        QSharedPointer<LocalMessageSplitter> splitter(new LocalMessageSplitter(MaxLength));
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket, splitter]() {
+            splitter->append(socket->readAll());
+            QByteArray data;
+            while (splitter->takeMessage(data)) {
+                socket->write(answer(data));
+            }
+            socket->flush();
+        });
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+// answers the key exchange and get-databasehash like KeePassXC does
+QByteArray TestConnectorDaemon::answer(const QByteArray& data) const
+{
+    const auto request = QJsonDocument::fromJson(data).object();
+    const auto action = request["action"].toString();
+
+    QJsonObject response;
+    response["action"] = action;
+    if (action == "change-public-keys") {
+        response["publicKey"] = QString(m_serverPublicKey.toBase64());
+        response["success"] = "true";
+    } else if (action == "get-databasehash") {
+        QJsonObject message;
+        message["hash"] = DatabaseHash;
+        const auto plain = QJsonDocument(message).toJson();
+
+        QByteArray nonce = newKey(crypto_box_NONCEBYTES);
+        randombytes_buf(nonce.data(), static_cast<size_t>(nonce.size()));
+        QByteArray encrypted = newKey(plain.size() + static_cast<int>(crypto_box_MACBYTES));
+        crypto_box_easy(bytes(encrypted), bytes(plain), static_cast<unsigned long long>(plain.size()),
+                        bytes(nonce), bytes(m_clientPublicKey), bytes(m_serverSecretKey));
+
+        response["nonce"] = QString(nonce.toBase64());
+        response["message"] = QString(encrypted.toBase64());
+    } else {
+        response["error"] = "Unknown action";
+    }
+
+    return QJsonDocument(response).toJson(QJsonDocument::Compact);
+}
+
+// a frontend of its own for each request, like git calling the credential helper
+QByteArray TestConnectorDaemon::request(const QByteArray& data) const
+{
+    QLocalSocket frontend;
+    frontend.connectToServer(AppBase::daemonSocketPath(m_idPath));
+    if (!frontend.waitForConnected(1000)) {
+        return QByteArray();
+    }
+    frontend.write(data);
+    frontend.flush();
+
+    LocalMessageSplitter splitter(MaxLength);
+    QByteArray reply;
+    for (int i = 0; i < 100; ++i) {
+        QTest::qWait(20);
+        splitter.append(frontend.readAll());
+        if (splitter.takeMessage(reply)) {
+            return reply;
+        }
+    }
+    return QByteArray();
+}
+
+void TestConnectorDaemon::testSequentialClients()
+{
+    DaemonApp daemon;
+    daemon.setIdPath(m_idPath);
+    QVERIFY(daemon.start({}));
+
+    const QByteArray getHash = R"({"action":"get-databasehash","message":{}})";
+    for (int i = 0; i < 2; ++i) {
+        const auto reply = QJsonDocument::fromJson(request(getHash)).object();
+        QCOMPARE(reply["action"].toString(), QString("get-databasehash"));
+        QVERIFY(!reply.contains("error"));
+        QCOMPARE(reply["message"].toObject()["hash"].toString(), DatabaseHash);
+    }
+
+    // both frontends went through the session the daemon negotiated once
+    QCOMPARE(m_connections, 1);
+}
+
+void TestConnectorDaemon::testSecondDaemon()
+{
+    DaemonApp daemon;
+    daemon.setIdPath(m_idPath);
+    QVERIFY(daemon.start({}));
+
+    DaemonApp second;
+    second.setIdPath(m_idPath);
+    QVERIFY(!second.start({}));
+
+    // the first daemon keeps its socket
+    const auto reply = QJsonDocument::fromJson(request(R"({"action":"get-databasehash"})")).object();
+    QCOMPARE(reply["message"].toObject()["hash"].toString(), DatabaseHash);
+    QCOMPARE(m_connections, 1);
+}
+
+void TestConnectorDaemon::testStaleSocket()
+{
+    // a daemon that got killed leaves its socket file behind
+    QFile stale(AppBase::daemonSocketPath(m_idPath));
+    QVERIFY(stale.open(QIODevice::WriteOnly));
+    stale.close();
+
+    DaemonApp daemon;
+    daemon.setIdPath(m_idPath);
+    QVERIFY(daemon.start({}));
+
+    const auto reply = QJsonDocument::fromJson(request(R"({"action":"get-databasehash"})")).object();
+    QCOMPARE(reply["message"].toObject()["hash"].toString(), DatabaseHash);
+}
@@ -0,0 +1,55 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSXC_TESTCONNECTORDAEMON_H
+#define KEEPASSXC_TESTCONNECTORDAEMON_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QScopedPointer>
+#include <QString>
+
+class QLocalServer;
+class QTemporaryDir;
+
+class TestConnectorDaemon : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void testSequentialClients();
+    void testSecondDaemon();
+    void testStaleSocket();
+
+private:
+    void newKeePassXCConnection();
+    QByteArray answer(const QByteArray& data) const;
+    QByteArray request(const QByteArray& data) const;
+
+    QScopedPointer<QTemporaryDir> m_runtimeDir;
+    QScopedPointer<QLocalServer> m_keePassXC;
+    QString m_idPath;
+    QByteArray m_clientPublicKey;
+    QByteArray m_serverPublicKey;
+    QByteArray m_serverSecretKey;
+    int m_connections;
+};
+
+#endif // KEEPASSXC_TESTCONNECTORDAEMON_H
@@ -19,12 +19,21 @@
 #include "TestDatabase.h"
 #include "TestGlobal.h"
 
+#include <QBuffer>
 #include <QSignalSpy>
 #include <QTemporaryFile>
+#include <QThread>
+#include <QThreadPool>
 
 #include "config-keepassx-tests.h"
+#include "core/Config.h"
+#include "core/DatabaseLoader.h"
+#include "core/Group.h"
 #include "core/Metadata.h"
+#include "core/QuickUnlock.h"
 #include "crypto/Crypto.h"
+#include "crypto/kdf/Argon2Kdf.h"
+#include "format/KeePass2Reader.h"
 #include "format/KeePass2Writer.h"
 #include "keys/PasswordKey.h"
 
@@ -33,6 +42,7 @@ QTEST_GUILESS_MAIN(TestDatabase)
 void TestDatabase::initTestCase()
 {
     QVERIFY(Crypto::init());
+    Config::createTempFileInstance();
 }
 
 void TestDatabase::testEmptyRecycleBinOnDisabled()
@@ -109,3 +119,330 @@ void TestDatabase::testEmptyRecycleBinWithHierarchicalData()
 
     delete db;
 }
+
+void TestDatabase::testSnapshot()
+{
+    QString filename = QString(KEEPASSX_TEST_DATA_DIR).append("/RecycleBinWithData.kdbx");
+    CompositeKey key;
+    key.addKey(PasswordKey("123"));
+    QScopedPointer<Database> db(Database::openDatabaseFile(filename, key));
+    QVERIFY(db);
+
+    QScopedPointer<Database> snapshot(db->snapshot());
+    QVERIFY(snapshot->key().rawKey() == db->key().rawKey());
+    QCOMPARE(snapshot->kdf()->seed(), db->kdf()->seed());
+    QVERIFY(snapshot->kdf() != db->kdf());
+    QCOMPARE(snapshot->rootGroup()->uuid(), db->rootGroup()->uuid());
+    QVERIFY(snapshot->metadata()->recycleBin());
+    QCOMPARE(snapshot->metadata()->recycleBin()->uuid(), db->metadata()->recycleBin()->uuid());
+    QCOMPARE(snapshot->metadata()->recycleBin()->database(), snapshot.data());
+
+    const QList<Entry*> entries = db->rootGroup()->entriesRecursive(true);
+    const QList<Entry*> snapshotEntries = snapshot->rootGroup()->entriesRecursive(true);
+    QCOMPARE(snapshotEntries.size(), entries.size());
+    for (int i = 0; i < entries.size(); ++i) {
+        QCOMPARE(snapshotEntries[i]->uuid(), entries[i]->uuid());
+        QCOMPARE(snapshotEntries[i]->timeInfo().locationChanged(), entries[i]->timeInfo().locationChanged());
+        QCOMPARE(snapshotEntries[i]->historyItems().size(), entries[i]->historyItems().size());
+    }
+
+    // later edits must not leak into the snapshot
+    db->metadata()->setName("changed");
+    db->emptyRecycleBin();
+    QVERIFY(snapshot->metadata()->name() != db->metadata()->name());
+    QCOMPARE(snapshot->rootGroup()->entriesRecursive(true).size(), entries.size());
+}
+
+void TestDatabase::testSaveToFileAsync()
+{
+    QString filename = QString(KEEPASSX_TEST_DATA_DIR).append("/RecycleBinWithData.kdbx");
+    CompositeKey key;
+    key.addKey(PasswordKey("123"));
+    QScopedPointer<Database> db(Database::openDatabaseFile(filename, key));
+    QVERIFY(db);
+
+    QTemporaryFile saveFile;
+    QVERIFY(saveFile.open());
+    saveFile.close();
+
+    QSignalSpy spySaved(db.data(), SIGNAL(saveFinished(QString, QString)));
+    db->saveToFileAsync(saveFile.fileName());
+    QVERIFY(db->isSaving());
+    // queued while the first save is running
+    db->metadata()->setName("async");
+    db->saveToFileAsync(saveFile.fileName());
+
+    QTRY_COMPARE_WITH_TIMEOUT(spySaved.count(), 2, 30000);
+    QVERIFY(!db->isSaving());
+    QCOMPARE(spySaved.at(0).at(0).toString(), saveFile.fileName());
+    QVERIFY(spySaved.at(0).at(1).toString().isEmpty());
+    QVERIFY(spySaved.at(1).at(1).toString().isEmpty());
+
+    QScopedPointer<Database> reopened(Database::openDatabaseFile(saveFile.fileName(), key));
+    QVERIFY(reopened);
+    QCOMPARE(reopened->metadata()->name(), QString("async"));
+    QCOMPARE(reopened->rootGroup()->entriesRecursive(true).size(), db->rootGroup()->entriesRecursive(true).size());
+
+    // a synchronous save supersedes a running background save and the queued one
+    db->saveToFileAsync(saveFile.fileName());
+    db->saveToFileAsync(saveFile.fileName());
+    db->metadata()->setName("sync");
+    QVERIFY(db->saveToFile(saveFile.fileName()).isEmpty());
+    QVERIFY(!db->isSaving());
+    QTest::qWait(100);
+    QCOMPARE(spySaved.count(), 2);
+
+    reopened.reset(Database::openDatabaseFile(saveFile.fileName(), key));
+    QVERIFY(reopened);
+    QCOMPARE(reopened->metadata()->name(), QString("sync"));
+
+    // finishing blocks until the queued save is written and reports both results
+    db->saveToFileAsync(saveFile.fileName());
+    db->metadata()->setName("finished");
+    db->saveToFileAsync(saveFile.fileName());
+    db->finishAsyncSave();
+    QVERIFY(!db->isSaving());
+    QCOMPARE(spySaved.count(), 4);
+    QVERIFY(spySaved.at(3).at(1).toString().isEmpty());
+    QTest::qWait(100);
+    QCOMPARE(spySaved.count(), 4);
+
+    reopened.reset(Database::openDatabaseFile(saveFile.fileName(), key));
+    QVERIFY(reopened);
+    QCOMPARE(reopened->metadata()->name(), QString("finished"));
+}
+
+void TestDatabase::testDatabaseLoader()
+{
+    QString filename = QString(KEEPASSX_TEST_DATA_DIR).append("/RecycleBinWithData.kdbx");
+    CompositeKey key;
+    key.addKey(PasswordKey("123"));
+
+    DatabaseLoader loader;
+    QSignalSpy spyPhase(&loader, SIGNAL(phaseChanged(int)));
+    QSignalSpy spyFinished(&loader, SIGNAL(finished(bool)));
+
+    loader.load(filename, key);
+    QVERIFY(loader.isLoading());
+    QTRY_COMPARE_WITH_TIMEOUT(spyFinished.count(), 1, 30000);
+    QCOMPARE(spyFinished.at(0).at(0).toBool(), true);
+    QVERIFY(!loader.isLoading());
+
+    QCOMPARE(spyPhase.count(), 3);
+    QCOMPARE(spyPhase.at(0).at(0).toInt(), static_cast<int>(KdbxReader::ReadPhase::DeriveKey));
+    QCOMPARE(spyPhase.at(2).at(0).toInt(), static_cast<int>(KdbxReader::ReadPhase::Parse));
+
+    QScopedPointer<Database> db(loader.takeDatabase());
+    QVERIFY(db);
+    QCOMPARE(db->thread(), QThread::currentThread());
+    QCOMPARE(db->rootGroup()->thread(), QThread::currentThread());
+    QVERIFY(!loader.takeDatabase());
+
+    // wrong key
+    CompositeKey wrongKey;
+    wrongKey.addKey(PasswordKey("wrong"));
+    loader.load(filename, wrongKey);
+    QTRY_COMPARE_WITH_TIMEOUT(spyFinished.count(), 2, 30000);
+    QCOMPARE(spyFinished.at(1).at(0).toBool(), false);
+    QVERIFY(!loader.errorString().isEmpty());
+
+    // canceled loads never report back
+    loader.load(filename, key);
+    loader.cancel();
+    QVERIFY(!loader.isLoading());
+    loader.load(filename, key);
+    QTRY_COMPARE_WITH_TIMEOUT(spyFinished.count(), 3, 30000);
+    QCOMPARE(spyFinished.at(2).at(0).toBool(), true);
+    QTest::qWait(100);
+    QCOMPARE(spyFinished.count(), 3);
+    delete loader.takeDatabase();
+}
+
+void TestDatabase::testDatabaseLoaderMemoryBudget()
+{
+    CompositeKey key;
+    key.addKey(PasswordKey("123"));
+
+    // databases whose key derivations need 1 MiB each
+    QList<QSharedPointer<QTemporaryFile>> files;
+    for (int i = 0; i < 3; ++i) {
+        Database db;
+        db.setKey(key);
+        auto kdf = QSharedPointer<Argon2Kdf>::create();
+        kdf->setRounds(1);
+        kdf->setMemory(1024);
+        kdf->setParallelism(1);
+        QVERIFY(db.changeKdf(kdf));
+        QCOMPARE(db.kdf()->memoryUsage(), quint64(1024 * 1024));
+
+        auto file = QSharedPointer<QTemporaryFile>::create();
+        QVERIFY(file->open());
+        file->close();
+        QVERIFY(db.saveToFile(file->fileName()).isEmpty());
+        files.append(file);
+    }
+
+    // a budget of a single derivation makes the loads take turns
+    const quint64 budget = DatabaseLoader::memoryBudget();
+    DatabaseLoader::setMemoryBudget(1024 * 1024);
+
+    QList<QSharedPointer<DatabaseLoader>> loaders;
+    QList<QSharedPointer<QSignalSpy>> spies;
+    for (const QSharedPointer<QTemporaryFile>& file : asConst(files)) {
+        auto loader = QSharedPointer<DatabaseLoader>::create();
+        spies.append(QSharedPointer<QSignalSpy>::create(loader.data(), SIGNAL(finished(bool))));
+        loader->load(file->fileName(), key);
+        loaders.append(loader);
+    }
+    // only one load at a time is admitted, the others wait without a thread of the global pool
+    QVERIFY(DatabaseLoader::memoryInUse() <= 1024 * 1024);
+    QCOMPARE(QThreadPool::globalInstance()->activeThreadCount(), 0);
+
+    for (int i = 0; i < loaders.size(); ++i) {
+        QTRY_COMPARE_WITH_TIMEOUT(spies[i]->count(), 1, 30000);
+        QCOMPARE(spies[i]->at(0).at(0).toBool(), true);
+        delete loaders[i]->takeDatabase();
+    }
+    QCOMPARE(DatabaseLoader::memoryInUse(), quint64(0));
+
+    // a derivation bigger than the whole budget still runs on its own
+    DatabaseLoader::setMemoryBudget(1024);
+    QSignalSpy spyFinished(loaders[0].data(), SIGNAL(finished(bool)));
+    loaders[0]->load(files[0]->fileName(), key);
+    QTRY_COMPARE_WITH_TIMEOUT(spyFinished.count(), 1, 30000);
+    QCOMPARE(spyFinished.at(0).at(0).toBool(), true);
+    delete loaders[0]->takeDatabase();
+    QCOMPARE(DatabaseLoader::memoryInUse(), quint64(0));
+
+    DatabaseLoader::setMemoryBudget(budget);
+}
+
+void TestDatabase::testQuickUnlock()
+{
+    config()->set("security/quickunlock", true);
+
+    QString filename = QString(KEEPASSX_TEST_DATA_DIR).append("/RecycleBinWithData.kdbx");
+    CompositeKey key;
+    key.addKey(PasswordKey("123"));
+    QScopedPointer<Database> db(Database::openDatabaseFile(filename, key));
+    QVERIFY(db);
+
+    // nothing is sealed without a PIN
+    QVERIFY(!quickUnlock()->seal(filename, db.data()));
+    QVERIFY(!quickUnlock()->isAvailable(filename));
+
+    quickUnlock()->prepare(filename, "1234");
+    QVERIFY(quickUnlock()->seal(filename, db.data()));
+    QVERIFY(quickUnlock()->isAvailable(filename));
+    QCOMPARE(quickUnlock()->remainingAttempts(filename), QuickUnlock::MaxAttempts);
+
+    QByteArray kdfSeed;
+    QByteArray transformedKey;
+    QVERIFY(quickUnlock()->unseal(filename, "0000", kdfSeed, transformedKey)
+            == QuickUnlock::Result::WrongPin);
+    QCOMPARE(quickUnlock()->remainingAttempts(filename), QuickUnlock::MaxAttempts - 1);
+    QVERIFY(transformedKey.isEmpty());
+
+    QVERIFY(quickUnlock()->unseal(filename, "1234", kdfSeed, transformedKey)
+            == QuickUnlock::Result::Unlocked);
+    QCOMPARE(kdfSeed, db->kdf()->seed());
+    QCOMPARE(transformedKey, db->transformedMasterKey());
+    QVERIFY(!quickUnlock()->isAvailable(filename));
+
+    DatabaseLoader loader;
+    QSignalSpy spyFinished(&loader, SIGNAL(finished(bool)));
+    loader.load(filename, kdfSeed, transformedKey);
+    QTRY_COMPARE_WITH_TIMEOUT(spyFinished.count(), 1, 30000);
+    QCOMPARE(spyFinished.at(0).at(0).toBool(), true);
+    QScopedPointer<Database> unlocked(loader.takeDatabase());
+    QVERIFY(unlocked);
+    QCOMPARE(unlocked->transformedMasterKey(), db->transformedMasterKey());
+    QCOMPARE(unlocked->rootGroup()->uuid(), db->rootGroup()->uuid());
+
+    // the key itself is never sealed, so it can't be derived with another KDF
+    QVERIFY(unlocked->hasKey());
+    QVERIFY(!unlocked->hasRawKey());
+    QVERIFY(db->hasRawKey());
+    QVERIFY(!unlocked->changeKdf(KeePass2::uuidToKdf(KeePass2::KDF_ARGON2)));
+
+    // a wrong transformed key is rejected by the header checks
+    loader.load(filename, kdfSeed, QByteArray(32, 'x'));
+    QTRY_COMPARE_WITH_TIMEOUT(spyFinished.count(), 2, 30000);
+    QCOMPARE(spyFinished.at(1).at(0).toBool(), false);
+
+    // without the key a changed KDF seed needs a full unlock
+    loader.load(filename, QByteArray(32, 's'), transformedKey);
+    QTRY_COMPARE_WITH_TIMEOUT(spyFinished.count(), 3, 30000);
+    QCOMPARE(spyFinished.at(2).at(0).toBool(), false);
+
+    // the sealed key is wiped after too many wrong PINs
+    quickUnlock()->prepare(filename, "1234");
+    QVERIFY(quickUnlock()->seal(filename, db.data()));
+    for (int i = 0; i < QuickUnlock::MaxAttempts; ++i) {
+        QVERIFY(quickUnlock()->unseal(filename, "4321", kdfSeed, transformedKey)
+                == QuickUnlock::Result::WrongPin);
+    }
+    QVERIFY(!quickUnlock()->isAvailable(filename));
+    QVERIFY(quickUnlock()->unseal(filename, "1234", kdfSeed, transformedKey)
+            == QuickUnlock::Result::Unavailable);
+
+    config()->set("security/quickunlock", false);
+}
+
+void TestDatabase::testTransformedKeyReuse()
+{
+    Database db;
+    auto kdf = QSharedPointer<Argon2Kdf>::create();
+    kdf->setRounds(2);
+    kdf->setMemory(1 << 10);
+    db.setKdf(kdf);
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+    QVERIFY(db.setKey(key, false, true));
+    QVERIFY(db.isTransformedKeyCurrent());
+
+    QByteArray seed = db.kdf()->seed();
+    QByteArray transformedKey = db.transformedMasterKey();
+
+    // saving doesn't derive the key again
+    QBuffer buffer;
+    buffer.open(QBuffer::ReadWrite);
+    KeePass2Writer writer;
+    QVERIFY(writer.writeDatabase(&buffer, &db));
+    QCOMPARE(db.kdf()->seed(), seed);
+    QCOMPARE(db.transformedMasterKey(), transformedKey);
+
+    buffer.seek(0);
+    KeePass2Reader reader;
+    QScopedPointer<Database> readDb(reader.readDatabase(&buffer, key));
+    QVERIFY(readDb);
+    QCOMPARE(readDb->transformedMasterKey(), transformedKey);
+
+    // neither does applying the same KDF parameters
+    QSharedPointer<Kdf> sameKdf = kdf->clone();
+    sameKdf->randomizeSeed();
+    QVERIFY(db.hasKdfParameters(sameKdf));
+    QVERIFY(db.changeKdf(sameKdf));
+    QCOMPARE(db.kdf()->seed(), seed);
+    QCOMPARE(db.transformedMasterKey(), transformedKey);
+
+    // changed parameters do
+    QSharedPointer<Kdf> newKdf = kdf->clone();
+    newKdf->setRounds(3);
+    QVERIFY(!db.hasKdfParameters(newKdf));
+    QVERIFY(db.changeKdf(newKdf));
+    QVERIFY(db.kdf()->seed() != seed);
+    QVERIFY(db.transformedMasterKey() != transformedKey);
+    QVERIFY(db.isTransformedKeyCurrent());
+
+    // as do parameters changed in place, on the next save
+    seed = db.kdf()->seed();
+    transformedKey = db.transformedMasterKey();
+    db.kdf()->setRounds(4);
+    QVERIFY(!db.isTransformedKeyCurrent());
+    buffer.seek(0);
+    QVERIFY(writer.writeDatabase(&buffer, &db));
+    QVERIFY(db.isTransformedKeyCurrent());
+    QVERIFY(db.kdf()->seed() != seed);
+    QVERIFY(db.transformedMasterKey() != transformedKey);
+}
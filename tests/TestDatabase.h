@@ -31,6 +31,12 @@ private slots:
     void testEmptyRecycleBinOnNotCreated();
     void testEmptyRecycleBinOnEmpty();
     void testEmptyRecycleBinWithHierarchicalData();
+    void testSnapshot();
+    void testSaveToFileAsync();
+    void testDatabaseLoader();
+    void testDatabaseLoaderMemoryBudget();
+    void testQuickUnlock();
+    void testTransformedKeyReuse();
 };
 
 #endif // KEEPASSX_TESTDATABASE_H
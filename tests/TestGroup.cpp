@@ -740,3 +740,50 @@ void TestGroup::testAddEntryWithPath()
 
     delete db;
 }
+
+void TestGroup::testIsRecycled()
+{
+    Database* db = new Database();
+    db->metadata()->setRecycleBinEnabled(true);
+
+    Group* group1 = new Group();
+    group1->setName("group1");
+    group1->setParent(db->rootGroup());
+
+    Group* group2 = new Group();
+    group2->setName("group2");
+    group2->setParent(group1);
+
+    Entry* entry1 = new Entry();
+    entry1->setTitle("entry1");
+    entry1->setGroup(group2);
+
+    Entry* entry2 = new Entry();
+    entry2->setTitle("entry2");
+    entry2->setGroup(db->rootGroup());
+
+    QVERIFY(!db->rootGroup()->isRecycled());
+    QVERIFY(!group2->isRecycled());
+    QVERIFY(!entry1->isRecycled());
+
+    db->recycleEntry(entry2);
+    QVERIFY(db->metadata()->recycleBin()->isRecycled());
+    QVERIFY(entry2->isRecycled());
+    QVERIFY(!entry1->isRecycled());
+
+    // everything below a recycled group counts as recycled
+    db->recycleGroup(group1);
+    QVERIFY(group1->isRecycled());
+    QVERIFY(group2->isRecycled());
+    QVERIFY(entry1->isRecycled());
+
+    group2->setParent(db->rootGroup());
+    QVERIFY(!group2->isRecycled());
+    QVERIFY(!entry1->isRecycled());
+
+    Entry* orphan = new Entry();
+    QVERIFY(!orphan->isRecycled());
+    delete orphan;
+
+    delete db;
+}
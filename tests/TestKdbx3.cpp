@@ -18,6 +18,8 @@
 #include "TestKdbx3.h"
 #include "TestGlobal.h"
 
+#include <QXmlStreamReader>
+
 #include "config-keepassx-tests.h"
 #include "core/Metadata.h"
 #include "format/KdbxXmlReader.h"
@@ -212,3 +214,47 @@ void TestKdbx3::testKdbxRepair()
     QCOMPARE(dbRepaired->rootGroup()->entries().at(0)->username(), QString("testuser").append(QChar(0x20AC)));
     QCOMPARE(dbRepaired->rootGroup()->entries().at(0)->password(), QString("testpw"));
 }
+
+void TestKdbx3::testBinariesOrder()
+{
+    QScopedPointer<Database> db(new Database());
+    db->setCompressionAlgo(Database::CompressionGZip);
+
+    const int count = 100;
+    for (int i = 0; i < count; ++i) {
+        auto entry = new Entry();
+        entry->setGroup(db->rootGroup());
+        entry->attachments()->set("file.bin", QByteArray(i * 1024 + 1, static_cast<char>('a' + i % 26)));
+    }
+
+    QBuffer buffer;
+    buffer.open(QBuffer::ReadWrite);
+    bool hasError;
+    QString errorString;
+    writeXml(&buffer, db.data(), hasError, errorString);
+    QVERIFY(!hasError);
+
+    // the <Binary> elements must be written in ID order
+    buffer.seek(0);
+    QXmlStreamReader xml(&buffer);
+    int nextId = 0;
+    while (!xml.atEnd()) {
+        if (xml.readNext() == QXmlStreamReader::StartElement && xml.name() == "Binary") {
+            QCOMPARE(xml.attributes().value("ID").toString().toInt(), nextId++);
+            QCOMPARE(xml.attributes().value("Compressed").toString(), QString("True"));
+        }
+    }
+    QVERIFY(!xml.hasError());
+    QCOMPARE(nextId, count);
+
+    buffer.seek(0);
+    QScopedPointer<Database> dbRead(readXml(&buffer, true, hasError, errorString));
+    QVERIFY(!hasError);
+    QVERIFY(dbRead);
+    const QList<Entry*> entries = dbRead->rootGroup()->entries();
+    QCOMPARE(entries.size(), count);
+    for (int i = 0; i < count; ++i) {
+        QCOMPARE(entries[i]->attachments()->value("file.bin"),
+                 QByteArray(i * 1024 + 1, static_cast<char>('a' + i % 26)));
+    }
+}
@@ -31,6 +31,7 @@ private slots:
     void testBrokenHeaderHash();
     void testFormat300();
     void testKdbxRepair();
+    void testBinariesOrder();
 
 protected:
     void initTestCaseImpl() override;
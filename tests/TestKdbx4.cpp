@@ -23,6 +23,7 @@
 #include "format/KdbxXmlReader.h"
 #include "format/KdbxXmlWriter.h"
 #include "format/KeePass2.h"
+#include "format/KeePass2RandomStream.h"
 #include "format/KeePass2Reader.h"
 #include "format/KeePass2Writer.h"
 #include "keys/FileKey.h"
@@ -426,3 +427,149 @@ QSharedPointer<Kdf> TestKdbx4::fastKdf(QSharedPointer<Kdf> kdf)
 
     return kdf;
 }
+
+namespace
+{
+    void populateDatabase(Database* db, int groupCount, int entriesPerGroup)
+    {
+        db->metadata()->setProtectNotes(true);
+
+        for (int g = 0; g < groupCount; ++g) {
+            auto* group = new Group();
+            group->setUuid(QUuid::createUuid());
+            group->setName(QString("Group %1").arg(g));
+            group->setParent(g % 2 == 0 ? db->rootGroup() : db->rootGroup()->children().last());
+
+            for (int e = 0; e < entriesPerGroup; ++e) {
+                auto* entry = new Entry();
+                entry->setUuid(QUuid::createUuid());
+                entry->setGroup(group);
+                entry->setTitle(QString("Entry %1/%2").arg(g).arg(e));
+                entry->setUsername(QString("user%1").arg(e));
+                entry->setPassword(QString("pässwörd-%1-%2").arg(g).arg(e));
+                if (e % 3 == 0) {
+                    entry->setNotes(QString("line 1\nline 2 of entry %1").arg(e));
+                }
+                if (e % 10 == 0) {
+                    entry->attributes()->set("Secret", QString("secret %1").arg(e), true);
+                    QScopedPointer<Entry> historyItem(entry->clone(Entry::CloneNoFlags));
+                    historyItem->setPassword(QString("old password %1").arg(e));
+                    entry->addHistoryItem(historyItem.take());
+                }
+            }
+        }
+    }
+} // namespace
+
+void TestKdbx4::testParallelXmlWriter()
+{
+    const int groupCount = 50;
+    const int entriesPerGroup = 1000;
+    Database db;
+    populateDatabase(&db, groupCount, entriesPerGroup);
+    QCOMPARE(db.rootGroup()->entriesRecursive().size(), groupCount * entriesPerGroup);
+
+    const QByteArray streamKey = QByteArray(64, '\x42');
+
+    QBuffer sequentialBuffer;
+    sequentialBuffer.open(QBuffer::ReadWrite);
+    KeePass2RandomStream sequentialStream(KeePass2::ProtectedStreamAlgo::ChaCha20);
+    QVERIFY(sequentialStream.init(streamKey));
+    KdbxXmlWriter sequentialWriter(KeePass2::FILE_VERSION_4);
+    sequentialWriter.setParallel(false);
+    sequentialWriter.writeDatabase(&sequentialBuffer, &db, &sequentialStream);
+    QVERIFY(!sequentialWriter.hasError());
+
+    QBuffer parallelBuffer;
+    parallelBuffer.open(QBuffer::ReadWrite);
+    KeePass2RandomStream parallelStream(KeePass2::ProtectedStreamAlgo::ChaCha20);
+    QVERIFY(parallelStream.init(streamKey));
+    KdbxXmlWriter parallelWriter(KeePass2::FILE_VERSION_4);
+    parallelWriter.writeDatabase(&parallelBuffer, &db, &parallelStream);
+    QVERIFY(!parallelWriter.hasError());
+
+    QCOMPARE(parallelBuffer.size(), sequentialBuffer.size());
+    QVERIFY(parallelBuffer.data() == sequentialBuffer.data());
+
+    parallelBuffer.seek(0);
+    KeePass2RandomStream readStream(KeePass2::ProtectedStreamAlgo::ChaCha20);
+    QVERIFY(readStream.init(streamKey));
+    Database readDb;
+    KdbxXmlReader reader(KeePass2::FILE_VERSION_4);
+    reader.readDatabase(&parallelBuffer, &readDb, &readStream);
+    QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+
+    const QList<Entry*> entries = db.rootGroup()->entriesRecursive();
+    const QList<Entry*> readEntries = readDb.rootGroup()->entriesRecursive();
+    QCOMPARE(readEntries.size(), entries.size());
+    for (int i = 0; i < entries.size(); ++i) {
+        QCOMPARE(readEntries[i]->uuid(), entries[i]->uuid());
+        QCOMPARE(readEntries[i]->password(), entries[i]->password());
+        QCOMPARE(readEntries[i]->notes(), entries[i]->notes());
+        QCOMPARE(readEntries[i]->attributes()->value("Secret"), entries[i]->attributes()->value("Secret"));
+        QCOMPARE(readEntries[i]->historyItems().size(), entries[i]->historyItems().size());
+        if (!entries[i]->historyItems().isEmpty()) {
+            QCOMPARE(readEntries[i]->historyItems().first()->password(),
+                     entries[i]->historyItems().first()->password());
+        }
+    }
+}
+
+void TestKdbx4::benchmarkStripInvalidXml10Chars()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QStringList strings;
+    for (int i = 0; i < 1000; ++i) {
+        strings << QString("Security questions:\r\n\tFirst pet: Rex\r\n\tCity of birth: Zürich\r\n"
+                           "Recovery codes %1 %2 %3 — keep in a safe place.")
+                       .arg(i * 7919)
+                       .arg(i * 104729)
+                       .arg(i * 1299709);
+        strings << QString("scan_2018-03-%1 Lohnabrechnung Gehaltsübersicht.pdf").arg(i % 31 + 1);
+        strings << QString("id_ed25519_%1.pub").arg(i);
+    }
+
+    QBENCHMARK
+    {
+        for (const QString& str : strings) {
+            Q_UNUSED(KdbxXmlWriter::stripInvalidXml10Chars(str));
+        }
+    };
+}
+
+void TestKdbx4::benchmarkXmlReader()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    Database db;
+    populateDatabase(&db, 20, 1000);
+
+    const QByteArray streamKey = QByteArray(64, '\x42');
+    QBuffer buffer;
+    buffer.open(QBuffer::ReadWrite);
+    KeePass2RandomStream writeStream(KeePass2::ProtectedStreamAlgo::ChaCha20);
+    QVERIFY(writeStream.init(streamKey));
+    KdbxXmlWriter writer(KeePass2::FILE_VERSION_4);
+    writer.writeDatabase(&buffer, &db, &writeStream);
+    QVERIFY(!writer.hasError());
+
+    QBENCHMARK
+    {
+        buffer.seek(0);
+        KeePass2RandomStream readStream(KeePass2::ProtectedStreamAlgo::ChaCha20);
+        QVERIFY(readStream.init(streamKey));
+        Database readDb;
+        KdbxXmlReader reader(KeePass2::FILE_VERSION_4);
+        reader.readDatabase(&buffer, &readDb, &readStream);
+        QVERIFY(!reader.hasError());
+    };
+}
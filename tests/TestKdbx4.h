@@ -31,6 +31,9 @@ private slots:
     void testUpgradeMasterKeyIntegrity();
     void testUpgradeMasterKeyIntegrity_data();
     void testCustomData();
+    void testParallelXmlWriter();
+    void benchmarkStripInvalidXml10Chars();
+    void benchmarkXmlReader();
 
 protected:
     void initTestCaseImpl() override;
@@ -0,0 +1,180 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestKdbxXmlTokenizer.h"
+#include "TestGlobal.h"
+
+#include "format/KdbxXmlTokenizer.h"
+
+QTEST_GUILESS_MAIN(TestKdbxXmlTokenizer)
+
+typedef KdbxXmlTokenizer::Tag Tag;
+typedef KdbxXmlTokenizer::Attribute Attribute;
+typedef KdbxXmlTokenizer::TokenType TokenType;
+
+void TestKdbxXmlTokenizer::testElements()
+{
+    KdbxXmlTokenizer xml;
+    xml.setData("\xEF\xBB\xBF<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\"?>\n"
+                "<!-- comment --><KeePassFile><Meta><Generator>KeePassXC</Generator></Meta>"
+                "<Root><Group><PreviousParentGroup/></Group></Root></KeePassFile>trailing");
+
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::KeePassFile);
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::Meta);
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::Generator);
+    QCOMPARE(xml.name(), QString("Generator"));
+    QCOMPARE(xml.readText(), QByteArray("KeePassXC"));
+    QCOMPARE(xml.tokenType(), TokenType::EndElement);
+    QVERIFY(!xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::Meta);
+
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::Root);
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::Group);
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::Unknown);
+    QCOMPARE(xml.name(), QString("PreviousParentGroup"));
+    QVERIFY(!xml.readNextStartElement());
+    QCOMPARE(xml.tokenType(), TokenType::EndElement);
+    QVERIFY(!xml.readNextStartElement());
+    QVERIFY(!xml.readNextStartElement());
+    QVERIFY(!xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::KeePassFile);
+
+    // nothing after the root element is read
+    QCOMPARE(xml.readNext(), TokenType::EndDocument);
+    QVERIFY(xml.atEnd());
+    QVERIFY(!xml.hasError());
+}
+
+void TestKdbxXmlTokenizer::testText()
+{
+    KdbxXmlTokenizer xml;
+    xml.setData("<Entry><Notes>a &lt;&gt;&amp;&quot;&apos; &#65;&#x20AC;<!-- c --><![CDATA[<b>&amp;]]>\r\nb\rc</Notes>"
+                "<Tags/><UUID></UUID><Key>\xC3\xBC</Key></Entry>");
+
+    QVERIFY(xml.readNextStartElement());
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::Notes);
+    QCOMPARE(QString::fromUtf8(xml.readText()), QString("a <>&\"' A€<b>&amp;\nb\nc"));
+
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::Tags);
+    QVERIFY(xml.readText().isEmpty());
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::UUID);
+    QVERIFY(xml.readText().isEmpty());
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(QString::fromUtf8(xml.readText()), QString("ü"));
+    QVERIFY(!xml.readNextStartElement());
+    QVERIFY(!xml.hasError());
+
+    xml.setData("<Value>a<Key/></Value>");
+    QVERIFY(xml.readNextStartElement());
+    xml.readText();
+    QVERIFY(xml.hasError());
+    QCOMPARE(xml.errorString(), QString("Expected character data."));
+}
+
+void TestKdbxXmlTokenizer::testAttributes()
+{
+    KdbxXmlTokenizer xml;
+    xml.setData("<Binaries><Binary ID='1' Compressed=\"True\" Other=\"x\"/>"
+                "<Value Protected = \"True\" Ref=\"a&amp;b\tc\r\nd\">x</Value><Value>y</Value></Binaries>");
+
+    QVERIFY(xml.readNextStartElement());
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::Binary);
+    QVERIFY(xml.hasAttribute(Attribute::ID));
+    QCOMPARE(xml.attribute(Attribute::ID), QByteArray("1"));
+    QCOMPARE(xml.attribute(Attribute::Compressed), QByteArray("True"));
+    QVERIFY(!xml.hasAttribute(Attribute::Protected));
+    QVERIFY(xml.readText().isEmpty());
+
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.attribute(Attribute::Protected), QByteArray("True"));
+    QCOMPARE(xml.attribute(Attribute::Ref), QByteArray("a&b c d"));
+    QVERIFY(!xml.hasAttribute(Attribute::ID));
+    QCOMPARE(xml.readText(), QByteArray("x"));
+
+    QVERIFY(xml.readNextStartElement());
+    QVERIFY(!xml.hasAttribute(Attribute::Protected));
+    QVERIFY(xml.attribute(Attribute::Protected).isEmpty());
+    QCOMPARE(xml.readText(), QByteArray("y"));
+    QVERIFY(!xml.hasError());
+}
+
+void TestKdbxXmlTokenizer::testSkipCurrentElement()
+{
+    KdbxXmlTokenizer xml;
+    xml.setData("<Root><History><Entry><String><Key>a</Key></String></Entry><Entry/></History><Group/></Root>");
+
+    QVERIFY(xml.readNextStartElement());
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::History);
+    xml.skipCurrentElement();
+    QCOMPARE(xml.tokenType(), TokenType::EndElement);
+    QCOMPARE(xml.tag(), Tag::History);
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::Group);
+    xml.skipCurrentElement();
+    QVERIFY(!xml.readNextStartElement());
+    QCOMPARE(xml.tag(), Tag::Root);
+    QVERIFY(!xml.hasError());
+}
+
+void TestKdbxXmlTokenizer::testInvalidDocuments()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, line);
+
+    KdbxXmlTokenizer xml;
+    xml.setData(data);
+    while (!xml.atEnd()) {
+        if (xml.readNext() == TokenType::StartElement && xml.tag() == Tag::Value) {
+            xml.readText();
+        }
+    }
+
+    QVERIFY(xml.hasError());
+    QVERIFY(!xml.errorString().isEmpty());
+    QCOMPARE(xml.lineNumber(), static_cast<qint64>(line));
+}
+
+void TestKdbxXmlTokenizer::testInvalidDocuments_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("line");
+
+    QTest::newRow("Empty") << QByteArray() << 1;
+    QTest::newRow("Premature end") << QByteArray("<Root>\n<Group>") << 2;
+    QTest::newRow("Tag mismatch") << QByteArray("<Root>\n<Group></Entry></Root>") << 2;
+    QTest::newRow("Control character") << QByteArray("<Root>\n<Value>a\x10</Value></Root>") << 2;
+    QTest::newRow("Invalid character reference") << QByteArray("<Root><Value>&#16;</Value></Root>") << 1;
+    QTest::newRow("Unknown entity") << QByteArray("<Root><Value>&nbsp;</Value></Root>") << 1;
+    QTest::newRow("Unterminated reference") << QByteArray("<Root><Value>&amp</Value></Root>") << 1;
+    QTest::newRow("Duplicate attribute") << QByteArray("<Root><Value Protected=\"1\" Protected=\"1\"/></Root>") << 1;
+    QTest::newRow("Unquoted attribute") << QByteArray("<Root><Value Protected=1/></Root>") << 1;
+    QTest::newRow("Invalid name") << QByteArray("<Root>\n\n<1Value/></Root>") << 3;
+    QTest::newRow("Text before root") << QByteArray("text<Root/>") << 1;
+    QTest::newRow("Doctype") << QByteArray("<!DOCTYPE Root [<!ENTITY a \"b\">]><Root/>") << 1;
+    QTest::newRow("Encoding") << QByteArray("<?xml version=\"1.0\" encoding=\"UTF-16\"?><Root/>") << 1;
+}
@@ -21,6 +21,7 @@
 #include "core/Metadata.h"
 #include "crypto/Crypto.h"
 #include "format/KdbxXmlReader.h"
+#include "format/KdbxXmlWriter.h"
 #include "keys/PasswordKey.h"
 
 #include "FailDevice.h"
@@ -465,6 +466,10 @@ void TestKeePass2Format::testXmlInvalidXmlChars()
     QCOMPARE(attrRead->value("LowLowSurrogate"), QString());
     QCOMPARE(attrRead->value("SurrogateValid1"), strSurrogateValid1);
     QCOMPARE(attrRead->value("SurrogateValid2"), strSurrogateValid2);
+
+    // clean strings are passed through without a copy
+    QCOMPARE(KdbxXmlWriter::stripInvalidXml10Chars(strPlainValid).constData(), strPlainValid.constData());
+    QCOMPARE(KdbxXmlWriter::stripInvalidXml10Chars(strSurrogateValid2).constData(), strSurrogateValid2.constData());
 }
 
 void TestKeePass2Format::testXmlRepairUuidHistoryItem()
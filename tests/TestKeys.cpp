@@ -20,19 +20,29 @@
 #include "TestGlobal.h"
 
 #include <QBuffer>
+#include <QTemporaryFile>
 
 #include "config-keepassx-tests.h"
 
+#include "core/Database.h"
 #include "core/Metadata.h"
 #include "crypto/Crypto.h"
 #include "crypto/CryptoHash.h"
+#include "crypto/Random.h"
+#include "crypto/SymmetricCipher.h"
 #include "crypto/kdf/AesKdf.h"
+#include "crypto/kdf/Argon2Kdf.h"
+#include "crypto/kdf/KdfCalibrator.h"
 #include "format/KeePass2Reader.h"
 #include "format/KeePass2Writer.h"
 #include "keys/FileKey.h"
 #include "keys/PasswordKey.h"
 #include "mock/MockChallengeResponseKey.h"
 
+#ifdef Q_OS_UNIX
+#include <utime.h>
+#endif
+
 QTEST_GUILESS_MAIN(TestKeys)
 Q_DECLARE_METATYPE(FileKey::Type);
 
@@ -210,6 +220,80 @@ void TestKeys::testFileKeyError()
     errorMsg = "";
 }
 
+void TestKeys::testLargeFileKey()
+{
+    FileKey::clearCache();
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QByteArray data = randomGen()->randomArray(3 * 1024 * 1024 + 17);
+    data[0] = '<';
+    QCOMPARE(file.write(data), static_cast<qint64>(data.size()));
+    file.close();
+
+#ifdef Q_OS_UNIX
+    struct utimbuf times;
+    times.actime = 1000000000;
+    times.modtime = 1000000000;
+    QCOMPARE(::utime(QFile::encodeName(file.fileName()).constData(), &times), 0);
+#endif
+
+    FileKey fileKey;
+    QVERIFY(fileKey.load(file.fileName()));
+    QCOMPARE(fileKey.type(), FileKey::Hashed);
+    QCOMPARE(fileKey.rawKey(), CryptoHash::hash(data, CryptoHash::Sha256));
+
+    // loaded again from the cache
+    FileKey cachedFileKey;
+    QVERIFY(cachedFileKey.load(file.fileName()));
+    QCOMPARE(cachedFileKey.type(), FileKey::Hashed);
+    QCOMPARE(cachedFileKey.rawKey(), fileKey.rawKey());
+
+#ifdef Q_OS_UNIX
+    // the file is not read again while its size, modification time and inode are unchanged,
+    // so content rewritten in place with the old modification time still yields the cached key
+    QVERIFY(file.open());
+    QVERIFY(file.seek(1));
+    data[1] = static_cast<char>(~data[1]);
+    QCOMPARE(file.write(data.mid(1, 1)), qint64(1));
+    file.close();
+    QCOMPARE(::utime(QFile::encodeName(file.fileName()).constData(), &times), 0);
+
+    FileKey staleFileKey;
+    QVERIFY(staleFileKey.load(file.fileName()));
+    QCOMPARE(staleFileKey.rawKey(), fileKey.rawKey());
+
+    // a new modification time alone makes it hash the file again
+    times.modtime += 10;
+    QCOMPARE(::utime(QFile::encodeName(file.fileName()).constData(), &times), 0);
+
+    FileKey touchedFileKey;
+    QVERIFY(touchedFileKey.load(file.fileName()));
+    QCOMPARE(touchedFileKey.rawKey(), CryptoHash::hash(data, CryptoHash::Sha256));
+    QVERIFY(touchedFileKey.rawKey() != fileKey.rawKey());
+#endif
+
+    // a modified file is hashed again
+    QVERIFY(file.open());
+    QVERIFY(file.seek(data.size()));
+    QCOMPARE(file.write("modified"), qint64(8));
+    file.close();
+    data.append("modified");
+
+    FileKey modifiedFileKey;
+    QVERIFY(modifiedFileKey.load(file.fileName()));
+    QCOMPARE(modifiedFileKey.rawKey(), CryptoHash::hash(data, CryptoHash::Sha256));
+
+    // devices that can't be mapped are read in chunks
+    QBuffer buffer(&data);
+    buffer.open(QBuffer::ReadOnly);
+    FileKey bufferFileKey;
+    QVERIFY(bufferFileKey.load(&buffer));
+    QCOMPARE(bufferFileKey.rawKey(), modifiedFileKey.rawKey());
+
+    FileKey::clearCache();
+}
+
 void TestKeys::benchmarkTransformKey()
 {
     QByteArray env = qgetenv("BENCHMARK");
@@ -236,6 +320,33 @@ void TestKeys::benchmarkTransformKey()
     };
 }
 
+void TestKeys::benchmarkVerifyKey()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    CompositeKey compositeKey;
+    compositeKey.addKey(PasswordKey("password"));
+    FileKey fileKey;
+    QVERIFY(fileKey.load(QString("%1/%2").arg(QString(KEEPASSX_TEST_DATA_DIR), "FileKeyHashed.key")));
+    compositeKey.addKey(fileKey);
+
+    Database db;
+    db.kdf()->setRounds(1);
+    QVERIFY(db.setKey(compositeKey));
+
+    CompositeKey otherKey = compositeKey;
+    bool verified = false;
+    QBENCHMARK
+    {
+        verified = db.verifyKey(otherKey);
+    };
+    QVERIFY(verified);
+}
+
 void TestKeys::testCompositeKeyComponents()
 {
     PasswordKey passwordKeyEnc("password");
@@ -317,3 +428,110 @@ void TestKeys::testCompositeKeyComponents()
     db2.reset(reader.readDatabase(&buffer, compositeKeyDec4));
     QVERIFY(reader.hasError());
 }
+
+void TestKeys::testCompositeKeyMatches()
+{
+    CompositeKey empty;
+    QCOMPARE(empty.rawKey(), CryptoHash::hash(QByteArray(), CryptoHash::Sha256));
+
+    PasswordKey passwordKey("password");
+    CompositeKey compositeKey1;
+    compositeKey1.addKey(passwordKey);
+    QCOMPARE(compositeKey1.rawKey(), CryptoHash::hash(passwordKey.rawKey(), CryptoHash::Sha256));
+    QCOMPARE(compositeKey1.rawKey(nullptr), compositeKey1.rawKey());
+
+    CompositeKey compositeKey2(compositeKey1);
+    QVERIFY(compositeKey1.matches(compositeKey2));
+    QVERIFY(!compositeKey1.matches(empty));
+
+    // the cached raw key follows added components without changing copies
+    compositeKey2.addKey(PasswordKey("other"));
+    QVERIFY(!compositeKey1.matches(compositeKey2));
+    QCOMPARE(compositeKey1.rawKey(), CryptoHash::hash(passwordKey.rawKey(), CryptoHash::Sha256));
+    QCOMPARE(compositeKey2.rawKey(),
+             CryptoHash::hash(passwordKey.rawKey() + PasswordKey("other").rawKey(), CryptoHash::Sha256));
+
+    compositeKey2.clear();
+    QVERIFY(compositeKey2.matches(empty));
+    compositeKey2 = compositeKey1;
+    QVERIFY(compositeKey2.matches(compositeKey1));
+
+    // assigning over a cached raw key replaces it
+    CompositeKey compositeKey3;
+    compositeKey3.addKey(PasswordKey("other"));
+    compositeKey3 = compositeKey1;
+    QVERIFY(compositeKey3.matches(compositeKey1));
+    compositeKey3.addKey(PasswordKey("other"));
+    QCOMPARE(compositeKey3.rawKey(),
+             CryptoHash::hash(passwordKey.rawKey() + PasswordKey("other").rawKey(), CryptoHash::Sha256));
+    compositeKey3 = empty;
+    QVERIFY(compositeKey3.isEmpty());
+    QVERIFY(compositeKey3.matches(empty));
+
+    Database db;
+    db.kdf()->setRounds(1);
+    QVERIFY(db.setKey(compositeKey1));
+    QVERIFY(db.verifyKey(compositeKey2));
+    QVERIFY(!db.verifyKey(empty));
+}
+
+void TestKeys::testKdfCalibration()
+{
+    KdfCalibrator aesCalibrator(QSharedPointer<AesKdf>::create());
+    aesCalibrator.setSampleCount(3);
+    KdfCalibrator::Result result = aesCalibrator.calibrate(100);
+    QVERIFY(result.isValid());
+    QVERIFY(result.rounds > 1);
+    QCOMPARE(result.samples, 3);
+    QCOMPARE(result.parallelism, quint32(0));
+    QVERIFY(result.expectedMsec > 0.0);
+    QVERIFY(result.errorMsec >= 0.0);
+
+    auto argon2Kdf = QSharedPointer<Argon2Kdf>::create();
+    argon2Kdf->setMemory(1024);
+    argon2Kdf->setParallelism(1);
+
+    KdfCalibrator argon2Calibrator(argon2Kdf);
+    result = argon2Calibrator.calibrate(100);
+    QVERIFY(result.isValid());
+    QCOMPARE(result.samples, KdfCalibrator::DefaultSampleCount);
+    QCOMPARE(result.parallelism, quint32(1));
+
+    argon2Calibrator.setChooseParallelism(true);
+    result = argon2Calibrator.calibrate(100);
+    QVERIFY(result.isValid());
+    QCOMPARE(result.parallelism, KdfCalibrator::idealParallelism());
+    // the calibration works on a copy
+    QCOMPARE(argon2Kdf->parallelism(), quint32(1));
+    QCOMPARE(argon2Kdf->rounds(), 1);
+}
+
+void TestKeys::testAesKdfTransform()
+{
+    QByteArray seed(32, '\0');
+    QByteArray raw(32, '\0');
+    for (int i = 0; i < 32; ++i) {
+        seed[i] = static_cast<char>(i * 7 + 1);
+        raw[i] = static_cast<char>(i * 13 + 5);
+    }
+
+    AesKdf kdf;
+    QVERIFY(kdf.setSeed(seed));
+    QVERIFY(kdf.setRounds(3));
+    QByteArray result;
+    QVERIFY(kdf.transform(raw, result));
+    QCOMPARE(result.toHex(), QByteArray("752b0fd217e8b8abec6d7ecf72735bd8daaf7896a28ea7f98729de322d1fda07"));
+
+    // the native kernel has to match libgcrypt
+    const int rounds = 10000;
+    SymmetricCipher cipher(SymmetricCipher::Aes256, SymmetricCipher::Ecb, SymmetricCipher::Encrypt);
+    QVERIFY(cipher.init(seed, QByteArray(16, 0)));
+    QByteArray left = raw.left(16);
+    QByteArray right = raw.right(16);
+    QVERIFY(cipher.processInPlace(left, rounds));
+    QVERIFY(cipher.processInPlace(right, rounds));
+
+    QVERIFY(kdf.setRounds(rounds));
+    QVERIFY(kdf.transform(raw, result));
+    QCOMPARE(result, CryptoHash::hash(left + right, CryptoHash::Sha256));
+}
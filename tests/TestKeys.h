@@ -34,8 +34,13 @@ private slots:
     void testCreateAndOpenFileKey();
     void testFileKeyHash();
     void testFileKeyError();
+    void testLargeFileKey();
     void testCompositeKeyComponents();
+    void testCompositeKeyMatches();
+    void testKdfCalibration();
+    void testAesKdfTransform();
     void benchmarkTransformKey();
+    void benchmarkVerifyKey();
 };
 
 #endif // KEEPASSX_TESTKEYS_H
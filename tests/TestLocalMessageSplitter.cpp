@@ -0,0 +1,101 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestLocalMessageSplitter.h"
+#include "TestGlobal.h"
+
+#include "browser/LocalMessageSplitter.h"
+
+QTEST_GUILESS_MAIN(TestLocalMessageSplitter)
+
+void TestLocalMessageSplitter::testSingleMessage()
+{
+    LocalMessageSplitter splitter(1024);
+    splitter.append("{\"action\":\"get-logins\",\"nonce\":\"abc\"}");
+
+    QByteArray message;
+    QVERIFY(splitter.takeMessage(message));
+    QCOMPARE(message, QByteArray("{\"action\":\"get-logins\",\"nonce\":\"abc\"}"));
+    QVERIFY(!splitter.takeMessage(message));
+    QVERIFY(!splitter.hasError());
+}
+
+void TestLocalMessageSplitter::testConsecutiveMessages()
+{
+    LocalMessageSplitter splitter(1024);
+    splitter.append("{\"action\":\"a\"}{\"action\":\"b\",\"list\":[{},[]]}\n [1,2] {\"action\":\"c\"}");
+
+    QByteArray message;
+    QVERIFY(splitter.takeMessage(message));
+    QCOMPARE(message, QByteArray("{\"action\":\"a\"}"));
+    QVERIFY(splitter.takeMessage(message));
+    QCOMPARE(message, QByteArray("{\"action\":\"b\",\"list\":[{},[]]}"));
+    QVERIFY(splitter.takeMessage(message));
+    QCOMPARE(message, QByteArray("[1,2]"));
+    QVERIFY(splitter.takeMessage(message));
+    QCOMPARE(message, QByteArray("{\"action\":\"c\"}"));
+    QVERIFY(!splitter.takeMessage(message));
+    QVERIFY(!splitter.hasError());
+}
+
+void TestLocalMessageSplitter::testPartialMessages()
+{
+    // brackets and escaped quotes inside strings don't end a message
+    const QByteArray data("{\"message\":\"}{ \\\"]\\\\\"}{\"action\":\"x\"}");
+
+    LocalMessageSplitter splitter(1024);
+    QList<QByteArray> messages;
+    for (int i = 0; i < data.size(); ++i) {
+        splitter.append(data.mid(i, 1));
+        QByteArray message;
+        while (splitter.takeMessage(message)) {
+            messages << message;
+        }
+    }
+
+    QCOMPARE(messages.size(), 2);
+    QCOMPARE(messages[0], QByteArray("{\"message\":\"}{ \\\"]\\\\\"}"));
+    QCOMPARE(messages[1], QByteArray("{\"action\":\"x\"}"));
+    QVERIFY(!splitter.hasError());
+}
+
+void TestLocalMessageSplitter::testInvalidData()
+{
+    LocalMessageSplitter splitter(1024);
+    splitter.append("{\"action\":\"a\"}garbage{\"action\":\"b\"}");
+
+    QByteArray message;
+    QVERIFY(splitter.takeMessage(message));
+    QVERIFY(!splitter.takeMessage(message));
+    QVERIFY(splitter.hasError());
+
+    splitter.clear();
+    QVERIFY(!splitter.hasError());
+    splitter.append("{}");
+    QVERIFY(splitter.takeMessage(message));
+    QCOMPARE(message, QByteArray("{}"));
+}
+
+void TestLocalMessageSplitter::testMaxLength()
+{
+    LocalMessageSplitter splitter(16);
+    splitter.append("{\"message\":\"0123456789");
+
+    QByteArray message;
+    QVERIFY(!splitter.takeMessage(message));
+    QVERIFY(splitter.hasError());
+}
@@ -0,0 +1,210 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestNativeMessageFramer.h"
+#include "TestGlobal.h"
+
+#include <QtConcurrent>
+
+#include <csignal>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "browser/NativeMessageFramer.h"
+
+QTEST_GUILESS_MAIN(TestNativeMessageFramer)
+
+namespace
+{
+    const quint32 MaxLength = 1024 * 1024;
+
+    QByteArray frame(const QByteArray& message)
+    {
+        const quint32 length = static_cast<quint32>(message.size());
+        return QByteArray(reinterpret_cast<const char*>(&length), 4) + message;
+    }
+
+    bool writeAll(int fd, const QByteArray& data)
+    {
+        const char* bytes = data.constData();
+        qint64 remaining = data.size();
+        while (remaining > 0) {
+            const auto written = ::write(fd, bytes, static_cast<size_t>(remaining));
+            if (written <= 0) {
+                return false;
+            }
+            bytes += written;
+            remaining -= written;
+        }
+        return true;
+    }
+} // namespace
+
+void TestNativeMessageFramer::initTestCase()
+{
+    // a failing reader closes its end while the writer may still be busy
+    signal(SIGPIPE, SIG_IGN);
+}
+
+void TestNativeMessageFramer::init()
+{
+    QCOMPARE(socketpair(AF_UNIX, SOCK_STREAM, 0, m_fds), 0);
+}
+
+void TestNativeMessageFramer::cleanup()
+{
+    ::close(m_fds[0]);
+    ::close(m_fds[1]);
+}
+
+void TestNativeMessageFramer::testReadMessages()
+{
+    QVERIFY(NativeMessageFramer::writeMessage(m_fds[1], "{\"action\":\"get-databasehash\"}"));
+    QVERIFY(NativeMessageFramer::writeMessage(m_fds[1], "{\"action\":\"test-associate\"}"));
+    ::shutdown(m_fds[1], SHUT_WR);
+
+    NativeMessageFramer framer(m_fds[0], MaxLength);
+    QByteArray message;
+    QCOMPARE(framer.readMessage(message), NativeMessageFramer::MessageRead);
+    QCOMPARE(message, QByteArray("{\"action\":\"get-databasehash\"}"));
+    QCOMPARE(framer.readMessage(message), NativeMessageFramer::MessageRead);
+    QCOMPARE(message, QByteArray("{\"action\":\"test-associate\"}"));
+    QCOMPARE(framer.readMessage(message), NativeMessageFramer::EndOfStream);
+}
+
+void TestNativeMessageFramer::testPartialReads()
+{
+    const QByteArray first(100000, 'a');
+    const QByteArray second("{\"action\":\"lock-database\"}");
+    const QByteArray stream = frame(first) + frame(second);
+
+    NativeMessageFramer framer(m_fds[0], MaxLength);
+    QList<QByteArray> messages;
+    QByteArray message;
+
+    // the header and the messages are split across several reads
+    for (int offset = 0; offset < stream.size(); offset += 3001) {
+        QVERIFY(writeAll(m_fds[1], stream.mid(offset, 3001)));
+        QCOMPARE(framer.readAvailable(), NativeMessageFramer::NeedMoreData);
+        while (framer.takeMessage(message)) {
+            messages.append(message);
+        }
+    }
+
+    QCOMPARE(messages.size(), 2);
+    QCOMPARE(messages[0], first);
+    QCOMPARE(messages[1], second);
+    QVERIFY(!framer.hasError());
+}
+
+void TestNativeMessageFramer::testTruncatedMessage()
+{
+    QVERIFY(writeAll(m_fds[1], frame("{\"action\":\"get-logins\"}").left(10)));
+    ::shutdown(m_fds[1], SHUT_WR);
+
+    NativeMessageFramer framer(m_fds[0], MaxLength);
+    QByteArray message;
+    QCOMPARE(framer.readMessage(message), NativeMessageFramer::EndOfStream);
+    QVERIFY(message.isEmpty());
+}
+
+void TestNativeMessageFramer::testInvalidLength()
+{
+    QVERIFY(writeAll(m_fds[1], frame(QByteArray(MaxLength + 1, 'x')).left(4096)));
+
+    NativeMessageFramer framer(m_fds[0], MaxLength);
+    QByteArray message;
+    QCOMPARE(framer.readMessage(message), NativeMessageFramer::Error);
+    QVERIFY(framer.hasError());
+    QVERIFY(!framer.takeMessage(message));
+}
+
+void TestNativeMessageFramer::testReplay()
+{
+    QVERIFY(replay(recordedSession(10)));
+}
+
+void TestNativeMessageFramer::benchmarkReplay()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    const QList<QByteArray> messages = recordedSession(1000);
+    QBENCHMARK
+    {
+        QVERIFY(replay(messages));
+    };
+}
+
+/**
+ * Messages in the shape a browser extension sends while filling in logins:
+ * key exchange, association checks and bursts of encrypted get-logins requests.
+ */
+QList<QByteArray> TestNativeMessageFramer::recordedSession(int rounds)
+{
+    const QString request("{\"action\":\"%1\",\"message\":\"%2\",\"nonce\":\"%3\",\"clientID\":\"%4\"}");
+    const QString nonce = QByteArray(24, '\x17').toBase64();
+    const QString clientId = QByteArray(24, '\x42').toBase64();
+
+    QList<QByteArray> messages;
+    messages << QString("{\"action\":\"change-public-keys\",\"publicKey\":\"%1\",\"nonce\":\"%2\",\"clientID\":\"%3\"}")
+                    .arg(QString(QByteArray(32, '\x01').toBase64()), nonce, clientId)
+                    .toUtf8();
+    for (int i = 0; i < rounds; ++i) {
+        const QString payload = QByteArray(64 + (i % 7) * 256, static_cast<char>(i)).toBase64();
+        messages << request.arg("test-associate", QByteArray(96, '\x02').toBase64(), nonce, clientId).toUtf8();
+        messages << request.arg("get-logins", payload, nonce, clientId).toUtf8();
+    }
+    // an occasional large message, such as a set-login with long notes
+    messages << request.arg("set-login", QByteArray(512 * 1024, 'n').toBase64(), nonce, clientId).toUtf8();
+    return messages;
+}
+
+bool TestNativeMessageFramer::replay(const QList<QByteArray>& messages)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return false;
+    }
+
+    const int writeFd = fds[1];
+    QFuture<bool> writer = QtConcurrent::run([writeFd, messages]() {
+        for (const QByteArray& message : messages) {
+            if (!NativeMessageFramer::writeMessage(writeFd, message)) {
+                return false;
+            }
+        }
+        return ::shutdown(writeFd, SHUT_WR) == 0;
+    });
+
+    NativeMessageFramer framer(fds[0], MaxLength);
+    QByteArray message;
+    int count = 0;
+    bool matches = true;
+    while (framer.readMessage(message) == NativeMessageFramer::MessageRead) {
+        matches = matches && count < messages.size() && message == messages[count];
+        ++count;
+    }
+
+    ::close(fds[0]);
+    const bool written = writer.result();
+    ::close(fds[1]);
+    return written && matches && count == messages.size() && !framer.hasError();
+}
@@ -0,0 +1,157 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestProxyRelay.h"
+#include "TestGlobal.h"
+
+#include <QtConcurrent>
+
+#include <csignal>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "browser/NativeMessageFramer.h"
+#include "proxy/ProxyRelay.h"
+
+QTEST_GUILESS_MAIN(TestProxyRelay)
+
+namespace
+{
+    const quint32 MaxLength = 1024 * 1024;
+
+    bool writeAll(int fd, const QByteArray& data)
+    {
+        const char* bytes = data.constData();
+        qint64 remaining = data.size();
+        while (remaining > 0) {
+            const auto written = ::write(fd, bytes, static_cast<size_t>(remaining));
+            if (written <= 0) {
+                return false;
+            }
+            bytes += written;
+            remaining -= written;
+        }
+        return true;
+    }
+
+    QByteArray readAll(int fd, int length)
+    {
+        QByteArray data(length, '\0');
+        int received = 0;
+        while (received < length) {
+            const auto bytesRead = ::read(fd, data.data() + received, static_cast<size_t>(length - received));
+            if (bytesRead <= 0) {
+                return data.left(received);
+            }
+            received += static_cast<int>(bytesRead);
+        }
+        return data;
+    }
+
+    QFuture<bool> startRelay(int inFd, int outFd, int socketFd)
+    {
+        return QtConcurrent::run([inFd, outFd, socketFd]() {
+            ProxyRelay relay(inFd, outFd, socketFd, MaxLength);
+            return relay.run();
+        });
+    }
+} // namespace
+
+void TestProxyRelay::initTestCase()
+{
+    signal(SIGPIPE, SIG_IGN);
+}
+
+// stdin and stdout are pipes like the ones browsers set up, KeePassXC is the other end of a socket pair
+void TestProxyRelay::init()
+{
+    QCOMPARE(pipe(m_stdin), 0);
+    QCOMPARE(pipe(m_stdout), 0);
+    QCOMPARE(socketpair(AF_UNIX, SOCK_STREAM, 0, m_socket), 0);
+}
+
+void TestProxyRelay::cleanup()
+{
+    for (int fd : {m_stdin[0], m_stdin[1], m_stdout[0], m_stdout[1], m_socket[0], m_socket[1]}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+void TestProxyRelay::testIsSupported()
+{
+    QVERIFY(ProxyRelay::isSupported(m_stdin[0], m_stdout[1]));
+    QVERIFY(!ProxyRelay::isSupported(m_socket[0], m_stdout[1]));
+    QVERIFY(!ProxyRelay::isSupported(m_stdin[0], m_socket[0]));
+}
+
+void TestProxyRelay::testRelayFromBrowser()
+{
+    QFuture<bool> relay = startRelay(m_stdin[0], m_stdout[1], m_socket[0]);
+
+    // KeePassXC gets the bare messages
+    const QByteArray first("{\"action\":\"get-databasehash\"}");
+    const QByteArray second("{\"action\":\"test-associate\"}");
+    QVERIFY(NativeMessageFramer::writeMessage(m_stdin[1], first));
+    QVERIFY(NativeMessageFramer::writeMessage(m_stdin[1], second));
+    QCOMPARE(readAll(m_socket[1], first.size() + second.size()), first + second);
+
+    closeKeePassXC();
+    QVERIFY(relay.result());
+}
+
+void TestProxyRelay::testRelayToBrowser()
+{
+    QFuture<bool> relay = startRelay(m_stdin[0], m_stdout[1], m_socket[0]);
+
+    const QByteArray first("{\"action\":\"get-databasehash\",\"hash\":\"29234e32274a32276e25666a42\"}");
+    const QByteArray second("{\"action\":\"test-associate\",\"message\":\"{not a brace}\"}");
+    const QByteArray third("{\"action\":\"get-logins\",\"message\":\"" + QByteArray(100000, 'a') + "\"}");
+
+    // two replies arrive at once, followed by the start of a third one
+    QVERIFY(writeAll(m_socket[1], first + second + third.left(1000)));
+
+    NativeMessageFramer framer(m_stdout[0], MaxLength);
+    QByteArray message;
+    QCOMPARE(framer.readMessage(message), NativeMessageFramer::MessageRead);
+    QCOMPARE(message, first);
+    QCOMPARE(framer.readMessage(message), NativeMessageFramer::MessageRead);
+    QCOMPARE(message, second);
+
+    // the third reply is only framed once it is complete
+    QVERIFY(writeAll(m_socket[1], third.mid(1000)));
+    QCOMPARE(framer.readMessage(message), NativeMessageFramer::MessageRead);
+    QCOMPARE(message, third);
+
+    closeKeePassXC();
+    QVERIFY(relay.result());
+}
+
+void TestProxyRelay::testInvalidReply()
+{
+    QFuture<bool> relay = startRelay(m_stdin[0], m_stdout[1], m_socket[0]);
+
+    QVERIFY(writeAll(m_socket[1], "not json"));
+    QVERIFY(!relay.result());
+}
+
+void TestProxyRelay::closeKeePassXC()
+{
+    ::close(m_socket[1]);
+    m_socket[1] = -1;
+}
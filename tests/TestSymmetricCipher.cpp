@@ -27,11 +27,39 @@
 
 QTEST_GUILESS_MAIN(TestSymmetricCipher)
 
+Q_DECLARE_METATYPE(SymmetricCipher::Backend)
+Q_DECLARE_METATYPE(SymmetricCipher::Algorithm)
+Q_DECLARE_METATYPE(SymmetricCipher::Mode)
+Q_DECLARE_METATYPE(SymmetricCipher::Direction)
+
+void TestSymmetricCipher::initTestCase_data()
+{
+    // every test runs once per backend, ciphers a backend lacks fall back to libgcrypt
+    QTest::addColumn<SymmetricCipher::Backend>("backend");
+
+    QTest::newRow("gcrypt") << SymmetricCipher::GcryptBackend;
+    QTest::newRow("aesni") << SymmetricCipher::AesNiBackend;
+}
+
 void TestSymmetricCipher::initTestCase()
 {
     QVERIFY(Crypto::init());
 }
 
+void TestSymmetricCipher::init()
+{
+    QFETCH_GLOBAL(SymmetricCipher::Backend, backend);
+    if (!SymmetricCipher::isBackendAvailable(backend, SymmetricCipher::Aes256, SymmetricCipher::Cbc)) {
+        QSKIP("Cipher backend is not supported on this system.");
+    }
+    SymmetricCipher::setBackend(backend);
+}
+
+void TestSymmetricCipher::cleanup()
+{
+    SymmetricCipher::setBackend(SymmetricCipher::AutomaticBackend);
+}
+
 void TestSymmetricCipher::testAes128CbcEncryption()
 {
     // http://csrc.nist.gov/publications/nistpubs/800-38a/sp800-38a.pdf
@@ -236,6 +264,38 @@ void TestSymmetricCipher::testAes256CtrDecryption()
     QVERIFY(ok);
 }
 
+void TestSymmetricCipher::testAes256CtrPartialBlocks()
+{
+    QByteArray key = QByteArray::fromHex("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4");
+    QByteArray ctr = QByteArray::fromHex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff");
+    QByteArray plainText = QByteArray::fromHex("6bc1bee22e409f96e93d7e117393172a");
+    plainText.append(QByteArray::fromHex("ae2d8a571e03ac9c9eb76fac45af8e51"));
+    plainText.append(QByteArray::fromHex("30c81c46a35ce411e5fbc1191a0a52ef"));
+    plainText.append(QByteArray::fromHex("f69f2445df4f9b17ad2b417be66c3710"));
+    QByteArray cipherText = QByteArray::fromHex("601ec313775789a5b7a7f504bbf3d228");
+    cipherText.append(QByteArray::fromHex("f443e3ca4d62b59aca84e990cacaf5c5"));
+    cipherText.append(QByteArray::fromHex("2b0930daa23de94ce87017ba2d84988d"));
+    cipherText.append(QByteArray::fromHex("dfc9c58db67aada613c2dd08457941a6"));
+
+    // the key stream has to continue where the previous chunk stopped
+    SymmetricCipher cipher(SymmetricCipher::Aes256, SymmetricCipher::Ctr, SymmetricCipher::Encrypt);
+    QVERIFY(cipher.init(key, ctr));
+    QByteArray result;
+    int offset = 0;
+    for (int size : {5, 11, 1, 20, 27}) {
+        QByteArray chunk = plainText.mid(offset, size);
+        QVERIFY(cipher.processInPlace(chunk));
+        result.append(chunk);
+        offset += size;
+    }
+    QCOMPARE(result, cipherText);
+
+    QVERIFY(cipher.reset());
+    QByteArray data = plainText;
+    QVERIFY(cipher.processInPlace(data));
+    QCOMPARE(data, cipherText);
+}
+
 void TestSymmetricCipher::testTwofish256CbcEncryption()
 {
     // NIST MCT Known-Answer Tests (cbc_e_m.txt)
@@ -490,3 +550,40 @@ void TestSymmetricCipher::testStreamReset()
     writer.close();
     QCOMPARE(buffer.buffer().size(), 16);
 }
+
+void TestSymmetricCipher::benchmarkThroughput_data()
+{
+    QTest::addColumn<SymmetricCipher::Algorithm>("algorithm");
+    QTest::addColumn<SymmetricCipher::Mode>("mode");
+    QTest::addColumn<SymmetricCipher::Direction>("direction");
+
+    QTest::newRow("aes256-cbc encrypt") << SymmetricCipher::Aes256 << SymmetricCipher::Cbc << SymmetricCipher::Encrypt;
+    QTest::newRow("aes256-cbc decrypt") << SymmetricCipher::Aes256 << SymmetricCipher::Cbc << SymmetricCipher::Decrypt;
+    QTest::newRow("aes256-ctr") << SymmetricCipher::Aes256 << SymmetricCipher::Ctr << SymmetricCipher::Encrypt;
+    QTest::newRow("twofish-cbc encrypt") << SymmetricCipher::Twofish << SymmetricCipher::Cbc << SymmetricCipher::Encrypt;
+    QTest::newRow("twofish-cbc decrypt") << SymmetricCipher::Twofish << SymmetricCipher::Cbc << SymmetricCipher::Decrypt;
+    QTest::newRow("chacha20") << SymmetricCipher::ChaCha20 << SymmetricCipher::Stream << SymmetricCipher::Encrypt;
+}
+
+void TestSymmetricCipher::benchmarkThroughput()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QFETCH(SymmetricCipher::Algorithm, algorithm);
+    QFETCH(SymmetricCipher::Mode, mode);
+    QFETCH(SymmetricCipher::Direction, direction);
+
+    // roughly the payload of a large database with attachments
+    QByteArray data(16 * 1024 * 1024, '\x42');
+    SymmetricCipher cipher(algorithm, mode, direction);
+    QVERIFY(cipher.init(QByteArray(32, '\x5a'), QByteArray(SymmetricCipher::algorithmIvSize(algorithm), '\xa5')));
+
+    QBENCHMARK
+    {
+        QVERIFY(cipher.processInPlace(data));
+    };
+}
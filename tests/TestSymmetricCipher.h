@@ -26,19 +26,25 @@ class TestSymmetricCipher : public QObject
     Q_OBJECT
 
 private slots:
+    void initTestCase_data();
     void initTestCase();
+    void init();
+    void cleanup();
     void testAes128CbcEncryption();
     void testAes128CbcDecryption();
     void testAes256CbcEncryption();
     void testAes256CbcDecryption();
     void testAes256CtrEncryption();
     void testAes256CtrDecryption();
+    void testAes256CtrPartialBlocks();
     void testTwofish256CbcEncryption();
     void testTwofish256CbcDecryption();
     void testSalsa20();
     void testChaCha20();
     void testPadding();
     void testStreamReset();
+    void benchmarkThroughput_data();
+    void benchmarkThroughput();
 };
 
 #endif // KEEPASSX_TESTSYMMETRICCIPHER_H
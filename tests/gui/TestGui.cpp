@@ -108,9 +108,10 @@ void TestGui::init()
 
     QTest::keyClicks(editPassword, "a");
     QTest::keyClick(editPassword, Qt::Key_Enter);
-    Tools::wait(100);
 
-    QVERIFY(m_tabWidget->currentDatabaseWidget());
+    // the database is unlocked on a worker thread
+    QTRY_VERIFY(m_tabWidget->currentDatabaseWidget()
+                && m_tabWidget->currentDatabaseWidget()->currentMode() == DatabaseWidget::ViewMode);
 
     m_dbWidget = m_tabWidget->currentDatabaseWidget();
     m_db = m_dbWidget->database();
@@ -1055,12 +1056,58 @@ void TestGui::testDatabaseLocking()
     QTest::keyClicks(editPassword, "a");
     QTest::keyClick(editPassword, Qt::Key_Enter);
 
-    QCOMPARE(m_tabWidget->tabText(0).remove('&'), origDbName);
+    QTRY_COMPARE(m_tabWidget->tabText(0).remove('&'), origDbName);
 
     actionDatabaseMerge = m_mainWindow->findChild<QAction*>("actionDatabaseMerge", Qt::FindChildrenRecursively);
     QCOMPARE(actionDatabaseMerge->isEnabled(), true);
 }
 
+void TestGui::testUnlockDatabases()
+{
+    const int openedDatabasesCount = m_tabWidget->count();
+    QSignalSpy spyFinished(m_tabWidget, SIGNAL(databaseUnlockFinished(QString, bool)));
+
+    // a second copy of the database has the same key
+    TemporaryFile otherFile;
+    QVERIFY(otherFile.open());
+    QCOMPARE(otherFile.write(m_dbData), static_cast<qint64>(m_dbData.size()));
+    otherFile.close();
+
+    triggerAction("actionLockDatabases");
+    QCOMPARE(m_dbWidget->currentMode(), DatabaseWidget::LockedMode);
+
+    // the locked tab and a new one are read at the same time
+    m_tabWidget->unlockDatabases({m_dbFilePath, otherFile.filePath()}, "a", QString());
+    QCOMPARE(m_tabWidget->count(), openedDatabasesCount + 1);
+    QTRY_COMPARE(spyFinished.count(), 2);
+    QVERIFY(spyFinished.at(0).at(1).toBool());
+    QVERIFY(spyFinished.at(1).at(1).toBool());
+    QCOMPARE(m_dbWidget->currentMode(), DatabaseWidget::ViewMode);
+    QCOMPARE(m_tabWidget->currentDatabaseWidget()->currentMode(), DatabaseWidget::ViewMode);
+
+    // an unlocked database is reported right away
+    m_tabWidget->unlockDatabases({otherFile.filePath()}, "a", QString());
+    QCOMPARE(spyFinished.count(), 3);
+    QCOMPARE(spyFinished.at(2).at(0).toString(), QFileInfo(otherFile.filePath()).absoluteFilePath());
+    QVERIFY(spyFinished.at(2).at(1).toBool());
+
+    QVERIFY(m_tabWidget->closeDatabase(m_tabWidget->currentIndex()));
+    QCOMPARE(m_tabWidget->count(), openedDatabasesCount);
+
+    // a wrong key is reported as well
+    triggerAction("actionLockDatabases");
+    m_tabWidget->unlockDatabases({m_dbFilePath}, "b", QString());
+    QTRY_COMPARE(spyFinished.count(), 4);
+    QCOMPARE(spyFinished.at(3).at(0).toString(), QFileInfo(m_dbFilePath).absoluteFilePath());
+    QVERIFY(!spyFinished.at(3).at(1).toBool());
+    QCOMPARE(m_dbWidget->currentMode(), DatabaseWidget::LockedMode);
+
+    m_tabWidget->unlockDatabases({m_dbFilePath}, "a", QString());
+    QTRY_COMPARE(spyFinished.count(), 5);
+    QVERIFY(spyFinished.at(4).at(1).toBool());
+    m_db = m_dbWidget->database();
+}
+
 void TestGui::testDragAndDropKdbxFiles()
 {
     const int openedDatabasesCount = m_tabWidget->count();
@@ -62,6 +62,7 @@ private slots:
     void testDatabaseSettings();
     void testKeePass1Import();
     void testDatabaseLocking();
+    void testUnlockDatabases();
     void testDragAndDropKdbxFiles();
     void testTrayRestoreHide();
 
@@ -0,0 +1,337 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestGuiBrowser.h"
+#include "TestGlobal.h"
+
+#include <QAction>
+#include <QApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QTimer>
+#include <QUrl>
+#include <QUuid>
+#include <QtConcurrent>
+
+#include <sodium.h>
+
+#include "browser/BrowserAccessControlDialog.h"
+#include "browser/BrowserAction.h"
+#include "browser/BrowserEntryConfig.h"
+#include "browser/BrowserService.h"
+#include "config-keepassx-tests.h"
+#include "core/Config.h"
+#include "core/Database.h"
+#include "core/Entry.h"
+#include "core/Group.h"
+#include "core/Tools.h"
+#include "crypto/Crypto.h"
+#include "gui/DatabaseTabWidget.h"
+#include "gui/DatabaseWidget.h"
+#include "gui/FileDialog.h"
+#include "gui/MainWindow.h"
+#include "gui/MessageBox.h"
+
+static const char CLIENT_ID[] = "testclient";
+static const char ASSOCIATION_ID[] = "test";
+static const char ASSOCIATION_KEY[] = "k3FVr7x8Q4Hd1d7o8S1pU7cTgr0tQpqZKJ0I1F3bW2E=";
+
+void TestGuiBrowser::initTestCase()
+{
+    QVERIFY(Crypto::init());
+    QVERIFY(sodium_init() >= 0);
+    Config::createTempFileInstance();
+    Config::instance()->set("AutoSaveAfterEveryChange", false);
+    Config::instance()->set("Browser/BestMatchOnly", true);
+
+    m_mainWindow = new MainWindow();
+    m_tabWidget = m_mainWindow->findChild<DatabaseTabWidget*>("tabWidget");
+    m_mainWindow->show();
+    Tools::wait(50);
+
+    QFile sourceDbFile(QString(KEEPASSX_TEST_DATA_DIR).append("/NewDatabase.kdbx"));
+    QVERIFY(sourceDbFile.open(QIODevice::ReadOnly));
+    QVERIFY(Tools::readAllFromDevice(&sourceDbFile, m_dbData));
+    sourceDbFile.close();
+}
+
+// Every test starts with a fresh copy of the database, associated with the test client
+void TestGuiBrowser::init()
+{
+    QVERIFY(m_dbFile.open());
+    QCOMPARE(m_dbFile.write(m_dbData), static_cast<qint64>((m_dbData.size())));
+    m_dbFile.close();
+
+    fileDialog()->setNextFileName(m_dbFile.filePath());
+    triggerAction("actionDatabaseOpen");
+
+    QWidget* databaseOpenWidget = m_mainWindow->findChild<QWidget*>("databaseOpenWidget");
+    QLineEdit* editPassword = databaseOpenWidget->findChild<QLineEdit*>("editPassword");
+    QVERIFY(editPassword);
+
+    QTest::keyClicks(editPassword, "a");
+    QTest::keyClick(editPassword, Qt::Key_Enter);
+
+    QTRY_VERIFY(m_tabWidget->currentDatabaseWidget()
+                && m_tabWidget->currentDatabaseWidget()->currentMode() == DatabaseWidget::ViewMode);
+
+    m_dbWidget = m_tabWidget->currentDatabaseWidget();
+    m_db = m_dbWidget->database();
+
+    m_browserService.reset(new BrowserService(m_tabWidget));
+    m_browserAction.reset(new BrowserAction(*m_browserService));
+
+    m_clientPublicKey.resize(crypto_box_PUBLICKEYBYTES);
+    m_clientSecretKey.resize(crypto_box_SECRETKEYBYTES);
+    crypto_box_keypair(reinterpret_cast<unsigned char*>(m_clientPublicKey.data()),
+                       reinterpret_cast<unsigned char*>(m_clientSecretKey.data()));
+
+    QByteArray nonce(crypto_box_NONCEBYTES, '\0');
+    randombytes_buf(nonce.data(), static_cast<size_t>(nonce.size()));
+
+    QJsonObject request;
+    request["action"] = QString("change-public-keys");
+    request["publicKey"] = QString(m_clientPublicKey.toBase64());
+    request["nonce"] = QString(nonce.toBase64());
+    request["clientID"] = QString(CLIENT_ID);
+    const QJsonObject response = m_browserAction->readResponse(request);
+    m_serverPublicKey = QByteArray::fromBase64(response.value("publicKey").toString().toLatin1());
+    QCOMPARE(m_serverPublicKey.size(), static_cast<int>(crypto_box_PUBLICKEYBYTES));
+
+    Entry* config = m_browserService->getConfigEntry(true);
+    QVERIFY(config);
+    config->attributes()->set(QString(BrowserService::ASSOCIATE_KEY_PREFIX) + ASSOCIATION_ID, ASSOCIATION_KEY);
+
+    QJsonObject associate;
+    associate["id"] = QString(ASSOCIATION_ID);
+    associate["key"] = QString(ASSOCIATION_KEY);
+    QCOMPARE(sendMessage("test-associate", associate).value("success").toString(), QString("true"));
+}
+
+// Every test ends with closing the database without saving
+void TestGuiBrowser::cleanup()
+{
+    m_browserAction.reset();
+    m_browserService.reset();
+
+    MessageBox::setNextAnswer(QMessageBox::No);
+    triggerAction("actionDatabaseClose");
+    Tools::wait(100);
+
+    if (m_db) {
+        delete m_db;
+    }
+    m_db = nullptr;
+
+    if (m_dbWidget) {
+        delete m_dbWidget;
+    }
+    m_dbWidget = nullptr;
+}
+
+void TestGuiBrowser::cleanupTestCase()
+{
+    delete m_mainWindow;
+}
+
+/**
+ * The entries of every URL are ranked against that URL, as if it was the
+ * submit URL of a single request.
+ */
+void TestGuiBrowser::testGetLoginsBatch()
+{
+    addEntry("https://example.com/login", "https-user", "example.com");
+    addEntry("http://example.com", "http-user", "example.com");
+    addEntry("https://example.org", "org-user", "example.org");
+
+    const QJsonObject reply = sendMessage(
+        "get-logins",
+        getLoginsRequest({"https://example.com/login", "https://example.org", "https://unknown.example.net"}));
+
+    QCOMPARE(reply.value("success").toString(), QString("true"));
+    QCOMPARE(reply.value("count").toInt(), 2);
+
+    const QJsonObject results = reply.value("results").toObject();
+    QCOMPARE(results.size(), 2);
+    QVERIFY(!results.contains("https://unknown.example.net"));
+
+    const QJsonArray comLogins = results.value("https://example.com/login").toArray();
+    QCOMPARE(comLogins.size(), 1);
+    QCOMPARE(comLogins.first().toObject().value("login").toString(), QString("https-user"));
+
+    const QJsonArray orgLogins = results.value("https://example.org").toArray();
+    QCOMPARE(orgLogins.size(), 1);
+    QCOMPARE(orgLogins.first().toObject().value("login").toString(), QString("org-user"));
+}
+
+/**
+ * The entries of all URLs that need a confirmation are shown in one dialog.
+ */
+void TestGuiBrowser::testGetLoginsBatchConfirm()
+{
+    addEntry("https://example.com", "com-user");
+    addEntry("https://example.org", "org-user");
+
+    int dialogs = 0;
+    int items = 0;
+    QTimer timer;
+    connect(&timer, &QTimer::timeout, [&]() {
+        auto* dialog = qobject_cast<BrowserAccessControlDialog*>(QApplication::activeModalWidget());
+        if (dialog) {
+            ++dialogs;
+            items = dialog->findChild<QListWidget*>("itemsList")->count();
+            dialog->accept();
+        }
+    });
+    timer.start(50);
+
+    const QJsonObject reply =
+        sendMessage("get-logins", getLoginsRequest({"https://example.com", "https://example.org"}));
+    timer.stop();
+
+    QCOMPARE(dialogs, 1);
+    QCOMPARE(items, 2);
+
+    const QJsonObject results = reply.value("results").toObject();
+    QCOMPARE(results.size(), 2);
+    QCOMPARE(results.value("https://example.com").toArray().first().toObject().value("login").toString(),
+             QString("com-user"));
+    QCOMPARE(results.value("https://example.org").toArray().first().toObject().value("login").toString(),
+             QString("org-user"));
+}
+
+/**
+ * Workers don't read config(), they use the settings copied when the request was dispatched.
+ */
+void TestGuiBrowser::testGeneratePasswordOnWorker()
+{
+    config()->set("generator/Type", 0);
+    config()->set("generator/Length", 24);
+    m_browserService->updateRequestSettings();
+    config()->set("generator/Length", 12);
+
+    QFuture<QJsonObject> future =
+        QtConcurrent::run(this, &TestGuiBrowser::sendMessage, QString("generate-password"), QJsonObject());
+    QTRY_VERIFY(future.isFinished());
+
+    const QJsonArray entries = future.result().value("entries").toArray();
+    QCOMPARE(entries.size(), 1);
+    QCOMPARE(entries.first().toObject().value("password").toString().length(), 24);
+
+    // on the GUI thread the current settings are used
+    const QJsonArray current = sendMessage("generate-password", QJsonObject()).value("entries").toArray();
+    QCOMPARE(current.size(), 1);
+    QCOMPARE(current.first().toObject().value("password").toString().length(), 12);
+}
+
+Entry* TestGuiBrowser::addEntry(const QString& url, const QString& username, const QString& allowedHost)
+{
+    auto* entry = new Entry();
+    entry->setUuid(QUuid::createUuid());
+    entry->setTitle(QUrl(url).host());
+    entry->setUrl(url);
+    entry->setUsername(username);
+    entry->setGroup(m_db->rootGroup());
+
+    if (!allowedHost.isEmpty()) {
+        BrowserEntryConfig config;
+        config.allow(allowedHost);
+        config.save(entry);
+    }
+
+    return entry;
+}
+
+QJsonObject TestGuiBrowser::getLoginsRequest(const QStringList& urls)
+{
+    QJsonObject key;
+    key["id"] = QString(ASSOCIATION_ID);
+    key["key"] = QString(ASSOCIATION_KEY);
+    QJsonArray keys;
+    keys.append(key);
+
+    QJsonObject request;
+    request["id"] = QString(ASSOCIATION_ID);
+    request["urls"] = QJsonArray::fromStringList(urls);
+    request["keys"] = keys;
+    return request;
+}
+
+/**
+ * Send an encrypted message like the browser extension does.
+ *
+ * @return the decrypted reply, or the plain reply if it is an error
+ */
+QJsonObject TestGuiBrowser::sendMessage(const QString& action, const QJsonObject& message)
+{
+    QJsonObject payload = message;
+    payload["action"] = action;
+    const QByteArray plain = QJsonDocument(payload).toJson(QJsonDocument::Compact);
+
+    QByteArray nonce(crypto_box_NONCEBYTES, '\0');
+    randombytes_buf(nonce.data(), static_cast<size_t>(nonce.size()));
+
+    QByteArray encrypted(plain.size() + static_cast<int>(crypto_box_MACBYTES), '\0');
+    crypto_box_easy(reinterpret_cast<unsigned char*>(encrypted.data()),
+                    reinterpret_cast<const unsigned char*>(plain.constData()),
+                    static_cast<unsigned long long>(plain.size()),
+                    reinterpret_cast<const unsigned char*>(nonce.constData()),
+                    reinterpret_cast<const unsigned char*>(m_serverPublicKey.constData()),
+                    reinterpret_cast<const unsigned char*>(m_clientSecretKey.constData()));
+
+    QJsonObject request;
+    request["action"] = action;
+    request["message"] = QString(encrypted.toBase64());
+    request["nonce"] = QString(nonce.toBase64());
+    request["clientID"] = QString(CLIENT_ID);
+
+    const QJsonObject response = m_browserAction->readResponse(request);
+    if (!response.contains("message")) {
+        return response;
+    }
+
+    const QByteArray reply = QByteArray::fromBase64(response.value("message").toString().toLatin1());
+    const QByteArray replyNonce = QByteArray::fromBase64(response.value("nonce").toString().toLatin1());
+    if (reply.size() < static_cast<int>(crypto_box_MACBYTES)) {
+        return QJsonObject();
+    }
+
+    QByteArray decrypted(reply.size() - static_cast<int>(crypto_box_MACBYTES), '\0');
+    if (crypto_box_open_easy(reinterpret_cast<unsigned char*>(decrypted.data()),
+                             reinterpret_cast<const unsigned char*>(reply.constData()),
+                             static_cast<unsigned long long>(reply.size()),
+                             reinterpret_cast<const unsigned char*>(replyNonce.constData()),
+                             reinterpret_cast<const unsigned char*>(m_serverPublicKey.constData()),
+                             reinterpret_cast<const unsigned char*>(m_clientSecretKey.constData()))
+        != 0) {
+        return QJsonObject();
+    }
+
+    return QJsonDocument::fromJson(decrypted).object();
+}
+
+void TestGuiBrowser::triggerAction(const QString& name)
+{
+    QAction* action = m_mainWindow->findChild<QAction*>(name);
+    QVERIFY(action);
+    QVERIFY(action->isEnabled());
+    action->trigger();
+}
+
+QTEST_MAIN(TestGuiBrowser)
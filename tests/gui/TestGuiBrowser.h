@@ -0,0 +1,70 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_TESTGUIBROWSER_H
+#define KEEPASSX_TESTGUIBROWSER_H
+
+#include "TemporaryFile.h"
+
+#include <QJsonObject>
+#include <QObject>
+#include <QPointer>
+#include <QScopedPointer>
+#include <QStringList>
+
+class BrowserAction;
+class BrowserService;
+class Database;
+class DatabaseTabWidget;
+class DatabaseWidget;
+class Entry;
+class MainWindow;
+
+class TestGuiBrowser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void cleanupTestCase();
+
+    void testGetLoginsBatch();
+    void testGetLoginsBatchConfirm();
+    void testGeneratePasswordOnWorker();
+
+private:
+    Entry* addEntry(const QString& url, const QString& username, const QString& allowedHost = QString());
+    QJsonObject getLoginsRequest(const QStringList& urls);
+    QJsonObject sendMessage(const QString& action, const QJsonObject& message);
+    void triggerAction(const QString& name);
+
+    QPointer<MainWindow> m_mainWindow;
+    QPointer<DatabaseTabWidget> m_tabWidget;
+    QPointer<DatabaseWidget> m_dbWidget;
+    QPointer<Database> m_db;
+    QScopedPointer<BrowserService> m_browserService;
+    QScopedPointer<BrowserAction> m_browserAction;
+    QByteArray m_dbData;
+    TemporaryFile m_dbFile;
+    QByteArray m_clientPublicKey;
+    QByteArray m_clientSecretKey;
+    QByteArray m_serverPublicKey;
+};
+
+#endif // KEEPASSX_TESTGUIBROWSER_H